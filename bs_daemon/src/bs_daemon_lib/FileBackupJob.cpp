@@ -3,6 +3,9 @@
 #include "bs_daemon_lib/log.hpp"
 #include "bslib/file/FileAdder.hpp"
 
+#include <algorithm>
+#include <thread>
+
 namespace af {
 namespace bs_daemon {
 
@@ -10,7 +13,10 @@ void FileBackupJob::Run(bslib::UnitOfWork& unitOfWork)
 {
 	auto recorder = unitOfWork.CreateFileBackupRunRecorder();
 	auto backupRunId = recorder->Start();
-	auto adder = unitOfWork.CreateFileAdder(backupRunId);
+	bslib::file::FileAdderSettings settings;
+	settings.readerThreads = std::max(std::thread::hardware_concurrency(), 1U);
+	settings.streamingScan = true;
+	auto adder = unitOfWork.CreateFileAdder(backupRunId, settings);
 	adder->GetEventManager().Subscribe([](const auto& fileEvent) {
 		BS_DAEMON_LOG_DEBUG << fileEvent.action << " " << fileEvent.fullPath.ToString();
 	});
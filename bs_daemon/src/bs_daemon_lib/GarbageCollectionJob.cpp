@@ -0,0 +1,17 @@
+#include "bs_daemon_lib/GarbageCollectionJob.hpp"
+
+#include "bs_daemon_lib/log.hpp"
+
+namespace af {
+namespace bs_daemon {
+
+void GarbageCollectionJob::Run(bslib::UnitOfWork& unitOfWork)
+{
+	const auto result = unitOfWork.CollectGarbage(_settings);
+	unitOfWork.Commit();
+	BS_DAEMON_LOG_INFO << "Garbage collection reclaimed " << result.bytesReclaimed << " bytes from " << result.blobsDeleted << " blobs, "
+		<< result.blobsInGracePeriod << " unknown blobs were kept as they're within the grace period";
+}
+
+}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "bs_daemon_lib/Job.hpp"
+#include "bslib/blob/GarbageCollectionSettings.hpp"
+
+namespace af {
+namespace bs_daemon {
+
+/**
+ * Deletes blobs that are no longer needed from every store, see UnitOfWork::CollectGarbage
+ */
+class GarbageCollectionJob : public Job
+{
+public:
+	explicit GarbageCollectionJob(const bslib::blob::GarbageCollectionSettings& settings)
+		: _settings(settings)
+	{
+	}
+	virtual ~GarbageCollectionJob() { }
+	void Run(bslib::UnitOfWork& unitOfWork) override;
+private:
+	const bslib::blob::GarbageCollectionSettings _settings;
+};
+
+}
+}
@@ -1,10 +1,15 @@
 #include "bs_daemon_lib/HttpServer.hpp"
 
 #include "bs_daemon_lib/FileBackupJob.hpp"
+#include "bs_daemon_lib/GarbageCollectionJob.hpp"
 #include "bs_daemon_lib/log.hpp"
+#include "bs_daemon_lib/RebuildPathStateJob.hpp"
+#include "bs_daemon_lib/ScrubJob.hpp"
 #include "bslib/date_time.hpp"
 #include "bslib/file/FileBackupRunSearchCriteria.hpp"
 #include "bslib/file/FileEventSearchCriteria.hpp"
+#include "bslib/file/exceptions.hpp"
+#include "bslib/file/PageToken.hpp"
 
 #include <boost/algorithm/string/split.hpp>
 #include <boost/tokenizer.hpp>
@@ -156,6 +161,11 @@ RequestHandler JsonHandler(JsonRequestHandler handler)
 			const auto& jsonResponse = handler(jsonRequest);
 			SendJsonResponse(jsonResponse, response);
 		}
+		catch (const bslib::file::InvalidPageTokenException& e)
+		{
+			const auto error = HttpJsonResponse::Error(400, "Bad Request", e.what());
+			SendJsonResponse(error, response);
+		}
 		catch (std::exception& e)
 		{
 			const auto error = HttpJsonResponse::Error(500, "Internal Server Error", e.what());
@@ -246,26 +256,30 @@ nlohmann::json ToJson(const bslib::file::VirtualFile& file)
 
 struct PagingParameters
 {
-	PagingParameters(unsigned skip, unsigned pageSize)
-		: skip(skip)
+	PagingParameters(const bslib::file::PageToken& pageToken, unsigned pageSize)
+		: pageToken(pageToken)
 		, pageSize(pageSize)
 	{
 	}
 
-	const unsigned skip;
+	const bslib::file::PageToken pageToken;
 	const unsigned pageSize;
 };
 
+/**
+ * Gets the page to return, which continues from the page token of the previous page's next_page_url
+ * \exception InvalidPageTokenException The page token wasn't one that was returned
+ */
 PagingParameters GetPagingParameters(const HttpJsonRequest& request)
 {
-	unsigned skip = 0;
+	bslib::file::PageToken pageToken;
 	unsigned pageSize = 30;
 	const auto queryParameters = request.GetQueryParameters();
 	{
-		auto it = queryParameters.find("skip");
+		auto it = queryParameters.find("pageToken");
 		if (it != queryParameters.end())
 		{
-			skip = boost::lexical_cast<unsigned>(it->second);
+			pageToken = bslib::file::PageToken::FromString(it->second);
 		}
 	}
 	{
@@ -276,7 +290,23 @@ PagingParameters GetPagingParameters(const HttpJsonRequest& request)
 		}
 	}
 
-	return PagingParameters(skip, pageSize);
+	return PagingParameters(pageToken, pageSize);
+}
+
+/**
+ * Gets the URL of the page after the requested one
+ */
+network::uri MakeNextPageUrl(const network::uri& requestUri, const bslib::file::PageToken& nextPageToken, unsigned pageSize)
+{
+	network::uri_builder builder(requestUri);
+	// Work around https://github.com/cpp-netlib/uri/issues/91
+	if (requestUri.has_query())
+	{
+		builder.clear_query();
+	}
+	builder.append_query_key_value_pair("pageToken", nextPageToken.ToString());
+	builder.append_query_key_value_pair("pageSize", std::to_string(pageSize));
+	return builder.uri();
 }
 
 template<typename T, typename C = std::vector<T>>
@@ -329,6 +359,68 @@ HttpServer::HttpServer(
 		return HttpJsonResponse(202, "Accepted");
 	});
 
+	_simpleServer.resource["^/api/blobs/collectgarbage$"]["POST"] = JsonHandler([&](const HttpJsonRequest& request) {
+		bslib::blob::GarbageCollectionSettings settings;
+		const auto inputGracePeriodHours = request.content.find("gracePeriodHours");
+		if (inputGracePeriodHours != request.content.end())
+		{
+			if (!inputGracePeriodHours->is_number_unsigned())
+			{
+				return HttpJsonResponse::Error(400, "Bad Request", "gracePeriodHours must be a whole number of hours");
+			}
+			settings.gracePeriod = boost::posix_time::hours(inputGracePeriodHours->get<int>());
+		}
+		const auto inputMaxDeletesPerSecond = request.content.find("maxDeletesPerSecond");
+		if (inputMaxDeletesPerSecond != request.content.end())
+		{
+			if (!inputMaxDeletesPerSecond->is_number() || inputMaxDeletesPerSecond->get<double>() < 0)
+			{
+				return HttpJsonResponse::Error(400, "Bad Request", "maxDeletesPerSecond must be a positive number");
+			}
+			settings.maxDeletesPerSecond = inputMaxDeletesPerSecond->get<double>();
+		}
+		_jobExecutor.Queue(std::make_unique<GarbageCollectionJob>(settings));
+		return HttpJsonResponse(202, "Accepted");
+	});
+
+	_simpleServer.resource["^/api/blobs/scrub$"]["POST"] = JsonHandler([&](const HttpJsonRequest& request) {
+		bslib::blob::ScrubSettings settings;
+		const auto inputThreads = request.content.find("threads");
+		if (inputThreads != request.content.end())
+		{
+			if (!inputThreads->is_number_unsigned())
+			{
+				return HttpJsonResponse::Error(400, "Bad Request", "threads must be a whole number");
+			}
+			settings.threads = inputThreads->get<unsigned>();
+		}
+		const auto inputMaxMegabytesPerSecond = request.content.find("maxMegabytesPerSecond");
+		if (inputMaxMegabytesPerSecond != request.content.end())
+		{
+			if (!inputMaxMegabytesPerSecond->is_number() || inputMaxMegabytesPerSecond->get<double>() < 0)
+			{
+				return HttpJsonResponse::Error(400, "Bad Request", "maxMegabytesPerSecond must be a positive number");
+			}
+			settings.maxBytesPerSecond = inputMaxMegabytesPerSecond->get<double>() * 1024 * 1024;
+		}
+		const auto inputMaxBlobs = request.content.find("maxBlobs");
+		if (inputMaxBlobs != request.content.end())
+		{
+			if (!inputMaxBlobs->is_number_unsigned())
+			{
+				return HttpJsonResponse::Error(400, "Bad Request", "maxBlobs must be a whole number");
+			}
+			settings.maxBlobs = inputMaxBlobs->get<uint64_t>();
+		}
+		_jobExecutor.Queue(std::make_unique<ScrubJob>(settings));
+		return HttpJsonResponse(202, "Accepted");
+	});
+
+	_simpleServer.resource["^/api/files/rebuildpathstate$"]["POST"] = JsonHandler([&](const HttpJsonRequest& request) {
+		_jobExecutor.Queue(std::make_unique<RebuildPathStateJob>());
+		return HttpJsonResponse(202, "Accepted");
+	});
+
 	// Test API that takes JSON and deserializes it, then sends it back as JSON
 	_simpleServer.resource["^/api/ping.*"]["POST"] = JsonHandler([](const HttpJsonRequest& request) {
 		nlohmann::json responseContent(request.content);
@@ -385,10 +477,10 @@ HttpServer::HttpServer(
 
 	_simpleServer.resource[R"(^/api/files/backups(\?.*|$))"]["GET"] = JsonHandler([&](const HttpJsonRequest& request) {
 		const auto paging = GetPagingParameters(request);
-		auto uow = _backup.CreateUnitOfWork();
+		auto uow = _backup.CreateReadOnlyUnitOfWork();
 		const auto reader = uow->CreateFileBackupRunReader();
 		const bslib::file::FileBackupRunSearchCriteria criteria;
-		const auto page = reader->Search(criteria, paging.skip, paging.pageSize);
+		const auto page = reader->Search(criteria, paging.pageToken, paging.pageSize);
 		auto backupsResult = nlohmann::json::array();
 		for (const auto& backup : page.backups)
 		{
@@ -400,30 +492,18 @@ HttpServer::HttpServer(
 		result["backups"] = backupsResult;
 		result["page_size"] = paging.pageSize;
 		result["total_backups"] = page.totalBackups;
-		network::uri nextPageUrl;
-		{
-			network::uri_builder builder(request.uri);
-			// Work around https://github.com/cpp-netlib/uri/issues/91
-			if (request.uri.has_query())
-			{
-				builder.clear_query();
-			}
-			builder.append_query_key_value_pair("skip", std::to_string(page.nextPageSkip));
-			builder.append_query_key_value_pair("pageSize", std::to_string(paging.pageSize));
-			nextPageUrl = builder.uri();
-		}
-		result["next_page_url"] = nextPageUrl.string();
+		result["next_page_url"] = MakeNextPageUrl(request.uri, page.nextPageToken, paging.pageSize).string();
 		return HttpJsonResponse(200, "OK", result);
 	});
 
 	_simpleServer.resource["^/api/files/backups/([^/]*)$"]["GET"] = JsonHandler([&](const HttpJsonRequest& request) {
 		std::string match = request.originalRequest.path_match[1];
 		const bslib::Uuid runId(match);
-		auto uow = _backup.CreateUnitOfWork();
+		auto uow = _backup.CreateReadOnlyUnitOfWork();
 		const auto reader = uow->CreateFileBackupRunReader();
 		bslib::file::FileBackupRunSearchCriteria criteria;
 		criteria.runId = runId;
-		const auto page = reader->Search(criteria, 0, 1, true);
+		const auto page = reader->Search(criteria, bslib::file::PageToken(), 1, true);
 		if (page.backups.empty())
 		{
 			return HttpJsonResponse::Error(404, "Not Found", "Backup with id " + match + " not found");
@@ -437,11 +517,11 @@ HttpServer::HttpServer(
 		const auto paging = GetPagingParameters(request);
 		std::string match = request.originalRequest.path_match[1];
 		const bslib::Uuid runId(match);
-		auto uow = _backup.CreateUnitOfWork();
+		auto uow = _backup.CreateReadOnlyUnitOfWork();
 		const auto finder = uow->CreateFileFinder();
 		bslib::file::FileEventSearchCriteria criteria;
 		criteria.runId = runId;
-		const auto page = finder->SearchEvents(criteria, paging.skip, paging.pageSize);
+		const auto page = finder->SearchEvents(criteria, paging.pageToken, paging.pageSize);
 		auto fileEventsResult = nlohmann::json::array();
 		for (const auto& fileEvent : page.events)
 		{
@@ -451,23 +531,11 @@ HttpServer::HttpServer(
 		result["file_events"] = fileEventsResult;
 		result["page_size"] = paging.pageSize;
 		result["total_file_events"] = page.totalEvents;
-		network::uri nextPageUrl;
-		{
-			network::uri_builder builder(request.uri);
-			// Work around https://github.com/cpp-netlib/uri/issues/91
-			if (request.uri.has_query())
-			{
-				builder.clear_query();
-			}
-			builder.append_query_key_value_pair("skip", std::to_string(page.nextPageSkip));
-			builder.append_query_key_value_pair("pageSize", std::to_string(paging.pageSize));
-			nextPageUrl = builder.uri();
-		}
-		result["next_page_url"] = nextPageUrl.string();
+		result["next_page_url"] = MakeNextPageUrl(request.uri, page.nextPageToken, paging.pageSize).string();
 		return HttpJsonResponse(200, "OK", result);
 	});
 
-	// GET /api/files/browse/(:pathId)?at=DATE&skip=N&pageSize=M
+	// GET /api/files/browse/(:pathId)?at=DATE&pageToken=T&pageSize=M
 	_simpleServer.resource["^/api/files/browse(?:/([0-9]+))?[^/]*$"]["GET"] = JsonHandler([&](const HttpJsonRequest& request) {
 		const auto paging = GetPagingParameters(request);
 		boost::optional<boost::posix_time::ptime> at;
@@ -479,41 +547,28 @@ HttpServer::HttpServer(
 				at = bslib::FromIso8601Utc(it->second);
 			}
 		}
-		auto uow = _backup.CreateUnitOfWork();
+		auto uow = _backup.CreateReadOnlyUnitOfWork();
 		const auto browser = uow->CreateVirtualFileBrowser(at);
 		const auto pathIdMatch = request.originalRequest.path_match[1];
-		std::vector<bslib::file::VirtualFile> files;
+		bslib::file::SearchPage<bslib::file::VirtualFile> files;
 		if (!pathIdMatch.matched)
 		{
-			files = browser->ListRoots(paging.skip, paging.pageSize);
+			files = browser->ListRoots(paging.pageToken, paging.pageSize);
 		}
 		else
 		{
 			const auto pathId = boost::lexical_cast<unsigned>(pathIdMatch.str());
-			files = browser->ListContents(pathId, paging.skip, paging.pageSize);
+			files = browser->ListContents(pathId, paging.pageToken, paging.pageSize);
 		}
 		auto filesResult = nlohmann::json::array();
-		for (const auto& file : files)
+		for (const auto& file : files.results)
 		{
 			filesResult.push_back(ToJson(file));
 		}
 		nlohmann::json result;
 		result["files"] = filesResult;
 		result["page_size"] = paging.pageSize;
-		network::uri nextPageUrl;
-		{
-			network::uri_builder builder(request.uri);
-			// Work around https://github.com/cpp-netlib/uri/issues/91
-			if (request.uri.has_query())
-			{
-				builder.clear_query();
-			}
-			const auto nextPageSkip = paging.skip + std::min(static_cast<unsigned>(files.size()), paging.pageSize);
-			builder.append_query_key_value_pair("skip", std::to_string(nextPageSkip));
-			builder.append_query_key_value_pair("pageSize", std::to_string(paging.pageSize));
-			nextPageUrl = builder.uri();
-		}
-		result["next_page_url"] = nextPageUrl.string();
+		result["next_page_url"] = MakeNextPageUrl(request.uri, files.nextPageToken, paging.pageSize).string();
 		return HttpJsonResponse(200, "OK", result);
 	});
 
@@ -530,7 +585,7 @@ HttpServer::HttpServer(
 		}
 		const auto pathIdsMatch = request.originalRequest.path_match[1];
 		const auto pathIds = ParseCommaList<int64_t, std::unordered_set<int64_t>>(pathIdsMatch.str());
-		auto uow = _backup.CreateUnitOfWork();
+		auto uow = _backup.CreateReadOnlyUnitOfWork();
 		const auto browser = uow->CreateVirtualFileBrowser(at);
 		const auto counts = browser->CountNestedMatches(pathIds);
 		nlohmann::json countsResult = nlohmann::json::array();
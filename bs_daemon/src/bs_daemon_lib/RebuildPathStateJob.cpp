@@ -0,0 +1,16 @@
+#include "bs_daemon_lib/RebuildPathStateJob.hpp"
+
+#include "bs_daemon_lib/log.hpp"
+
+namespace af {
+namespace bs_daemon {
+
+void RebuildPathStateJob::Run(bslib::UnitOfWork& unitOfWork)
+{
+	const auto pathCount = unitOfWork.RebuildPathState();
+	unitOfWork.Commit();
+	BS_DAEMON_LOG_INFO << "Rebuilt the latest events of " << pathCount << " paths";
+}
+
+}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "bs_daemon_lib/Job.hpp"
+
+namespace af {
+namespace bs_daemon {
+
+/**
+ * Rebuilds the latest events and versions of every path from their history, see UnitOfWork::RebuildPathState
+ */
+class RebuildPathStateJob : public Job
+{
+public:
+	virtual ~RebuildPathStateJob() { }
+	void Run(bslib::UnitOfWork& unitOfWork) override;
+};
+
+}
+}
@@ -0,0 +1,17 @@
+#include "bs_daemon_lib/ScrubJob.hpp"
+
+#include "bs_daemon_lib/log.hpp"
+
+namespace af {
+namespace bs_daemon {
+
+void ScrubJob::Run(bslib::UnitOfWork& unitOfWork)
+{
+	const auto result = unitOfWork.ScrubBlobs(_settings);
+	unitOfWork.Commit();
+	BS_DAEMON_LOG_INFO << "Scrub checked " << result.blobsScrubbed << " blobs, " << result.blobsMissing << " were missing and "
+		<< result.blobsCorrupt << " were corrupt" << (result.complete ? "" : ", the next scrub carries on from there");
+}
+
+}
+}
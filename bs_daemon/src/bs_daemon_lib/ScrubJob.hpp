@@ -0,0 +1,26 @@
+#pragma once
+
+#include "bs_daemon_lib/Job.hpp"
+#include "bslib/blob/ScrubSettings.hpp"
+
+namespace af {
+namespace bs_daemon {
+
+/**
+ * Checks the blobs in every store for damage, see UnitOfWork::ScrubBlobs
+ */
+class ScrubJob : public Job
+{
+public:
+	explicit ScrubJob(const bslib::blob::ScrubSettings& settings)
+		: _settings(settings)
+	{
+	}
+	virtual ~ScrubJob() { }
+	void Run(bslib::UnitOfWork& unitOfWork) override;
+private:
+	const bslib::blob::ScrubSettings _settings;
+};
+
+}
+}
@@ -17,6 +17,9 @@
 
 #include <algorithm>
 #include <random>
+#include <set>
+#include <string>
+#include <vector>
 
 typedef SimpleWeb::Client<SimpleWeb::HTTP> HttpClient;
 
@@ -147,6 +150,59 @@ TEST_F(HttpServerIntegrationTest, PostFilePath_BadRequestIfMissingPath)
 	EXPECT_TRUE(json.at("error").is_string());
 }
 
+TEST_F(HttpServerIntegrationTest, PostCollectGarbage_Success)
+{
+	// Arrange
+	HttpClient client(_testAddress);
+	const auto rawContent = u8R"({"gracePeriodHours":48,"maxDeletesPerSecond":100})";
+
+	// Act
+	auto response = client.request("POST", "/api/blobs/collectgarbage", rawContent);
+
+	// Assert
+	ASSERT_EQ(response->status_code, "202 Accepted");
+}
+
+TEST_F(HttpServerIntegrationTest, PostCollectGarbage_BadRequestIfNegativeRate)
+{
+	// Arrange
+	HttpClient client(_testAddress);
+	const auto rawContent = u8R"({"maxDeletesPerSecond":-1})";
+
+	// Act
+	auto response = client.request("POST", "/api/blobs/collectgarbage", rawContent);
+
+	// Assert
+	ASSERT_EQ(response->status_code, "400 Bad Request");
+	const auto json = nlohmann::json::parse(response->content);
+	EXPECT_TRUE(json.at("error").is_string());
+}
+
+TEST_F(HttpServerIntegrationTest, PostScrub_Success)
+{
+	// Arrange
+	HttpClient client(_testAddress);
+	const auto rawContent = u8R"({"threads":2,"maxMegabytesPerSecond":50,"maxBlobs":1000})";
+
+	// Act
+	auto response = client.request("POST", "/api/blobs/scrub", rawContent);
+
+	// Assert
+	ASSERT_EQ(response->status_code, "202 Accepted");
+}
+
+TEST_F(HttpServerIntegrationTest, PostRebuildPathState_Success)
+{
+	// Arrange
+	HttpClient client(_testAddress);
+
+	// Act
+	auto response = client.request("POST", "/api/files/rebuildpathstate", "{}");
+
+	// Assert
+	ASSERT_EQ(response->status_code, "202 Accepted");
+}
+
 TEST_F(HttpServerIntegrationTest, PostStores_Success)
 {
 	// Arrange
@@ -389,6 +445,75 @@ TEST_F(HttpServerIntegrationTest, GetBackupFileEvents_Success)
 	}
 }
 
+TEST_F(HttpServerIntegrationTest, GetBackupFileEvents_FollowsNextPageUrlToLastPage)
+{
+	// Arrange
+	HttpClient client(_testAddress);
+
+	auto uow = _backup.CreateUnitOfWork();
+	auto recorder = uow->CreateFileBackupRunRecorder();
+	const auto run1 = recorder->Start();
+	auto fileAdder1 = uow->CreateFileAdder(run1);
+	for (auto i = 0; i < 5; i++)
+	{
+		const auto testFilePath = GetUniqueExtendedTempPath();
+		WriteFile(testFilePath, "hello");
+		fileAdder1->Add(testFilePath.ToExtendedString());
+	}
+	recorder->Stop(run1);
+	uow->Commit();
+
+	// Act
+	std::vector<size_t> pageSizes;
+	std::set<std::string> paths;
+	auto nextPath = "/api/files/backups/" + run1.ToString() + "/fileevents?pageSize=2";
+	while (pageSizes.size() < 10)
+	{
+		auto response = client.request("GET", nextPath);
+		ASSERT_EQ(response->status_code, "200 OK");
+		const auto responseContent = nlohmann::json::parse(response->content);
+		const auto fileEvents = responseContent.at("file_events");
+		pageSizes.push_back(fileEvents.size());
+		for (const auto& fileEvent : fileEvents)
+		{
+			paths.insert(fileEvent.at("path").get<std::string>());
+		}
+		if (fileEvents.empty())
+		{
+			break;
+		}
+
+		// The client is pretty crummy, so have to pull apart the URL :/
+		const network::uri nextUrl(responseContent.at("next_page_url").get<std::string>());
+		ASSERT_NE(std::string::npos, nextUrl.query().to_string().find("pageToken="));
+		nextPath = nextUrl.path().to_string() + "?" + nextUrl.query().to_string();
+	}
+
+	// Assert
+	EXPECT_THAT(pageSizes, ::testing::ElementsAre(2, 2, 1, 0));
+	EXPECT_EQ(5, paths.size());
+}
+
+TEST_F(HttpServerIntegrationTest, GetBackupFileEvents_BadRequestIfPageTokenMalformed)
+{
+	// Arrange
+	HttpClient client(_testAddress);
+
+	auto uow = _backup.CreateUnitOfWork();
+	auto recorder = uow->CreateFileBackupRunRecorder();
+	const auto run1 = recorder->Start();
+	recorder->Stop(run1);
+	uow->Commit();
+
+	// Act
+	auto response = client.request("GET", "/api/files/backups/" + run1.ToString() + "/fileevents?pageToken=notatoken&pageSize=2");
+
+	// Assert
+	ASSERT_EQ(response->status_code, "400 Bad Request");
+	const auto responseContent = nlohmann::json::parse(response->content);
+	EXPECT_TRUE(responseContent.at("error").is_string());
+}
+
 TEST_F(HttpServerIntegrationTest, GetFiles_Success)
 {
 	// Arrange
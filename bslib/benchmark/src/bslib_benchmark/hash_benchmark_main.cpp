@@ -0,0 +1,120 @@
+#include "bslib/blob/Blake3Hasher.hpp"
+#include "bslib/blob/Sha1Hasher.hpp"
+
+#include <boost/program_options.hpp>
+#include <boost/uuid/sha1.hpp>
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+/**
+ * Hashes the buffer a number of times on the calling thread
+ * \return GB/s
+ */
+double Measure(const std::vector<uint8_t>& buffer, unsigned iterations, const std::function<void(const std::vector<uint8_t>&)>& hash)
+{
+	// Warm up caches and the CPU's clock
+	hash(buffer);
+
+	const auto start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; ++i)
+	{
+		hash(buffer);
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return (static_cast<double>(buffer.size()) * iterations) / elapsed.count() / 1e9;
+}
+
+void Report(const std::string& name, double gigabytesPerSecond)
+{
+	std::cout << std::left << std::setw(32) << name << std::fixed << std::setprecision(2) << gigabytesPerSecond << " GB/s" << std::endl;
+}
+
+// Feeds the hasher in reads the size of the file adder's buffer
+const size_t UPDATE_SIZE_BYTES = 1024 * 1024;
+
+void Hash(af::bslib::blob::Hasher& hasher, const std::vector<uint8_t>& buffer)
+{
+	for (size_t offset = 0; offset < buffer.size(); offset += UPDATE_SIZE_BYTES)
+	{
+		hasher.Update(&buffer[offset], std::min(UPDATE_SIZE_BYTES, buffer.size() - offset));
+	}
+	uint8_t digest[af::bslib::blob::Address::MAX_DIGEST_SIZE_BYTES];
+	hasher.Finalize(digest);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	namespace po = boost::program_options;
+	using namespace af::bslib::blob;
+
+	size_t sizeMegabytes;
+	unsigned iterations;
+
+	po::options_description desc("Measures single core throughput of the address algorithms");
+	desc.add_options()
+		("help,h", "print usage message")
+		("size,s", po::value(&sizeMegabytes)->default_value(64), "Size of the buffer to hash in MiB")
+		("iterations,i", po::value(&iterations)->default_value(8), "Number of times to hash the buffer");
+
+	po::variables_map vm;
+	try
+	{
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+
+		if (vm.count("help"))
+		{
+			std::cout << desc << std::endl;
+			return 0;
+		}
+
+		po::notify(vm);
+	}
+	catch (const po::error& e)
+	{
+		std::cerr << "Error processing command line arguments: " << e.what() << std::endl;
+		return 1;
+	}
+
+	std::vector<uint8_t> buffer(sizeMegabytes * 1024 * 1024);
+	std::mt19937 generator(42);
+	for (auto& b : buffer)
+	{
+		b = static_cast<uint8_t>(generator());
+	}
+
+	Report("SHA-1 (boost, previous)", Measure(buffer, iterations, [](const std::vector<uint8_t>& content) {
+		boost::uuids::detail::sha1 sha;
+		for (size_t offset = 0; offset < content.size(); offset += UPDATE_SIZE_BYTES)
+		{
+			sha.process_bytes(&content[offset], std::min(UPDATE_SIZE_BYTES, content.size() - offset));
+		}
+		unsigned int digest[5];
+		sha.get_digest(digest);
+	}));
+
+	const auto measureHasher = [&](const std::function<std::unique_ptr<Hasher>()>& createHasher) {
+		const auto name = createHasher()->GetImplementationName();
+		Report(name, Measure(buffer, iterations, [&](const std::vector<uint8_t>& content) {
+			auto hasher = createHasher();
+			Hash(*hasher, content);
+		}));
+	};
+
+	measureHasher([]() { return std::make_unique<Sha1Hasher>(false); });
+	if (Sha1Hasher::IsHardwareAccelerationSupported())
+	{
+		measureHasher([]() { return std::make_unique<Sha1Hasher>(true); });
+	}
+	measureHasher([]() { return std::make_unique<Blake3Hasher>(); });
+
+	return 0;
+}
@@ -0,0 +1,289 @@
+#include "bslib/file/FileBackupRunEvent.hpp"
+#include "bslib/file/FileEvent.hpp"
+#include "bslib/file/FileType.hpp"
+#include "bslib/SchemaMigrations.hpp"
+#include "bslib/sqlitepp/sqlitepp.hpp"
+#include "bslib/Uuid.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace af::bslib;
+
+// Version of the schema before the covering indexes were added
+const int UNINDEXED_SCHEMA_VERSION = 2;
+
+const unsigned FILES_PER_DIRECTORY = 100;
+
+struct Catalog
+{
+	std::vector<int64_t> pathIds;
+	std::vector<Uuid::BinaryType> runIds;
+	int64_t lastEventId;
+};
+
+struct BenchmarkQuery
+{
+	std::string name;
+	std::string sql;
+
+	// Binds the parameters of one execution
+	std::function<void(sqlite3_stmt* statement, std::mt19937& generator)> bind;
+};
+
+void BindRunId(sqlite3_stmt* statement, const Uuid::BinaryType& runId)
+{
+	sqlitepp::BindByParameterNameBlob(statement, ":BackupRunId", &runId[0], runId.size());
+}
+
+/**
+ * Fills the catalog with a run per backup, in which every path is seen and a few have changed
+ */
+Catalog Populate(const sqlitepp::ScopedSqlite3Object& db, unsigned pathCount, unsigned runCount)
+{
+	Catalog catalog;
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<int> percent(0, 99);
+
+	sqlitepp::ScopedTransaction transaction(db);
+	sqlitepp::ScopedStatement addPath;
+	sqlitepp::prepare_or_throw(db, "INSERT INTO FilePath (FullPath, FileType, ParentId) VALUES (:FullPath, :FileType, :ParentId)", addPath);
+	int64_t directoryId = 0;
+	for (unsigned i = 0; i < pathCount; ++i)
+	{
+		const auto isDirectory = i % FILES_PER_DIRECTORY == 0;
+		const auto fullPath = isDirectory
+			? "C:\\dir" + std::to_string(i) + "\\"
+			: "C:\\dir" + std::to_string(i - i % FILES_PER_DIRECTORY) + "\\file" + std::to_string(i) + ".txt";
+		sqlitepp::ScopedStatementReset reset(addPath);
+		sqlitepp::BindByParameterNameText(addPath, ":FullPath", fullPath);
+		sqlitepp::BindByParameterNameInt32(addPath, ":FileType", static_cast<int32_t>(isDirectory ? file::FileType::Directory : file::FileType::RegularFile));
+		if (isDirectory)
+		{
+			sqlitepp::BindByParameterNameNull(addPath, ":ParentId");
+		}
+		else
+		{
+			sqlitepp::BindByParameterNameInt64(addPath, ":ParentId", directoryId);
+		}
+		if (sqlite3_step(addPath) != SQLITE_DONE)
+		{
+			throw std::runtime_error("Failed to add path " + fullPath);
+		}
+		const auto pathId = sqlite3_last_insert_rowid(db);
+		if (isDirectory)
+		{
+			directoryId = pathId;
+		}
+		catalog.pathIds.push_back(pathId);
+	}
+
+	sqlitepp::ScopedStatement addRunEvent;
+	sqlitepp::prepare_or_throw(db, "INSERT INTO FileBackupRunEvent (BackupRunId, DateTimeUtc, Action) VALUES (:BackupRunId, 0, :Action)", addRunEvent);
+	sqlitepp::ScopedStatement addEvent;
+	sqlitepp::prepare_or_throw(db, "INSERT INTO FileEvent (PathId, Action, BackupRunId, DateTimeUtc) VALUES (:PathId, :Action, :BackupRunId, 0)", addEvent);
+	const auto addRunAction = [&](const Uuid::BinaryType& runId, file::FileBackupRunEventAction action) {
+		sqlitepp::ScopedStatementReset reset(addRunEvent);
+		BindRunId(addRunEvent, runId);
+		sqlitepp::BindByParameterNameInt32(addRunEvent, ":Action", static_cast<int32_t>(action));
+		if (sqlite3_step(addRunEvent) != SQLITE_DONE)
+		{
+			throw std::runtime_error("Failed to add backup run event");
+		}
+	};
+
+	for (unsigned run = 0; run < runCount; ++run)
+	{
+		const auto runId = Uuid::Create().ToArray();
+		catalog.runIds.push_back(runId);
+		addRunAction(runId, file::FileBackupRunEventAction::Started);
+		for (const auto pathId : catalog.pathIds)
+		{
+			auto action = file::FileEventAction::Unchanged;
+			if (run == 0)
+			{
+				action = file::FileEventAction::ChangedAdded;
+			}
+			else if (percent(generator) < 10)
+			{
+				action = file::FileEventAction::ChangedModified;
+			}
+
+			sqlitepp::ScopedStatementReset reset(addEvent);
+			sqlitepp::BindByParameterNameInt64(addEvent, ":PathId", pathId);
+			sqlitepp::BindByParameterNameInt32(addEvent, ":Action", static_cast<int32_t>(action));
+			BindRunId(addEvent, runId);
+			if (sqlite3_step(addEvent) != SQLITE_DONE)
+			{
+				throw std::runtime_error("Failed to add file event");
+			}
+		}
+		addRunAction(runId, file::FileBackupRunEventAction::Finished);
+	}
+	catalog.lastEventId = sqlite3_last_insert_rowid(db);
+	transaction.Commit();
+	return catalog;
+}
+
+/**
+ * The queries of FileEventStreamRepository and FileBackupRunEventStreamRepository that the indexes are for
+ */
+std::vector<BenchmarkQuery> GetQueries(const Catalog& catalog)
+{
+	const auto randomPath = [&](sqlite3_stmt* statement, std::mt19937& generator) {
+		std::uniform_int_distribution<size_t> index(0, catalog.pathIds.size() - 1);
+		sqlitepp::BindByParameterNameInt64(statement, ":PathId", catalog.pathIds[index(generator)]);
+	};
+	const auto randomRun = [&](sqlite3_stmt* statement, std::mt19937& generator) {
+		std::uniform_int_distribution<size_t> index(0, catalog.runIds.size() - 1);
+		BindRunId(statement, catalog.runIds[index(generator)]);
+	};
+
+	return {
+		{ "Latest change of a path", R"(
+			SELECT MAX(Last.Id) FROM FileEvent AS Last
+			WHERE Last.PathId = :PathId AND Last.Action IN (0, 1, 2) AND Last.Id <= :LastEventId)",
+			[&catalog, randomPath](sqlite3_stmt* statement, std::mt19937& generator) {
+				randomPath(statement, generator);
+				sqlitepp::BindByParameterNameInt64(statement, ":LastEventId", catalog.lastEventId);
+			} },
+		{ "Changes of a run", R"(
+			SELECT FileEvent.BackupRunId, COUNT(FileEvent.Id), SUM(Blob.SizeBytes) FROM FileEvent
+			LEFT OUTER JOIN Blob ON FileEvent.ContentBlobAddress = Blob.Address
+			WHERE FileEvent.BackupRunId IN (:BackupRunId) AND FileEvent.Action IN (0, 1, 2)
+			GROUP BY FileEvent.BackupRunId)",
+			randomRun },
+		{ "Events of a backup run", R"(
+			SELECT Id, DateTimeUtc, BackupRunId, Action FROM FileBackupRunEvent
+			WHERE BackupRunId = :BackupRunId
+			ORDER BY Id ASC)",
+			randomRun },
+		{ "Latest backup runs", R"(
+			SELECT Id, DateTimeUtc, BackupRunId, Action FROM FileBackupRunEvent
+			WHERE BackupRunId IN (
+				SELECT BackupRunId FROM FileBackupRunEvent
+				WHERE Action = 0
+				ORDER BY Id DESC
+				LIMIT 0, 10
+			)
+			ORDER BY Id DESC)",
+			[](sqlite3_stmt*, std::mt19937&) {} },
+	};
+}
+
+void PrintPlan(const sqlitepp::ScopedSqlite3Object& db, const BenchmarkQuery& query)
+{
+	sqlitepp::ScopedStatement statement;
+	const auto sql = "EXPLAIN QUERY PLAN " + query.sql;
+	sqlitepp::prepare_or_throw(db, sql.c_str(), statement);
+	while (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		std::cout << "    " << reinterpret_cast<const char*>(sqlite3_column_text(statement, 3)) << std::endl;
+	}
+}
+
+/**
+ * Runs the query a number of times, each with different parameters
+ * \return Microseconds per query
+ */
+double Measure(const sqlitepp::ScopedSqlite3Object& db, const BenchmarkQuery& query, unsigned iterations)
+{
+	sqlitepp::ScopedStatement statement;
+	sqlitepp::prepare_or_throw(db, query.sql.c_str(), statement);
+	std::mt19937 generator(42);
+
+	const auto start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < iterations; ++i)
+	{
+		sqlitepp::ScopedStatementReset reset(statement);
+		query.bind(statement, generator);
+		while (sqlite3_step(statement) == SQLITE_ROW)
+		{
+		}
+	}
+	const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / iterations;
+}
+
+void Report(const sqlitepp::ScopedSqlite3Object& db, const std::vector<BenchmarkQuery>& queries, unsigned iterations)
+{
+	for (const auto& query : queries)
+	{
+		const auto microseconds = Measure(db, query, iterations);
+		std::cout << std::left << std::setw(32) << query.name << std::fixed << std::setprecision(1) << microseconds << " us" << std::endl;
+		PrintPlan(db, query);
+	}
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	namespace po = boost::program_options;
+
+	unsigned pathCount;
+	unsigned runCount;
+	unsigned iterations;
+
+	po::options_description desc("Shows the query plans and times of the catalog's event queries before and after upgrading its schema");
+	desc.add_options()
+		("help,h", "print usage message")
+		("paths,p", po::value(&pathCount)->default_value(10000), "Number of paths in the catalog")
+		("runs,r", po::value(&runCount)->default_value(20), "Number of backup runs, each with an event for every path")
+		("iterations,i", po::value(&iterations)->default_value(200), "Number of times to run each query");
+
+	po::variables_map vm;
+	try
+	{
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+
+		if (vm.count("help"))
+		{
+			std::cout << desc << std::endl;
+			return 0;
+		}
+
+		po::notify(vm);
+	}
+	catch (const po::error& e)
+	{
+		std::cerr << "Error processing command line arguments: " << e.what() << std::endl;
+		return 1;
+	}
+
+	const auto path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("bslib-%%%%-%%%%.db");
+	try
+	{
+		sqlitepp::ScopedSqlite3Object db;
+		sqlitepp::open_database_or_throw(path.string().c_str(), db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+		MigrateSchema(db, path.string(), UNINDEXED_SCHEMA_VERSION);
+		const auto catalog = Populate(db, pathCount, runCount);
+		const auto queries = GetQueries(catalog);
+
+		std::cout << "Schema version " << GetSchemaVersion(db) << std::endl;
+		Report(db, queries, iterations);
+
+		MigrateSchema(db, path.string());
+		std::cout << std::endl << "Schema version " << GetSchemaVersion(db) << std::endl;
+		Report(db, queries, iterations);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		boost::filesystem::remove(path);
+		return 1;
+	}
+
+	boost::filesystem::remove(path);
+	return 0;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "bslib/DatabaseSettings.hpp"
 #include "bslib/unicode.hpp"
 #include "bslib/UnitOfWork.hpp"
 
@@ -24,7 +25,11 @@ class BackupDatabase;
 class Backup
 {
 public:
-	Backup(const boost::filesystem::path& databasePath, const UTF8String& name, const blob::BlobStoreManager& blobStoreManager);
+	Backup(
+		const boost::filesystem::path& databasePath,
+		const UTF8String& name,
+		const blob::BlobStoreManager& blobStoreManager,
+		const DatabaseSettings& databaseSettings = DatabaseSettings());
 	virtual ~Backup();
 
 	/**
@@ -32,6 +37,12 @@ public:
 	 */
 	virtual std::unique_ptr<UnitOfWork> CreateUnitOfWork();
 
+	/**
+	 * Creates a unit of work for queries, such as browsing the backup, which sees the backup as of its first query
+	 * without waiting for or holding up units of work that write. Anything that writes fails.
+	 */
+	virtual std::unique_ptr<UnitOfWork> CreateReadOnlyUnitOfWork();
+
 	/**
 	 * Opens an existing database
 	 * \throws DatabaseNotFoundException The database couldn't be found
@@ -65,6 +76,7 @@ private:
 	const boost::filesystem::path _databasePath;
 	const UTF8String _name;
 	const blob::BlobStoreManager& _blobStoreManager;
+	const DatabaseSettings _databaseSettings;
 	std::unique_ptr<BackupDatabase> _backupDatabase;
 };
 
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace af {
+namespace bslib {
+
+/**
+ * How long SQLite waits for writes to reach the disk, with the catalog in WAL mode
+ */
+enum class SynchronousLevel
+{
+	// Leaves it to the OS, so commits may be lost if the machine fails
+	Off = 0,
+
+	// Syncs on checkpoints, so the last commits may be lost if the machine fails but the catalog stays consistent
+	Normal = 1,
+
+	// Syncs every commit
+	Full = 2
+};
+
+struct DatabaseSettings
+{
+	// Connections for units of work that write, such as backups, which take turns to commit
+	unsigned maxConnections = 3;
+
+	// Read only connections for units of work that only query the catalog, such as browsing it, which read the last
+	// commit without waiting for writers
+	unsigned maxReadOnlyConnections = 8;
+
+	// Pages cached by each connection
+	unsigned cacheSizeKibibytes = 16 * 1024;
+
+	// Size of the catalog each connection maps into memory rather than reading, 0 reads it
+	uint64_t mmapSizeBytes = 256 * 1024 * 1024;
+
+	SynchronousLevel synchronous = SynchronousLevel::Normal;
+
+	// Pages written to the write-ahead log before it's copied back into the catalog
+	unsigned walAutoCheckpointPages = 1000;
+
+	// How long a writer waits for another writer's commit before failing
+	std::chrono::milliseconds busyTimeout = std::chrono::milliseconds(30000);
+};
+
+}
+}
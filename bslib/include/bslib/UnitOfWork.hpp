@@ -1,9 +1,13 @@
 #pragma once
 
 #include "bslib/blob/Address.hpp"
+#include "bslib/blob/BlobView.hpp"
+#include "bslib/blob/GarbageCollectionSettings.hpp"
+#include "bslib/blob/ScrubSettings.hpp"
 #include "bslib/file/FileBackupRunReader.hpp"
 #include "bslib/file/FileBackupRunRecorder.hpp"
 #include "bslib/file/FileAdder.hpp"
+#include "bslib/file/FileAdderSettings.hpp"
 #include "bslib/file/FileFinder.hpp"
 #include "bslib/file/FileRestorer.hpp"
 #include "bslib/file/VirtualFileBrowser.hpp"
@@ -13,6 +17,8 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/optional.hpp>
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -26,7 +32,8 @@ public:
 	virtual ~UnitOfWork() { }
 
 	/**
-	 * Saves the new unit of work
+	 * Saves the new unit of work, once the blobs it created are stored durably so that nothing saved refers to a
+	 * missing blob
 	 */
 	virtual void Commit() = 0;
 
@@ -48,7 +55,7 @@ public:
 	/**
 	 * Creates a file adder for backing up files and directories.
 	 */
-	virtual std::unique_ptr<file::FileAdder> CreateFileAdder(const Uuid& backupRunId) = 0;
+	virtual std::unique_ptr<file::FileAdder> CreateFileAdder(const Uuid& backupRunId, const file::FileAdderSettings& settings = file::FileAdderSettings()) = 0;
 
 	/**
 	 * Creates a file restorer for restoring files and directories.
@@ -61,10 +68,53 @@ public:
 	virtual std::unique_ptr<file::FileFinder> CreateFileFinder() = 0;
 
 	/**
-	 * Gets a blob by address.
+	 * Gets a blob by address, content that was stored in chunks is reassembled.
 	 * \exception BlobReadException The blob with the given address couldn't be read, e.g. it doesn't exist or a permissions failure.
 	 */
 	virtual std::vector<uint8_t> GetBlob(const blob::Address& address) const = 0;
+
+	/**
+	 * Reads a blob by address a part at a time, each a view that refers to the stored blob rather than a copy of it where
+	 * the store allows. Content that was stored in chunks is visited a chunk at a time in order, so the whole of it is
+	 * never held at once, other content is visited whole.
+	 * \exception BlobReadException The blob with the given address couldn't be read, e.g. it doesn't exist or a permissions failure.
+	 */
+	virtual void ReadBlob(const blob::Address& address, const std::function<void(const blob::BlobView& part)>& visit) const = 0;
+
+	/**
+	 * Copies the blobs that a store is missing from the other stores, such as after it failed to store them or was added
+	 * later. Blobs the store already has intact, but that weren't recorded, are only recorded. Nothing is recorded until the unit
+	 * of work is committed.
+	 * \exception BlobStoreNotFoundException The store isn't one of the stores blobs are created in
+	 * \exception CreateBlobFailed A blob couldn't be stored
+	 * \return The number of blobs copied
+	 */
+	virtual uint64_t CopyMissingBlobs(const Uuid& storeId) = 0;
+
+	/**
+	 * Deletes the blobs in each store that the catalog doesn't know, other than those stored within the grace period,
+	 * and removes the blobs from the catalog that no file event refers to. Blobs are deleted from the stores straight
+	 * away, but are only removed from the catalog when the unit of work is committed, and their content is deleted by
+	 * the next collection.
+	 * \exception BlobStoreError A store couldn't list its blobs
+	 */
+	virtual blob::GarbageCollectionResult CollectGarbage(const blob::GarbageCollectionSettings& settings = blob::GarbageCollectionSettings()) = 0;
+
+	/**
+	 * Reads back the blobs each store is recorded as holding, checking they still hash to their address, carrying on
+	 * from where the last committed scrub stopped. Damaged blobs are recorded, and are stored again by copying missing
+	 * blobs to the store or by the next backup of a file with that content. The unit of work is committed after each
+	 * batch of blobs, so a scrub that's stopped keeps its progress and backups aren't held up while blobs are read.
+	 */
+	virtual blob::ScrubResult ScrubBlobs(const blob::ScrubSettings& settings = blob::ScrubSettings()) = 0;
+
+	/**
+	 * Rebuilds the latest events and versions of every path, which finding files and browsing read instead of each
+	 * path's history, from the whole history. They're otherwise kept up to date as files are backed up, so this is only
+	 * needed if they're found to be wrong. Nothing is changed until the unit of work is committed.
+	 * \return The number of paths with events
+	 */
+	virtual uint64_t RebuildPathState() = 0;
 };
 
 
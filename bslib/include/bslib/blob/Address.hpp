@@ -2,6 +2,8 @@
 
 #include <array>
 #include <cstdint>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace af {
@@ -19,15 +21,55 @@ public:
 
 typedef std::array<uint8_t, 20> binary_address;
 
+/**
+ * Hash used to calculate an address.
+ *
+ * SHA-1 addresses are encoded as just the digest, as they were before other algorithms were supported, so existing
+ * catalogs and blob stores keep working. Addresses using any other algorithm are encoded as the algorithm followed by
+ * the digest.
+ */
+enum class AddressAlgorithm : uint8_t
+{
+	Sha1 = 0,
+	Blake3 = 1
+};
+
 class Address
 {
 public:
-	Address() { }
+	/**
+	 * Largest digest of any algorithm
+	 */
+	static const size_t MAX_DIGEST_SIZE_BYTES = 32;
+
+	Address();
+
+	/**
+	 * Decodes an address from the result of ToBinary
+	 * \exception InvalidAddressException The buffer isn't an encoded address
+	 */
 	Address(const void* rawBuffer, int bufferLength);
 	explicit Address(const binary_address& address);
+
+	/**
+	 * \param digest GetDigestSize(algorithm) bytes
+	 */
+	Address(AddressAlgorithm algorithm, const uint8_t* digest);
+
+	/**
+	 * Decodes an address from the result of ToString
+	 * \exception InvalidAddressException The string isn't an encoded address
+	 */
 	explicit Address(const std::string& address);
+
+	AddressAlgorithm GetAlgorithm() const { return _algorithm; }
+
+	/**
+	 * Returns the raw digest, GetDigestSize(GetAlgorithm()) bytes long
+	 */
+	const uint8_t* GetDigest() const { return _digest.data(); }
 	std::string ToString() const;
-	binary_address ToBinary() const;
+	std::vector<uint8_t> ToBinary() const;
 	bool operator<(const Address& rhs) const;
 	bool operator==(const Address& rhs) const;
 	bool operator!=(const Address& rhs) const;
@@ -35,9 +77,19 @@ public:
 	/**
 	 * Calculates a new address based on the given binary content.
 	 */
-	static Address CalculateFromContent(const std::vector<uint8_t>& content);
+	static Address CalculateFromContent(
+		const std::vector<uint8_t>& content,
+		AddressAlgorithm algorithm = AddressAlgorithm::Sha1);
+
+	/**
+	 * \exception InvalidAddressException The algorithm isn't known
+	 */
+	static size_t GetDigestSize(AddressAlgorithm algorithm);
 private:
-	binary_address _address;
+	AddressAlgorithm _algorithm;
+
+	// Bytes after the algorithm's digest size are always zero
+	std::array<uint8_t, MAX_DIGEST_SIZE_BYTES> _digest;
 };
 
 
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "bslib/blob/Address.hpp"
+
+#include <boost/core/noncopyable.hpp>
+
+#include <cstdint>
+#include <memory>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+class Hasher;
+
+/**
+ * Incrementally calculates the address of content, so the content doesn't need to be held in memory at once.
+ */
+class AddressCalculator : private boost::noncopyable
+{
+public:
+	/**
+	 * \exception InvalidAddressException The algorithm isn't known
+	 */
+	explicit AddressCalculator(AddressAlgorithm algorithm = AddressAlgorithm::Sha1);
+	~AddressCalculator();
+
+	/**
+	 * Adds the given bytes to the content being addressed
+	 */
+	void Update(const void* data, size_t size);
+
+	/**
+	 * Returns the address of all content given so far. The calculator can't be updated after this is called.
+	 */
+	Address Finalize();
+private:
+	const AddressAlgorithm _algorithm;
+	std::unique_ptr<Hasher> _hasher;
+};
+
+}
+}
+}
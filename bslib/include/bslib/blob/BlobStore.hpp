@@ -1,13 +1,18 @@
 #pragma once
 
 #include "bslib/blob/Address.hpp"
+#include "bslib/blob/BlobView.hpp"
+#include "bslib/blob/BlobWriter.hpp"
 #include "bslib/unicode.hpp"
 #include "bslib/Uuid.hpp"
 
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/filesystem/path.hpp>
 #include <json.hpp>
 
+#include <functional>
 #include <memory>
+#include <set>
 #include <stdexcept>
 #include <vector>
 
@@ -40,6 +45,73 @@ public:
 	const boost::system::error_code ec;
 };
 
+class DeleteBlobFailed : public BlobStoreError
+{
+public:
+	explicit DeleteBlobFailed(
+		const std::string& msg,
+		const boost::filesystem::path& path,
+		boost::system::error_code ec = {})
+		: BlobStoreError(msg)
+		, path(path)
+		, ec(ec)
+	{
+	}
+
+	const boost::filesystem::path path;
+	const boost::system::error_code ec;
+};
+
+/**
+ * A blob as listed by a store
+ */
+struct StoredBlob
+{
+	Address address;
+	uint64_t sizeBytes;
+
+	// When the blob was last written to the store
+	boost::posix_time::ptime lastWriteUtc;
+};
+
+/**
+ * Counters of the blobs created through a store
+ */
+struct BlobStoreStats
+{
+	BlobStoreStats()
+		: blobsCreated(0)
+		, contentBytes(0)
+		, storedBytes(0)
+		, encodeSeconds(0)
+	{
+	}
+
+	/**
+	 * Ratio of content size to stored size, 1 if nothing has been stored
+	 */
+	double GetCompressionRatio() const
+	{
+		return storedBytes == 0 ? 1.0 : static_cast<double>(contentBytes) / static_cast<double>(storedBytes);
+	}
+
+	/**
+	 * Rate content was encoded for storage, such as by compressing it
+	 */
+	double GetEncodeMegabytesPerSecond() const
+	{
+		return encodeSeconds <= 0 ? 0.0 : static_cast<double>(contentBytes) / (1024 * 1024) / encodeSeconds;
+	}
+
+	uint64_t blobsCreated;
+
+	// Size of the content given to the store, and the size it was stored as
+	uint64_t contentBytes;
+	uint64_t storedBytes;
+
+	double encodeSeconds;
+};
+
 class BlobStore
 {
 public:
@@ -60,6 +132,12 @@ public:
 	 */
 	virtual void CreateBlob(const Address& address, const std::vector<uint8_t>& content) = 0;
 
+	/**
+	 * Creates a writer for streaming the content of a new blob, the address is given when the writer is committed.
+	 * \remarks The default implementation holds the content in memory until it's committed
+	 */
+	virtual std::unique_ptr<BlobWriter> CreateBlobWriter();
+
 	/**
 	 * Creates a new named blob. If the blob already exists, it's overwritten.
 	 */
@@ -71,10 +149,81 @@ public:
 	 */
 	virtual std::vector<uint8_t> GetBlob(const Address& address) const = 0;
 
+	/**
+	 * Gets a view of a blob by address, which stores may read in place rather than copying, such as by mapping the
+	 * file it's stored in.
+	 * \exception BlobReadException The blob with the given address couldn't be read, e.g. it doesn't exist or a permissions failure.
+	 * \remarks The default implementation holds the result of GetBlob
+	 */
+	virtual BlobView GetBlobView(const Address& address) const;
+
+	/**
+	 * Gets a view of a blob as the store holds it, rather than from a cache of it, so that reading it checks the store
+	 * \exception BlobReadException The blob with the given address couldn't be read, e.g. it doesn't exist or a permissions failure.
+	 * \remarks The default implementation is GetBlobView
+	 */
+	virtual BlobView GetStoredBlobView(const Address& address) const { return GetBlobView(address); }
+
+	/**
+	 * Finds which of the given blobs are in the store, such that a batch of blobs can be checked without reading them
+	 * \exception BlobStoreError The blobs couldn't be checked
+	 * \return The addresses of the blobs that are there
+	 * \remarks The default implementation reads each blob
+	 */
+	virtual std::set<Address> FindBlobs(const std::vector<Address>& addresses) const
+	{
+		std::set<Address> result;
+		for (const auto& address : addresses)
+		{
+			try
+			{
+				GetBlobView(address);
+				result.insert(address);
+			}
+			catch (const std::exception&)
+			{
+				// Not there, or can't be read
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * Waits until every blob created so far is stored durably, such that it survives the process or machine failing.
+	 * \exception CreateBlobFailed A blob couldn't be stored
+	 * \remarks The default implementation does nothing, for stores where blobs are durable once they're created
+	 */
+	virtual void Flush() { }
+
+	/**
+	 * Calls the given function with every blob in the store, so blobs that are no longer needed can be found and
+	 * deleted. Blobs created while the store is listed may or may not be included.
+	 * \exception BlobStoreError The blobs couldn't be listed
+	 * \return false if the store can't list or delete its blobs, in which case nothing is listed
+	 * \remarks The default implementation can't list blobs
+	 */
+	virtual bool ListBlobs(const std::function<void(const StoredBlob& blob)>& visit) const { return false; }
+
+	/**
+	 * Deletes a blob, doing nothing if it doesn't exist
+	 * \exception DeleteBlobFailed The blob couldn't be deleted
+	 * \remarks The default implementation can't delete blobs, as stores that can't list their blobs needn't
+	 */
+	virtual void DeleteBlob(const Address& address)
+	{
+		throw DeleteBlobFailed(GetTypeString() + " blob stores can't delete blobs", boost::filesystem::path());
+	}
+
 	/**
 	 * Returns the blob store settings as a property tree
 	 */
 	virtual nlohmann::json ConvertToJson() const = 0;
+
+	/**
+	 * Gets counters of the blobs created since the store was opened
+	 * \remarks The default implementation doesn't count anything
+	 */
+	virtual BlobStoreStats GetStats() const { return BlobStoreStats(); }
 };
 
 }
@@ -18,7 +18,7 @@ public:
 	explicit BlobStoreManager(const boost::filesystem::path& settingsPath);
 
 	/**
-	 * Loads blob stores from the configured settings path
+	 * Loads blob stores from the configured settings path, with the ids they were saved with
 	 */
 	void LoadFromSettingsFile();
 
@@ -34,7 +34,7 @@ public:
 	BlobStore& AddBlobStore(std::shared_ptr<BlobStore> store);
 
 	/**
-	 * Adds a blob store from a given type string and associated settings
+	 * Adds a new blob store from a given type string and associated settings, with a new id
 	 */
 	BlobStore& AddBlobStore(const UTF8String& typeString, const nlohmann::json& settings);
 
@@ -45,7 +45,7 @@ public:
 
 	const std::vector<std::shared_ptr<BlobStore>> GetStores() const;
 private:
-	BlobStore& BlobStoreManager::AddBlobStoreNoLock(const UTF8String& typeString, const nlohmann::json& settings);
+	BlobStore& AddBlobStoreNoLock(const Uuid& id, const UTF8String& typeString, const nlohmann::json& settings);
 	const boost::filesystem::path _settingsPath;
 	mutable std::mutex _mutex;
 	std::vector<std::shared_ptr<BlobStore>> _stores;
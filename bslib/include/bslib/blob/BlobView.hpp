@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+/**
+ * Read-only view of the content of a blob, that shares ownership of whatever holds it, such as a buffer or a mapping
+ * of the file it's stored in. Copies are cheap, as they refer to the same content.
+ */
+class BlobView
+{
+public:
+	/**
+	 * Creates a view of empty content
+	 */
+	BlobView();
+
+	/**
+	 * Creates a view that holds the given content
+	 */
+	explicit BlobView(std::vector<uint8_t> content);
+
+	/**
+	 * Creates a view of content held by the given owner, which is kept alive as long as any view of it is
+	 */
+	BlobView(std::shared_ptr<const void> owner, const uint8_t* data, size_t size);
+
+	const uint8_t* GetData() const { return _data; }
+	size_t GetSizeBytes() const { return _size; }
+	bool IsEmpty() const { return _size == 0; }
+
+	const uint8_t* begin() const { return _data; }
+	const uint8_t* end() const { return _data + _size; }
+
+	/**
+	 * Gets a view of part of the content, sharing its owner
+	 * \exception std::out_of_range The range isn't within the content
+	 */
+	BlobView GetRange(size_t offset, size_t size) const;
+
+	/**
+	 * Copies the content
+	 */
+	std::vector<uint8_t> ToVector() const;
+private:
+	std::shared_ptr<const void> _owner;
+	const uint8_t* _data;
+	size_t _size;
+};
+
+}
+}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "bslib/blob/Address.hpp"
+
+#include <boost/core/noncopyable.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+/**
+ * Streams the content of a new blob into a blob store before its address is known.
+ * Content that is written but never committed is discarded when the writer is destroyed.
+ */
+class BlobWriter : private boost::noncopyable
+{
+public:
+	virtual ~BlobWriter() { }
+
+	/**
+	 * Appends the given bytes to the blob
+	 * \exception CreateBlobFailed The content couldn't be written
+	 */
+	virtual void Write(const uint8_t* data, size_t size) = 0;
+
+	/**
+	 * Stores everything written so far as the blob with the given address. Nothing can be written after this is called.
+	 * \exception CreateBlobFailed The blob couldn't be stored
+	 */
+	virtual void Commit(const Address& address) = 0;
+};
+
+class BlobStore;
+
+/**
+ * Writer that keeps content in memory and creates the blob on commit, for stores that can't stream
+ */
+class BufferedBlobWriter : public BlobWriter
+{
+public:
+	explicit BufferedBlobWriter(BlobStore& blobStore);
+	void Write(const uint8_t* data, size_t size) override;
+	void Commit(const Address& address) override;
+private:
+	BlobStore& _blobStore;
+	std::vector<uint8_t> _content;
+};
+
+}
+}
+}
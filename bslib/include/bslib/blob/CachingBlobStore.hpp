@@ -0,0 +1,181 @@
+#pragma once
+
+#include "bslib/blob/BlobStore.hpp"
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+struct CachingBlobStoreSettings
+{
+	// Size of the blobs held in memory before the least recently used are evicted
+	uint64_t maxMemoryBytes = 256 * 1024 * 1024;
+
+	// Size of the blobs held on disk before the least recently used are evicted, nothing is cached on disk if 0
+	uint64_t maxDiskBytes = 0;
+
+	// Directory the disk cache is kept in, which is kept between runs
+	boost::filesystem::path diskPath;
+};
+
+/**
+ * Counters of the blobs read through a cache
+ */
+struct BlobCacheStats
+{
+	BlobCacheStats()
+		: memoryHits(0)
+		, diskHits(0)
+		, misses(0)
+		, memoryBytes(0)
+		, diskBytes(0)
+	{
+	}
+
+	uint64_t memoryHits;
+	uint64_t diskHits;
+
+	// Reads that went to the inner store
+	uint64_t misses;
+
+	// Size of the blobs currently held in each tier
+	uint64_t memoryBytes;
+	uint64_t diskBytes;
+};
+
+/**
+ * Keeps recently read blobs in memory and in a local directory, so reading the same blobs again doesn't go back to
+ * another store, such as one on a slow network share. Blobs are evicted from each tier once it's over its size, least
+ * recently read first, and as blobs never change once they're created nothing is ever invalidated.
+ * Blobs are only cached when they're read, creating blobs goes straight to the inner store.
+ * Enabled by setting "cache" in a store's settings, to an object of the settings that differ from the defaults.
+ * \remarks Thread safe if the inner store is. A blob read by several threads at once before it's cached may be read
+ * from the inner store by each of them.
+ */
+class CachingBlobStore : public BlobStore
+{
+public:
+	static const std::string SETTINGS_KEY;
+
+	/**
+	 * Blobs already in the disk cache directory are kept, up to its size
+	 */
+	CachingBlobStore(std::shared_ptr<BlobStore> inner, const CachingBlobStoreSettings& settings);
+	CachingBlobStore(std::shared_ptr<BlobStore> inner, const nlohmann::json& settings);
+
+	// Identified as the inner store, as the decorator is part of its settings
+	UTF8String GetTypeString() const override { return _inner->GetTypeString(); }
+	Uuid GetId() const override { return _inner->GetId(); }
+	void CreateBlob(const Address& address, const std::vector<uint8_t>& content) override;
+	std::unique_ptr<BlobWriter> CreateBlobWriter() override { return _inner->CreateBlobWriter(); }
+	void CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath) override;
+
+	/**
+	 * Gets a blob from the cache, reading it from the inner store and caching it if it's not there
+	 * \exception BlobReadException The blob isn't cached and couldn't be read from the inner store
+	 */
+	std::vector<uint8_t> GetBlob(const Address& address) const override;
+	BlobView GetBlobView(const Address& address) const override;
+
+	// Neither read from nor added to the cache
+	BlobView GetStoredBlobView(const Address& address) const override { return _inner->GetStoredBlobView(address); }
+	std::set<Address> FindBlobs(const std::vector<Address>& addresses) const override { return _inner->FindBlobs(addresses); }
+	void Flush() override { _inner->Flush(); }
+	bool ListBlobs(const std::function<void(const StoredBlob& blob)>& visit) const override { return _inner->ListBlobs(visit); }
+
+	/**
+	 * Deletes a blob from the inner store and the cache
+	 */
+	void DeleteBlob(const Address& address) override;
+	nlohmann::json ConvertToJson() const override;
+	BlobStoreStats GetStats() const override { return _inner->GetStats(); }
+
+	BlobCacheStats GetCacheStats() const;
+
+	static CachingBlobStoreSettings ParseSettings(const nlohmann::json& settings);
+private:
+	/**
+	 * A tier of cached blobs, the least recently used at the back
+	 */
+	template<typename T>
+	struct Tier
+	{
+		struct Entry
+		{
+			T value;
+			uint64_t sizeBytes;
+			std::list<Address>::iterator position;
+		};
+
+		std::map<Address, Entry> entries;
+		std::list<Address> recentlyUsed;
+		uint64_t sizeBytes = 0;
+	};
+
+	/**
+	 * Finds the files already in the disk cache, evicting any over its size
+	 */
+	void LoadDiskCache();
+
+	/**
+	 * Reads a blob from the disk cache, evicting it from the cache if its file can't be read
+	 */
+	bool ReadFromDisk(const Address& address, std::vector<uint8_t>& content) const;
+
+	/**
+	 * Writes a blob to the disk cache, which is best effort as the blob can always be read from the inner store
+	 */
+	void WriteToDisk(const Address& address, const BlobView& content) const;
+	void AddToMemoryNoLock(const Address& address, const BlobView& content) const;
+
+	/**
+	 * Marks the blob as the most recently used in the tier
+	 * \return false if it's not in the tier
+	 */
+	template<typename T>
+	static bool TouchNoLock(Tier<T>& tier, const Address& address);
+	template<typename T>
+	static void AddNoLock(Tier<T>& tier, const Address& address, T value, uint64_t sizeBytes);
+
+	/**
+	 * Removes a blob from the tier
+	 * \return false if it's not in the tier
+	 */
+	template<typename T>
+	static bool RemoveNoLock(Tier<T>& tier, const Address& address);
+
+	/**
+	 * Removes the least recently used blobs from the tier until it's no larger than the given size
+	 * \return The blobs removed
+	 */
+	template<typename T>
+	static std::vector<T> EvictNoLock(Tier<T>& tier, uint64_t maxSizeBytes);
+
+	boost::filesystem::path GetDiskPath(const Address& address) const;
+
+	const std::shared_ptr<BlobStore> _inner;
+	const CachingBlobStoreSettings _settings;
+
+	// Whether blobs are cached on disk, which they're not if the cache directory can't be created
+	bool _diskEnabled;
+
+	mutable std::mutex _mutex;
+	mutable Tier<BlobView> _memory;
+
+	// Path of each blob on disk
+	mutable Tier<boost::filesystem::path> _disk;
+	mutable BlobCacheStats _stats;
+};
+
+}
+}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "bslib/blob/BlobStore.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+class InvalidCompressionCodecException : public BlobStoreError
+{
+public:
+	explicit InvalidCompressionCodecException(const std::string& codec)
+		: BlobStoreError(codec + " is not a valid compression codec")
+	{
+	}
+};
+
+/**
+ * How a blob's content is encoded after its frame header
+ */
+enum class CompressionCodec : uint8_t
+{
+	None = 0,
+	Lz4 = 1,
+
+	// Content split into chunks, each compressed with LZ4 or stored as is, which is how streamed blobs are written
+	Lz4Chunks = 2
+};
+
+/**
+ * Compresses blobs before they're written to another store, and decompresses them when they're read.
+ * Each blob is framed with a header naming the codec it was stored with, so the codec can be chosen per blob: content
+ * that looks random (such as media or archives) or doesn't shrink is stored as is. Blobs written without the decorator
+ * have no header, and are read back unchanged.
+ * Enabled by setting "compression" to a codec name in a store's settings.
+ * \remarks Thread safe if the inner store is
+ */
+class CompressedBlobStore : public BlobStore
+{
+public:
+	static const std::string SETTINGS_KEY;
+
+	/**
+	 * \exception InvalidCompressionCodecException The codec isn't known
+	 */
+	CompressedBlobStore(std::shared_ptr<BlobStore> inner, const UTF8String& codec);
+
+	/**
+	 * Gets the codec with the given name, as used in settings
+	 * \exception InvalidCompressionCodecException The codec isn't known
+	 */
+	static CompressionCodec ParseCodec(const UTF8String& codec);
+	static UTF8String GetCodecName(CompressionCodec codec);
+
+	// Identified as the inner store, as the decorator is part of its settings
+	UTF8String GetTypeString() const override { return _inner->GetTypeString(); }
+	Uuid GetId() const override { return _inner->GetId(); }
+	void CreateBlob(const Address& address, const std::vector<uint8_t>& content) override;
+
+	/**
+	 * Creates a writer that compresses content a chunk at a time into a writer of the inner store, such that large
+	 * blobs aren't held in memory. Blobs that fit in a chunk are stored as CreateBlob would store them.
+	 */
+	std::unique_ptr<BlobWriter> CreateBlobWriter() override;
+
+	/**
+	 * Named blobs are stored uncompressed, so they can be used without the decorator
+	 */
+	void CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath) override;
+
+	/**
+	 * \exception BlobReadException The blob couldn't be read or decompressed
+	 */
+	std::vector<uint8_t> GetBlob(const Address& address) const override;
+
+	/**
+	 * Gets a view of a blob, which refers to the stored blob if it wasn't compressed
+	 * \exception BlobReadException The blob couldn't be read or decompressed
+	 */
+	BlobView GetBlobView(const Address& address) const override;
+	void Flush() override { _inner->Flush(); }
+	std::set<Address> FindBlobs(const std::vector<Address>& addresses) const override { return _inner->FindBlobs(addresses); }
+
+	// Blobs are listed with the size they're stored as
+	bool ListBlobs(const std::function<void(const StoredBlob& blob)>& visit) const override { return _inner->ListBlobs(visit); }
+	void DeleteBlob(const Address& address) override { _inner->DeleteBlob(address); }
+	nlohmann::json ConvertToJson() const override;
+	BlobStoreStats GetStats() const override;
+
+	/**
+	 * Encodes content for storage with the given codec, falling back to no compression if it's not worthwhile
+	 */
+	static std::vector<uint8_t> Encode(const std::vector<uint8_t>& content, CompressionCodec codec);
+
+	/**
+	 * Decodes content encoded with Encode
+	 * \return false if the content is framed but can't be decoded
+	 */
+	static bool Decode(const std::vector<uint8_t>& stored, std::vector<uint8_t>& content);
+
+	/**
+	 * Estimates the Shannon entropy of a sample of the given content, 8 bits per byte being indistinguishable from random
+	 */
+	static double EstimateEntropyBitsPerByte(const uint8_t* data, size_t size);
+private:
+	class Writer;
+
+	void AddEncoded(uint64_t contentBytes, uint64_t storedBytes, std::chrono::steady_clock::duration elapsed);
+
+	const std::shared_ptr<BlobStore> _inner;
+	const CompressionCodec _codec;
+
+	std::atomic<uint64_t> _blobsCreated;
+	std::atomic<uint64_t> _contentBytes;
+	std::atomic<uint64_t> _storedBytes;
+	std::atomic<uint64_t> _encodeMicroseconds;
+};
+
+}
+}
+}
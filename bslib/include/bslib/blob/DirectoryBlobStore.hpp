@@ -4,8 +4,13 @@
 
 #include <boost/filesystem/path.hpp>
 
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <set>
 #include <stdexcept>
 #include <string>
+#include <thread>
 
 namespace af {
 namespace bslib {
@@ -29,25 +34,110 @@ public:
 };
 
 /**
- * Manages blobs with-in a directory
+ * Manages blobs with-in a directory.
+ * Blobs are fanned out into nested directories named after the leading characters of their address, so
+ * with a depth of 2 blob abcdef... is stored as ab/cd/abcdef..., keeping directories small however many blobs
+ * there are. The layout on disk is recorded in the store, and if it doesn't match the configured depth (such as
+ * for stores written before blobs were fanned out) the blobs are moved in the background. Until that finishes
+ * blobs are written to the new layout, and read from whichever layout they're in.
+ * Views of larger blobs map their files into memory rather than reading them.
  */
 class DirectoryBlobStore : public BlobStore
 {
 public:
 	static const std::string TYPE;
-	explicit DirectoryBlobStore(const boost::filesystem::path& rootPath);
+	static const unsigned DEFAULT_FAN_OUT_DEPTH;
+	static const unsigned MAX_FAN_OUT_DEPTH;
+
+	// Records the fan out depth of the blobs on disk, stores without it are flat
+	static const std::string LAYOUT_FILENAME;
+
+	/**
+	 * \exception DirectoryBlobCreationFailed The root path couldn't be created, or the depth is above MAX_FAN_OUT_DEPTH
+	 */
+	explicit DirectoryBlobStore(const boost::filesystem::path& rootPath, unsigned fanOutDepth = DEFAULT_FAN_OUT_DEPTH);
 	DirectoryBlobStore(const Uuid& id, const nlohmann::json& settings);
+	~DirectoryBlobStore();
+
 	Uuid GetId() const override { return _id; }
 	UTF8String GetTypeString() const override { return TYPE; }
 	void CreateBlob(const Address& address, const std::vector<uint8_t>& content) override;
+	std::unique_ptr<BlobWriter> CreateBlobWriter() override;
 	void CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath) override;
 	std::vector<uint8_t> GetBlob(const Address& address) const override;
+
+	/**
+	 * Gets a view of a blob that maps its file into memory, or reads it if it's small
+	 */
+	BlobView GetBlobView(const Address& address) const override;
+
+	/**
+	 * Finds the blobs' files in whichever layout they're in, without opening them
+	 */
+	std::set<Address> FindBlobs(const std::vector<Address>& addresses) const override;
+
+	/**
+	 * Flushes the files of the blobs created since the last flush to disk
+	 */
+	void Flush() override;
+
+	/**
+	 * Lists the blobs in whichever layout they're in, named blobs and those still being written aren't listed
+	 * \exception DirectoryBlobCreationFailed The directory couldn't be listed
+	 */
+	bool ListBlobs(const std::function<void(const StoredBlob& blob)>& visit) const override;
+
+	/**
+	 * Deletes a blob from whichever layout it's in, leaving the directories it was in
+	 */
+	void DeleteBlob(const Address& address) override;
 	nlohmann::json ConvertToJson() const override;
+
+	unsigned GetFanOutDepth() const { return _fanOutDepth; }
+
+	/**
+	 * Checks if blobs are still being moved to the configured layout
+	 */
+	bool IsMigrating() const { return _migratingFromFanOutDepth >= 0; }
+
+	/**
+	 * Waits for blobs to be moved to the configured layout.
+	 * \remarks If moving fails, the migration is retried the next time the store is opened
+	 */
+	void WaitForMigration();
+
+	/**
+	 * Gets the path of a blob in the given layout
+	 */
+	static boost::filesystem::path GetBlobPath(
+		const boost::filesystem::path& rootPath,
+		const Address& address,
+		unsigned fanOutDepth);
 private:
-	explicit DirectoryBlobStore(const Uuid& id, const boost::filesystem::path& rootPath);
+	DirectoryBlobStore(const Uuid& id, const boost::filesystem::path& rootPath, unsigned fanOutDepth);
+
+	void StartMigration();
+	void Migrate();
+	void WriteLayout(unsigned fanOutDepth) const;
+	void AddUnflushed(const boost::filesystem::path& blobPath);
+
+	/**
+	 * Reads a blob from whichever layout it's in with the given function, which returns false if it can't be read
+	 * from a path
+	 */
+	bool ReadBlob(const Address& address, const std::function<bool(const boost::filesystem::path& blobPath)>& read) const;
 
 	const boost::filesystem::path _rootPath;
 	const Uuid _id;
+	const unsigned _fanOutDepth;
+
+	// Layout blobs are being moved from, or -1 if they're all in the configured layout
+	std::atomic<int> _migratingFromFanOutDepth;
+	std::atomic_bool _stopMigration;
+	std::thread _migrationThread;
+
+	std::mutex _unflushedMutex;
+	std::vector<boost::filesystem::path> _unflushedPaths;
 };
 
 }
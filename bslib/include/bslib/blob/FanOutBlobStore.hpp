@@ -0,0 +1,172 @@
+#pragma once
+
+#include "bslib/blob/BlobStore.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+/**
+ * Creates every blob in each of a number of stores at once, such as a local disk and a NAS. Content is read once and
+ * shared between a queue per store, each written by its own thread, so a backup takes as long as its slowest store
+ * rather than the sum of them.
+ * A store failing doesn't fail the backup while the blob is stored elsewhere, the blobs each store holds are reported
+ * by RecordStoredBlobs so the others can be copied to it later.
+ * A single store is written on the calling thread, as there's nothing to fan out to, so blobs created on several threads
+ * are written at once rather than one at a time by the store's thread. The threads are only started once something is
+ * queued, so a unit of work that only reads doesn't start them.
+ * \remarks Thread safe if the stores are. Blobs are read from the first store that has them.
+ */
+class FanOutBlobStore : public BlobStore
+{
+public:
+	static const std::string TYPE;
+	static const uint64_t DEFAULT_MAX_QUEUED_BYTES_PER_STORE = 64 * 1024 * 1024;
+
+	/**
+	 * Creates blobs in each of the given stores, creating a blob waits while the content queued for any store is
+	 * larger than maxQueuedBytesPerStore
+	 */
+	explicit FanOutBlobStore(
+		const std::vector<std::shared_ptr<BlobStore>>& stores,
+		uint64_t maxQueuedBytesPerStore = DEFAULT_MAX_QUEUED_BYTES_PER_STORE);
+
+	/**
+	 * Waits for queued blobs to be written, without flushing them
+	 */
+	~FanOutBlobStore();
+
+	UTF8String GetTypeString() const override { return TYPE; }
+	Uuid GetId() const override { return _id; }
+
+	/**
+	 * Queues a blob to be created in every store, waiting while any store's queue is full. A single store creates it
+	 * immediately, and its failure is thrown as there's no other store to hold the blob
+	 */
+	void CreateBlob(const Address& address, const std::vector<uint8_t>& content) override;
+
+	/**
+	 * Creates a writer that streams content to a writer in every store, or the writer of a single store
+	 */
+	std::unique_ptr<BlobWriter> CreateBlobWriter() override;
+
+	/**
+	 * Named blobs are created in every store immediately
+	 */
+	void CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath) override;
+
+	/**
+	 * Gets a blob from the first store that has it, waiting for queued blobs to be written if none do
+	 */
+	std::vector<uint8_t> GetBlob(const Address& address) const override;
+	BlobView GetBlobView(const Address& address) const override;
+
+	/**
+	 * Waits for queued blobs to be written, and flushes every store at once. A store that fails to write or flush a
+	 * blob is only logged, as long as another store has it.
+	 * \exception CreateBlobFailed A blob couldn't be stored in any store
+	 */
+	void Flush() override;
+	nlohmann::json ConvertToJson() const override;
+
+	/**
+	 * Gets the sum of the counters of every store
+	 */
+	BlobStoreStats GetStats() const override;
+
+	const std::vector<std::shared_ptr<BlobStore>>& GetStores() const { return _stores; }
+
+	/**
+	 * Calls the given function with each store and blob it has stored durably since this was last called, which is
+	 * every blob flushed that the store didn't fail to write or flush.
+	 */
+	void RecordStoredBlobs(const std::function<void(const Uuid& storeId, const Address& address)>& record);
+private:
+	class FanOutBlobWriter;
+	class SingleStoreWriter;
+
+	struct Task
+	{
+		std::function<void()> run;
+		uint64_t sizeBytes;
+	};
+
+	struct StoreQueue
+	{
+		std::shared_ptr<BlobStore> store;
+		std::deque<Task> tasks;
+		uint64_t queuedBytes = 0;
+
+		// Whether a task has been taken from the queue, and is running
+		bool running = false;
+
+		// Blobs created in the store since they were last recorded, that it failed to write or flush
+		std::set<Address> failedAddresses;
+
+		// Number of created blobs the last flush of the store covered
+		size_t flushedCount = 0;
+	};
+
+	/**
+	 * Waits until the given number of bytes can be queued for every store
+	 */
+	void WaitForSpaceNoLock(std::unique_lock<std::mutex>& lock, uint64_t sizeBytes);
+
+	/**
+	 * Queues tasks for every store, so every store runs the tasks in the same order.
+	 * \param makeTask Called with the index of each store, returns the task to queue for it
+	 */
+	void EnqueueForEachStoreNoLock(uint64_t sizeBytes, const std::function<std::function<void()>(size_t storeIndex)>& makeTask);
+	void WaitForQueuesNoLock(std::unique_lock<std::mutex>& lock) const;
+	void RecordFailure(size_t storeIndex, const Address& address, const std::string& error);
+
+	/**
+	 * Records a blob written straight to the only store, once it's written so a flush started after covers it
+	 */
+	void RecordCreated(const Address& address);
+	bool HasSingleStore() const { return _stores.size() == 1; }
+	void RunStore(size_t storeIndex);
+
+	/**
+	 * Gets a blob with the given function from the first store that has it, waiting for queued blobs to be written if
+	 * none do
+	 * \exception BlobReadException No store has the blob
+	 */
+	template<typename T>
+	T GetFromFirstStore(const Address& address, T (BlobStore::*get)(const Address& address) const) const;
+
+	const Uuid _id;
+	const std::vector<std::shared_ptr<BlobStore>> _stores;
+	const uint64_t _maxQueuedBytesPerStore;
+
+	mutable std::mutex _mutex;
+
+	// Signalled when tasks are queued, or the threads are stopping. The threads are started by the first task queued
+	std::condition_variable _queued;
+
+	// Signalled when tasks finish
+	mutable std::condition_variable _progressed;
+
+	std::vector<StoreQueue> _queues;
+
+	// Blobs created since they were last recorded, in the order they were queued
+	std::vector<Address> _createdAddresses;
+	bool _stopping;
+
+	std::vector<std::thread> _threads;
+};
+
+}
+}
+}
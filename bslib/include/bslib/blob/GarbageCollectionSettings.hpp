@@ -0,0 +1,59 @@
+#pragma once
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include <cstdint>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+struct GarbageCollectionSettings
+{
+	// blobs stored more recently than this are never deleted, as they may belong to a backup that hasn't committed yet,
+	// so it must be longer than any backup takes
+	boost::posix_time::time_duration gracePeriod = boost::posix_time::hours(24);
+
+	// blobs deleted from a store each second, to leave its I/O for other work, 0 doesn't limit deletes
+	double maxDeletesPerSecond = 0;
+};
+
+/**
+ * What a garbage collection found and reclaimed
+ */
+struct GarbageCollectionResult
+{
+	GarbageCollectionResult()
+		: catalogBlobs(0)
+		, catalogBlobsRemoved(0)
+		, storedBlobs(0)
+		, blobsDeleted(0)
+		, bytesReclaimed(0)
+		, blobsInGracePeriod(0)
+		, blobsFailedToDelete(0)
+		, storesSkipped(0)
+	{
+	}
+
+	// Blobs in the catalog when the collection started, which were all kept
+	uint64_t catalogBlobs;
+
+	// Blobs removed from the catalog as nothing refers to them, their stored content is deleted by the next collection
+	uint64_t catalogBlobsRemoved;
+
+	// Blobs found in every store, and those deleted as they weren't in the catalog
+	uint64_t storedBlobs;
+	uint64_t blobsDeleted;
+	uint64_t bytesReclaimed;
+
+	// Blobs that weren't in the catalog but were kept, as they were stored within the grace period
+	uint64_t blobsInGracePeriod;
+	uint64_t blobsFailedToDelete;
+
+	// Stores that can't list their blobs, so weren't collected
+	uint64_t storesSkipped;
+};
+
+}
+}
+}
@@ -6,6 +6,16 @@ namespace af {
 namespace bslib {
 namespace blob {
 
+/**
+ * Discards everything that's written to it
+ */
+class NullBlobWriter : public BlobWriter
+{
+public:
+	void Write(const uint8_t* data, size_t size) override { }
+	void Commit(const Address& address) override { }
+};
+
 /**
  * Null implementation of the blob store where blobs are not stored.
  */
@@ -26,6 +36,7 @@ public:
 	UTF8String GetTypeString() const override { return TYPE; }
 	Uuid GetId() const override { return _id; }
 	void CreateBlob(const Address& address, const std::vector<uint8_t>& content) override { }
+	std::unique_ptr<BlobWriter> CreateBlobWriter() override { return std::make_unique<NullBlobWriter>(); }
 	void CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath) override { }
 	std::vector<uint8_t> GetBlob(const Address& address) const override { return std::vector<uint8_t>(); }
 	nlohmann::json ConvertToJson() const override { return nlohmann::json::object(); }
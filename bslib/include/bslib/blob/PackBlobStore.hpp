@@ -0,0 +1,137 @@
+#pragma once
+
+#include "bslib/blob/BlobStore.hpp"
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+class PackBlobStoreOpenFailed : public BlobStoreError
+{
+public:
+	explicit PackBlobStoreOpenFailed(
+		const std::string& msg,
+		const boost::filesystem::path& path,
+		boost::system::error_code ec = {})
+		: BlobStoreError(msg)
+		, path(path)
+		, ec(ec)
+	{
+	}
+
+	const boost::filesystem::path path;
+	const boost::system::error_code ec;
+};
+
+/**
+ * Manages blobs appended together into pack files, rather than a file per blob, so a store of millions of small blobs
+ * isn't millions of files. Blobs are appended to the active pack until it reaches the maximum size, when it's sealed
+ * by writing a sorted index of its blobs beside it. The location of every blob is held in memory, so reading a blob
+ * is a single seek into its pack.
+ * \remarks Thread safe
+ */
+class PackBlobStore : public BlobStore
+{
+public:
+	static const std::string TYPE;
+	static const uint64_t DEFAULT_MAX_PACK_SIZE_BYTES;
+
+	/**
+	 * Opens the store at the given path, creating it if it doesn't exist
+	 * \exception PackBlobStoreOpenFailed The store's directory couldn't be created or listed
+	 * \exception CreateBlobFailed The active pack, or the index of a pack that was left unsealed, couldn't be written
+	 */
+	explicit PackBlobStore(const boost::filesystem::path& rootPath, uint64_t maxPackSizeBytes = DEFAULT_MAX_PACK_SIZE_BYTES);
+	PackBlobStore(const Uuid& id, const nlohmann::json& settings);
+	Uuid GetId() const override { return _id; }
+	UTF8String GetTypeString() const override { return TYPE; }
+
+	/**
+	 * Appends a blob to the active pack, blobs that are already stored aren't stored again
+	 */
+	void CreateBlob(const Address& address, const std::vector<uint8_t>& content) override;
+
+	/**
+	 * Creates a writer that spools content to a file beside the packs, such that large blobs aren't held in memory
+	 */
+	std::unique_ptr<BlobWriter> CreateBlobWriter() override;
+	void CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath) override;
+	std::vector<uint8_t> GetBlob(const Address& address) const override;
+
+	/**
+	 * Flushes the packs appended to since the last flush to disk, which makes every blob appended to them durable at once
+	 */
+	void Flush() override;
+	nlohmann::json ConvertToJson() const override;
+
+	uint64_t GetBlobCount() const;
+
+	/**
+	 * Gets the number of packs, including the active pack
+	 */
+	unsigned GetPackCount() const;
+private:
+	class Writer;
+
+	struct Location
+	{
+		uint32_t packNumber;
+
+		// Of the content, after the record's header
+		uint64_t offset;
+		uint64_t sizeBytes;
+	};
+
+	struct IndexEntry
+	{
+		Address address;
+		Location location;
+
+		bool operator<(const IndexEntry& rhs) const { return address < rhs.address; }
+	};
+
+	PackBlobStore(const Uuid& id, const boost::filesystem::path& rootPath, uint64_t maxPackSizeBytes);
+
+	void Open();
+	boost::filesystem::path GetPackPath(uint32_t packNumber) const;
+	boost::filesystem::path GetIndexPath(uint32_t packNumber) const;
+	bool LoadIndex(uint32_t packNumber, std::vector<IndexEntry>& entries) const;
+	void WriteIndex(uint32_t packNumber, std::vector<IndexEntry> entries) const;
+	uint64_t ScanPack(uint32_t packNumber, std::vector<IndexEntry>& entries) const;
+
+	boost::optional<Location> FindNoLock(const Address& address) const;
+	void AppendNoLock(const Address& address, uint64_t sizeBytes, const std::function<void(std::ostream&)>& writeContent);
+	void OpenActivePackNoLock();
+	void SealNoLock();
+
+	const boost::filesystem::path _rootPath;
+	const Uuid _id;
+	const uint64_t _maxPackSizeBytes;
+
+	mutable std::mutex _mutex;
+
+	// Blobs in sealed packs, sorted by address
+	std::vector<IndexEntry> _sealedIndex;
+	std::map<Address, Location> _activeIndex;
+	unsigned _sealedPackCount;
+	uint32_t _activePackNumber;
+	uint64_t _activePackSizeBytes;
+	boost::filesystem::ofstream _activePack;
+	std::set<uint32_t> _unflushedPacks;
+};
+
+}
+}
+}
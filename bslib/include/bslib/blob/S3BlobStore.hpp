@@ -0,0 +1,148 @@
+#pragma once
+
+#include "bslib/blob/BlobStore.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+struct HttpResponse;
+
+struct S3BlobStoreSettings
+{
+	// Host and port of the server, such as "localhost:9000"
+	std::string endpoint;
+	std::string bucket;
+	std::string region = "us-east-1";
+
+	// Put before the key of each blob, so a bucket can hold several stores
+	std::string prefix;
+
+	// Requests are signed with these if they're set, and are anonymous otherwise
+	std::string accessKeyId;
+	std::string secretAccessKey;
+
+	// Connections kept open to the server, which is the number of requests that can be in flight at once
+	unsigned maxConnections = 16;
+
+	// Blobs at least this large are uploaded in parts, several at once
+	uint64_t multipartThresholdBytes = 16 * 1024 * 1024;
+
+	// Size of each part but the last, which S3 requires to be at least 5 MiB
+	uint64_t partSizeBytes = 8 * 1024 * 1024;
+
+	// Longest connecting, or any one read or write of a request, can take before the request is sent again
+	std::chrono::milliseconds timeout = std::chrono::seconds(30);
+};
+
+/**
+ * Manages blobs as objects in a bucket of an S3 compatible object store, such as MinIO, keyed by their address.
+ * Requests go over a pool of connections that are kept open, and as each request waits on the network the store is
+ * meant to be written by several threads at once, so when it's opened through BlobStoreManager it's written behind on
+ * a thread per connection unless "writeBehind" is set. Large blobs are uploaded in parts on several connections at
+ * once, and checking which of a batch of blobs exist sends the checks at once.
+ * Requests are signed with AWS Signature Version 4 without signing their content, as blobs are checked against their
+ * address when they're read.
+ * \remarks Thread safe. Only plain HTTP endpoints are supported.
+ */
+class S3BlobStore : public BlobStore
+{
+public:
+	static const std::string TYPE;
+
+	explicit S3BlobStore(const S3BlobStoreSettings& settings);
+	S3BlobStore(const Uuid& id, const nlohmann::json& settings);
+	~S3BlobStore();
+
+	Uuid GetId() const override { return _id; }
+	UTF8String GetTypeString() const override { return TYPE; }
+
+	/**
+	 * Puts a blob, in parts if it's over the multipart threshold
+	 * \exception CreateBlobFailed The server refused the blob, any parts already uploaded are aborted
+	 * \exception BlobStoreError The server couldn't be reached
+	 */
+	void CreateBlob(const Address& address, const std::vector<uint8_t>& content) override;
+
+	/**
+	 * Creates a writer that holds content in memory until it reaches the multipart threshold, and then spools it to a
+	 * temporary file, as an object is keyed by an address that isn't known until commit. Spooled content is uploaded
+	 * from the file a part at a time, such that only the parts being uploaded are held in memory.
+	 */
+	std::unique_ptr<BlobWriter> CreateBlobWriter() override;
+
+	/**
+	 * Puts a file, which is read a part at a time if it's over the multipart threshold
+	 */
+	void CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath) override;
+	std::vector<uint8_t> GetBlob(const Address& address) const override;
+
+	/**
+	 * Checks the blobs exist with a request each, sent several at once
+	 * \exception BlobStoreError The server couldn't be reached, or refused a check
+	 */
+	std::set<Address> FindBlobs(const std::vector<Address>& addresses) const override;
+
+	/**
+	 * Lists the objects under the prefix that are named after an address, named blobs aren't listed
+	 */
+	bool ListBlobs(const std::function<void(const StoredBlob& blob)>& visit) const override;
+	void DeleteBlob(const Address& address) override;
+	nlohmann::json ConvertToJson() const override;
+
+	static S3BlobStoreSettings ParseSettings(const nlohmann::json& settings);
+private:
+	class Writer;
+	struct Connections;
+
+	S3BlobStore(const Uuid& id, const S3BlobStoreSettings& settings);
+
+	/**
+	 * Signs and sends a request for an object on a pooled connection, sending it again a few times if it times out
+	 * \param key Key of the object, or empty for the bucket
+	 * \exception HttpRequestTimedOut Every attempt timed out
+	 * \exception HttpRequestFailed The server couldn't be reached
+	 */
+	HttpResponse Send(
+		const std::string& method,
+		const std::string& key,
+		const std::map<std::string, std::string>& query,
+		const uint8_t* body = nullptr,
+		size_t bodySize = 0) const;
+
+	void PutObject(const std::string& key, const uint8_t* data, size_t size);
+
+	/**
+	 * Uploads an object in parts, each part's content is got with the given function, which returns it either from
+	 * existing content or having read it into the given buffer
+	 */
+	void PutObjectInParts(
+		const std::string& key,
+		uint64_t sizeBytes,
+		const std::function<const uint8_t*(uint64_t offset, size_t size, std::vector<uint8_t>& buffer)>& getPart);
+
+	/**
+	 * Runs the given function for each index on up to a thread per connection, stopping on the first failure, which
+	 * is thrown once every thread has finished
+	 */
+	void RunConcurrently(size_t count, const std::function<void(size_t index)>& run) const;
+
+	std::string GetBlobKey(const Address& address) const;
+
+	const Uuid _id;
+	const S3BlobStoreSettings _settings;
+	const std::unique_ptr<Connections> _connections;
+};
+
+}
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+/**
+ * How a stored blob was found to be damaged
+ */
+enum class BlobDamage
+{
+	// The store couldn't read the blob
+	Missing = 0,
+
+	// The blob's content doesn't hash to its address
+	Corrupt = 1
+};
+
+struct ScrubSettings
+{
+	// blobs read and hashed at once, 0 uses a thread per core
+	unsigned threads = 0;
+
+	// bytes read from the stores each second, to leave their I/O for other work, 0 doesn't limit reads
+	double maxBytesPerSecond = 0;
+
+	// blobs scrubbed before stopping, the scrub carries on from there next time, 0 scrubs every store to the end
+	uint64_t maxBlobs = 0;
+};
+
+/**
+ * What a scrub read, and the damage it found
+ */
+struct ScrubResult
+{
+	ScrubResult()
+		: blobsScrubbed(0)
+		, bytesScrubbed(0)
+		, blobsMissing(0)
+		, blobsCorrupt(0)
+		, complete(false)
+	{
+	}
+
+	uint64_t blobsScrubbed;
+	uint64_t bytesScrubbed;
+	uint64_t blobsMissing;
+	uint64_t blobsCorrupt;
+
+	// Whether every store was scrubbed to the end, in which case the next scrub starts from the beginning
+	bool complete;
+};
+
+}
+}
+}
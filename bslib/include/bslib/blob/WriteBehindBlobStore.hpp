@@ -0,0 +1,163 @@
+#pragma once
+
+#include "bslib/blob/BlobStore.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+struct WriteBehindBlobStoreSettings
+{
+	// Threads writing blobs to the inner store
+	unsigned writerThreads = 4;
+
+	// Size of the blobs that can be queued or being written before creating a blob waits for space
+	uint64_t maxInFlightBytes = 64 * 1024 * 1024;
+
+	// How often the blobs written since the last flush are flushed together
+	std::chrono::milliseconds flushInterval = std::chrono::milliseconds(100);
+};
+
+/**
+ * Creates blobs in another store on a pool of writer threads, so creating a blob returns as soon as it's queued.
+ * Blobs written since the last flush are made durable together at a regular interval, rather than one at a time, and
+ * Flush waits for every blob created before it to be written and flushed.
+ * Enabled by setting "writeBehind" in a store's settings, to an object of the settings that differ from the defaults.
+ * \remarks Thread safe if the inner store is. A blob that fails to be written is reported once, by the first flush
+ * that's asked to cover it, so a failure doesn't fail every later flush of a store that's kept open.
+ */
+class WriteBehindBlobStore : public BlobStore
+{
+public:
+	static const std::string SETTINGS_KEY;
+
+	WriteBehindBlobStore(std::shared_ptr<BlobStore> inner, const WriteBehindBlobStoreSettings& settings);
+	WriteBehindBlobStore(std::shared_ptr<BlobStore> inner, const nlohmann::json& settings);
+
+	/**
+	 * Waits for queued blobs to be written and flushed
+	 */
+	~WriteBehindBlobStore();
+
+	// Identified as the inner store, as the decorator is part of its settings
+	UTF8String GetTypeString() const override { return _inner->GetTypeString(); }
+	Uuid GetId() const override { return _inner->GetId(); }
+
+	/**
+	 * Queues a blob to be written, waiting while the queue is full. Failing to write it is reported by Flush
+	 */
+	void CreateBlob(const Address& address, const std::vector<uint8_t>& content) override;
+
+	/**
+	 * Creates a writer that streams content into a writer of the inner store on the calling thread, as queueing it
+	 * would hold it in memory. Committed blobs are flushed with the blobs queued before them.
+	 */
+	std::unique_ptr<BlobWriter> CreateBlobWriter() override;
+
+	/**
+	 * Named blobs are created immediately
+	 */
+	void CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath) override;
+
+	/**
+	 * Gets a blob, including those that are queued but not yet written
+	 */
+	std::vector<uint8_t> GetBlob(const Address& address) const override;
+	BlobView GetBlobView(const Address& address) const override;
+
+	/**
+	 * Finds blobs in the inner store, and those that are queued but not yet written
+	 */
+	std::set<Address> FindBlobs(const std::vector<Address>& addresses) const override;
+
+	/**
+	 * \exception CreateBlobFailed A blob created before the flush failed to be written, or the inner store failed to
+	 * be flushed. The failure isn't reported again by later flushes
+	 */
+	void Flush() override;
+
+	// Blobs that are queued but not yet written aren't listed
+	bool ListBlobs(const std::function<void(const StoredBlob& blob)>& visit) const override { return _inner->ListBlobs(visit); }
+	void DeleteBlob(const Address& address) override { _inner->DeleteBlob(address); }
+	nlohmann::json ConvertToJson() const override;
+	BlobStoreStats GetStats() const override { return _inner->GetStats(); }
+
+	static WriteBehindBlobStoreSettings ParseSettings(const nlohmann::json& settings);
+private:
+	class Writer;
+
+	struct PendingBlob
+	{
+		uint64_t sequence;
+		Address address;
+		std::shared_ptr<const std::vector<uint8_t>> content;
+	};
+
+	void RunWriter();
+	void RunFlusher();
+
+	/**
+	 * Gets the sequence number that every blob up to and including has been written
+	 */
+	uint64_t GetWrittenSequenceNoLock() const;
+
+	/**
+	 * Throws the first error of the blobs up to and including the sequence number, forgetting the errors of those
+	 * blobs so they're only reported once
+	 */
+	void ThrowIfFailedNoLock(uint64_t sequence);
+
+	const std::shared_ptr<BlobStore> _inner;
+	const WriteBehindBlobStoreSettings _settings;
+
+	mutable std::mutex _mutex;
+
+	// Signalled when blobs are queued, or the writers are stopping
+	std::condition_variable _queued;
+
+	// Signalled when blobs are written or flushed, or a flush fails
+	std::condition_variable _progressed;
+
+	// Signalled when a flush is requested, or the flusher is stopping
+	std::condition_variable _flushRequested;
+
+	std::deque<PendingBlob> _queue;
+
+	// Content of the blobs that are queued or being written, so they can be read
+	std::map<Address, std::shared_ptr<const std::vector<uint8_t>>> _pendingContent;
+
+	// Sequence numbers of the blobs that are queued or being written, which can finish out of order
+	std::set<uint64_t> _pendingSequences;
+	uint64_t _pendingBytes;
+	uint64_t _nextSequence;
+	uint64_t _flushedSequence;
+	bool _flushPending;
+	bool _stopWriters;
+	bool _stopFlusher;
+
+	// Errors of the blobs that failed to be written and haven't been reported, by their sequence numbers
+	std::map<uint64_t, std::exception_ptr> _writeErrors;
+
+	// Error of the last flush of the inner store if it failed, until it's reported or a later flush succeeds
+	std::exception_ptr _flushError;
+
+	std::vector<std::thread> _writers;
+	std::thread _flusher;
+};
+
+}
+}
+}
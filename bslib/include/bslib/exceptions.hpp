@@ -41,6 +41,18 @@ public:
 	}
 };
 
+/**
+ * The database was upgraded by a later version, whose schema this version can't read
+ */
+class DatabaseSchemaTooNewException : public std::runtime_error
+{
+public:
+	DatabaseSchemaTooNewException(const std::string& path, int version, int supportedVersion)
+		: std::runtime_error("Database at " + path + " has schema version " + std::to_string(version) + ", newer than version " + std::to_string(supportedVersion) + " which is the latest supported")
+	{
+	}
+};
+
 class SaveDatabaseAsFailedException : public std::runtime_error
 {
 public:
@@ -59,5 +71,14 @@ public:
 	}
 };
 
+class BlobStoreNotFoundException : public std::runtime_error
+{
+public:
+	explicit BlobStoreNotFoundException(const std::string& storeId)
+		: std::runtime_error("Blob store " + storeId + " isn't configured")
+	{
+	}
+};
+
 }
 }
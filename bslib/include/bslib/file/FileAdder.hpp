@@ -2,16 +2,19 @@
 
 #include "bslib/blob/Address.hpp"
 #include "bslib/EventManager.hpp"
+#include "bslib/file/FileAdderSettings.hpp"
 #include "bslib/file/FileEvent.hpp"
+#include "bslib/file/fs/FileStatus.hpp"
 #include "bslib/file/fs/path.hpp"
 
 #include <boost/optional.hpp>
 
 #include <functional>
+#include <istream>
 #include <vector>
 #include <map>
 #include <memory>
-#include <unordered_map>
+#include <set>
 
 namespace af {
 namespace bslib {
@@ -21,10 +24,13 @@ class BlobStore;
 }
 namespace file {
 class FileEventStreamRepository;
+class FilePathIndex;
 class FilePathRepository;
 
 /**
- * Adds files to the backup
+ * Adds files to the backup.
+ * Blobs that were found damaged in a store are stored again when a file with that content is added, including files
+ * that haven't changed since they were last added.
  */
 class FileAdder
 {
@@ -34,7 +40,10 @@ public:
 		std::shared_ptr<blob::BlobStore> blobStore,
 		blob::BlobInfoRepository& blobInfoRepository,
 		FileEventStreamRepository& fileEventStreamRepository,
-		FilePathRepository& filePathRepository);
+		FilePathRepository& filePathRepository,
+		const std::set<blob::Address>& damagedBlobAddresses = std::set<blob::Address>(),
+		const FileAdderSettings& settings = FileAdderSettings());
+	~FileAdder();
 
 	/**
 	* Adds the contents of the given file or directory to the attached backup
@@ -43,29 +52,81 @@ public:
 	*/
 	void Add(const UTF8String& sourcePath);
 
+	/**
+	 * Gets the events emitted so far, which a streaming scan doesn't keep so its memory use doesn't grow with the tree.
+	 * Subscribe to the event manager to see them instead
+	 */
 	const std::vector<FileEvent>& GetEmittedEvents() { return _emittedEvents; }
 	EventManager<FileEvent>& GetEventManager() { return _eventManager; }
 private:
-	boost::optional<blob::Address> SaveFileContents(const fs::NativePath& sourcePath);
+	/**
+	 * Amount of a file that's held in memory at once while saving its contents
+	 */
+	static const size_t READ_BUFFER_SIZE_BYTES = 1024 * 1024;
+
+	struct FileReadResult;
+	struct Pipeline;
+	typedef std::function<void(const blob::Address& address, std::vector<uint8_t>& content)> ChunkSink;
+
+	void Run(const std::function<void()>& scan);
+	void RunPipeline(const std::function<void()>& scan);
+	void QueueEvent(const FileEvent& fileEvent);
+	void QueueFile(const fs::NativePath& sourcePath, const fs::FileStatus& status, const boost::optional<FileEvent>& previousEvent);
 
-	void ScanDirectory(const fs::NativePath& sourcePath);
-	void VisitPath(const fs::NativePath& sourcePath, const boost::optional<FileEvent>& previousEvent);
-	void VisitFile(const fs::NativePath& sourcePath, const boost::optional<FileEvent>& previousEvent);
+	FileReadResult ReadFile(
+		const fs::NativePath& sourcePath,
+		const fs::FileStatus& status,
+		const boost::optional<FileEvent>& previousEvent,
+		std::vector<uint8_t>& readBuffer,
+		std::vector<uint8_t>& chunkBuffer,
+		const ChunkSink& chunkSink) const;
+	bool ReadWholeContents(std::istream& file, FileReadResult& result, std::vector<uint8_t>& readBuffer) const;
+	bool ReadChunkedContents(
+		std::istream& file,
+		FileReadResult& result,
+		std::vector<uint8_t>& readBuffer,
+		std::vector<uint8_t>& chunkBuffer,
+		const ChunkSink& chunkSink) const;
+	void SaveChunk(const blob::Address& address, std::vector<uint8_t>& content);
+	bool IsDamaged(const blob::Address& address) const;
+	void CompleteFile(const fs::NativePath& sourcePath, const boost::optional<FileEvent>& previousEvent, FileReadResult& result);
+
+	void ScanDirectory(
+		const fs::NativePath& sourcePath,
+		const fs::FileStatus& status,
+		std::map<fs::NativePath, FileEvent>& lastChangeEvents);
+	void ScanDirectorySorted(
+		const fs::NativePath& sourcePath,
+		const fs::FileStatus& status,
+		const std::function<std::unique_ptr<FileEvent>()>& nextLastChangeEvent);
+	void VisitPath(const fs::NativePath& sourcePath, const fs::FileStatus& status, const boost::optional<FileEvent>& previousEvent);
 	void VisitDirectory(const fs::NativePath& sourcePath, const boost::optional<FileEvent>& previousEvent);
 	void EmitEvent(const FileEvent& fileEvent);
 	static boost::optional<FileEvent> FindPreviousEvent(
 		const std::map<fs::NativePath, FileEvent>& fileEvents,
 		const fs::NativePath& fullPath);
 
-	std::unordered_map<fs::NativePath, std::unordered_map<FileType, int64_t>> _knownPaths;
+	std::unique_ptr<FilePathIndex> _knownPaths;
 
 	const Uuid _backupRunId;
 	std::shared_ptr<blob::BlobStore> _blobStore;
 	blob::BlobInfoRepository& _blobInfoRepository;
 	FileEventStreamRepository& _fileEventStreamRepository;
 	FilePathRepository& _filePathRepository;
+
+	// The repository is shared by the unit of work, so its batch size is put back when the adder is done with it
+	const unsigned _previousEventBatchSize;
+
+	// Blobs damaged in a store, and blobs stored in chunks that include one
+	const std::set<blob::Address> _damagedBlobAddresses;
 	std::vector<FileEvent> _emittedEvents;
 	EventManager<FileEvent> _eventManager;
+	const FileAdderSettings _settings;
+	std::vector<uint8_t> _readBuffer;
+	std::vector<uint8_t> _chunkBuffer;
+
+	// Set while a pipelined add is running
+	Pipeline* _pipeline;
 };
 
 }
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "bslib/blob/Address.hpp"
+
+#include <cstddef>
+
+namespace af {
+namespace bslib {
+namespace file {
+
+struct FileAdderSettings
+{
+	// read and hash every file, rather than trusting that files with unchanged metadata have unchanged content
+	bool paranoid = false;
+
+	// hash used for the addresses of new content, existing content keeps the address it was stored with
+	blob::AddressAlgorithm addressAlgorithm = blob::AddressAlgorithm::Sha1;
+
+	// split file contents into content-defined chunks, so only the changed parts of modified files are stored again
+	// off by default, as it changes how content is stored, and whole files are streamed into the store without buffering
+	bool contentDefinedChunking = false;
+
+	// chunks are never smaller than this, other than the end of a file
+	size_t minChunkSizeBytes = 256 * 1024;
+
+	// target chunk size, must be a power of two
+	size_t averageChunkSizeBytes = 1024 * 1024;
+
+	// chunks are always cut at this size
+	size_t maxChunkSizeBytes = 4 * 1024 * 1024;
+
+	// threads reading and hashing file contents, 0 does everything on the calling thread
+	// when non-zero the directory scan also runs on its own thread, and the blob store must support concurrent writes
+	unsigned readerThreads = 0;
+
+	// threads writing new chunks to the blob store, 0 writes them on the calling thread, only used with reader threads
+	unsigned storeWriterThreads = 2;
+
+	// events buffered before they're written to the catalog as multi-row inserts, the rest are written on commit
+	unsigned eventBatchSize = 1000;
+
+	// files and events that can be in flight between the pipeline stages before the scan waits
+	size_t pipelineDepth = 64;
+
+	// walk directories in path order and match them against the catalog as it's read, rather than loading the catalog's
+	// view of the whole tree first, so memory use grows with the depth and width of directories rather than the tree's size
+	// emitted events aren't kept either, they're only published to the adder's event manager
+	bool streamingScan = false;
+};
+
+}
+}
+}
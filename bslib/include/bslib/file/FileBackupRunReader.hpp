@@ -1,6 +1,7 @@
 #pragma once
 
 #include "bslib/file/FileBackupRunEvent.hpp"
+#include "bslib/file/PageToken.hpp"
 #include "bslib/Uuid.hpp"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -39,12 +40,11 @@ public:
 	{
 		ResultsPage()
 			: totalBackups(0)
-			, nextPageSkip(0)
 		{
 
 		}
 		unsigned totalBackups;
-		unsigned nextPageSkip;
+		PageToken nextPageToken;
 		std::vector<BackupSummary> backups;
 	};
 
@@ -53,9 +53,10 @@ public:
 		const FileEventStreamRepository& fileEventStreamRepository);
 
 	/**
-	 * Gets searches for a list of backups
+	 * Gets searches for a list of backups, most recently started first
+	 * \param pageToken Where to continue from, the next page token of the previous page
 	 */
-	ResultsPage Search(const FileBackupRunSearchCriteria& criteria, unsigned skip, unsigned pageSize, bool includeRunEvents = false) const;
+	ResultsPage Search(const FileBackupRunSearchCriteria& criteria, const PageToken& pageToken, unsigned pageSize, bool includeRunEvents = false) const;
 private:
 	const FileBackupRunEventStreamRepository& _backupRunEventRepository;
 	const FileEventStreamRepository& _fileEventStreamRepository;
@@ -2,6 +2,7 @@
 
 #include "bslib/blob/Address.hpp"
 #include "bslib/file/FileType.hpp"
+#include "bslib/file/fs/FileMetadata.hpp"
 #include "bslib/file/fs/path.hpp"
 #include "bslib/Uuid.hpp"
 
@@ -36,13 +37,15 @@ struct FileEvent
 		FileType type,
 		const boost::optional<blob::Address>& contentBlobAddress, 
 		FileEventAction action,
-		const boost::posix_time::ptime& dateTimeUtc = boost::posix_time::second_clock::universal_time())
+		const boost::posix_time::ptime& dateTimeUtc = boost::posix_time::second_clock::universal_time(),
+		const boost::optional<fs::FileMetadata>& metadata = boost::none)
 		: backupRunId(backupRunId)
 		, fullPath(fullPath)
 		, type(type)
 		, contentBlobAddress(contentBlobAddress)
 		, dateTimeUtc(dateTimeUtc)
 		, action(action)
+		, metadata(metadata)
 	{
 	}
 
@@ -60,9 +63,12 @@ struct FileEvent
 	const boost::posix_time::ptime dateTimeUtc;
 	const FileEventAction action;
 
+	// Metadata of a regular file when it was last seen with this content
+	const boost::optional<fs::FileMetadata> metadata;
+
 	bool operator==(const FileEvent& rhs) const
 	{
-		// Note this purposefully ignores dates as this is really only used for testing
+		// Note this purposefully ignores dates and metadata as this is really only used for testing
 		return backupRunId == rhs.backupRunId &&
 			fullPath == rhs.fullPath &&
 			type == rhs.type &&
@@ -94,6 +100,17 @@ struct RegularFileEvent : public FileEvent
 		: FileEvent(backupRunId, fullPath, FileType::RegularFile, contentBlobAddress, action, dateTimeUtc)
 	{
 	}
+
+	RegularFileEvent(
+		const Uuid& backupRunId,
+		const fs::NativePath& fullPath,
+		const boost::optional<blob::Address>& contentBlobAddress,
+		FileEventAction action,
+		const boost::optional<fs::FileMetadata>& metadata,
+		const boost::posix_time::ptime& dateTimeUtc = boost::posix_time::second_clock::universal_time())
+		: FileEvent(backupRunId, fullPath, FileType::RegularFile, contentBlobAddress, action, dateTimeUtc, metadata)
+	{
+	}
 };
 
 std::string ToString(FileEventAction action);
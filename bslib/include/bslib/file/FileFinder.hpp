@@ -2,6 +2,7 @@
 
 #include "bslib/file/FileEvent.hpp"
 #include "bslib/file/fs/path.hpp"
+#include "bslib/file/PageToken.hpp"
 
 #include <boost/optional.hpp>
 
@@ -28,11 +29,10 @@ public:
 	{
 		ResultsPage()
 			: totalEvents(0)
-			, nextPageSkip(0)
 		{
 		}
 		unsigned totalEvents;
-		unsigned nextPageSkip;
+		PageToken nextPageToken;
 		std::vector<FileEvent> events;
 	};
 
@@ -43,7 +43,12 @@ public:
 	boost::optional<FileEvent> FindLastChangedEventByPath(const fs::NativePath& fullPath) const;
 	std::map<fs::NativePath, FileEvent> GetLastChangedEventsUnderPath(const fs::NativePath& fullPath) const;
 	std::vector<FileEvent> GetAllEvents() const;
-	ResultsPage SearchEvents(const FileEventSearchCriteria& criteria, unsigned skip, unsigned pageSize) const;
+
+	/**
+	 * Searches for events in the order they were recorded
+	 * \param pageToken Where to continue from, the next page token of the previous page
+	 */
+	ResultsPage SearchEvents(const FileEventSearchCriteria& criteria, const PageToken& pageToken, unsigned pageSize) const;
 private:
 	const FileEventStreamRepository& _fileEventStreamRepository;
 	const FilePathRepository& _filePathRepository;
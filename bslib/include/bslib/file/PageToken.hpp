@@ -0,0 +1,62 @@
+#pragma once
+
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace file {
+
+/**
+ * Where a page of search results continues from, which is the key of the last result on the previous page. Searches
+ * resume after the key through an index rather than skipping every earlier result, so each page costs the same however
+ * deep it is, and results added while paging don't shift later pages.
+ * A token is only meaningful to the search that returned it.
+ */
+class PageToken
+{
+public:
+	/**
+	 * Token of the first page
+	 */
+	PageToken() = default;
+	explicit PageToken(int64_t lastKey)
+		: _lastKey(lastKey)
+	{
+	}
+
+	// Key of the last result of the previous page, none for the first page
+	const boost::optional<int64_t>& GetLastKey() const { return _lastKey; }
+
+	/**
+	 * Gets the token to hand to clients, which is empty for the first page
+	 */
+	std::string ToString() const;
+
+	/**
+	 * Parses a token from ToString, an empty string being the first page
+	 * \exception InvalidPageTokenException The string isn't a page token
+	 */
+	static PageToken FromString(const std::string& token);
+private:
+	boost::optional<int64_t> _lastKey;
+};
+
+/**
+ * A page of search results and the token of the page after it
+ */
+template<typename T>
+struct SearchPage
+{
+	std::vector<T> results;
+
+	// Continues after the last result, or from the same place again if the page is empty
+	PageToken nextPageToken;
+};
+
+}
+}
+}
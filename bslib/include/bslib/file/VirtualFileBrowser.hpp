@@ -1,5 +1,6 @@
 #pragma once
 
+#include "bslib/file/PageToken.hpp"
 #include "bslib/file/VirtualFile.hpp"
 
 #include <unordered_map>
@@ -22,11 +23,16 @@ class VirtualFileBrowser
 {
 public:
 	VirtualFileBrowser(FileEventStreamRepository& fileEventStreamRepository, const boost::optional<boost::posix_time::ptime>& atUtc);
-	std::vector<VirtualFile> ListRoots(unsigned skip, unsigned limit) const;
-	std::vector<VirtualFile> ListContents(int64_t pathId, unsigned skip, unsigned limit) const;
+
+	/**
+	 * Lists files, most recently added first
+	 * \param pageToken Where to continue from, the next page token of the previous page
+	 */
+	SearchPage<VirtualFile> ListRoots(const PageToken& pageToken, unsigned limit) const;
+	SearchPage<VirtualFile> ListContents(int64_t pathId, const PageToken& pageToken, unsigned limit) const;
 	std::unordered_map<int64_t, unsigned> CountNestedMatches(const std::unordered_set<int64_t>& pathIds) const;
 private:
-	std::vector<VirtualFile> List(const FilePathSearchCriteria& pathCriteria, unsigned skip, unsigned limit) const;
+	SearchPage<VirtualFile> List(const FilePathSearchCriteria& pathCriteria, const PageToken& pageToken, unsigned limit) const;
 
 	FileEventStreamRepository& _fileEventStreamRepository;
 	const boost::optional<boost::posix_time::ptime> _atUtc;
@@ -93,6 +93,18 @@ public:
 	}
 };
 
+/**
+* Page token wasn't returned by a search.
+*/
+class InvalidPageTokenException : public std::runtime_error
+{
+public:
+	explicit InvalidPageTokenException(const std::string& token)
+		: std::runtime_error("Page token " + token + " is not valid")
+	{
+	}
+};
+
 }
 }
 }
\ No newline at end of file
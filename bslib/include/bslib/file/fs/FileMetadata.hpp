@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+namespace af {
+namespace bslib {
+namespace file {
+namespace fs {
+
+/**
+ * File system properties of a file that change whenever its content is likely to have changed
+ * \remarks Times are in the platform's native resolution, they're only meant to be compared with each other
+ */
+struct FileMetadata
+{
+	uint64_t sizeBytes = 0;
+
+	// when the content was last written
+	int64_t modifiedTime = 0;
+
+	// when the content or attributes were last changed
+	int64_t changedTime = 0;
+
+	// identifies the file on its volume, this changes when a file is replaced rather than written to
+	uint64_t fileId = 0;
+
+	bool operator==(const FileMetadata& rhs) const
+	{
+		return sizeBytes == rhs.sizeBytes &&
+			modifiedTime == rhs.modifiedTime &&
+			changedTime == rhs.changedTime &&
+			fileId == rhs.fileId;
+	}
+
+	bool operator!=(const FileMetadata& rhs) const
+	{
+		return !(*this == rhs);
+	}
+};
+
+}
+}
+}
+}
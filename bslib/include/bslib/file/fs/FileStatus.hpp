@@ -0,0 +1,38 @@
+#pragma once
+
+#include "bslib/file/fs/FileMetadata.hpp"
+
+#include <boost/optional.hpp>
+
+namespace af {
+namespace bslib {
+namespace file {
+namespace fs {
+
+enum class PathType
+{
+	NotFound = 0,
+	RegularFile,
+	Directory,
+	Other
+};
+
+/**
+ * What's known about a path from a single query of the file system, such that it needn't be queried again while it's being visited
+ */
+struct FileStatus
+{
+	PathType type = PathType::NotFound;
+
+	// Not set if the query that found the path didn't provide it, e.g. a directory listing only provides the type
+	boost::optional<FileMetadata> metadata;
+
+	bool Exists() const { return type != PathType::NotFound; }
+	bool IsRegularFile() const { return type == PathType::RegularFile; }
+	bool IsDirectory() const { return type == PathType::Directory; }
+};
+
+}
+}
+}
+}
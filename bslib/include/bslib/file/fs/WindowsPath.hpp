@@ -56,6 +56,17 @@ public:
 	 */
 	std::vector<WindowsPath> GetIntermediatePaths() const;
 
+	/**
+	 * Returns the offset one past the end of the segment starting at the given offset, including any trailing separator.
+	 * Segments match the paths returned by GetIntermediatePaths(), e.g. given "\\?\C:\foo\bar.txt" the segments are "\\?\C:\", "foo\" and "bar.txt"
+	 */
+	std::size_t GetSegmentEnd(std::size_t offset) const;
+
+	/**
+	 * Returns the offset of the last segment, or 0 if the path only has one segment
+	 */
+	std::size_t GetLastSegmentOffset() const;
+
 	/**
 	 * Returns the "extended" path (with the extended prefix)
 	 */
@@ -13,10 +13,15 @@
 namespace af {
 namespace bslib {
 
-Backup::Backup(const boost::filesystem::path& databasePath, const UTF8String& name, const blob::BlobStoreManager& blobStoreManager)
+Backup::Backup(
+	const boost::filesystem::path& databasePath,
+	const UTF8String& name,
+	const blob::BlobStoreManager& blobStoreManager,
+	const DatabaseSettings& databaseSettings)
 	: _databasePath(databasePath)
 	, _name(name)
 	, _blobStoreManager(blobStoreManager)
+	, _databaseSettings(databaseSettings)
 {
 }
 
@@ -27,31 +32,40 @@ Backup::~Backup()
 
 void Backup::Open()
 {
-	_backupDatabase = std::make_unique<bslib::BackupDatabase>(_databasePath);
+	_backupDatabase = std::make_unique<bslib::BackupDatabase>(_databasePath, _databaseSettings);
 	_backupDatabase->Open();
 }
 
 void Backup::Create()
 {
-	_backupDatabase = std::make_unique<bslib::BackupDatabase>(_databasePath);
+	_backupDatabase = std::make_unique<bslib::BackupDatabase>(_databasePath, _databaseSettings);
 	_backupDatabase->Create();
 }
 
 void Backup::OpenOrCreate()
 {
-	_backupDatabase = std::make_unique<bslib::BackupDatabase>(_databasePath);
+	_backupDatabase = std::make_unique<bslib::BackupDatabase>(_databasePath, _databaseSettings);
 	_backupDatabase->OpenOrCreate();
 }
 
 std::unique_ptr<UnitOfWork> Backup::CreateUnitOfWork()
 {
-	// TODO: add support for multiple stores
 	const auto stores = _blobStoreManager.GetStores();
 	if (stores.empty())
 	{
 		throw NoBlobStoresConfiguredException("At least one blob store is required before working with the backup");
 	}
-	return _backupDatabase->CreateUnitOfWork(*(stores.begin()));
+	return _backupDatabase->CreateUnitOfWork(stores);
+}
+
+std::unique_ptr<UnitOfWork> Backup::CreateReadOnlyUnitOfWork()
+{
+	const auto stores = _blobStoreManager.GetStores();
+	if (stores.empty())
+	{
+		throw NoBlobStoresConfiguredException("At least one blob store is required before working with the backup");
+	}
+	return _backupDatabase->CreateReadOnlyUnitOfWork(stores);
 }
 
 void Backup::SaveDatabaseCopy()
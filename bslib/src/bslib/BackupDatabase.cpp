@@ -1,8 +1,10 @@
 #include "bslib/BackupDatabase.hpp"
 
 #include "bslib/exceptions.hpp"
+#include "bslib/SchemaMigrations.hpp"
 #include "bslib/sqlitepp/sqlitepp.hpp"
 #include "bslib/BackupDatabaseUnitOfWork.hpp"
+#include "bslib/log.hpp"
 
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
@@ -10,23 +12,90 @@
 namespace af {
 namespace bslib {
 
-BackupDatabase::BackupDatabase(const boost::filesystem::path& databasePath)
+namespace {
+// Blobs are never updated in place and the change count only ever increases, so together they tell whether any have
+// been added or removed since, even by another process
+void GetBlobTableState(const sqlitepp::ScopedSqlite3Object& db, uint64_t& blobCount, int64_t& blobChangeCount)
+{
+	sqlitepp::ScopedStatement statement;
+	sqlitepp::prepare_or_throw(db, "SELECT (SELECT COUNT(*) FROM Blob), ChangeCount FROM BlobChangeCount", statement);
+	const auto stepResult = sqlite3_step(statement);
+	if (stepResult != SQLITE_ROW)
+	{
+		throw ExecuteFailedException(stepResult);
+	}
+	blobCount = static_cast<uint64_t>(sqlite3_column_int64(statement, 0));
+	blobChangeCount = sqlite3_column_int64(statement, 1);
+}
+
+// Readers see the last commit rather than waiting for a writer to finish, which is kept in the database file so
+// every later connection uses it
+void EnableWriteAheadLog(const sqlitepp::ScopedSqlite3Object& db)
+{
+	sqlitepp::ScopedStatement statement;
+	sqlitepp::prepare_or_throw(db, "PRAGMA journal_mode = WAL", statement);
+	const auto stepResult = sqlite3_step(statement);
+	if (stepResult != SQLITE_ROW)
+	{
+		throw ExecuteFailedException(stepResult);
+	}
+
+	// Such as on file systems without shared memory, readers then wait for writers as they did before
+	const std::string journalMode(reinterpret_cast<const char*>(sqlite3_column_text(statement, 0)));
+	if (journalMode != "wal")
+	{
+		BSLIB_LOG_WARNING << "Failed to switch the backup database to WAL mode, using journal mode " << journalMode;
+	}
+}
+}
+
+BackupDatabase::BackupDatabase(const boost::filesystem::path& databasePath, const DatabaseSettings& settings)
 	: _databasePath(databasePath)
-	, _connections(3, [&]() { return Connect(); })
+	, _settings(settings)
+	, _connections(settings.maxConnections, [&]() { return Connect(false); })
+	, _readOnlyConnections(settings.maxReadOnlyConnections, [&]() { return Connect(true); })
 {
 }
 
 BackupDatabase::~BackupDatabase()
 {
 	// Needed to delete incomplete types
+	try
+	{
+		SaveBlobAddressFilter();
+	}
+	catch (const std::exception& e)
+	{
+		// Not fatal, the filter is rebuilt next time the database is opened
+		BSLIB_LOG_WARNING << "Failed to save blob address filter: " << e.what();
+	}
 }
 
-std::unique_ptr<BackupDatabaseConnection> BackupDatabase::Connect()
+std::unique_ptr<BackupDatabaseConnection> BackupDatabase::Connect(bool readOnly)
 {
 	auto connection = std::make_unique<sqlitepp::ScopedSqlite3Object>();
-	sqlitepp::open_database_or_throw(_databasePath.string().c_str(), *connection, SQLITE_OPEN_READWRITE);
+	sqlitepp::open_database_or_throw(_databasePath.string().c_str(), *connection, readOnly ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE);
 	sqlitepp::exec_or_throw(*connection, "PRAGMA case_sensitive_like = true;");
-	return std::make_unique<BackupDatabaseConnection>(std::move(connection));
+
+	// A negative cache size is in KiB rather than pages
+	const auto pragmas = (boost::format(
+		"PRAGMA cache_size = -%1%;"
+		"PRAGMA mmap_size = %2%;"
+		"PRAGMA busy_timeout = %3%;")
+		% _settings.cacheSizeKibibytes
+		% _settings.mmapSizeBytes
+		% _settings.busyTimeout.count()).str();
+	sqlitepp::exec_or_throw(*connection, pragmas.c_str());
+	if (!readOnly)
+	{
+		const auto writerPragmas = (boost::format(
+			"PRAGMA synchronous = %1%;"
+			"PRAGMA wal_autocheckpoint = %2%;")
+			% static_cast<int>(_settings.synchronous)
+			% _settings.walAutoCheckpointPages).str();
+		sqlitepp::exec_or_throw(*connection, writerPragmas.c_str());
+	}
+	return std::make_unique<BackupDatabaseConnection>(std::move(connection), _blobAddressFilter);
 }
 
 void BackupDatabase::Open()
@@ -36,9 +105,81 @@ void BackupDatabase::Open()
 		throw DatabaseNotFoundException(_databasePath.string());
 	}
 
+	{
+		sqlitepp::ScopedSqlite3Object db;
+		sqlitepp::open_database_or_throw(_databasePath.string().c_str(), db, SQLITE_OPEN_READWRITE);
+		EnableWriteAheadLog(db);
+		MigrateSchema(db, _databasePath.string());
+	}
+
+	// Connections share the filter, so it must be loaded before any are made
+	LoadBlobAddressFilter();
 	_connections.AddOne();
 }
 
+boost::filesystem::path BackupDatabase::GetBlobAddressFilterPath() const
+{
+	auto path = _databasePath;
+	path += ".blobfilter";
+	return path;
+}
+
+void BackupDatabase::LoadBlobAddressFilter()
+{
+	sqlitepp::ScopedSqlite3Object db;
+	sqlitepp::open_database_or_throw(_databasePath.string().c_str(), db, SQLITE_OPEN_READONLY);
+
+	uint64_t blobCount;
+	int64_t blobChangeCount;
+	GetBlobTableState(db, blobCount, blobChangeCount);
+	auto filter = blob::BlobAddressFilter::Load(GetBlobAddressFilterPath(), blobCount, blobChangeCount);
+	if (filter)
+	{
+		_blobAddressFilter = std::move(filter);
+		return;
+	}
+
+	// Leave room for the blobs of the next few backups before the filter has to add a layer
+	BSLIB_LOG_DEBUG << "Rebuilding blob address filter for " << blobCount << " blobs";
+	_blobAddressFilter = std::make_shared<blob::BlobAddressFilter>(blobCount * 2);
+	sqlitepp::ScopedStatement statement;
+	sqlitepp::prepare_or_throw(db, "SELECT Address FROM Blob", statement);
+	while (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		const auto addressBytesCount = sqlite3_column_bytes(statement, 0);
+		const auto addressBytes = sqlite3_column_blob(statement, 0);
+		_blobAddressFilter->Add(blob::Address(addressBytes, addressBytesCount));
+	}
+}
+
+void BackupDatabase::SaveBlobAddressFilter() const
+{
+	if (!_blobAddressFilter)
+	{
+		return;
+	}
+
+	const auto stats = _blobAddressFilter->GetStats();
+	BSLIB_LOG_DEBUG << "Blob address filter answered " << stats.lookups << " lookups with a false positive rate of " << stats.GetFalsePositiveRate();
+
+	sqlitepp::ScopedSqlite3Object db;
+	sqlitepp::open_database_or_throw(_databasePath.string().c_str(), db, SQLITE_OPEN_READONLY);
+
+	uint64_t blobCount;
+	int64_t blobChangeCount;
+	GetBlobTableState(db, blobCount, blobChangeCount);
+	_blobAddressFilter->Save(GetBlobAddressFilterPath(), blobCount, blobChangeCount);
+}
+
+blob::BlobAddressFilterStats BackupDatabase::GetBlobAddressFilterStats() const
+{
+	if (!_blobAddressFilter)
+	{
+		return blob::BlobAddressFilterStats();
+	}
+	return _blobAddressFilter->GetStats();
+}
+
 void BackupDatabase::Create()
 {
 	{
@@ -54,42 +195,7 @@ void BackupDatabase::Create()
 			throw CreateDatabaseFailedException(_databasePath.string(), result);
 		}
 
-		// Create tables
-		// Note that SQLite supports blobs as primary keys fine, see https://www.sqlite.org/cvstrac/wiki?p=KeyValueDatabase
-		const auto sql = R"(
-			CREATE TABLE Blob (
-				Address BLOB (20) PRIMARY KEY,
-				SizeBytes INTEGER (8) NOT NULL
-			);
-			CREATE TABLE FileEvent (
-				Id INTEGER PRIMARY KEY AUTOINCREMENT,
-				PathId INTEGER NOT NULL REFERENCES FilePath (Id),
-				ContentBlobAddress BLOB(20) REFERENCES Blob (Address),
-				Action INTEGER NOT NULL,
-				BackupRunId BLOB(16) NOT NULL,
-				DateTimeUtc INTEGER NOT NULL
-			);
-			CREATE TABLE FileBackupRunEvent (
-				Id INTEGER PRIMARY KEY AUTOINCREMENT,
-				BackupRunId BLOB(16) NOT NULL,
-				DateTimeUtc INTEGER NOT NULL,
-				Action INTEGER NOT NULL
-			);
-			CREATE TABLE FilePath (
-				Id INTEGER PRIMARY KEY,
-				FullPath TEXT NOT NULL COLLATE BINARY,
-				FileType INTEGER NOT NULL,
-				ParentId INTEGER NULL REFERENCES FilePath (Id),
-				UNIQUE (FullPath, FileType)
-			);
-		)";
-
-		sqlitepp::ScopedErrorMessage errorMessage;
-		const auto execResult = sqlite3_exec(db, sql, 0, 0, errorMessage);
-		if (execResult != SQLITE_OK)
-		{
-			throw CreateDatabaseFailedException(_databasePath.string(), execResult, errorMessage);
-		}
+		MigrateSchema(db, _databasePath.string());
 	}
 
 	Open();
@@ -105,10 +211,16 @@ void BackupDatabase::OpenOrCreate()
 	Create();
 }
 
-std::unique_ptr<UnitOfWork> BackupDatabase::CreateUnitOfWork(std::shared_ptr<blob::BlobStore> blobStore)
+std::unique_ptr<UnitOfWork> BackupDatabase::CreateUnitOfWork(const std::vector<std::shared_ptr<blob::BlobStore>>& blobStores)
 {
 	auto pooledConnection = _connections.Acquire();
-	return std::make_unique<BackupDatabaseUnitOfWork>(std::move(pooledConnection), blobStore);
+	return std::make_unique<BackupDatabaseUnitOfWork>(std::move(pooledConnection), blobStores);
+}
+
+std::unique_ptr<UnitOfWork> BackupDatabase::CreateReadOnlyUnitOfWork(const std::vector<std::shared_ptr<blob::BlobStore>>& blobStores)
+{
+	auto pooledConnection = _readOnlyConnections.Acquire();
+	return std::make_unique<BackupDatabaseUnitOfWork>(std::move(pooledConnection), blobStores);
 }
 
 void BackupDatabase::SaveAs(const boost::filesystem::path& databasePath)
@@ -121,7 +233,8 @@ void BackupDatabase::SaveAs(const boost::filesystem::path& databasePath)
 	auto destinationConnection = std::make_unique<sqlitepp::ScopedSqlite3Object>();
 	sqlitepp::open_database_or_throw(databasePath.string().c_str(), *destinationConnection, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
 
-	auto pooledConnection = _connections.Acquire();
+	// Read only, so a backup that's writing isn't held up while the copy is made
+	auto pooledConnection = _readOnlyConnections.Acquire();
 	const auto& sourceConnection = pooledConnection->GetSqlConnection();
 
 	auto backup = sqlite3_backup_init(*destinationConnection, "main", sourceConnection, "main");
@@ -136,7 +249,9 @@ void BackupDatabase::SaveAs(const boost::filesystem::path& databasePath)
 		// Per https://www.sqlite.org/c3ref/backup_finish.html this returns SQLITE_OK if there's more pages to copy
 		// And per https://www.sqlite.org/backup.html BUSY and LOCKED should be handled gracefully
 		// This assumes we'll eventually be able to complete the copy
-		result = sqlite3_backup_step(scopedBackup, 5);
+		// Every page is copied in one step from a single snapshot, which doesn't hold up writers in WAL mode, whereas
+		// copying a few pages at a time starts again whenever a writer commits
+		result = sqlite3_backup_step(scopedBackup, -1);
 		if (result == SQLITE_OK || result == SQLITE_BUSY || result == SQLITE_LOCKED)
 		{
 			// Sleep to release any mutexes (muticies? mutexeses? mutsex?), as recommended on https://www.sqlite.org/backup.html
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "bslib/BackupDatabaseConnection.hpp"
+#include "bslib/blob/BlobAddressFilter.hpp"
+#include "bslib/DatabaseSettings.hpp"
 #include "bslib/ObjectPool.hpp"
 #include "bslib/UnitOfWork.hpp"
 
@@ -8,6 +10,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace af {
 namespace bslib {
@@ -26,17 +29,26 @@ public:
 	/**
 	 * Initializes a database with the given path for opening or creating.
 	 */
-	explicit BackupDatabase(const boost::filesystem::path& databasePath);
+	explicit BackupDatabase(const boost::filesystem::path& databasePath, const DatabaseSettings& settings = DatabaseSettings());
 	~BackupDatabase();
 
 	/**
-	 * Creates a new unit of work. Note that the database must remain open while the unit of work is being used.
+	 * Creates a new unit of work that creates blobs in every given store. Note that the database must remain open while
+	 * the unit of work is being used.
 	 */
-	std::unique_ptr<UnitOfWork> CreateUnitOfWork(std::shared_ptr<blob::BlobStore> blobStore);
+	std::unique_ptr<UnitOfWork> CreateUnitOfWork(const std::vector<std::shared_ptr<blob::BlobStore>>& blobStores);
 
 	/**
-	 * Opens an existing database
+	 * Creates a unit of work on a read only connection, which sees the catalog as of its first query for as long as
+	 * it's open, without waiting for or holding up units of work that write. Anything that writes to the catalog fails.
+	 */
+	std::unique_ptr<UnitOfWork> CreateReadOnlyUnitOfWork(const std::vector<std::shared_ptr<blob::BlobStore>>& blobStores);
+
+	/**
+	 * Opens an existing database, switching it to WAL mode if it isn't already and upgrading its schema to the
+	 * current version
 	 * \throws DatabaseNotFoundException The database couldn't be found
+	 * \throws DatabaseSchemaTooNewException The database was upgraded by a later version
 	 */
 	void Open();
 
@@ -56,16 +68,31 @@ public:
 	void OpenOrCreate();
 
 	/**
-	 * Saves a copy of the database to the given path.
+	 * Saves a copy of the database to the given path, read on a read only connection.
 	 * \remarks This is safe to call while the database is being used, any uncommitted work will not be included
 	 * \throws DatabaseAlreadyExistsException A database (or path) already exists at the given path
 	 */
 	void SaveAs(const boost::filesystem::path& databasePath);
+
+	/**
+	 * Gets statistics on how many blob lookups the blob address filter has avoided since the database was opened
+	 */
+	blob::BlobAddressFilterStats GetBlobAddressFilterStats() const;
 private:
-	std::unique_ptr<BackupDatabaseConnection> Connect();
+	std::unique_ptr<BackupDatabaseConnection> Connect(bool readOnly);
+
+	/**
+	 * Loads the blob address filter persisted alongside the database, or rebuilds it if it's missing or stale
+	 */
+	void LoadBlobAddressFilter();
+	void SaveBlobAddressFilter() const;
+	boost::filesystem::path GetBlobAddressFilterPath() const;
 
 	const boost::filesystem::path _databasePath;
+	const DatabaseSettings _settings;
+	std::shared_ptr<blob::BlobAddressFilter> _blobAddressFilter;
 	ObjectPool<BackupDatabaseConnection> _connections;
+	ObjectPool<BackupDatabaseConnection> _readOnlyConnections;
 	std::unique_ptr<sqlitepp::ScopedSqlite3Object> _connection;
 };
 
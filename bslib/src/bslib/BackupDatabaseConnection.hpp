@@ -1,6 +1,7 @@
 #pragma once
 
 #include "bslib/blob/BlobInfoRepository.hpp"
+#include "bslib/blob/StoreBlobRepository.hpp"
 #include "bslib/file/FileBackupRunEventStreamRepository.hpp"
 #include "bslib/file/FileEventStreamRepository.hpp"
 #include "bslib/file/FilePathRepository.hpp"
@@ -19,12 +20,13 @@ namespace bslib {
 class BackupDatabaseConnection : public boost::noncopyable
 {
 public:
-	explicit BackupDatabaseConnection(std::unique_ptr<sqlitepp::ScopedSqlite3Object> connection)
+	BackupDatabaseConnection(std::unique_ptr<sqlitepp::ScopedSqlite3Object> connection, std::shared_ptr<blob::BlobAddressFilter> blobAddressFilter)
 		: _connection(std::move(connection))
-		, _blobInfoRepository(*_connection)
+		, _blobInfoRepository(*_connection, blobAddressFilter)
 		, _fileEventStreamRepository(*_connection)
 		, _filePathRepository(*_connection)
 		, _backupRunEventStreamRepository(*_connection)
+		, _storeBlobRepository(*_connection)
 	{
 	}
 
@@ -33,6 +35,7 @@ public:
 	file::FileEventStreamRepository& GetFileEventStreamRepository() { return _fileEventStreamRepository; }
 	file::FileBackupRunEventStreamRepository& GetFileBackupRunEventStreamRepository() { return _backupRunEventStreamRepository; }
 	file::FilePathRepository& GetFilePathRepository() { return _filePathRepository; }
+	blob::StoreBlobRepository& GetStoreBlobRepository() { return _storeBlobRepository; }
 
 private:
 	const std::unique_ptr<sqlitepp::ScopedSqlite3Object> _connection;
@@ -40,6 +43,7 @@ private:
 	file::FileEventStreamRepository _fileEventStreamRepository;
 	file::FilePathRepository _filePathRepository;
 	file::FileBackupRunEventStreamRepository _backupRunEventStreamRepository;
+	blob::StoreBlobRepository _storeBlobRepository;
 };
 
 typedef ObjectPool<BackupDatabaseConnection>::PointerType PooledDatabaseConnection;
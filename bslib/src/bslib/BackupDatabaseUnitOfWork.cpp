@@ -1,20 +1,60 @@
 #include "bslib/BackupDatabaseUnitOfWork.hpp"
 
+#include "bslib/blob/AddressCalculator.hpp"
+#include "bslib/blob/BlobGarbageCollector.hpp"
+#include "bslib/blob/BlobScrubber.hpp"
+#include "bslib/exceptions.hpp"
+#include "bslib/log.hpp"
+
+#include <algorithm>
 #include <ctime>
 
 namespace af {
 namespace bslib {
 
-BackupDatabaseUnitOfWork::BackupDatabaseUnitOfWork(PooledDatabaseConnection connection, std::shared_ptr<blob::BlobStore> blobStore)
+namespace {
+// Number of missing blobs looked up at a time when copying them to a store
+const unsigned COPY_MISSING_BLOBS_BATCH_SIZE = 1000;
+
+/**
+ * Whether the content hashes to the address, so a damaged copy isn't taken for the blob
+ */
+bool IsIntact(const blob::Address& address, const blob::BlobView& content)
+{
+	blob::AddressCalculator addressCalculator(address.GetAlgorithm());
+	addressCalculator.Update(content.GetData(), content.GetSizeBytes());
+	return addressCalculator.Finalize() == address;
+}
+}
+
+BackupDatabaseUnitOfWork::BackupDatabaseUnitOfWork(PooledDatabaseConnection connection, const std::vector<std::shared_ptr<blob::BlobStore>>& blobStores)
 	: _connection(std::move(connection))
-	, _transaction(_connection->GetSqlConnection())
-	, _blobStore(blobStore)
+	, _transaction(std::make_unique<sqlitepp::ScopedTransaction>(_connection->GetSqlConnection()))
+	, _blobStore(std::make_shared<blob::FanOutBlobStore>(blobStores))
+{
+}
+
+BackupDatabaseUnitOfWork::~BackupDatabaseUnitOfWork()
 {
+	// Events that weren't committed are rolled back with the transaction, they mustn't be written by the connection's next user
+	_connection->GetFileEventStreamRepository().DiscardUnflushedEvents();
 }
 
 void BackupDatabaseUnitOfWork::Commit()
 {
-	_transaction.Commit();
+	_blobStore->Flush();
+	auto& storeBlobRepository = _connection->GetStoreBlobRepository();
+	_blobStore->RecordStoredBlobs([&](const Uuid& storeId, const blob::Address& address) {
+		storeBlobRepository.AddStoreBlob(storeId, address);
+	});
+	_connection->GetFileEventStreamRepository().Flush();
+	_transaction->Commit();
+}
+
+void BackupDatabaseUnitOfWork::CommitAndContinue()
+{
+	Commit();
+	_transaction = std::make_unique<sqlitepp::ScopedTransaction>(_connection->GetSqlConnection());
 }
 
 std::unique_ptr<file::FileBackupRunReader> BackupDatabaseUnitOfWork::CreateFileBackupRunReader()
@@ -32,9 +72,16 @@ std::unique_ptr<file::VirtualFileBrowser> BackupDatabaseUnitOfWork::CreateVirtua
 	return std::make_unique<file::VirtualFileBrowser>(_connection->GetFileEventStreamRepository(), atUtc);
 }
 
-std::unique_ptr<file::FileAdder> BackupDatabaseUnitOfWork::CreateFileAdder(const Uuid& backupRunId)
+std::unique_ptr<file::FileAdder> BackupDatabaseUnitOfWork::CreateFileAdder(const Uuid& backupRunId, const file::FileAdderSettings& settings)
 {
-	return std::make_unique<file::FileAdder>(backupRunId, _blobStore, _connection->GetBlobInfoRepository(), _connection->GetFileEventStreamRepository(), _connection->GetFilePathRepository());
+	return std::make_unique<file::FileAdder>(
+		backupRunId,
+		_blobStore,
+		_connection->GetBlobInfoRepository(),
+		_connection->GetFileEventStreamRepository(),
+		_connection->GetFilePathRepository(),
+		_connection->GetStoreBlobRepository().GetDamagedBlobs(),
+		settings);
 }
 
 std::unique_ptr<file::FileRestorer> BackupDatabaseUnitOfWork::CreateFileRestorer()
@@ -49,8 +96,151 @@ std::unique_ptr<file::FileFinder> BackupDatabaseUnitOfWork::CreateFileFinder()
 
 std::vector<uint8_t> BackupDatabaseUnitOfWork::GetBlob(const blob::Address& address) const
 {
-	// TODO: does this need to be tracked/looked up?
-	return _blobStore->GetBlob(address);
+	auto& blobInfoRepository = _connection->GetBlobInfoRepository();
+	const auto chunkAddresses = blobInfoRepository.GetBlobChunks(address);
+	if (chunkAddresses.empty())
+	{
+		return _blobStore->GetBlob(address);
+	}
+
+	// Sized up front, so each chunk is copied once
+	std::vector<uint8_t> result;
+	const auto info = blobInfoRepository.FindBlob(address);
+	if (info)
+	{
+		result.reserve(static_cast<size_t>(info->GetSizeBytes()));
+	}
+	for (const auto& chunkAddress : chunkAddresses)
+	{
+		const auto chunk = _blobStore->GetBlobView(chunkAddress);
+		result.insert(result.end(), chunk.begin(), chunk.end());
+	}
+	return result;
+}
+
+void BackupDatabaseUnitOfWork::ReadBlob(const blob::Address& address, const std::function<void(const blob::BlobView& part)>& visit) const
+{
+	const auto chunkAddresses = _connection->GetBlobInfoRepository().GetBlobChunks(address);
+	if (chunkAddresses.empty())
+	{
+		visit(_blobStore->GetBlobView(address));
+		return;
+	}
+
+	// Each chunk is let go before the next is read
+	for (const auto& chunkAddress : chunkAddresses)
+	{
+		visit(_blobStore->GetBlobView(chunkAddress));
+	}
+}
+
+uint64_t BackupDatabaseUnitOfWork::CopyMissingBlobs(const Uuid& storeId)
+{
+	const auto& stores = _blobStore->GetStores();
+	const auto target = std::find_if(stores.begin(), stores.end(), [&](const std::shared_ptr<blob::BlobStore>& store) {
+		return store->GetId() == storeId;
+	});
+	if (target == stores.end())
+	{
+		throw BlobStoreNotFoundException(storeId.ToString());
+	}
+
+	auto& storeBlobRepository = _connection->GetStoreBlobRepository();
+	uint64_t copiedCount = 0;
+	boost::optional<blob::Address> after;
+	while (true)
+	{
+		const auto missingAddresses = storeBlobRepository.GetBlobsMissingFromStore(storeId, after, COPY_MISSING_BLOBS_BATCH_SIZE);
+		if (missingAddresses.empty())
+		{
+			break;
+		}
+		after = missingAddresses.back();
+
+		// Blobs created before stores were recorded may already be there, unless they're damaged. The batch is checked
+		// at once first, so only the blobs that are there are read.
+		const auto foundAddresses = (*target)->FindBlobs(missingAddresses);
+		std::vector<blob::Address> storedAddresses;
+		for (const auto& address : missingAddresses)
+		{
+			try
+			{
+				if (foundAddresses.count(address) > 0 && IsIntact(address, (*target)->GetStoredBlobView(address)))
+				{
+					storedAddresses.push_back(address);
+					continue;
+				}
+			}
+			catch (const std::exception&)
+			{
+				// Not there, so it's copied
+			}
+
+			boost::optional<blob::BlobView> content;
+			for (auto source = stores.begin(); source != stores.end() && !content; ++source)
+			{
+				if (source == target)
+				{
+					continue;
+				}
+				try
+				{
+					auto sourceContent = (*source)->GetStoredBlobView(address);
+					if (IsIntact(address, sourceContent))
+					{
+						content = std::move(sourceContent);
+					}
+				}
+				catch (const std::exception&)
+				{
+					// Try the next store
+				}
+			}
+
+			if (content)
+			{
+				(*target)->CreateBlob(address, content->ToVector());
+				storedAddresses.push_back(address);
+				++copiedCount;
+			}
+		}
+
+		if (storedAddresses.size() < missingAddresses.size())
+		{
+			BSLIB_LOG_WARNING << (missingAddresses.size() - storedAddresses.size()) << " blobs missing from blob store " << storeId << " couldn't be read from any other store";
+		}
+
+		// Only recorded once they're durable
+		(*target)->Flush();
+		for (const auto& address : storedAddresses)
+		{
+			storeBlobRepository.AddStoreBlob(storeId, address);
+		}
+	}
+	return copiedCount;
+}
+
+blob::GarbageCollectionResult BackupDatabaseUnitOfWork::CollectGarbage(const blob::GarbageCollectionSettings& settings)
+{
+	blob::BlobGarbageCollector collector(
+		_connection->GetBlobInfoRepository(),
+		_connection->GetStoreBlobRepository(),
+		_blobStore->GetStores(),
+		settings);
+	return collector.Collect();
+}
+
+blob::ScrubResult BackupDatabaseUnitOfWork::ScrubBlobs(const blob::ScrubSettings& settings)
+{
+	blob::BlobScrubber scrubber(_connection->GetStoreBlobRepository(), _blobStore->GetStores(), settings, [this]() {
+		CommitAndContinue();
+	});
+	return scrubber.Scrub();
+}
+
+uint64_t BackupDatabaseUnitOfWork::RebuildPathState()
+{
+	return _connection->GetFileEventStreamRepository().RebuildPathState();
 }
 
 }
@@ -5,6 +5,7 @@
 #include "bslib/blob/BlobInfo.hpp"
 #include "bslib/blob/BlobStore.hpp"
 #include "bslib/blob/BlobInfoRepository.hpp"
+#include "bslib/blob/FanOutBlobStore.hpp"
 #include "bslib/file/FileEvent.hpp"
 #include "bslib/file/FileEventStreamRepository.hpp"
 #include "bslib/sqlitepp/ScopedTransaction.hpp"
@@ -12,27 +13,45 @@
 
 #include <boost/core/noncopyable.hpp>
 
+#include <memory>
+#include <vector>
+
 namespace af {
 namespace bslib {
 
 class BackupDatabaseUnitOfWork : public UnitOfWork
 {
 public:
-	BackupDatabaseUnitOfWork(PooledDatabaseConnection connection, std::shared_ptr<blob::BlobStore> blobStore);
+	BackupDatabaseUnitOfWork(PooledDatabaseConnection connection, const std::vector<std::shared_ptr<blob::BlobStore>>& blobStores);
+	~BackupDatabaseUnitOfWork() override;
 
+	/**
+	 * Saves the unit of work once its blobs are stored durably in at least one store, recording which stores have them
+	 * \exception CreateBlobFailed A blob couldn't be stored in any store
+	 */
 	void Commit() override;
 
 	std::unique_ptr<file::FileBackupRunReader> CreateFileBackupRunReader() override;
 	std::unique_ptr<file::FileBackupRunRecorder> CreateFileBackupRunRecorder() override;
 	std::unique_ptr<file::VirtualFileBrowser> CreateVirtualFileBrowser(const boost::optional<boost::posix_time::ptime>& atUtc = boost::none) override;
-	std::unique_ptr<file::FileAdder> CreateFileAdder(const Uuid& backupRunId) override;
+	std::unique_ptr<file::FileAdder> CreateFileAdder(const Uuid& backupRunId, const file::FileAdderSettings& settings = file::FileAdderSettings()) override;
 	std::unique_ptr<file::FileRestorer> CreateFileRestorer() override;
 	std::unique_ptr<file::FileFinder> CreateFileFinder() override;
 	std::vector<uint8_t> GetBlob(const blob::Address& address) const override;
+	void ReadBlob(const blob::Address& address, const std::function<void(const blob::BlobView& part)>& visit) const override;
+	uint64_t CopyMissingBlobs(const Uuid& storeId) override;
+	blob::GarbageCollectionResult CollectGarbage(const blob::GarbageCollectionSettings& settings = blob::GarbageCollectionSettings()) override;
+	blob::ScrubResult ScrubBlobs(const blob::ScrubSettings& settings = blob::ScrubSettings()) override;
+	uint64_t RebuildPathState() override;
 private:
+	/**
+	 * Commits the unit of work so far, and starts a new transaction for the rest of it
+	 */
+	void CommitAndContinue();
+
 	PooledDatabaseConnection _connection;
-	sqlitepp::ScopedTransaction _transaction;
-	std::shared_ptr<blob::BlobStore> _blobStore;
+	std::unique_ptr<sqlitepp::ScopedTransaction> _transaction;
+	std::shared_ptr<blob::FanOutBlobStore> _blobStore;
 };
 
 
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+
+#include <boost/noncopyable.hpp>
+
+namespace af {
+namespace bslib {
+
+/**
+ * Multi-producer, multi-consumer FIFO queue that blocks producers while it's full
+ */
+template<class T>
+class BoundedQueue : public boost::noncopyable
+{
+public:
+	explicit BoundedQueue(size_t capacity)
+		: _capacity(capacity)
+		, _closed(false)
+	{
+	}
+
+	/**
+	 * Adds an item to the back of the queue, waiting for space if it's full
+	 * \return false if the queue was closed, in which case the item is dropped
+	 */
+	bool Push(T item)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_notFull.wait(lock, [&]() {
+			return _closed || _items.size() < _capacity;
+		});
+
+		if (_closed)
+		{
+			return false;
+		}
+
+		_items.push(std::move(item));
+		_notEmpty.notify_one();
+		return true;
+	}
+
+	/**
+	 * Removes the item at the front of the queue, waiting for one if it's empty
+	 * \return false if the queue is closed and there are no more items
+	 */
+	bool Pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_notEmpty.wait(lock, [&]() {
+			return _closed || !_items.empty();
+		});
+
+		if (_items.empty())
+		{
+			return false;
+		}
+
+		item = std::move(_items.front());
+		_items.pop();
+		_notFull.notify_one();
+		return true;
+	}
+
+	/**
+	 * Stops accepting items and wakes all waiters, items already queued can still be popped
+	 */
+	void Close()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_closed = true;
+		_notFull.notify_all();
+		_notEmpty.notify_all();
+	}
+
+private:
+	std::mutex _mutex;
+	std::condition_variable _notFull;
+	std::condition_variable _notEmpty;
+	const size_t _capacity;
+	bool _closed;
+	std::queue<T> _items;
+};
+
+}
+}
@@ -0,0 +1,263 @@
+#include "bslib/SchemaMigrations.hpp"
+
+#include "bslib/exceptions.hpp"
+#include "bslib/log.hpp"
+#include "bslib/sqlitepp/exceptions.hpp"
+#include "bslib/sqlitepp/ScopedTransaction.hpp"
+#include "bslib/sqlitepp/sqlitepp.hpp"
+
+#include <iterator>
+#include <string>
+
+namespace af {
+namespace bslib {
+
+namespace {
+struct Migration
+{
+	// Version the schema is at once the migration is applied
+	int version;
+	const char* description;
+	const char* sql;
+	// Applied after the SQL when the change depends on what's already in the database, which SQL alone can't check
+	void (*apply)(const sqlitepp::ScopedSqlite3Object& db);
+};
+
+bool HasColumn(const sqlitepp::ScopedSqlite3Object& db, const std::string& table, const std::string& column)
+{
+	// Pragmas can't be bound
+	const auto sql = "PRAGMA table_info(" + table + ")";
+	sqlitepp::ScopedStatement statement;
+	sqlitepp::prepare_or_throw(db, sql.c_str(), statement);
+	auto stepResult = sqlite3_step(statement);
+	for (; stepResult == SQLITE_ROW; stepResult = sqlite3_step(statement))
+	{
+		const auto name = reinterpret_cast<const char*>(sqlite3_column_text(statement, 1));
+		if (name && column == name)
+		{
+			return true;
+		}
+	}
+	if (stepResult != SQLITE_DONE)
+	{
+		throw ExecuteFailedException(stepResult);
+	}
+	return false;
+}
+
+// Event tables created before the file's size, times and id were recorded are missing their columns, which the first
+// migration can't add as it only creates the table if it doesn't exist
+void AddFileEventMetadataColumns(const sqlitepp::ScopedSqlite3Object& db)
+{
+	const char* const columns[][2] = {
+		{ "SizeBytes", "ALTER TABLE FileEvent ADD COLUMN SizeBytes INTEGER NULL" },
+		{ "ModifiedTime", "ALTER TABLE FileEvent ADD COLUMN ModifiedTime INTEGER NULL" },
+		{ "ChangedTime", "ALTER TABLE FileEvent ADD COLUMN ChangedTime INTEGER NULL" },
+		{ "FileId", "ALTER TABLE FileEvent ADD COLUMN FileId INTEGER NULL" },
+	};
+	for (const auto& column : columns)
+	{
+		if (!HasColumn(db, "FileEvent", column[0]))
+		{
+			sqlitepp::exec_or_throw(db, column[1]);
+		}
+	}
+}
+
+// Never change a migration once it's released, add another that changes what it did instead.
+// Databases created before schemas were versioned are at version 0 with some of the schema in place, so the first
+// migrations only create what doesn't already exist
+// Note that SQLite supports blobs as primary keys fine, see https://www.sqlite.org/cvstrac/wiki?p=KeyValueDatabase
+const Migration MIGRATIONS[] = {
+	{ 1, "Create files and blobs", R"(
+		CREATE TABLE IF NOT EXISTS Blob (
+			Address BLOB (20) PRIMARY KEY,
+			SizeBytes INTEGER (8) NOT NULL
+		);
+		CREATE TABLE IF NOT EXISTS BlobChunk (
+			BlobAddress BLOB (20) NOT NULL REFERENCES Blob (Address),
+			ChunkIndex INTEGER NOT NULL,
+			ChunkAddress BLOB (20) NOT NULL REFERENCES Blob (Address),
+			PRIMARY KEY (BlobAddress, ChunkIndex)
+		);
+		CREATE TABLE IF NOT EXISTS FileEvent (
+			Id INTEGER PRIMARY KEY AUTOINCREMENT,
+			PathId INTEGER NOT NULL REFERENCES FilePath (Id),
+			ContentBlobAddress BLOB(20) REFERENCES Blob (Address),
+			Action INTEGER NOT NULL,
+			BackupRunId BLOB(16) NOT NULL,
+			DateTimeUtc INTEGER NOT NULL,
+			SizeBytes INTEGER NULL,
+			ModifiedTime INTEGER NULL,
+			ChangedTime INTEGER NULL,
+			FileId INTEGER NULL
+		);
+		CREATE INDEX IF NOT EXISTS FileEvent_PathId ON FileEvent (PathId, Id);
+		CREATE TABLE IF NOT EXISTS FileBackupRunEvent (
+			Id INTEGER PRIMARY KEY AUTOINCREMENT,
+			BackupRunId BLOB(16) NOT NULL,
+			DateTimeUtc INTEGER NOT NULL,
+			Action INTEGER NOT NULL
+		);
+		CREATE TABLE IF NOT EXISTS FilePath (
+			Id INTEGER PRIMARY KEY,
+			FullPath TEXT NOT NULL COLLATE BINARY,
+			FileType INTEGER NOT NULL,
+			ParentId INTEGER NULL REFERENCES FilePath (Id),
+			UNIQUE (FullPath, FileType)
+		);
+		CREATE INDEX IF NOT EXISTS FilePath_ParentId ON FilePath (ParentId);
+	)" },
+	{ 2, "Record the blobs in each store", R"(
+		CREATE TABLE IF NOT EXISTS StoreBlob (
+			StoreId BLOB(16) NOT NULL,
+			BlobAddress BLOB(20) NOT NULL REFERENCES Blob (Address),
+			PRIMARY KEY (StoreId, BlobAddress)
+		);
+		CREATE TABLE IF NOT EXISTS DamagedBlob (
+			StoreId BLOB(16) NOT NULL,
+			BlobAddress BLOB(20) NOT NULL REFERENCES Blob (Address),
+			Damage INTEGER NOT NULL,
+			DetectedUtc INTEGER NOT NULL,
+			PRIMARY KEY (StoreId, BlobAddress)
+		);
+		CREATE TABLE IF NOT EXISTS ScrubCursor (
+			StoreId BLOB(16) PRIMARY KEY,
+			AfterAddress BLOB(20) NOT NULL
+		);
+	)" },
+	// Each index holds every column its queries read, so they're answered from the index without reading the table.
+	// The latest event of a path is found by walking back from the newest with the action read from the index, and
+	// the event and backup run searches by run no longer scan every event
+	{ 3, "Add covering indexes for event queries", R"(
+		DROP INDEX IF EXISTS FileEvent_PathId;
+		CREATE INDEX FileEvent_PathId_Id_Action ON FileEvent (PathId, Id, Action);
+		CREATE INDEX FileEvent_BackupRunId ON FileEvent (BackupRunId, Action, ContentBlobAddress);
+		CREATE INDEX FileBackupRunEvent_BackupRunId ON FileBackupRunEvent (BackupRunId, Id, DateTimeUtc, Action);
+		CREATE INDEX FileBackupRunEvent_Action ON FileBackupRunEvent (Action, Id, BackupRunId);
+	)" },
+	// The latest change (added, modified or removed) and observation of content (added, modified or unchanged) of
+	// each path, so finding the current state of paths doesn't search their history. Kept up to date by the trigger
+	// in the transaction that adds the event
+	{ 4, "Track the latest events of each path", R"(
+		CREATE TABLE PathState (
+			PathId INTEGER PRIMARY KEY REFERENCES FilePath (Id),
+			LastChangedEventId INTEGER NULL REFERENCES FileEvent (Id),
+			LastObservedEventId INTEGER NULL REFERENCES FileEvent (Id)
+		);
+		INSERT INTO PathState (PathId, LastChangedEventId, LastObservedEventId)
+			SELECT PathId, MAX(CASE WHEN Action IN (0, 1, 2) THEN Id END), MAX(CASE WHEN Action IN (0, 1, 5) THEN Id END)
+			FROM FileEvent GROUP BY PathId;
+		CREATE TRIGGER FileEvent_UpdatePathState AFTER INSERT ON FileEvent
+		BEGIN
+			INSERT OR IGNORE INTO PathState (PathId) VALUES (NEW.PathId);
+			UPDATE PathState SET
+				LastChangedEventId = CASE WHEN NEW.Action IN (0, 1, 2) THEN NEW.Id ELSE LastChangedEventId END,
+				LastObservedEventId = CASE WHEN NEW.Action IN (0, 1, 5) THEN NEW.Id ELSE LastObservedEventId END
+			WHERE PathId = NEW.PathId;
+		END;
+	)" },
+	// Each event a backup saw a path in (added, modified, removed or unchanged) is a version of the path, valid from the
+	// event's time until the path's next version, or forever for its current version. The versions of a path don't
+	// overlap and are indexed by when they end, so the version valid at a time is the first ending after it
+	{ 5, "Track the versions of each path", R"(
+		CREATE TABLE PathVersion (
+			EventId INTEGER PRIMARY KEY REFERENCES FileEvent (Id),
+			PathId INTEGER NOT NULL REFERENCES FilePath (Id),
+			ValidFromUtc INTEGER NOT NULL,
+			ValidToUtc INTEGER NOT NULL
+		);
+		INSERT INTO PathVersion (EventId, PathId, ValidFromUtc, ValidToUtc)
+			SELECT FileEvent.Id, FileEvent.PathId, FileEvent.DateTimeUtc, IFNULL((
+				SELECT NextEvent.DateTimeUtc FROM FileEvent AS NextEvent
+				WHERE NextEvent.PathId = FileEvent.PathId AND NextEvent.Id > FileEvent.Id AND NextEvent.Action IN (0, 1, 2, 5)
+				ORDER BY NextEvent.Id LIMIT 1
+			), 9223372036854775807)
+			FROM FileEvent WHERE FileEvent.Action IN (0, 1, 2, 5);
+		CREATE INDEX PathVersion_PathId_ValidToUtc ON PathVersion (PathId, ValidToUtc, ValidFromUtc);
+		CREATE TRIGGER FileEvent_UpdatePathVersion AFTER INSERT ON FileEvent WHEN NEW.Action IN (0, 1, 2, 5)
+		BEGIN
+			UPDATE PathVersion SET ValidToUtc = NEW.DateTimeUtc WHERE PathId = NEW.PathId AND ValidToUtc = 9223372036854775807;
+			INSERT INTO PathVersion (EventId, PathId, ValidFromUtc, ValidToUtc) VALUES (NEW.Id, NEW.PathId, NEW.DateTimeUtc, 9223372036854775807);
+		END;
+	)" },
+	// A run's events are paged through in order of id, continuing after the last id of the previous page, which is a
+	// seek of this index rather than sorting all of the run's events for every page. It still covers the run stats
+	{ 6, "Order the events of each run by id", R"(
+		DROP INDEX IF EXISTS FileEvent_BackupRunId;
+		CREATE INDEX FileEvent_BackupRunId_Id ON FileEvent (BackupRunId, Id, Action, ContentBlobAddress);
+	)" },
+	{ 7, "Add file metadata to events of unversioned databases", nullptr, AddFileEventMetadataColumns },
+	// Counts every blob added or removed, by any process, so the saved blob address filter can tell whether it still
+	// matches the table. Row ids can't, since without AUTOINCREMENT the id of a removed last blob is reused
+	{ 8, "Count changes to blobs", R"(
+		CREATE TABLE BlobChangeCount (
+			Id INTEGER PRIMARY KEY CHECK (Id = 0),
+			ChangeCount INTEGER NOT NULL
+		);
+		INSERT INTO BlobChangeCount (Id, ChangeCount) VALUES (0, 0);
+		CREATE TRIGGER Blob_CountInsert AFTER INSERT ON Blob
+		BEGIN
+			UPDATE BlobChangeCount SET ChangeCount = ChangeCount + 1;
+		END;
+		CREATE TRIGGER Blob_CountDelete AFTER DELETE ON Blob
+		BEGIN
+			UPDATE BlobChangeCount SET ChangeCount = ChangeCount + 1;
+		END;
+	)" },
+};
+
+void SetSchemaVersion(const sqlitepp::ScopedSqlite3Object& db, int version)
+{
+	// Pragmas can't be bound
+	const auto sql = "PRAGMA user_version = " + std::to_string(version);
+	sqlitepp::exec_or_throw(db, sql.c_str());
+}
+}
+
+const int CURRENT_SCHEMA_VERSION = (std::end(MIGRATIONS) - 1)->version;
+
+int GetSchemaVersion(const sqlitepp::ScopedSqlite3Object& db)
+{
+	sqlitepp::ScopedStatement statement;
+	sqlitepp::prepare_or_throw(db, "PRAGMA user_version", statement);
+	const auto stepResult = sqlite3_step(statement);
+	if (stepResult != SQLITE_ROW)
+	{
+		throw ExecuteFailedException(stepResult);
+	}
+	return sqlite3_column_int(statement, 0);
+}
+
+void MigrateSchema(const sqlitepp::ScopedSqlite3Object& db, const std::string& databasePath, int targetVersion)
+{
+	const auto version = GetSchemaVersion(db);
+	if (version > CURRENT_SCHEMA_VERSION)
+	{
+		throw DatabaseSchemaTooNewException(databasePath, version, CURRENT_SCHEMA_VERSION);
+	}
+
+	for (const auto& migration : MIGRATIONS)
+	{
+		if (migration.version <= version || migration.version > targetVersion)
+		{
+			continue;
+		}
+
+		BSLIB_LOG_INFO << "Upgrading database " << databasePath << " to version " << migration.version << ": " << migration.description;
+		sqlitepp::ScopedTransaction transaction(db);
+		if (migration.sql)
+		{
+			sqlitepp::exec_or_throw(db, migration.sql);
+		}
+		if (migration.apply)
+		{
+			migration.apply(db);
+		}
+		SetSchemaVersion(db, migration.version);
+		transaction.Commit();
+	}
+}
+
+}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "bslib/sqlitepp/handles.hpp"
+
+#include <string>
+
+namespace af {
+namespace bslib {
+
+/**
+ * Version of the catalog schema this build creates and reads, kept in the database's user_version
+ */
+extern const int CURRENT_SCHEMA_VERSION;
+
+/**
+ * \return The version of the database's schema, 0 if it's empty or was created before schemas were versioned
+ */
+int GetSchemaVersion(const sqlitepp::ScopedSqlite3Object& db);
+
+/**
+ * Upgrades the database's schema in place, from its version up to the given version. Each migration is applied in its
+ * own transaction, so a failed upgrade leaves the database at the last version that was reached.
+ * An empty database is given the whole schema.
+ * \throws DatabaseSchemaTooNewException The database's schema is newer than this build's
+ * \throws ExecuteFailedException A migration couldn't be applied
+ */
+void MigrateSchema(const sqlitepp::ScopedSqlite3Object& db, const std::string& databasePath, int targetVersion = CURRENT_SCHEMA_VERSION);
+
+}
+}
@@ -1,103 +1,154 @@
 #include "bslib/blob/Address.hpp"
 
-#include <boost/uuid/sha1.hpp>
+#include "bslib/blob/AddressCalculator.hpp"
 
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <cctype>
+#include <tuple>
 
 namespace af {
 namespace bslib {
 namespace blob {
 
+Address::Address()
+	: _algorithm(AddressAlgorithm::Sha1)
+{
+	_digest.fill(0);
+}
+
 Address::Address(const void* rawBuffer, int bufferLength)
+	: Address()
 {
-	if (bufferLength != static_cast<int>(_address.max_size()))
+	const auto bytes = static_cast<const uint8_t*>(rawBuffer);
+	if (bufferLength == static_cast<int>(std::tuple_size<binary_address>::value))
+	{
+		std::copy_n(bytes, bufferLength, _digest.begin());
+		return;
+	}
+
+	// Versioned, the algorithm followed by the digest
+	if (bufferLength < 1)
+	{
+		throw InvalidAddressException("Given buffer is not of the correct size, expected " + std::to_string(std::tuple_size<binary_address>::value));
+	}
+
+	const auto algorithm = static_cast<AddressAlgorithm>(bytes[0]);
+	if (algorithm == AddressAlgorithm::Sha1 || bufferLength != static_cast<int>(1 + GetDigestSize(algorithm)))
 	{
-		throw InvalidAddressException("Given buffer is not of the correct size, expected " + _address.max_size());
+		throw InvalidAddressException("Given buffer is not of the correct size for address algorithm " + std::to_string(bytes[0]));
 	}
-	std::copy_n(static_cast<const uint8_t*>(rawBuffer), bufferLength, _address.begin());
+	_algorithm = algorithm;
+	std::copy_n(bytes + 1, bufferLength - 1, _digest.begin());
 }
 
 Address::Address(const binary_address& address)
-	: _address(address)
+	: Address()
 {
+	std::copy(address.begin(), address.end(), _digest.begin());
+}
+
+Address::Address(AddressAlgorithm algorithm, const uint8_t* digest)
+	: Address()
+{
+	_algorithm = algorithm;
+	std::copy_n(digest, GetDigestSize(algorithm), _digest.begin());
 }
 
 Address::Address(const std::string& address)
 {
-	const auto length = 40;
-	if (address.length() != length)
+	const auto sha1Length = 2 * std::tuple_size<binary_address>::value;
+	if (address.length() != sha1Length && (address.length() % 2 != 0 || address.length() < 2))
 	{
 		throw InvalidAddressException("Given address is not a valid string-encoded address");
 	}
-	
-	auto ai = 0;
-	for (auto i = 0; i < length; i += 2)
+
+	std::vector<uint8_t> bytes;
+	bytes.reserve(address.length() / 2);
+	for (size_t i = 0; i < address.length(); i += 2)
 	{
+		if (!std::isxdigit(static_cast<unsigned char>(address[i])) || !std::isxdigit(static_cast<unsigned char>(address[i + 1])))
+		{
+			throw InvalidAddressException("Given address is not a valid string-encoded address");
+		}
+
 		// The stream overload for hex will treat the parsing differently if the target is a char
 		int tmp;
 		std::istringstream(address.substr(i, 2)) >> std::hex >> tmp;
-		_address[ai] = static_cast<uint8_t>(tmp);
-		ai++;
+		bytes.push_back(static_cast<uint8_t>(tmp));
+	}
+
+	try
+	{
+		*this = Address(&bytes[0], static_cast<int>(bytes.size()));
+	}
+	catch (const InvalidAddressException&)
+	{
+		throw InvalidAddressException("Given address is not a valid string-encoded address");
 	}
 }
 
 bool Address::operator<(const Address& rhs) const
 {
-	return _address < rhs._address;
+	return std::tie(_algorithm, _digest) < std::tie(rhs._algorithm, rhs._digest);
 }
 
 bool Address::operator==(const Address& rhs) const
 {
-	return _address == rhs._address;
+	return _algorithm == rhs._algorithm && _digest == rhs._digest;
 }
 
 bool Address::operator!=(const Address& rhs) const
 {
-	return _address != rhs._address;
+	return !(*this == rhs);
 }
 
-binary_address Address::ToBinary() const
+std::vector<uint8_t> Address::ToBinary() const
 {
-	return _address;
+	std::vector<uint8_t> result;
+	if (_algorithm != AddressAlgorithm::Sha1)
+	{
+		result.push_back(static_cast<uint8_t>(_algorithm));
+	}
+	result.insert(result.end(), _digest.begin(), _digest.begin() + GetDigestSize(_algorithm));
+	return result;
 }
 
 std::string Address::ToString() const
 {
 	std::ostringstream result;
-	for (auto c: _address)
+	for (auto c : ToBinary())
 	{
 		result << std::setfill('0') << std::setw(2) << std::hex << static_cast<uint16_t>(c);
 	}
 	return result.str();
 }
 
-Address Address::CalculateFromContent(const std::vector<uint8_t>& content)
+Address Address::CalculateFromContent(const std::vector<uint8_t>& content, AddressAlgorithm algorithm)
 {
-	if (content.size() == 0)
+	AddressCalculator calculator(algorithm);
+	if (!content.empty())
 	{
-		// Null value hash for SHA1
-		return Address("da39a3ee5e6b4b0d3255bfef95601890afd80709");
+		calculator.Update(&content[0], content.size());
 	}
+	return calculator.Finalize();
+}
 
-	boost::uuids::detail::sha1 sha;
-	sha.process_bytes(&content[0], content.size());
-	unsigned int digest[5];
-	sha.get_digest(digest);
-	auto i = 0;
-	binary_address hash;
-	for (auto d : digest)
+size_t Address::GetDigestSize(AddressAlgorithm algorithm)
+{
+	switch (algorithm)
 	{
-		hash[i++] = (d >> 24) & 0xFF;
-		hash[i++] = (d >> 16) & 0xFF;
-		hash[i++] = (d >> 8) & 0xFF;
-		hash[i++] = d & 0xFF;
+		case AddressAlgorithm::Sha1:
+			return std::tuple_size<binary_address>::value;
+
+		case AddressAlgorithm::Blake3:
+			return 32;
 	}
-	return Address(hash);
+
+	throw InvalidAddressException("Unknown address algorithm " + std::to_string(static_cast<int>(algorithm)));
 }
 
 }
 }
 }
-
@@ -0,0 +1,38 @@
+#include "bslib/blob/AddressCalculator.hpp"
+
+#include "bslib/blob/Hasher.hpp"
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+AddressCalculator::AddressCalculator(AddressAlgorithm algorithm)
+	: _algorithm(algorithm)
+	, _hasher(CreateHasher(algorithm))
+{
+}
+
+AddressCalculator::~AddressCalculator()
+{
+	// Needed to delete incomplete types
+}
+
+void AddressCalculator::Update(const void* data, size_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+	_hasher->Update(static_cast<const uint8_t*>(data), size);
+}
+
+Address AddressCalculator::Finalize()
+{
+	uint8_t digest[Address::MAX_DIGEST_SIZE_BYTES];
+	_hasher->Finalize(digest);
+	return Address(_algorithm, digest);
+}
+
+}
+}
+}
@@ -0,0 +1,210 @@
+#include "bslib/blob/Blake3Hasher.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+namespace {
+
+const uint32_t IV[8] = { 0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19 };
+
+// The message word order for each round, the permutation applied repeatedly
+const uint8_t MESSAGE_SCHEDULE[7][16] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+	{ 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+	{ 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+	{ 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+	{ 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+	{ 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 }
+};
+
+const uint32_t CHUNK_START = 1 << 0;
+const uint32_t CHUNK_END = 1 << 1;
+const uint32_t PARENT = 1 << 2;
+const uint32_t ROOT = 1 << 3;
+
+inline uint32_t RotateRight(uint32_t value, int bits)
+{
+	return (value >> bits) | (value << (32 - bits));
+}
+
+inline void G(uint32_t* state, size_t a, size_t b, size_t c, size_t d, uint32_t x, uint32_t y)
+{
+	state[a] = state[a] + state[b] + x;
+	state[d] = RotateRight(state[d] ^ state[a], 16);
+	state[c] = state[c] + state[d];
+	state[b] = RotateRight(state[b] ^ state[c], 12);
+	state[a] = state[a] + state[b] + y;
+	state[d] = RotateRight(state[d] ^ state[a], 8);
+	state[c] = state[c] + state[d];
+	state[b] = RotateRight(state[b] ^ state[c], 7);
+}
+
+/**
+ * The BLAKE3 compression function, writes the full 16 word output
+ */
+void Compress(
+	const uint32_t* chainingValue,
+	const uint32_t* blockWords,
+	uint64_t counter,
+	uint32_t blockSize,
+	uint32_t flags,
+	uint32_t* output)
+{
+	uint32_t state[16] = {
+		chainingValue[0], chainingValue[1], chainingValue[2], chainingValue[3],
+		chainingValue[4], chainingValue[5], chainingValue[6], chainingValue[7],
+		IV[0], IV[1], IV[2], IV[3],
+		static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), blockSize, flags
+	};
+
+	for (const auto& schedule : MESSAGE_SCHEDULE)
+	{
+		G(state, 0, 4, 8, 12, blockWords[schedule[0]], blockWords[schedule[1]]);
+		G(state, 1, 5, 9, 13, blockWords[schedule[2]], blockWords[schedule[3]]);
+		G(state, 2, 6, 10, 14, blockWords[schedule[4]], blockWords[schedule[5]]);
+		G(state, 3, 7, 11, 15, blockWords[schedule[6]], blockWords[schedule[7]]);
+		G(state, 0, 5, 10, 15, blockWords[schedule[8]], blockWords[schedule[9]]);
+		G(state, 1, 6, 11, 12, blockWords[schedule[10]], blockWords[schedule[11]]);
+		G(state, 2, 7, 8, 13, blockWords[schedule[12]], blockWords[schedule[13]]);
+		G(state, 3, 4, 9, 14, blockWords[schedule[14]], blockWords[schedule[15]]);
+	}
+
+	for (auto i = 0; i < 8; ++i)
+	{
+		output[i] = state[i] ^ state[i + 8];
+		output[i + 8] = state[i + 8] ^ chainingValue[i];
+	}
+}
+
+void LoadWords(const uint8_t* bytes, uint32_t* words)
+{
+	for (auto i = 0; i < 16; ++i)
+	{
+		words[i] = static_cast<uint32_t>(bytes[i * 4]) |
+			(static_cast<uint32_t>(bytes[i * 4 + 1]) << 8) |
+			(static_cast<uint32_t>(bytes[i * 4 + 2]) << 16) |
+			(static_cast<uint32_t>(bytes[i * 4 + 3]) << 24);
+	}
+}
+
+}
+
+Blake3Hasher::Blake3Hasher()
+	: _chunkCounter(0)
+	, _blockSize(0)
+	, _blocksCompressed(0)
+{
+	std::copy_n(IV, 8, _chunkChainingValue.begin());
+}
+
+void Blake3Hasher::Update(const uint8_t* data, size_t size)
+{
+	while (size > 0)
+	{
+		// Only finish a block once there's more input, as the last block of the last chunk is finalized differently
+		if (_blockSize == BLOCK_SIZE_BYTES)
+		{
+			if (_blocksCompressed == CHUNK_SIZE_BYTES / BLOCK_SIZE_BYTES - 1)
+			{
+				CompressBlock(CHUNK_END);
+				++_chunkCounter;
+				AddChunkChainingValue(_chunkChainingValue, _chunkCounter);
+				std::copy_n(IV, 8, _chunkChainingValue.begin());
+				_blocksCompressed = 0;
+			}
+			else
+			{
+				CompressBlock(0);
+				++_blocksCompressed;
+			}
+			_blockSize = 0;
+		}
+
+		const auto copySize = std::min(size, BLOCK_SIZE_BYTES - _blockSize);
+		std::memcpy(&_block[_blockSize], data, copySize);
+		_blockSize += copySize;
+		data += copySize;
+		size -= copySize;
+	}
+}
+
+void Blake3Hasher::Finalize(uint8_t* digest)
+{
+	std::fill(_block.begin() + _blockSize, _block.end(), 0);
+
+	uint32_t inputChainingValue[8];
+	std::copy(_chunkChainingValue.begin(), _chunkChainingValue.end(), inputChainingValue);
+	uint32_t blockWords[16];
+	LoadWords(&_block[0], blockWords);
+	auto counter = _chunkCounter;
+	auto blockSize = static_cast<uint32_t>(_blockSize);
+	auto flags = CHUNK_END | (_blocksCompressed == 0 ? CHUNK_START : 0);
+
+	// Merge the subtrees from the right, the root node is the last one
+	uint32_t output[16];
+	for (auto it = _chainingValueStack.rbegin(); it != _chainingValueStack.rend(); ++it)
+	{
+		Compress(inputChainingValue, blockWords, counter, blockSize, flags, output);
+		std::copy(it->begin(), it->end(), blockWords);
+		std::copy_n(output, 8, blockWords + 8);
+		std::copy_n(IV, 8, inputChainingValue);
+		counter = 0;
+		blockSize = BLOCK_SIZE_BYTES;
+		flags = PARENT;
+	}
+
+	Compress(inputChainingValue, blockWords, counter, blockSize, flags | ROOT, output);
+	for (auto i = 0; i < 8; ++i)
+	{
+		digest[i * 4] = static_cast<uint8_t>(output[i]);
+		digest[i * 4 + 1] = static_cast<uint8_t>(output[i] >> 8);
+		digest[i * 4 + 2] = static_cast<uint8_t>(output[i] >> 16);
+		digest[i * 4 + 3] = static_cast<uint8_t>(output[i] >> 24);
+	}
+}
+
+const char* Blake3Hasher::GetImplementationName() const
+{
+	return "BLAKE3 (portable)";
+}
+
+void Blake3Hasher::CompressBlock(uint32_t flags)
+{
+	uint32_t blockWords[16];
+	LoadWords(&_block[0], blockWords);
+	if (_blocksCompressed == 0)
+	{
+		flags |= CHUNK_START;
+	}
+
+	uint32_t output[16];
+	Compress(&_chunkChainingValue[0], blockWords, _chunkCounter, BLOCK_SIZE_BYTES, flags, output);
+	std::copy_n(output, 8, _chunkChainingValue.begin());
+}
+
+void Blake3Hasher::AddChunkChainingValue(ChainingValue chainingValue, uint64_t totalChunks)
+{
+	// Each trailing zero bit in the chunk count completes a subtree, which merges with its left sibling
+	while ((totalChunks & 1) == 0)
+	{
+		uint32_t blockWords[16];
+		std::copy(_chainingValueStack.back().begin(), _chainingValueStack.back().end(), blockWords);
+		std::copy(chainingValue.begin(), chainingValue.end(), blockWords + 8);
+		_chainingValueStack.pop_back();
+
+		uint32_t output[16];
+		Compress(IV, blockWords, 0, BLOCK_SIZE_BYTES, PARENT, output);
+		std::copy_n(output, 8, chainingValue.begin());
+		totalChunks >>= 1;
+	}
+	_chainingValueStack.push_back(chainingValue);
+}
+
+}
+}
+}
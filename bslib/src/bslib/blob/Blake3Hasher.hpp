@@ -0,0 +1,46 @@
+#pragma once
+
+#include "bslib/blob/Hasher.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+/**
+ * BLAKE3 with a 256 bit digest
+ */
+class Blake3Hasher : public Hasher
+{
+public:
+	Blake3Hasher();
+
+	void Update(const uint8_t* data, size_t size) override;
+	void Finalize(uint8_t* digest) override;
+	const char* GetImplementationName() const override;
+private:
+	typedef std::array<uint32_t, 8> ChainingValue;
+
+	static const size_t BLOCK_SIZE_BYTES = 64;
+	static const size_t CHUNK_SIZE_BYTES = 1024;
+
+	void CompressBlock(uint32_t flags);
+	void AddChunkChainingValue(ChainingValue chainingValue, uint64_t totalChunks);
+
+	// Chaining values of completed subtrees, one for each bit set in the chunk count
+	std::vector<ChainingValue> _chainingValueStack;
+
+	// The chunk being hashed
+	ChainingValue _chunkChainingValue;
+	uint64_t _chunkCounter;
+	std::array<uint8_t, BLOCK_SIZE_BYTES> _block;
+	size_t _blockSize;
+	size_t _blocksCompressed;
+};
+
+}
+}
+}
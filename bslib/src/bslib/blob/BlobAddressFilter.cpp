@@ -0,0 +1,348 @@
+#include "bslib/blob/BlobAddressFilter.hpp"
+
+#include "bslib/blob/exceptions.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+namespace {
+const char FILE_MAGIC[4] = { 'B', 'S', 'B', 'F' };
+const uint32_t FILE_VERSION = 3;
+
+// Smallest filter worth allocating, about 120KiB at the default rate
+const uint64_t MIN_CAPACITY = 1 << 16;
+const uint32_t MAX_HASH_COUNT = 16;
+
+// Each layer's false positive rate is this times the last's, so the rates of all of them sum to at most the filter's
+const double LAYER_TIGHTENING_RATIO = 0.5;
+
+uint64_t ReadUInt64(const uint8_t* bytes)
+{
+	uint64_t value;
+	std::memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+template <typename T>
+void Write(std::ostream& output, const T& value)
+{
+	output.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool Read(std::istream& input, T& value)
+{
+	return static_cast<bool>(input.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+uint64_t GetBitCount(uint64_t capacity, double falsePositiveRate)
+{
+	const auto ln2 = std::log(2.0);
+	const auto bits = -static_cast<double>(capacity) * std::log(falsePositiveRate) / (ln2 * ln2);
+	return std::max<uint64_t>(64, static_cast<uint64_t>(std::ceil(bits)));
+}
+
+uint32_t GetHashCount(uint64_t capacity, uint64_t bitCount)
+{
+	const auto hashes = std::round(static_cast<double>(bitCount) / static_cast<double>(capacity) * std::log(2.0));
+	return std::min(MAX_HASH_COUNT, std::max<uint32_t>(1, static_cast<uint32_t>(hashes)));
+}
+
+// The digest is already uniformly distributed, so derive the probes from it directly (Kirsch-Mitzenmacher double hashing)
+void GetProbeHashes(const Address& address, uint64_t& h1, uint64_t& h2)
+{
+	const auto digest = address.GetDigest();
+	h1 = ReadUInt64(digest) ^ static_cast<uint64_t>(address.GetAlgorithm());
+	h2 = ReadUInt64(digest + 8) | 1;
+}
+}
+
+const double BlobAddressFilter::DEFAULT_FALSE_POSITIVE_RATE = 0.01;
+
+BlobAddressFilter::Layer::Layer(uint64_t capacity, uint64_t bitCount, uint32_t hashCount)
+	: capacity(capacity)
+	, bitCount(bitCount)
+	, hashCount(hashCount)
+	, words(new std::atomic<uint64_t>[GetWordCount()]())
+	, count(0)
+{
+}
+
+void BlobAddressFilter::Layer::Add(uint64_t h1, uint64_t h2)
+{
+	for (auto i = 0U; i < hashCount; ++i)
+	{
+		const auto bit = (h1 + i * h2) % bitCount;
+		words[bit / 64].fetch_or(1ULL << (bit % 64), std::memory_order_relaxed);
+	}
+	++count;
+}
+
+bool BlobAddressFilter::Layer::MayContain(uint64_t h1, uint64_t h2) const
+{
+	for (auto i = 0U; i < hashCount; ++i)
+	{
+		const auto bit = (h1 + i * h2) % bitCount;
+		if ((words[bit / 64].load(std::memory_order_relaxed) & (1ULL << (bit % 64))) == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+BlobAddressFilter::BlobAddressFilter(uint64_t capacity, double falsePositiveRate)
+	: BlobAddressFilter(falsePositiveRate, MakeLayer(std::max(capacity, MIN_CAPACITY), falsePositiveRate, 0))
+{
+}
+
+BlobAddressFilter::BlobAddressFilter(double falsePositiveRate, std::unique_ptr<Layer> firstLayer)
+	: _falsePositiveRate(falsePositiveRate)
+	, _layerCount(0)
+	, _lookups(0)
+	, _possibleHits(0)
+	, _falsePositives(0)
+{
+	AddLayerNoLock(std::move(firstLayer));
+}
+
+std::unique_ptr<BlobAddressFilter::Layer> BlobAddressFilter::MakeLayer(uint64_t capacity, double falsePositiveRate, size_t index)
+{
+	const auto layerRate = falsePositiveRate * (1 - LAYER_TIGHTENING_RATIO) * std::pow(LAYER_TIGHTENING_RATIO, static_cast<double>(index));
+	const auto bitCount = GetBitCount(capacity, layerRate);
+	return std::make_unique<Layer>(capacity, bitCount, GetHashCount(capacity, bitCount));
+}
+
+void BlobAddressFilter::AddLayerNoLock(std::unique_ptr<Layer> layer)
+{
+	const auto index = _layerCount.load();
+	_layers[index] = std::move(layer);
+	_layerCount.store(index + 1, std::memory_order_release);
+}
+
+void BlobAddressFilter::Add(const Address& address)
+{
+	uint64_t h1;
+	uint64_t h2;
+	GetProbeHashes(address, h1, h2);
+
+	// Addresses go in the newest layer, which once full is followed by a larger one rather than saturating
+	auto& layer = *_layers[_layerCount.load(std::memory_order_acquire) - 1];
+	layer.Add(h1, h2);
+	if (layer.count > layer.capacity)
+	{
+		std::lock_guard<std::mutex> lock(_growMutex);
+		const auto layerCount = _layerCount.load();
+		if (_layers[layerCount - 1].get() == &layer && layerCount < MAX_LAYER_COUNT)
+		{
+			AddLayerNoLock(MakeLayer(layer.capacity * 2, _falsePositiveRate, layerCount));
+		}
+	}
+}
+
+bool BlobAddressFilter::MayContain(const Address& address) const
+{
+	++_lookups;
+	uint64_t h1;
+	uint64_t h2;
+	GetProbeHashes(address, h1, h2);
+
+	const auto layerCount = _layerCount.load(std::memory_order_acquire);
+	for (auto i = 0U; i < layerCount; ++i)
+	{
+		if (_layers[i]->MayContain(h1, h2))
+		{
+			++_possibleHits;
+			return true;
+		}
+	}
+	return false;
+}
+
+void BlobAddressFilter::RecordFalsePositive() const
+{
+	++_falsePositives;
+}
+
+uint64_t BlobAddressFilter::GetCapacity() const
+{
+	uint64_t capacity = 0;
+	const auto layerCount = _layerCount.load(std::memory_order_acquire);
+	for (auto i = 0U; i < layerCount; ++i)
+	{
+		capacity += _layers[i]->capacity;
+	}
+	return capacity;
+}
+
+uint64_t BlobAddressFilter::GetCount() const
+{
+	uint64_t count = 0;
+	const auto layerCount = _layerCount.load(std::memory_order_acquire);
+	for (auto i = 0U; i < layerCount; ++i)
+	{
+		count += _layers[i]->count;
+	}
+	return count;
+}
+
+BlobAddressFilterStats BlobAddressFilter::GetStats() const
+{
+	BlobAddressFilterStats stats;
+	stats.lookups = _lookups;
+	stats.possibleHits = _possibleHits;
+	stats.falsePositives = _falsePositives;
+	return stats;
+}
+
+void BlobAddressFilter::Save(const boost::filesystem::path& path, uint64_t blobCount, int64_t blobChangeCount) const
+{
+	// Write then swap, such that a crash mid-write never leaves a truncated filter behind
+	auto tempPath = path;
+	tempPath += ".tmp";
+	{
+		boost::filesystem::ofstream output(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!output)
+		{
+			throw BlobAddressFilterSaveFailedException(tempPath.string());
+		}
+
+		const auto layerCount = static_cast<uint32_t>(_layerCount.load(std::memory_order_acquire));
+		output.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+		Write(output, FILE_VERSION);
+		Write(output, _falsePositiveRate);
+		Write(output, blobCount);
+		Write(output, blobChangeCount);
+		Write(output, layerCount);
+		for (auto i = 0U; i < layerCount; ++i)
+		{
+			const auto& layer = *_layers[i];
+			Write(output, layer.capacity);
+			Write(output, layer.bitCount);
+			Write(output, layer.hashCount);
+			Write(output, layer.count.load());
+			const auto wordCount = layer.GetWordCount();
+			for (auto j = 0ULL; j < wordCount; ++j)
+			{
+				Write(output, layer.words[j].load(std::memory_order_relaxed));
+			}
+		}
+
+		output.close();
+		if (!output)
+		{
+			throw BlobAddressFilterSaveFailedException(tempPath.string());
+		}
+	}
+
+	boost::system::error_code ec;
+	boost::filesystem::rename(tempPath, path, ec);
+	if (ec)
+	{
+		throw BlobAddressFilterSaveFailedException(path.string());
+	}
+}
+
+std::unique_ptr<BlobAddressFilter> BlobAddressFilter::Load(const boost::filesystem::path& path, uint64_t blobCount, int64_t blobChangeCount)
+{
+	boost::filesystem::ifstream input(path, std::ios::in | std::ios::binary);
+	if (!input)
+	{
+		return nullptr;
+	}
+
+	char magic[sizeof(FILE_MAGIC)];
+	uint32_t version;
+	double falsePositiveRate;
+	uint64_t savedBlobCount;
+	int64_t savedBlobChangeCount;
+	uint32_t layerCount;
+	if (!input.read(magic, sizeof(magic))
+		|| std::memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0
+		|| !Read(input, version)
+		|| version != FILE_VERSION
+		|| !Read(input, falsePositiveRate)
+		|| !Read(input, savedBlobCount)
+		|| !Read(input, savedBlobChangeCount)
+		|| !Read(input, layerCount))
+	{
+		return nullptr;
+	}
+
+	// Blobs added or removed since the filter was saved would be missing or wrongly present
+	if (savedBlobCount != blobCount || savedBlobChangeCount != blobChangeCount)
+	{
+		return nullptr;
+	}
+
+	boost::system::error_code ec;
+	const auto fileSizeBytes = boost::filesystem::file_size(path, ec);
+	if (ec || !(falsePositiveRate > 0 && falsePositiveRate < 1) || layerCount == 0 || layerCount > MAX_LAYER_COUNT)
+	{
+		return nullptr;
+	}
+
+	std::unique_ptr<BlobAddressFilter> filter;
+	for (auto i = 0U; i < layerCount; ++i)
+	{
+		uint64_t capacity;
+		uint64_t bitCount;
+		uint32_t hashCount;
+		uint64_t count;
+		if (!Read(input, capacity)
+			|| !Read(input, bitCount)
+			|| !Read(input, hashCount)
+			|| !Read(input, count))
+		{
+			return nullptr;
+		}
+
+		// Don't trust the header enough to allocate from it unless the file holds as many words as it implies
+		const auto wordsSizeBytes = (bitCount + 63) / 64 * sizeof(uint64_t);
+		const auto positionBytes = static_cast<uint64_t>(input.tellg());
+		if (capacity == 0 || bitCount == 0 || hashCount == 0 || hashCount > MAX_HASH_COUNT
+			|| fileSizeBytes < positionBytes || fileSizeBytes - positionBytes < wordsSizeBytes)
+		{
+			return nullptr;
+		}
+
+		auto layer = std::make_unique<Layer>(capacity, bitCount, hashCount);
+		const auto wordCount = layer->GetWordCount();
+		for (auto j = 0ULL; j < wordCount; ++j)
+		{
+			uint64_t word;
+			if (!Read(input, word))
+			{
+				return nullptr;
+			}
+			layer->words[j].store(word, std::memory_order_relaxed);
+		}
+		layer->count = count;
+		if (filter)
+		{
+			filter->AddLayerNoLock(std::move(layer));
+		}
+		else
+		{
+			filter.reset(new BlobAddressFilter(falsePositiveRate, std::move(layer)));
+		}
+	}
+
+	if (static_cast<uint64_t>(input.tellg()) != fileSizeBytes)
+	{
+		return nullptr;
+	}
+	return filter;
+}
+
+}
+}
+}
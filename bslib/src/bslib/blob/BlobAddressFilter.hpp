@@ -0,0 +1,127 @@
+#pragma once
+
+#include "bslib/blob/Address.hpp"
+
+#include <boost/filesystem/path.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+struct BlobAddressFilterStats
+{
+	BlobAddressFilterStats()
+		: lookups(0)
+		, possibleHits(0)
+		, falsePositives(0)
+	{
+	}
+
+	/**
+	 * Ratio of lookups for unknown addresses that the filter couldn't rule out
+	 */
+	double GetFalsePositiveRate() const
+	{
+		const auto negatives = lookups - possibleHits + falsePositives;
+		return negatives == 0 ? 0.0 : static_cast<double>(falsePositives) / static_cast<double>(negatives);
+	}
+
+	uint64_t lookups;
+	uint64_t possibleHits;
+	uint64_t falsePositives;
+};
+
+/**
+ * Bloom filter of known blob addresses, used to skip database lookups for blobs that have definitely never been stored.
+ * The filter may report addresses that were never added (false positives), but never misses an address that was added.
+ * Once more addresses are added than it was sized for, it grows by chaining a layer twice the size of the last, each
+ * with a lower false positive rate such that the rate of the whole filter stays near the one it was created with.
+ * \remarks Thread safe
+ */
+class BlobAddressFilter
+{
+public:
+	/**
+	 * Creates an empty filter sized to hold the given number of addresses at roughly the given false positive rate
+	 */
+	explicit BlobAddressFilter(uint64_t capacity, double falsePositiveRate = DEFAULT_FALSE_POSITIVE_RATE);
+
+	void Add(const Address& address);
+
+	/**
+	 * \return false if the address has definitely not been added, otherwise true
+	 */
+	bool MayContain(const Address& address) const;
+
+	/**
+	 * Records that an address the filter may have contained wasn't actually known
+	 */
+	void RecordFalsePositive() const;
+
+	// Of all of the filter's layers
+	uint64_t GetCapacity() const;
+	uint64_t GetCount() const;
+	size_t GetLayerCount() const { return _layerCount; }
+	BlobAddressFilterStats GetStats() const;
+
+	/**
+	 * Saves the filter to the given path, stamped with the state of the blob table it reflects.
+	 * \exception BlobAddressFilterSaveFailedException The filter couldn't be written
+	 */
+	void Save(const boost::filesystem::path& path, uint64_t blobCount, int64_t blobChangeCount) const;
+
+	/**
+	 * Loads a filter saved with Save, provided it reflects the given state of the blob table.
+	 * \return The filter, or nullptr if it doesn't exist, is stale or is corrupt
+	 */
+	static std::unique_ptr<BlobAddressFilter> Load(const boost::filesystem::path& path, uint64_t blobCount, int64_t blobChangeCount);
+
+	static const double DEFAULT_FALSE_POSITIVE_RATE;
+private:
+	// Each doubles the capacity of the filter, so this many is never reached
+	static const size_t MAX_LAYER_COUNT = 32;
+
+	struct Layer
+	{
+		Layer(uint64_t capacity, uint64_t bitCount, uint32_t hashCount);
+
+		uint64_t GetWordCount() const { return (bitCount + 63) / 64; }
+		void Add(uint64_t h1, uint64_t h2);
+		bool MayContain(uint64_t h1, uint64_t h2) const;
+
+		const uint64_t capacity;
+		const uint64_t bitCount;
+		const uint32_t hashCount;
+		std::unique_ptr<std::atomic<uint64_t>[]> words;
+		std::atomic<uint64_t> count;
+	};
+
+	BlobAddressFilter(double falsePositiveRate, std::unique_ptr<Layer> firstLayer);
+
+	/**
+	 * Makes a layer sized to hold the given number of addresses, at the false positive rate of its position in a filter
+	 */
+	static std::unique_ptr<Layer> MakeLayer(uint64_t capacity, double falsePositiveRate, size_t index);
+	void AddLayerNoLock(std::unique_ptr<Layer> layer);
+
+	const double _falsePositiveRate;
+
+	// Layers are only ever added, and are published by incrementing the count once they're in place
+	std::array<std::unique_ptr<Layer>, MAX_LAYER_COUNT> _layers;
+	std::atomic<size_t> _layerCount;
+	std::mutex _growMutex;
+
+	mutable std::atomic<uint64_t> _lookups;
+	mutable std::atomic<uint64_t> _possibleHits;
+	mutable std::atomic<uint64_t> _falsePositives;
+};
+
+}
+}
+}
@@ -0,0 +1,120 @@
+#include "bslib/blob/BlobGarbageCollector.hpp"
+
+#include "bslib/log.hpp"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <thread>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+namespace {
+// Low enough that hardly any unknown blobs are kept, at under 2 bytes per blob in the catalog
+const double MARK_FALSE_POSITIVE_RATE = 0.001;
+}
+
+BlobGarbageCollector::BlobGarbageCollector(
+	BlobInfoRepository& blobInfoRepository,
+	StoreBlobRepository& storeBlobRepository,
+	const std::vector<std::shared_ptr<BlobStore>>& stores,
+	const GarbageCollectionSettings& settings)
+	: _blobInfoRepository(blobInfoRepository)
+	, _storeBlobRepository(storeBlobRepository)
+	, _stores(stores)
+	, _settings(settings)
+	, _deleteCount(0)
+{
+}
+
+GarbageCollectionResult BlobGarbageCollector::Collect()
+{
+	GarbageCollectionResult result;
+	const auto marked = Mark(result);
+
+	_deletesStarted = std::chrono::steady_clock::now();
+	_deleteCount = 0;
+	for (const auto& store : _stores)
+	{
+		Sweep(*store, *marked, result);
+	}
+
+	result.catalogBlobsRemoved = _blobInfoRepository.RemoveUnreferencedBlobs();
+	_storeBlobRepository.RemoveUnknownBlobs();
+
+	BSLIB_LOG_INFO << "Garbage collection deleted " << result.blobsDeleted << " of " << result.storedBlobs << " stored blobs, reclaiming "
+		<< result.bytesReclaimed << " bytes, and removed " << result.catalogBlobsRemoved << " unreferenced blobs from the catalog";
+	return result;
+}
+
+std::unique_ptr<BlobAddressFilter> BlobGarbageCollector::Mark(GarbageCollectionResult& result) const
+{
+	auto marked = std::make_unique<BlobAddressFilter>(_blobInfoRepository.GetBlobCount(), MARK_FALSE_POSITIVE_RATE);
+	_blobInfoRepository.VisitBlobAddresses([&](const Address& address) {
+		marked->Add(address);
+		++result.catalogBlobs;
+	});
+	return marked;
+}
+
+void BlobGarbageCollector::Sweep(BlobStore& store, const BlobAddressFilter& marked, GarbageCollectionResult& result)
+{
+	// Blobs written after this may belong to backups that haven't been committed
+	const auto graceStartUtc = boost::posix_time::second_clock::universal_time() - _settings.gracePeriod;
+
+	// Deleted once they're all listed, rather than changing the store as it's listed
+	std::vector<StoredBlob> unknownBlobs;
+	const auto listed = store.ListBlobs([&](const StoredBlob& blob) {
+		++result.storedBlobs;
+		if (marked.MayContain(blob.address))
+		{
+			return;
+		}
+
+		if (blob.lastWriteUtc >= graceStartUtc)
+		{
+			++result.blobsInGracePeriod;
+			return;
+		}
+		unknownBlobs.push_back(blob);
+	});
+	if (!listed)
+	{
+		BSLIB_LOG_DEBUG << "Skipping garbage collection of blob store " << store.GetId().ToString() << " as it can't list its blobs";
+		++result.storesSkipped;
+		return;
+	}
+
+	for (const auto& blob : unknownBlobs)
+	{
+		WaitToDelete();
+		try
+		{
+			store.DeleteBlob(blob.address);
+			++result.blobsDeleted;
+			result.bytesReclaimed += blob.sizeBytes;
+		}
+		catch (const BlobStoreError& e)
+		{
+			// Left for the next collection
+			BSLIB_LOG_WARNING << "Failed to delete unknown blob " << blob.address.ToString() << ": " << e.what();
+			++result.blobsFailedToDelete;
+		}
+	}
+}
+
+void BlobGarbageCollector::WaitToDelete()
+{
+	if (_settings.maxDeletesPerSecond > 0)
+	{
+		const auto due = _deletesStarted + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(_deleteCount / _settings.maxDeletesPerSecond));
+		std::this_thread::sleep_until(due);
+	}
+	++_deleteCount;
+}
+
+}
+}
+}
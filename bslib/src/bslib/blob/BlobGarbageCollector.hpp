@@ -0,0 +1,60 @@
+#pragma once
+
+#include "bslib/blob/BlobAddressFilter.hpp"
+#include "bslib/blob/BlobInfoRepository.hpp"
+#include "bslib/blob/BlobStore.hpp"
+#include "bslib/blob/GarbageCollectionSettings.hpp"
+#include "bslib/blob/StoreBlobRepository.hpp"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+/**
+ * Deletes blobs from stores that the catalog doesn't know, such as those written by backups that failed before they
+ * were committed, and removes blobs from the catalog that nothing refers to any more.
+ * Every blob in the catalog is marked in a filter, then each store is listed and the blobs that aren't marked are
+ * deleted, and finally the catalog's unreferenced blobs are removed. Blobs removed from the catalog are only deleted
+ * from stores by the next collection, once the removal is committed, so the catalog never knows a deleted blob even if
+ * the collection doesn't finish.
+ * \remarks The filter can mistake a few unknown blobs for known ones, which are kept until a later collection
+ */
+class BlobGarbageCollector
+{
+public:
+	BlobGarbageCollector(
+		BlobInfoRepository& blobInfoRepository,
+		StoreBlobRepository& storeBlobRepository,
+		const std::vector<std::shared_ptr<BlobStore>>& stores,
+		const GarbageCollectionSettings& settings);
+
+	/**
+	 * Deletes unknown blobs from every store that can list its blobs, the catalog is changed in the caller's transaction
+	 * \exception BlobStoreError A store couldn't be listed
+	 */
+	GarbageCollectionResult Collect();
+private:
+	std::unique_ptr<BlobAddressFilter> Mark(GarbageCollectionResult& result) const;
+	void Sweep(BlobStore& store, const BlobAddressFilter& marked, GarbageCollectionResult& result);
+
+	/**
+	 * Waits until another blob can be deleted without going over the delete rate
+	 */
+	void WaitToDelete();
+
+	BlobInfoRepository& _blobInfoRepository;
+	StoreBlobRepository& _storeBlobRepository;
+	const std::vector<std::shared_ptr<BlobStore>> _stores;
+	const GarbageCollectionSettings _settings;
+
+	std::chrono::steady_clock::time_point _deletesStarted;
+	uint64_t _deleteCount;
+};
+
+}
+}
+}
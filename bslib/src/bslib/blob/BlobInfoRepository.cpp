@@ -3,6 +3,7 @@
 
 #include "bslib/blob/BlobInfo.hpp"
 #include "bslib/blob/exceptions.hpp"
+#include "bslib/sqlitepp/exceptions.hpp"
 #include "bslib/sqlitepp/sqlitepp.hpp"
 
 #include <boost/format.hpp>
@@ -25,14 +26,50 @@ enum FindBlobColumnIndex
 {
 	FindBlob_ColumnIndex_SizeBytes = 0
 };
+
+enum GetBlobChunksColumnIndex
+{
+	GetBlobChunks_ColumnIndex_ChunkAddress = 0
+};
+
+enum GetBlobAddressesColumnIndex
+{
+	GetBlobAddresses_ColumnIndex_Address = 0
+};
+
+enum GetBlobCountColumnIndex
+{
+	GetBlobCount_ColumnIndex_Count = 0
+};
 }
 
 BlobInfoRepository::BlobInfoRepository(const sqlitepp::ScopedSqlite3Object& connection)
+	: BlobInfoRepository(connection, nullptr)
+{
+}
+
+BlobInfoRepository::BlobInfoRepository(const sqlitepp::ScopedSqlite3Object& connection, std::shared_ptr<BlobAddressFilter> addressFilter)
 	: _db(connection)
+	, _addressFilter(addressFilter)
 {
 	sqlitepp::prepare_or_throw(_db, "INSERT INTO Blob (Address, SizeBytes) VALUES (:Address, :SizeBytes)", _insertBlobStatement);
 	sqlitepp::prepare_or_throw(_db, "SELECT Address, SizeBytes FROM Blob", _getAllBlobsStatement);
 	sqlitepp::prepare_or_throw(_db, "SELECT SizeBytes FROM Blob WHERE Address = :Address", _findBlobStatement);
+	sqlitepp::prepare_or_throw(_db, "INSERT INTO BlobChunk (BlobAddress, ChunkIndex, ChunkAddress) VALUES (:BlobAddress, :ChunkIndex, :ChunkAddress)", _insertBlobChunkStatement);
+	sqlitepp::prepare_or_throw(_db, "SELECT ChunkAddress FROM BlobChunk WHERE BlobAddress = :BlobAddress ORDER BY ChunkIndex", _getBlobChunksStatement);
+	sqlitepp::prepare_or_throw(_db, "SELECT Address FROM Blob", _getBlobAddressesStatement);
+	sqlitepp::prepare_or_throw(_db, "SELECT COUNT(*) FROM Blob", _getBlobCountStatement);
+
+	// Chunks go first, so the blobs they were chunks of no longer refer to them
+	sqlitepp::prepare_or_throw(_db, R"(
+		DELETE FROM BlobChunk
+		WHERE BlobAddress NOT IN (SELECT ContentBlobAddress FROM FileEvent WHERE ContentBlobAddress IS NOT NULL)
+	)", _removeUnreferencedBlobChunksStatement);
+	sqlitepp::prepare_or_throw(_db, R"(
+		DELETE FROM Blob
+		WHERE Address NOT IN (SELECT ContentBlobAddress FROM FileEvent WHERE ContentBlobAddress IS NOT NULL)
+		AND Address NOT IN (SELECT ChunkAddress FROM BlobChunk)
+	)", _removeUnreferencedBlobsStatement);
 }
 
 std::vector<std::shared_ptr<BlobInfo>> BlobInfoRepository::GetAllBlobs() const
@@ -52,6 +89,34 @@ std::vector<std::shared_ptr<BlobInfo>> BlobInfoRepository::GetAllBlobs() const
 	return result;
 }
 
+void BlobInfoRepository::VisitBlobAddresses(const std::function<void(const Address& address)>& visit) const
+{
+	sqlitepp::ScopedStatementReset reset(_getBlobAddressesStatement);
+
+	auto stepResult = 0;
+	while ((stepResult = sqlite3_step(_getBlobAddressesStatement)) == SQLITE_ROW)
+	{
+		const auto addressBytesCount = sqlite3_column_bytes(_getBlobAddressesStatement, GetBlobAddresses_ColumnIndex_Address);
+		const auto addressBytes = sqlite3_column_blob(_getBlobAddressesStatement, GetBlobAddresses_ColumnIndex_Address);
+		visit(Address(addressBytes, addressBytesCount));
+	}
+	if (stepResult != SQLITE_DONE)
+	{
+		throw ExecuteFailedException(stepResult);
+	}
+}
+
+uint64_t BlobInfoRepository::GetBlobCount() const
+{
+	sqlitepp::ScopedStatementReset reset(_getBlobCountStatement);
+	const auto stepResult = sqlite3_step(_getBlobCountStatement);
+	if (stepResult != SQLITE_ROW)
+	{
+		throw ExecuteFailedException(stepResult);
+	}
+	return static_cast<uint64_t>(sqlite3_column_int64(_getBlobCountStatement, GetBlobCount_ColumnIndex_Count));
+}
+
 void BlobInfoRepository::AddBlob(const BlobInfo& info)
 {
 	// binary address, note this has to be kept in scope until SQLite has finished as we've opted not to make a copy
@@ -60,6 +125,12 @@ void BlobInfoRepository::AddBlob(const BlobInfo& info)
 	sqlitepp::BindByParameterNameBlob(_insertBlobStatement, ":Address", &binaryAddress[0], binaryAddress.size());
 	sqlitepp::BindByParameterNameInt64(_insertBlobStatement, ":SizeBytes", static_cast<int64_t>(info.GetSizeBytes()));
 
+	// Added up front, such that the filter never misses a blob even if other connections look for it before this commits
+	if (_addressFilter)
+	{
+		_addressFilter->Add(info.GetAddress());
+	}
+
 	// execute
 	const auto stepResult = sqlite3_step(_insertBlobStatement);
 	if (stepResult != SQLITE_DONE)
@@ -74,6 +145,11 @@ void BlobInfoRepository::AddBlob(const BlobInfo& info)
 
 std::unique_ptr<BlobInfo> BlobInfoRepository::FindBlob(const Address& address)
 {
+	if (_addressFilter && !_addressFilter->MayContain(address))
+	{
+		return std::unique_ptr<BlobInfo>();
+	}
+
 	const auto binaryAddress = address.ToBinary();
 	sqlitepp::ScopedStatementReset reset(_findBlobStatement);
 	sqlitepp::BindByParameterNameBlob(_findBlobStatement, ":Address", &binaryAddress[0], binaryAddress.size());
@@ -81,6 +157,10 @@ std::unique_ptr<BlobInfo> BlobInfoRepository::FindBlob(const Address& address)
 	const auto stepResult = sqlite3_step(_findBlobStatement);
 	if (stepResult != SQLITE_ROW)
 	{
+		if (_addressFilter)
+		{
+			_addressFilter->RecordFalsePositive();
+		}
 		return std::unique_ptr<BlobInfo>();
 	}
 
@@ -88,6 +168,62 @@ std::unique_ptr<BlobInfo> BlobInfoRepository::FindBlob(const Address& address)
 	return std::make_unique<BlobInfo>(address, sizeBytes);
 }
 
+void BlobInfoRepository::AddBlobChunks(const Address& address, const std::vector<Address>& chunkAddresses)
+{
+	const auto binaryAddress = address.ToBinary();
+	for (auto i = 0U; i < chunkAddresses.size(); ++i)
+	{
+		const auto binaryChunkAddress = chunkAddresses[i].ToBinary();
+		sqlitepp::ScopedStatementReset reset(_insertBlobChunkStatement);
+		sqlitepp::BindByParameterNameBlob(_insertBlobChunkStatement, ":BlobAddress", &binaryAddress[0], binaryAddress.size());
+		sqlitepp::BindByParameterNameInt64(_insertBlobChunkStatement, ":ChunkIndex", i);
+		sqlitepp::BindByParameterNameBlob(_insertBlobChunkStatement, ":ChunkAddress", &binaryChunkAddress[0], binaryChunkAddress.size());
+
+		const auto stepResult = sqlite3_step(_insertBlobChunkStatement);
+		if (stepResult != SQLITE_DONE)
+		{
+			throw AddBlobFailedException((boost::format("Failed to execute statement for insert chunk %1% of blob %2%. SQLite error %3%") % i % address.ToString() % stepResult).str());
+		}
+	}
+}
+
+std::vector<Address> BlobInfoRepository::GetBlobChunks(const Address& address) const
+{
+	std::vector<Address> result;
+	const auto binaryAddress = address.ToBinary();
+	sqlitepp::ScopedStatementReset reset(_getBlobChunksStatement);
+	sqlitepp::BindByParameterNameBlob(_getBlobChunksStatement, ":BlobAddress", &binaryAddress[0], binaryAddress.size());
+
+	auto stepResult = 0;
+	while ((stepResult = sqlite3_step(_getBlobChunksStatement)) == SQLITE_ROW)
+	{
+		const auto addressBytesCount = sqlite3_column_bytes(_getBlobChunksStatement, GetBlobChunks_ColumnIndex_ChunkAddress);
+		const auto addressBytes = sqlite3_column_blob(_getBlobChunksStatement, GetBlobChunks_ColumnIndex_ChunkAddress);
+		result.push_back(Address(addressBytes, addressBytesCount));
+	}
+	return result;
+}
+
+uint64_t BlobInfoRepository::RemoveUnreferencedBlobs()
+{
+	{
+		sqlitepp::ScopedStatementReset reset(_removeUnreferencedBlobChunksStatement);
+		const auto stepResult = sqlite3_step(_removeUnreferencedBlobChunksStatement);
+		if (stepResult != SQLITE_DONE)
+		{
+			throw ExecuteFailedException(stepResult);
+		}
+	}
+
+	sqlitepp::ScopedStatementReset reset(_removeUnreferencedBlobsStatement);
+	const auto stepResult = sqlite3_step(_removeUnreferencedBlobsStatement);
+	if (stepResult != SQLITE_DONE)
+	{
+		throw ExecuteFailedException(stepResult);
+	}
+	return static_cast<uint64_t>(sqlite3_changes(_db));
+}
+
 }
 }
 }
\ No newline at end of file
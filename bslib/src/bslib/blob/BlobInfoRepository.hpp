@@ -1,10 +1,12 @@
 #pragma once
 
 #include "bslib/blob/address.hpp"
+#include "bslib/blob/BlobAddressFilter.hpp"
 #include "bslib/blob/BlobInfo.hpp"
 #include "bslib/sqlitepp/handles.hpp"
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -23,11 +25,27 @@ public:
 	 */
 	explicit BlobInfoRepository(const sqlitepp::ScopedSqlite3Object& connection);
 
+	/**
+	 * Creates a new blob info repository that consults the given filter before looking up blobs, and keeps it up to date as blobs are added
+	 */
+	BlobInfoRepository(const sqlitepp::ScopedSqlite3Object& connection, std::shared_ptr<BlobAddressFilter> addressFilter);
+
 	/**
 	 * Returns all of the blobs known.
 	 */
 	std::vector<std::shared_ptr<BlobInfo>> GetAllBlobs() const;
 
+	/**
+	 * Calls the given function with the address of every blob known, without holding them all in memory
+	 * \throws ExecuteFailedException The blobs couldn't be read
+	 */
+	void VisitBlobAddresses(const std::function<void(const Address& address)>& visit) const;
+
+	/**
+	 * Gets the number of blobs known
+	 */
+	uint64_t GetBlobCount() const;
+
 	/**
 	 * Adds a blob.
 	 * \throws DuplicateBlobException if the address has already been stored
@@ -35,15 +53,42 @@ public:
 	void AddBlob(const BlobInfo& info);
 
 	/**
-	 * Finds a blob by address.
+	 * Finds a blob by address, the database is only queried if the address filter (if any) may contain the address.
 	 * \return a NULL pointer if the blob couldn't be found, else its information.
 	 */
 	std::unique_ptr<BlobInfo> FindBlob(const blob::Address& address);
+
+	/**
+	 * Records the chunks that make up the content of a blob, in order.
+	 */
+	void AddBlobChunks(const Address& address, const std::vector<Address>& chunkAddresses);
+
+	/**
+	 * Gets the chunks that make up the content of a blob, in order.
+	 * \return The chunk addresses, empty if the blob is stored whole.
+	 */
+	std::vector<Address> GetBlobChunks(const Address& address) const;
+
+	/**
+	 * Removes the blobs that no file event refers to, either directly or as a chunk of a blob it refers to, along
+	 * with their chunks.
+	 * \remarks The address filter isn't updated, as it may contain addresses that aren't known anyway
+	 * \throws ExecuteFailedException The blobs couldn't be removed
+	 * \return The number of blobs removed
+	 */
+	uint64_t RemoveUnreferencedBlobs();
 private:
 	const sqlitepp::ScopedSqlite3Object& _db;
+	const std::shared_ptr<BlobAddressFilter> _addressFilter;
 	sqlitepp::ScopedStatement _getAllBlobsStatement;
 	sqlitepp::ScopedStatement _insertBlobStatement;
 	sqlitepp::ScopedStatement _findBlobStatement;
+	sqlitepp::ScopedStatement _insertBlobChunkStatement;
+	sqlitepp::ScopedStatement _getBlobChunksStatement;
+	sqlitepp::ScopedStatement _getBlobAddressesStatement;
+	sqlitepp::ScopedStatement _getBlobCountStatement;
+	sqlitepp::ScopedStatement _removeUnreferencedBlobChunksStatement;
+	sqlitepp::ScopedStatement _removeUnreferencedBlobsStatement;
 };
 
 }
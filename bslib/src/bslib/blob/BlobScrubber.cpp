@@ -0,0 +1,197 @@
+#include "bslib/blob/BlobScrubber.hpp"
+
+#include "bslib/blob/AddressCalculator.hpp"
+#include "bslib/log.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+namespace {
+// Number of blobs looked up and read at a time, the damage and cursor are committed after each batch
+const unsigned SCRUB_BATCH_SIZE = 1000;
+
+const char* ToString(BlobDamage damage)
+{
+	switch (damage)
+	{
+		case BlobDamage::Missing:
+			return "missing";
+		case BlobDamage::Corrupt:
+			return "corrupt";
+	}
+	return "damaged";
+}
+}
+
+BlobScrubber::BlobScrubber(
+	StoreBlobRepository& storeBlobRepository,
+	const std::vector<std::shared_ptr<BlobStore>>& stores,
+	const ScrubSettings& settings,
+	const std::function<void()>& commitBatch)
+	: _storeBlobRepository(storeBlobRepository)
+	, _stores(stores)
+	, _settings(settings)
+	, _commitBatch(commitBatch)
+	, _bytesRead(0)
+{
+}
+
+ScrubResult BlobScrubber::Scrub()
+{
+	ScrubResult result;
+	_readsStarted = std::chrono::steady_clock::now();
+	_bytesRead = 0;
+
+	result.complete = true;
+	for (const auto& store : _stores)
+	{
+		if (!ScrubStore(*store, result))
+		{
+			result.complete = false;
+			break;
+		}
+	}
+
+	BSLIB_LOG_INFO << "Scrubbed " << result.blobsScrubbed << " blobs of " << result.bytesScrubbed << " bytes, "
+		<< result.blobsMissing << " were missing and " << result.blobsCorrupt << " were corrupt";
+	return result;
+}
+
+bool BlobScrubber::ScrubStore(const BlobStore& store, ScrubResult& result)
+{
+	const auto storeId = store.GetId();
+	auto after = _storeBlobRepository.GetScrubCursor(storeId);
+	while (true)
+	{
+		auto limit = SCRUB_BATCH_SIZE;
+		if (_settings.maxBlobs > 0)
+		{
+			const auto remaining = _settings.maxBlobs - std::min(_settings.maxBlobs, result.blobsScrubbed);
+			if (remaining == 0)
+			{
+				return false;
+			}
+			limit = static_cast<unsigned>(std::min<uint64_t>(limit, remaining));
+		}
+
+		const auto addresses = _storeBlobRepository.GetStoreBlobs(storeId, after, limit);
+		if (addresses.empty())
+		{
+			// The next scrub starts again from the beginning
+			_storeBlobRepository.SetScrubCursor(storeId, boost::none);
+			_commitBatch();
+			return true;
+		}
+
+		std::vector<Check> checks;
+		checks.reserve(addresses.size());
+		for (const auto& address : addresses)
+		{
+			checks.push_back(Check{ address, 0, boost::none });
+		}
+		CheckBlobs(store, checks);
+
+		// Only written once the batch is read, so the catalog is locked for writing just while it's committed
+		for (const auto& check : checks)
+		{
+			++result.blobsScrubbed;
+			result.bytesScrubbed += check.sizeBytes;
+			if (!check.damage)
+			{
+				continue;
+			}
+
+			BSLIB_LOG_WARNING << "Blob " << check.address.ToString() << " is " << ToString(*check.damage) << " in blob store " << storeId;
+			_storeBlobRepository.AddDamagedBlob(storeId, check.address, *check.damage);
+			if (*check.damage == BlobDamage::Missing)
+			{
+				++result.blobsMissing;
+			}
+			else
+			{
+				++result.blobsCorrupt;
+			}
+		}
+
+		after = addresses.back();
+		_storeBlobRepository.SetScrubCursor(storeId, after);
+		_commitBatch();
+	}
+}
+
+void BlobScrubber::CheckBlobs(const BlobStore& store, std::vector<Check>& checks)
+{
+	auto threadCount = _settings.threads > 0 ? _settings.threads : std::max(std::thread::hardware_concurrency(), 1U);
+	threadCount = std::min<size_t>(threadCount, checks.size());
+
+	// Each thread takes the next unchecked blob, so a large blob doesn't hold up the blobs behind it
+	std::atomic<size_t> next(0);
+	const auto run = [&]() {
+		for (auto i = next++; i < checks.size(); i = next++)
+		{
+			CheckBlob(store, checks[i]);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (auto i = 1U; i < threadCount; ++i)
+	{
+		threads.emplace_back(run);
+	}
+	run();
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void BlobScrubber::CheckBlob(const BlobStore& store, Check& check)
+{
+	BlobView content;
+	try
+	{
+		content = store.GetStoredBlobView(check.address);
+	}
+	catch (const std::exception& e)
+	{
+		BSLIB_LOG_DEBUG << "Failed to read blob " << check.address.ToString() << " while scrubbing: " << e.what();
+		check.damage = BlobDamage::Missing;
+		return;
+	}
+
+	check.sizeBytes = content.GetSizeBytes();
+	WaitForRead(check.sizeBytes);
+
+	AddressCalculator addressCalculator(check.address.GetAlgorithm());
+	addressCalculator.Update(content.GetData(), content.GetSizeBytes());
+	if (addressCalculator.Finalize() != check.address)
+	{
+		check.damage = BlobDamage::Corrupt;
+	}
+}
+
+void BlobScrubber::WaitForRead(uint64_t sizeBytes)
+{
+	if (_settings.maxBytesPerSecond <= 0)
+	{
+		return;
+	}
+
+	std::chrono::steady_clock::time_point due;
+	{
+		std::unique_lock<std::mutex> lock(_readMutex);
+		due = _readsStarted + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(_bytesRead / _settings.maxBytesPerSecond));
+		_bytesRead += sizeBytes;
+	}
+	std::this_thread::sleep_until(due);
+}
+
+}
+}
+}
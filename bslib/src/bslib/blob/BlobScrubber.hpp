@@ -0,0 +1,83 @@
+#pragma once
+
+#include "bslib/blob/Address.hpp"
+#include "bslib/blob/BlobStore.hpp"
+#include "bslib/blob/ScrubSettings.hpp"
+#include "bslib/blob/StoreBlobRepository.hpp"
+
+#include <boost/optional.hpp>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+/**
+ * Reads back the blobs recorded in each store and checks that they still hash to their address, so that damage is
+ * found while the blob can still be stored again, rather than when it's restored.
+ * Each store is scrubbed in order of address, from a cursor saved in the catalog, so a scrub that's stopped carries on
+ * where it left off. Damaged blobs are recorded and are no longer recorded as stored in the store, so copying missing
+ * blobs or backing up the file again stores them once more.
+ * \remarks Stores are read by several threads at once
+ */
+class BlobScrubber
+{
+public:
+	/**
+	 * \param commitBatch Commits the damage and cursor recorded for a batch, so a scrub that's stopped keeps its
+	 * progress, and the catalog isn't locked for writing while blobs are read
+	 */
+	BlobScrubber(
+		StoreBlobRepository& storeBlobRepository,
+		const std::vector<std::shared_ptr<BlobStore>>& stores,
+		const ScrubSettings& settings,
+		const std::function<void()>& commitBatch);
+
+	/**
+	 * Scrubs each store from its cursor, until every store has been scrubbed or the settings' number of blobs have
+	 * been read. The damage and cursor are committed after each batch.
+	 */
+	ScrubResult Scrub();
+private:
+	struct Check
+	{
+		Address address;
+		uint64_t sizeBytes;
+		boost::optional<BlobDamage> damage;
+	};
+
+	/**
+	 * Scrubs one store from its cursor
+	 * \return Whether the store was scrubbed to the end
+	 */
+	bool ScrubStore(const BlobStore& store, ScrubResult& result);
+
+	/**
+	 * Reads and hashes the given blobs on the settings' number of threads
+	 */
+	void CheckBlobs(const BlobStore& store, std::vector<Check>& checks);
+	void CheckBlob(const BlobStore& store, Check& check);
+
+	/**
+	 * Waits until the given number of bytes have been read without going over the read rate
+	 */
+	void WaitForRead(uint64_t sizeBytes);
+
+	StoreBlobRepository& _storeBlobRepository;
+	const std::vector<std::shared_ptr<BlobStore>> _stores;
+	const ScrubSettings _settings;
+	const std::function<void()> _commitBatch;
+
+	std::mutex _readMutex;
+	std::chrono::steady_clock::time_point _readsStarted;
+	uint64_t _bytesRead;
+};
+
+}
+}
+}
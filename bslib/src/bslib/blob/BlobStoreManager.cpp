@@ -1,7 +1,12 @@
 #include "bslib/blob/BlobStoreManager.hpp"
 
+#include "bslib/blob/CachingBlobStore.hpp"
+#include "bslib/blob/CompressedBlobStore.hpp"
 #include "bslib/blob/DirectoryBlobStore.hpp"
 #include "bslib/blob/NullBlobStore.hpp"
+#include "bslib/blob/PackBlobStore.hpp"
+#include "bslib/blob/S3BlobStore.hpp"
+#include "bslib/blob/WriteBehindBlobStore.hpp"
 #include "bslib/blob/exceptions.hpp"
 
 #include <boost/filesystem.hpp>
@@ -33,7 +38,9 @@ void BlobStoreManager::LoadFromSettingsFile()
 	{
 		for (const auto& store : settings["stores"])
 		{
-			AddBlobStoreNoLock(store.at("type").get<std::string>(), store.at("settings"));
+			// Kept across restarts, as blobs are recorded against the store they're in
+			const Uuid id(store.at("id").get<std::string>());
+			AddBlobStoreNoLock(id, store.at("type").get<std::string>(), store.at("settings"));
 		}
 	}
 }
@@ -76,23 +83,62 @@ BlobStore& BlobStoreManager::AddBlobStore(std::shared_ptr<BlobStore> store)
 BlobStore& BlobStoreManager::AddBlobStore(const UTF8String& typeString, const nlohmann::json& settings)
 {
 	std::unique_lock<std::mutex> lock(_mutex);
-	return AddBlobStoreNoLock(typeString, settings);
+	return AddBlobStoreNoLock(Uuid::Create(), typeString, settings);
 }
 
-BlobStore& BlobStoreManager::AddBlobStoreNoLock(const UTF8String& typeString, const nlohmann::json& settings)
+BlobStore& BlobStoreManager::AddBlobStoreNoLock(const Uuid& id, const UTF8String& typeString, const nlohmann::json& settings)
 {
+	std::shared_ptr<BlobStore> store;
 	if (typeString == DirectoryBlobStore::TYPE)
 	{
-		_stores.push_back(std::make_shared<DirectoryBlobStore>(Uuid::Create(), settings));
+		store = std::make_shared<DirectoryBlobStore>(id, settings);
+	}
+	else if (typeString == PackBlobStore::TYPE)
+	{
+		store = std::make_shared<PackBlobStore>(id, settings);
+	}
+	else if (typeString == S3BlobStore::TYPE)
+	{
+		store = std::make_shared<S3BlobStore>(id, settings);
 	}
 	else if (typeString == NullBlobStore::TYPE)
 	{
-		_stores.push_back(std::make_shared<NullBlobStore>(Uuid::Create()));
+		store = std::make_shared<NullBlobStore>(id);
 	}
 	else
 	{
 		throw InvalidBlobStoreTypeException(typeString + " is not a valid blob store type");
 	}
+
+	// Any type of store can be compressed
+	const auto compression = settings.find(CompressedBlobStore::SETTINGS_KEY);
+	if (compression != settings.end())
+	{
+		store = std::make_shared<CompressedBlobStore>(store, compression->get<std::string>());
+	}
+
+	// Outside compression, so blobs are compressed on the writer threads
+	const auto writeBehind = settings.find(WriteBehindBlobStore::SETTINGS_KEY);
+	if (writeBehind != settings.end())
+	{
+		store = std::make_shared<WriteBehindBlobStore>(store, *writeBehind);
+	}
+	else if (typeString == S3BlobStore::TYPE)
+	{
+		// Each request waits on the network, so blobs are written on a thread per connection unless told otherwise
+		WriteBehindBlobStoreSettings writeBehindSettings;
+		writeBehindSettings.writerThreads = S3BlobStore::ParseSettings(settings).maxConnections;
+		store = std::make_shared<WriteBehindBlobStore>(store, writeBehindSettings);
+	}
+
+	// Outermost, so blobs are cached decompressed and blobs still being written can be cached
+	const auto cache = settings.find(CachingBlobStore::SETTINGS_KEY);
+	if (cache != settings.end())
+	{
+		store = std::make_shared<CachingBlobStore>(store, *cache);
+	}
+
+	_stores.push_back(store);
 	return *_stores.back();
 }
 
@@ -0,0 +1,54 @@
+#include "bslib/blob/BlobView.hpp"
+
+#include "bslib/blob/BlobStore.hpp"
+
+#include <stdexcept>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+BlobView::BlobView()
+	: _data(nullptr)
+	, _size(0)
+{
+}
+
+BlobView::BlobView(std::vector<uint8_t> content)
+{
+	// Moved into the owner, so the view doesn't copy the content
+	const auto owner = std::make_shared<const std::vector<uint8_t>>(std::move(content));
+	_data = owner->data();
+	_size = owner->size();
+	_owner = owner;
+}
+
+BlobView::BlobView(std::shared_ptr<const void> owner, const uint8_t* data, size_t size)
+	: _owner(owner)
+	, _data(data)
+	, _size(size)
+{
+}
+
+BlobView BlobView::GetRange(size_t offset, size_t size) const
+{
+	if (offset > _size || size > _size - offset)
+	{
+		throw std::out_of_range("Range is outside of the blob");
+	}
+	return BlobView(_owner, _data + offset, size);
+}
+
+std::vector<uint8_t> BlobView::ToVector() const
+{
+	return std::vector<uint8_t>(begin(), end());
+}
+
+BlobView BlobStore::GetBlobView(const Address& address) const
+{
+	return BlobView(GetBlob(address));
+}
+
+}
+}
+}
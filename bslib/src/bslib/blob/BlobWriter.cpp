@@ -0,0 +1,32 @@
+#include "bslib/blob/BlobWriter.hpp"
+
+#include "bslib/blob/BlobStore.hpp"
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+BufferedBlobWriter::BufferedBlobWriter(BlobStore& blobStore)
+	: _blobStore(blobStore)
+{
+}
+
+void BufferedBlobWriter::Write(const uint8_t* data, size_t size)
+{
+	_content.insert(_content.end(), data, data + size);
+}
+
+void BufferedBlobWriter::Commit(const Address& address)
+{
+	_blobStore.CreateBlob(address, _content);
+	std::vector<uint8_t>().swap(_content);
+}
+
+std::unique_ptr<BlobWriter> BlobStore::CreateBlobWriter()
+{
+	return std::make_unique<BufferedBlobWriter>(*this);
+}
+
+}
+}
+}
@@ -0,0 +1,359 @@
+#include "bslib/blob/CachingBlobStore.hpp"
+
+#include "bslib/blob/exceptions.hpp"
+#include "bslib/log.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <tuple>
+#include <utility>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+const std::string CachingBlobStore::SETTINGS_KEY = "cache";
+
+namespace {
+const std::string INCOMING_PREFIX = ".incoming-";
+
+bool ReadCachedFile(const boost::filesystem::path& path, std::vector<uint8_t>& result)
+{
+	std::ifstream f(path.string(), std::ios::in | std::ifstream::binary);
+	if (f.fail())
+	{
+		return false;
+	}
+
+	f.seekg(0, std::ios::end);
+	const auto end = f.tellg();
+	if (end < 0)
+	{
+		return false;
+	}
+	const auto sizeBytes = static_cast<size_t>(end);
+	f.seekg(0, std::ios::beg);
+	result.resize(sizeBytes);
+	if (sizeBytes > 0)
+	{
+		f.read(reinterpret_cast<char*>(&result[0]), sizeBytes);
+	}
+	return static_cast<size_t>(f.gcount()) == sizeBytes;
+}
+
+void RemoveCachedFiles(const std::vector<boost::filesystem::path>& paths)
+{
+	for (const auto& path : paths)
+	{
+		boost::system::error_code ec;
+		boost::filesystem::remove(path, ec);
+	}
+}
+}
+
+CachingBlobStore::CachingBlobStore(std::shared_ptr<BlobStore> inner, const CachingBlobStoreSettings& settings)
+	: _inner(inner)
+	, _settings(settings)
+	, _diskEnabled(settings.maxDiskBytes > 0 && !settings.diskPath.empty())
+{
+	if (_diskEnabled)
+	{
+		LoadDiskCache();
+	}
+}
+
+CachingBlobStore::CachingBlobStore(std::shared_ptr<BlobStore> inner, const nlohmann::json& settings)
+	: CachingBlobStore(inner, ParseSettings(settings))
+{
+}
+
+CachingBlobStoreSettings CachingBlobStore::ParseSettings(const nlohmann::json& settings)
+{
+	CachingBlobStoreSettings result;
+	result.maxMemoryBytes = settings.value("maxMemoryBytes", result.maxMemoryBytes);
+	result.maxDiskBytes = settings.value("maxDiskBytes", result.maxDiskBytes);
+	result.diskPath = settings.value("diskPath", std::string());
+	return result;
+}
+
+void CachingBlobStore::CreateBlob(const Address& address, const std::vector<uint8_t>& content)
+{
+	_inner->CreateBlob(address, content);
+}
+
+void CachingBlobStore::CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath)
+{
+	_inner->CreateNamedBlob(name, sourcePath);
+}
+
+void CachingBlobStore::DeleteBlob(const Address& address)
+{
+	_inner->DeleteBlob(address);
+
+	bool cachedOnDisk;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		RemoveNoLock(_memory, address);
+		cachedOnDisk = RemoveNoLock(_disk, address);
+	}
+	if (cachedOnDisk)
+	{
+		RemoveCachedFiles({ GetDiskPath(address) });
+	}
+}
+
+std::vector<uint8_t> CachingBlobStore::GetBlob(const Address& address) const
+{
+	return GetBlobView(address).ToVector();
+}
+
+BlobView CachingBlobStore::GetBlobView(const Address& address) const
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (TouchNoLock(_memory, address))
+		{
+			++_stats.memoryHits;
+			return _memory.entries.at(address).value;
+		}
+	}
+
+	std::vector<uint8_t> cached;
+	if (ReadFromDisk(address, cached))
+	{
+		const BlobView view(std::move(cached));
+		std::unique_lock<std::mutex> lock(_mutex);
+		++_stats.diskHits;
+		AddToMemoryNoLock(address, view);
+		return view;
+	}
+
+	auto view = _inner->GetBlobView(address);
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		++_stats.misses;
+	}
+
+	if (_diskEnabled && view.GetSizeBytes() <= _settings.maxDiskBytes)
+	{
+		WriteToDisk(address, view);
+	}
+	if (view.GetSizeBytes() <= _settings.maxMemoryBytes)
+	{
+		// Copied, as the inner store's view may refer to the file it's stored in
+		view = BlobView(view.ToVector());
+		std::unique_lock<std::mutex> lock(_mutex);
+		AddToMemoryNoLock(address, view);
+	}
+	return view;
+}
+
+nlohmann::json CachingBlobStore::ConvertToJson() const
+{
+	auto result = _inner->ConvertToJson();
+	nlohmann::json settings;
+	settings["maxMemoryBytes"] = _settings.maxMemoryBytes;
+	settings["maxDiskBytes"] = _settings.maxDiskBytes;
+	settings["diskPath"] = _settings.diskPath.string();
+	result[SETTINGS_KEY] = settings;
+	return result;
+}
+
+BlobCacheStats CachingBlobStore::GetCacheStats() const
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto result = _stats;
+	result.memoryBytes = _memory.sizeBytes;
+	result.diskBytes = _disk.sizeBytes;
+	return result;
+}
+
+void CachingBlobStore::LoadDiskCache()
+{
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(_settings.diskPath, ec);
+	if (ec)
+	{
+		BSLIB_LOG_WARNING << "Failed to create blob cache directory " << _settings.diskPath << ", blobs won't be cached on disk: " << ec.message();
+		_diskEnabled = false;
+		return;
+	}
+
+	// Files were touched when they were last read, so the oldest are the least recently used
+	std::vector<std::tuple<std::time_t, Address, boost::filesystem::path, uint64_t>> files;
+	for (boost::filesystem::directory_iterator it(_settings.diskPath, ec), end; !ec && it != end; it.increment(ec))
+	{
+		const auto& path = it->path();
+		const auto filename = path.filename().string();
+		if (filename.compare(0, INCOMING_PREFIX.size(), INCOMING_PREFIX) == 0)
+		{
+			// Left behind by a write that didn't finish
+			RemoveCachedFiles({ path });
+			continue;
+		}
+
+		try
+		{
+			const Address address(filename);
+			boost::system::error_code fileEc;
+			const auto sizeBytes = boost::filesystem::file_size(path, fileEc);
+			const auto lastWriteTime = boost::filesystem::last_write_time(path, fileEc);
+			if (!fileEc)
+			{
+				files.emplace_back(lastWriteTime, address, path, sizeBytes);
+			}
+		}
+		catch (const InvalidAddressException&)
+		{
+			// Not a cached blob
+		}
+	}
+
+	std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) {
+		return std::get<0>(a) < std::get<0>(b);
+	});
+	for (const auto& file : files)
+	{
+		AddNoLock(_disk, std::get<1>(file), std::get<2>(file), std::get<3>(file));
+	}
+	RemoveCachedFiles(EvictNoLock(_disk, _settings.maxDiskBytes));
+}
+
+bool CachingBlobStore::ReadFromDisk(const Address& address, std::vector<uint8_t>& content) const
+{
+	boost::filesystem::path path;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (!_diskEnabled || !TouchNoLock(_disk, address))
+		{
+			return false;
+		}
+		path = _disk.entries.at(address).value;
+	}
+
+	if (!ReadCachedFile(path, content))
+	{
+		BSLIB_LOG_WARNING << "Failed to read cached blob " << path << ", reading it from the store instead";
+		std::unique_lock<std::mutex> lock(_mutex);
+		RemoveNoLock(_disk, address);
+		return false;
+	}
+
+	// So the order blobs were used in is kept between runs
+	boost::system::error_code ec;
+	boost::filesystem::last_write_time(path, std::time(nullptr), ec);
+	return true;
+}
+
+void CachingBlobStore::WriteToDisk(const Address& address, const BlobView& content) const
+{
+	const auto incomingPath = _settings.diskPath / (INCOMING_PREFIX + Uuid::Create().ToDashlessString());
+	const auto path = GetDiskPath(address);
+	{
+		std::ofstream f(incomingPath.string(), std::ios::out | std::ofstream::binary);
+		f.write(reinterpret_cast<const char*>(content.GetData()), content.GetSizeBytes());
+		f.close();
+		if (f.fail())
+		{
+			BSLIB_LOG_WARNING << "Failed to write cached blob " << incomingPath;
+			RemoveCachedFiles({ incomingPath });
+			return;
+		}
+	}
+
+	// Renamed once it's complete, so a cached file is never partly written
+	boost::system::error_code ec;
+	boost::filesystem::rename(incomingPath, path, ec);
+	if (ec)
+	{
+		BSLIB_LOG_WARNING << "Failed to move cached blob to " << path << ": " << ec.message();
+		RemoveCachedFiles({ incomingPath });
+		return;
+	}
+
+	std::vector<boost::filesystem::path> evicted;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (!TouchNoLock(_disk, address))
+		{
+			AddNoLock(_disk, address, path, content.GetSizeBytes());
+		}
+		evicted = EvictNoLock(_disk, _settings.maxDiskBytes);
+	}
+	RemoveCachedFiles(evicted);
+}
+
+void CachingBlobStore::AddToMemoryNoLock(const Address& address, const BlobView& content) const
+{
+	if (content.GetSizeBytes() > _settings.maxMemoryBytes || TouchNoLock(_memory, address))
+	{
+		return;
+	}
+	AddNoLock(_memory, address, content, content.GetSizeBytes());
+	EvictNoLock(_memory, _settings.maxMemoryBytes);
+}
+
+template<typename T>
+bool CachingBlobStore::TouchNoLock(Tier<T>& tier, const Address& address)
+{
+	const auto entry = tier.entries.find(address);
+	if (entry == tier.entries.end())
+	{
+		return false;
+	}
+	tier.recentlyUsed.splice(tier.recentlyUsed.begin(), tier.recentlyUsed, entry->second.position);
+	return true;
+}
+
+template<typename T>
+void CachingBlobStore::AddNoLock(Tier<T>& tier, const Address& address, T value, uint64_t sizeBytes)
+{
+	tier.recentlyUsed.push_front(address);
+	typename Tier<T>::Entry entry;
+	entry.value = std::move(value);
+	entry.sizeBytes = sizeBytes;
+	entry.position = tier.recentlyUsed.begin();
+	tier.entries[address] = std::move(entry);
+	tier.sizeBytes += sizeBytes;
+}
+
+template<typename T>
+bool CachingBlobStore::RemoveNoLock(Tier<T>& tier, const Address& address)
+{
+	const auto entry = tier.entries.find(address);
+	if (entry == tier.entries.end())
+	{
+		return false;
+	}
+	tier.sizeBytes -= entry->second.sizeBytes;
+	tier.recentlyUsed.erase(entry->second.position);
+	tier.entries.erase(entry);
+	return true;
+}
+
+template<typename T>
+std::vector<T> CachingBlobStore::EvictNoLock(Tier<T>& tier, uint64_t maxSizeBytes)
+{
+	std::vector<T> evicted;
+	while (tier.sizeBytes > maxSizeBytes && !tier.recentlyUsed.empty())
+	{
+		const auto entry = tier.entries.find(tier.recentlyUsed.back());
+		tier.sizeBytes -= entry->second.sizeBytes;
+		evicted.push_back(std::move(entry->second.value));
+		tier.entries.erase(entry);
+		tier.recentlyUsed.pop_back();
+	}
+	return evicted;
+}
+
+boost::filesystem::path CachingBlobStore::GetDiskPath(const Address& address) const
+{
+	return _settings.diskPath / address.ToString();
+}
+
+}
+}
+}
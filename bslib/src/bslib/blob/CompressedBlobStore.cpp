@@ -0,0 +1,469 @@
+#include "bslib/blob/CompressedBlobStore.hpp"
+
+#include "bslib/blob/AddressCalculator.hpp"
+#include "bslib/blob/exceptions.hpp"
+#include "bslib/blob/Lz4.hpp"
+
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+const std::string CompressedBlobStore::SETTINGS_KEY = "compression";
+
+namespace {
+// Starts every blob written through the decorator, followed by the codec and the size of the content
+const uint8_t FRAME_MAGIC[4] = { 'B', 'S', 'Z', 0x01 };
+const size_t FRAME_HEADER_SIZE_BYTES = sizeof(FRAME_MAGIC) + sizeof(uint8_t) + sizeof(uint64_t);
+
+// Content above this is about as dense as compressed data, so isn't worth trying to compress
+const double MAX_COMPRESSIBLE_ENTROPY_BITS_PER_BYTE = 7.5;
+
+// Sampled from across the content, so the probe is cheap however large the blob is
+const size_t ENTROPY_SAMPLE_COUNT = 16;
+const size_t ENTROPY_SAMPLE_SIZE_BYTES = 4096;
+
+// Compressed content has to be at least this much smaller to be worth decompressing on every read
+const double MIN_SAVINGS_RATIO = 1.0 / 32;
+
+// Streamed content is compressed this much at a time, which is also the most a chunk can hold
+const size_t CHUNK_SIZE_BYTES = 1024 * 1024;
+
+// Precedes each chunk of a chunked frame with the size of its content and the size it's stored as, which are the same
+// if it isn't compressed
+const size_t CHUNK_HEADER_SIZE_BYTES = 2 * sizeof(uint32_t);
+
+std::vector<uint8_t> MakeFrameHeader(CompressionCodec codec, uint64_t sizeBytes)
+{
+	std::vector<uint8_t> header(FRAME_MAGIC, FRAME_MAGIC + sizeof(FRAME_MAGIC));
+	header.push_back(static_cast<uint8_t>(codec));
+	const auto sizeBytesStart = reinterpret_cast<const uint8_t*>(&sizeBytes);
+	header.insert(header.end(), sizeBytesStart, sizeBytesStart + sizeof(sizeBytes));
+	return header;
+}
+
+/**
+ * Compresses content if the codec compresses it, it doesn't look random, and it's worth it
+ * \return false if the content should be stored as is
+ */
+bool TryCompress(const uint8_t* data, size_t size, CompressionCodec codec, std::vector<uint8_t>& compressed)
+{
+	if (codec != CompressionCodec::Lz4 || size == 0
+		|| CompressedBlobStore::EstimateEntropyBitsPerByte(data, size) > MAX_COMPRESSIBLE_ENTROPY_BITS_PER_BYTE)
+	{
+		return false;
+	}
+	Lz4CompressBlock(data, size, compressed);
+	return compressed.size() < size - static_cast<size_t>(size * MIN_SAVINGS_RATIO);
+}
+
+/**
+ * Appends a chunk of a chunked frame, compressed if it's worth it
+ */
+void AppendChunk(const uint8_t* data, size_t size, CompressionCodec codec, std::vector<uint8_t>& stored)
+{
+	std::vector<uint8_t> compressed;
+	const auto isCompressed = TryCompress(data, size, codec, compressed);
+	const uint32_t header[] = {
+		static_cast<uint32_t>(size),
+		static_cast<uint32_t>(isCompressed ? compressed.size() : size)
+	};
+	const auto headerStart = reinterpret_cast<const uint8_t*>(header);
+	stored.insert(stored.end(), headerStart, headerStart + sizeof(header));
+	if (isCompressed)
+	{
+		stored.insert(stored.end(), compressed.begin(), compressed.end());
+	}
+	else
+	{
+		stored.insert(stored.end(), data, data + size);
+	}
+}
+
+/**
+ * Reads the header of the chunk at the given offset of a chunked frame's payload
+ * \return false if the chunk doesn't fit in the payload, or is larger than a chunk can be
+ */
+bool ReadChunkHeader(
+	const uint8_t* payload,
+	size_t payloadSizeBytes,
+	size_t offset,
+	uint64_t maxChunkSizeBytes,
+	uint32_t& chunkSizeBytes,
+	uint32_t& storedSizeBytes)
+{
+	if (payloadSizeBytes - offset < CHUNK_HEADER_SIZE_BYTES)
+	{
+		return false;
+	}
+	std::memcpy(&chunkSizeBytes, &payload[offset], sizeof(chunkSizeBytes));
+	std::memcpy(&storedSizeBytes, &payload[offset + sizeof(chunkSizeBytes)], sizeof(storedSizeBytes));
+
+	// Guards against allocating from a corrupt header, LZ4 can't expand more than 255 times
+	return chunkSizeBytes <= maxChunkSizeBytes
+		&& storedSizeBytes <= chunkSizeBytes
+		&& chunkSizeBytes / 255 <= storedSizeBytes
+		&& storedSizeBytes <= payloadSizeBytes - offset - CHUNK_HEADER_SIZE_BYTES;
+}
+
+/**
+ * Finds the content of a stored blob, which is either a range of the stored blob or decompressed from it
+ * \return false if the blob is framed but can't be decoded
+ */
+bool DecodeFrame(
+	const uint8_t* stored,
+	size_t storedSizeBytes,
+	size_t& contentOffset,
+	size_t& contentSizeBytes,
+	boost::optional<std::vector<uint8_t>>& decompressed)
+{
+	if (storedSizeBytes < FRAME_HEADER_SIZE_BYTES || std::memcmp(stored, FRAME_MAGIC, sizeof(FRAME_MAGIC)) != 0)
+	{
+		// Written before the store was compressed
+		contentOffset = 0;
+		contentSizeBytes = storedSizeBytes;
+		return true;
+	}
+
+	const auto codec = static_cast<CompressionCodec>(stored[sizeof(FRAME_MAGIC)]);
+	uint64_t sizeBytes;
+	std::memcpy(&sizeBytes, &stored[sizeof(FRAME_MAGIC) + 1], sizeof(sizeBytes));
+	const auto payload = stored + FRAME_HEADER_SIZE_BYTES;
+	const auto payloadSizeBytes = storedSizeBytes - FRAME_HEADER_SIZE_BYTES;
+
+	switch (codec)
+	{
+		case CompressionCodec::None:
+			if (payloadSizeBytes != sizeBytes)
+			{
+				return false;
+			}
+			contentOffset = FRAME_HEADER_SIZE_BYTES;
+			contentSizeBytes = payloadSizeBytes;
+			return true;
+
+		case CompressionCodec::Lz4:
+			// Guards against allocating from a corrupt header, LZ4 can't expand more than 255 times
+			if (sizeBytes / 255 > payloadSizeBytes)
+			{
+				return false;
+			}
+			decompressed = std::vector<uint8_t>(static_cast<size_t>(sizeBytes));
+			return Lz4DecompressBlock(payload, payloadSizeBytes, decompressed->data(), decompressed->size());
+
+		case CompressionCodec::Lz4Chunks:
+		{
+			// The size in the header is the most a chunk can hold, the size of the content is the total of the chunks
+			uint64_t totalSizeBytes = 0;
+			uint32_t chunkSizeBytes;
+			uint32_t chunkStoredSizeBytes;
+			for (size_t offset = 0; offset < payloadSizeBytes; offset += CHUNK_HEADER_SIZE_BYTES + chunkStoredSizeBytes)
+			{
+				if (!ReadChunkHeader(payload, payloadSizeBytes, offset, sizeBytes, chunkSizeBytes, chunkStoredSizeBytes))
+				{
+					return false;
+				}
+				totalSizeBytes += chunkSizeBytes;
+			}
+
+			decompressed = std::vector<uint8_t>(static_cast<size_t>(totalSizeBytes));
+			auto chunkContent = decompressed->data();
+			for (size_t offset = 0; offset < payloadSizeBytes; offset += CHUNK_HEADER_SIZE_BYTES + chunkStoredSizeBytes)
+			{
+				ReadChunkHeader(payload, payloadSizeBytes, offset, sizeBytes, chunkSizeBytes, chunkStoredSizeBytes);
+				const auto chunkStored = payload + offset + CHUNK_HEADER_SIZE_BYTES;
+				if (chunkStoredSizeBytes == chunkSizeBytes)
+				{
+					std::memcpy(chunkContent, chunkStored, chunkSizeBytes);
+				}
+				else if (!Lz4DecompressBlock(chunkStored, chunkStoredSizeBytes, chunkContent, chunkSizeBytes))
+				{
+					return false;
+				}
+				chunkContent += chunkSizeBytes;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+}
+
+/**
+ * Compresses content a chunk at a time into a writer of the inner store. The first chunk is held back until there's
+ * more content, so a blob that fits in a chunk is framed as CreateBlob would frame it.
+ */
+class CompressedBlobStore::Writer : public BlobWriter
+{
+public:
+	explicit Writer(CompressedBlobStore& store)
+		: _store(store)
+		, _inner(store._inner->CreateBlobWriter())
+		, _chunked(false)
+		, _contentBytes(0)
+		, _storedBytes(0)
+		, _elapsed(0)
+	{
+		_chunk.reserve(CHUNK_SIZE_BYTES);
+	}
+
+	void Write(const uint8_t* data, size_t size) override
+	{
+		while (size > 0)
+		{
+			if (_chunk.size() == CHUNK_SIZE_BYTES)
+			{
+				WriteChunk();
+			}
+
+			const auto count = std::min(size, CHUNK_SIZE_BYTES - _chunk.size());
+			_chunk.insert(_chunk.end(), data, data + count);
+			data += count;
+			size -= count;
+		}
+	}
+
+	void Commit(const Address& address) override
+	{
+		if (_chunked)
+		{
+			WriteChunk();
+		}
+		else
+		{
+			const auto start = std::chrono::steady_clock::now();
+			const auto stored = Encode(_chunk, _store._codec);
+			_elapsed += std::chrono::steady_clock::now() - start;
+			WriteStored(_chunk.size(), stored);
+		}
+		_inner->Commit(address);
+		_store.AddEncoded(_contentBytes, _storedBytes, _elapsed);
+	}
+
+private:
+	void WriteChunk()
+	{
+		const auto start = std::chrono::steady_clock::now();
+		std::vector<uint8_t> stored;
+		if (!_chunked)
+		{
+			stored = MakeFrameHeader(CompressionCodec::Lz4Chunks, CHUNK_SIZE_BYTES);
+			_chunked = true;
+		}
+		AppendChunk(_chunk.data(), _chunk.size(), _store._codec, stored);
+		_elapsed += std::chrono::steady_clock::now() - start;
+		WriteStored(_chunk.size(), stored);
+		_chunk.clear();
+	}
+
+	void WriteStored(size_t contentBytes, const std::vector<uint8_t>& stored)
+	{
+		_inner->Write(stored.data(), stored.size());
+		_contentBytes += contentBytes;
+		_storedBytes += stored.size();
+	}
+
+	CompressedBlobStore& _store;
+	const std::unique_ptr<BlobWriter> _inner;
+	std::vector<uint8_t> _chunk;
+	bool _chunked;
+	uint64_t _contentBytes;
+	uint64_t _storedBytes;
+	std::chrono::steady_clock::duration _elapsed;
+};
+
+CompressedBlobStore::CompressedBlobStore(std::shared_ptr<BlobStore> inner, const UTF8String& codec)
+	: _inner(inner)
+	, _codec(ParseCodec(codec))
+	, _blobsCreated(0)
+	, _contentBytes(0)
+	, _storedBytes(0)
+	, _encodeMicroseconds(0)
+{
+}
+
+CompressionCodec CompressedBlobStore::ParseCodec(const UTF8String& codec)
+{
+	if (codec == "none")
+	{
+		return CompressionCodec::None;
+	}
+	else if (codec == "lz4")
+	{
+		return CompressionCodec::Lz4;
+	}
+	throw InvalidCompressionCodecException(codec);
+}
+
+UTF8String CompressedBlobStore::GetCodecName(CompressionCodec codec)
+{
+	switch (codec)
+	{
+		case CompressionCodec::None:
+			return "none";
+		case CompressionCodec::Lz4:
+			return "lz4";
+		case CompressionCodec::Lz4Chunks:
+			// Only chosen for streamed blobs, not in settings
+			break;
+	}
+	throw InvalidCompressionCodecException(std::to_string(static_cast<int>(codec)));
+}
+
+void CompressedBlobStore::CreateBlob(const Address& address, const std::vector<uint8_t>& content)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const auto stored = Encode(content, _codec);
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+
+	_inner->CreateBlob(address, stored);
+	AddEncoded(content.size(), stored.size(), elapsed);
+}
+
+std::unique_ptr<BlobWriter> CompressedBlobStore::CreateBlobWriter()
+{
+	return std::make_unique<Writer>(*this);
+}
+
+void CompressedBlobStore::CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath)
+{
+	_inner->CreateNamedBlob(name, sourcePath);
+}
+
+BlobView CompressedBlobStore::GetBlobView(const Address& address) const
+{
+	const auto stored = _inner->GetBlobView(address);
+	size_t contentOffset;
+	size_t contentSizeBytes;
+	boost::optional<std::vector<uint8_t>> decompressed;
+	if (DecodeFrame(stored.GetData(), stored.GetSizeBytes(), contentOffset, contentSizeBytes, decompressed))
+	{
+		// Content that isn't compressed is a view of the stored blob, rather than a copy of it
+		return decompressed ? BlobView(std::move(*decompressed)) : stored.GetRange(contentOffset, contentSizeBytes);
+	}
+
+	// Unframed content that happens to start like a frame, which is only possible if it was written without the decorator
+	AddressCalculator calculator(address.GetAlgorithm());
+	calculator.Update(stored.GetData(), stored.GetSizeBytes());
+	if (calculator.Finalize() == address)
+	{
+		return stored;
+	}
+	throw BlobReadException(address);
+}
+
+std::vector<uint8_t> CompressedBlobStore::GetBlob(const Address& address) const
+{
+	auto stored = _inner->GetBlob(address);
+	std::vector<uint8_t> content;
+	if (Decode(stored, content))
+	{
+		return content;
+	}
+
+	// Unframed content that happens to start like a frame, which is only possible if it was written without the decorator
+	if (Address::CalculateFromContent(stored, address.GetAlgorithm()) == address)
+	{
+		return stored;
+	}
+	throw BlobReadException(address);
+}
+
+nlohmann::json CompressedBlobStore::ConvertToJson() const
+{
+	auto result = _inner->ConvertToJson();
+	result[SETTINGS_KEY] = GetCodecName(_codec);
+	return result;
+}
+
+BlobStoreStats CompressedBlobStore::GetStats() const
+{
+	BlobStoreStats stats;
+	stats.blobsCreated = _blobsCreated;
+	stats.contentBytes = _contentBytes;
+	stats.storedBytes = _storedBytes;
+	stats.encodeSeconds = static_cast<double>(_encodeMicroseconds) / 1000000;
+	return stats;
+}
+
+void CompressedBlobStore::AddEncoded(uint64_t contentBytes, uint64_t storedBytes, std::chrono::steady_clock::duration elapsed)
+{
+	_blobsCreated++;
+	_contentBytes += contentBytes;
+	_storedBytes += storedBytes;
+	_encodeMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+std::vector<uint8_t> CompressedBlobStore::Encode(const std::vector<uint8_t>& content, CompressionCodec codec)
+{
+	auto stored = MakeFrameHeader(CompressionCodec::None, content.size());
+	std::vector<uint8_t> compressed;
+	if (!content.empty() && TryCompress(&content[0], content.size(), codec, compressed))
+	{
+		stored[sizeof(FRAME_MAGIC)] = static_cast<uint8_t>(CompressionCodec::Lz4);
+		stored.insert(stored.end(), compressed.begin(), compressed.end());
+		return stored;
+	}
+
+	stored.insert(stored.end(), content.begin(), content.end());
+	return stored;
+}
+
+bool CompressedBlobStore::Decode(const std::vector<uint8_t>& stored, std::vector<uint8_t>& content)
+{
+	size_t contentOffset;
+	size_t contentSizeBytes;
+	boost::optional<std::vector<uint8_t>> decompressed;
+	if (!DecodeFrame(stored.data(), stored.size(), contentOffset, contentSizeBytes, decompressed))
+	{
+		return false;
+	}
+
+	if (decompressed)
+	{
+		content.swap(*decompressed);
+	}
+	else
+	{
+		content.assign(stored.begin() + contentOffset, stored.begin() + contentOffset + contentSizeBytes);
+	}
+	return true;
+}
+
+double CompressedBlobStore::EstimateEntropyBitsPerByte(const uint8_t* data, size_t size)
+{
+	std::array<uint64_t, 256> counts = {};
+	uint64_t total = 0;
+	const auto stride = std::max(size / ENTROPY_SAMPLE_COUNT, ENTROPY_SAMPLE_SIZE_BYTES);
+	for (size_t start = 0; start < size; start += stride)
+	{
+		const auto end = std::min(size, start + ENTROPY_SAMPLE_SIZE_BYTES);
+		for (auto i = start; i < end; ++i)
+		{
+			counts[data[i]]++;
+		}
+		total += end - start;
+	}
+
+	double entropy = 0;
+	for (const auto count : counts)
+	{
+		if (count > 0)
+		{
+			const auto p = static_cast<double>(count) / static_cast<double>(total);
+			entropy -= p * std::log2(p);
+		}
+	}
+	return entropy;
+}
+
+}
+}
+}
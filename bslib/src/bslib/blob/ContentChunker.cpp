@@ -0,0 +1,127 @@
+#include "bslib/blob/ContentChunker.hpp"
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+namespace {
+typedef std::array<uint64_t, 256> GearTable;
+
+/**
+ * Random values mixed in for each byte value.
+ * \remarks Changing these moves every chunk boundary, so previously stored chunks would no longer be deduplicated
+ */
+GearTable CreateGearTable()
+{
+	// splitmix64 with a fixed seed
+	GearTable table;
+	uint64_t state = 0x6166206368756e6bULL;
+	for (auto& value : table)
+	{
+		state += 0x9e3779b97f4a7c15ULL;
+		auto z = state;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		value = z ^ (z >> 31);
+	}
+	return table;
+}
+
+const GearTable GEAR = CreateGearTable();
+
+bool IsPowerOfTwo(size_t value)
+{
+	return value != 0 && (value & (value - 1)) == 0;
+}
+
+unsigned int Log2(size_t value)
+{
+	unsigned int result = 0;
+	while (value >>= 1)
+	{
+		++result;
+	}
+	return result;
+}
+
+/**
+ * Creates a mask over the highest bits of the hash, as those depend on the most recent bytes
+ */
+uint64_t CreateMask(unsigned int bits)
+{
+	return bits == 0 ? 0 : ~uint64_t(0) << (64 - bits);
+}
+
+size_t ValidateSizes(size_t minSizeBytes, size_t averageSizeBytes, size_t maxSizeBytes)
+{
+	if (!IsPowerOfTwo(averageSizeBytes) || averageSizeBytes < 64)
+	{
+		throw InvalidChunkSizeException((boost::format("Average chunk size %1% must be a power of two of at least 64") % averageSizeBytes).str());
+	}
+
+	if (minSizeBytes == 0 || minSizeBytes > averageSizeBytes || averageSizeBytes > maxSizeBytes)
+	{
+		throw InvalidChunkSizeException((boost::format("Chunk sizes must be ordered min %1% <= average %2% <= max %3%") % minSizeBytes % averageSizeBytes % maxSizeBytes).str());
+	}
+	return averageSizeBytes;
+}
+}
+
+ContentChunker::ContentChunker(size_t minSizeBytes, size_t averageSizeBytes, size_t maxSizeBytes)
+	: _minSizeBytes(minSizeBytes)
+	, _averageSizeBytes(ValidateSizes(minSizeBytes, averageSizeBytes, maxSizeBytes))
+	, _maxSizeBytes(maxSizeBytes)
+	// Normalized chunking: cutting is harder before the average size and easier after, which narrows the size distribution
+	, _smallMask(CreateMask(Log2(averageSizeBytes) + 2))
+	, _largeMask(CreateMask(Log2(averageSizeBytes) - 2))
+{
+}
+
+size_t ContentChunker::Next(const uint8_t* data, size_t size)
+{
+	if (_chunkComplete)
+	{
+		_chunkComplete = false;
+		_chunkSizeBytes = 0;
+		_hash = 0;
+	}
+
+	size_t i = 0;
+
+	// Nothing before the minimum size can be a boundary, so there's no need to hash it
+	if (_chunkSizeBytes < _minSizeBytes)
+	{
+		const auto skip = std::min(size, _minSizeBytes - _chunkSizeBytes);
+		i += skip;
+		_chunkSizeBytes += skip;
+	}
+
+	for (; i < size; ++i)
+	{
+		if (_chunkSizeBytes >= _maxSizeBytes)
+		{
+			_chunkComplete = true;
+			return i;
+		}
+
+		_hash = (_hash << 1) + GEAR[data[i]];
+		++_chunkSizeBytes;
+
+		const auto mask = _chunkSizeBytes < _averageSizeBytes ? _smallMask : _largeMask;
+		if ((_hash & mask) == 0)
+		{
+			_chunkComplete = true;
+			return i + 1;
+		}
+	}
+
+	return size;
+}
+
+}
+}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+class InvalidChunkSizeException : public std::runtime_error
+{
+public:
+	explicit InvalidChunkSizeException(const std::string& message)
+		: std::runtime_error(message)
+	{
+	}
+};
+
+/**
+ * Finds content-defined chunk boundaries in a stream of bytes using a FastCDC style gear hash.
+ * Boundaries only depend on the bytes near them, so an insert or append only changes the chunks around the edit.
+ */
+class ContentChunker
+{
+public:
+	/**
+	 * \param minSizeBytes Chunks are never smaller than this, other than the last chunk of a stream
+	 * \param averageSizeBytes Target chunk size, must be a power of two
+	 * \param maxSizeBytes Chunks are always cut at this size
+	 * \exception InvalidChunkSizeException The sizes aren't ordered or the average isn't a power of two
+	 */
+	ContentChunker(size_t minSizeBytes, size_t averageSizeBytes, size_t maxSizeBytes);
+
+	/**
+	 * Scans the next part of the stream for the end of the current chunk.
+	 * \return The number of bytes of data that belong to the current chunk, if less than size then the chunk ends
+	 *         there and the remaining bytes should be passed to the next call.
+	 */
+	size_t Next(const uint8_t* data, size_t size);
+
+	/**
+	 * Whether the previous call to Next found the end of a chunk
+	 */
+	bool IsChunkComplete() const { return _chunkComplete; }
+
+private:
+	const size_t _minSizeBytes;
+	const size_t _averageSizeBytes;
+	const size_t _maxSizeBytes;
+	const uint64_t _smallMask;
+	const uint64_t _largeMask;
+
+	size_t _chunkSizeBytes = 0;
+	uint64_t _hash = 0;
+	bool _chunkComplete = false;
+};
+
+}
+}
+}
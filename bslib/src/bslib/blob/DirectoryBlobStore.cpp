@@ -3,12 +3,21 @@
 #include "bslib/blob/BlobInfo.hpp"
 #include "bslib/blob/BlobInfoRepository.hpp"
 #include "bslib/blob/exceptions.hpp"
+#include "bslib/file/fs/operations.hpp"
+#include "bslib/log.hpp"
+#include "bslib/unicode.hpp"
 
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/optional.hpp>
 
 #include <algorithm>
 #include <fstream>
+#include <functional>
 #include <iterator>
+#include <memory>
 #include <vector>
 
 namespace af {
@@ -16,41 +25,278 @@ namespace bslib {
 namespace blob {
 
 const std::string DirectoryBlobStore::TYPE = "directory";
+const unsigned DirectoryBlobStore::DEFAULT_FAN_OUT_DEPTH = 2;
+const unsigned DirectoryBlobStore::MAX_FAN_OUT_DEPTH = 4;
+const std::string DirectoryBlobStore::LAYOUT_FILENAME = ".layout";
 
-DirectoryBlobStore::DirectoryBlobStore(const boost::filesystem::path& rootPath)
-	: DirectoryBlobStore(Uuid::Create(), rootPath)
+namespace {
+const std::string INCOMING_PREFIX = ".incoming-";
+
+// Each level of fan out is named after this many characters of the address
+const size_t FAN_OUT_CHARACTERS = 2;
+
+// Mapping a file costs more than reading it for blobs smaller than this
+const uint64_t MIN_MAPPED_SIZE_BYTES = 64 * 1024;
+
+/**
+ * Creates the directories between the root and a blob, which are created on demand rather than up front
+ * \remarks The root itself isn't created, so writes still fail if it's removed
+ */
+void CreateFanOutDirectories(const boost::filesystem::path& rootPath, const boost::filesystem::path& blobPath)
+{
+	std::vector<boost::filesystem::path> directories;
+	for (auto parent = blobPath.parent_path(); parent != rootPath && !parent.empty(); parent = parent.parent_path())
+	{
+		directories.push_back(parent);
+	}
+
+	for (auto it = directories.rbegin(); it != directories.rend(); ++it)
+	{
+		boost::system::error_code ec;
+		boost::filesystem::create_directory(*it, ec);
+	}
+}
+
+bool ReadBlobFile(const boost::filesystem::path& blobPath, std::vector<uint8_t>& result)
+{
+	std::ifstream f(blobPath.string(), std::ios::in | std::ifstream::binary);
+	if (f.fail())
+	{
+		return false;
+	}
+
+	// Sized up front, so the content is read in one go
+	f.seekg(0, std::ios::end);
+	const auto end = f.tellg();
+	if (end < 0)
+	{
+		return false;
+	}
+	const auto sizeBytes = static_cast<size_t>(end);
+	f.seekg(0, std::ios::beg);
+	result.resize(sizeBytes);
+	if (sizeBytes > 0)
+	{
+		f.read(reinterpret_cast<char*>(&result[0]), sizeBytes);
+	}
+	return static_cast<size_t>(f.gcount()) == sizeBytes;
+}
+
+bool MapBlobFile(const boost::filesystem::path& blobPath, BlobView& result)
+{
+	boost::system::error_code ec;
+	const auto sizeBytes = boost::filesystem::file_size(blobPath, ec);
+	if (ec)
+	{
+		return false;
+	}
+
+	if (sizeBytes < MIN_MAPPED_SIZE_BYTES)
+	{
+		std::vector<uint8_t> content;
+		if (!ReadBlobFile(blobPath, content))
+		{
+			return false;
+		}
+		result = BlobView(std::move(content));
+		return true;
+	}
+
+	try
+	{
+		// The region stays mapped after the file mapping is closed
+		const boost::interprocess::file_mapping file(blobPath.string().c_str(), boost::interprocess::read_only);
+		const auto region = std::make_shared<boost::interprocess::mapped_region>(file, boost::interprocess::read_only);
+		result = BlobView(region, static_cast<const uint8_t*>(region->get_address()), region->get_size());
+		return true;
+	}
+	catch (const boost::interprocess::interprocess_exception&)
+	{
+		return false;
+	}
+}
+
+boost::optional<unsigned> ReadLayout(const boost::filesystem::path& rootPath)
+{
+	std::ifstream f((rootPath / DirectoryBlobStore::LAYOUT_FILENAME).string());
+	unsigned fanOutDepth;
+	if (!(f >> fanOutDepth))
+	{
+		return boost::none;
+	}
+	return fanOutDepth;
+}
+
+/**
+ * Writes content to a temporary file in the store, which is renamed to the blob address on commit
+ */
+class DirectoryBlobWriter : public BlobWriter
+{
+public:
+	DirectoryBlobWriter(
+		const boost::filesystem::path& rootPath,
+		unsigned fanOutDepth,
+		const std::function<void(const boost::filesystem::path&)>& onCommitted)
+		: _rootPath(rootPath)
+		, _fanOutDepth(fanOutDepth)
+		, _onCommitted(onCommitted)
+		, _incomingPath(rootPath / (INCOMING_PREFIX + Uuid::Create().ToDashlessString()))
+		, _file(_incomingPath.string(), std::ios::out | std::ofstream::binary)
+	{
+		if (!_file)
+		{
+			throw CreateBlobFailed("Failed to create incoming blob file", _incomingPath);
+		}
+	}
+
+	~DirectoryBlobWriter()
+	{
+		if (_file.is_open())
+		{
+			_file.close();
+		}
+
+		if (!_committed)
+		{
+			boost::system::error_code ec;
+			boost::filesystem::remove(_incomingPath, ec);
+		}
+	}
+
+	void Write(const uint8_t* data, size_t size) override
+	{
+		_file.write(reinterpret_cast<const char*>(data), size);
+		if (!_file)
+		{
+			throw CreateBlobFailed("Failed to write incoming blob file", _incomingPath);
+		}
+	}
+
+	void Commit(const Address& address) override
+	{
+		_file.close();
+		if (_file.fail())
+		{
+			throw CreateBlobFailed("Failed to write incoming blob file", _incomingPath);
+		}
+
+		const auto blobPath = DirectoryBlobStore::GetBlobPath(_rootPath, address, _fanOutDepth);
+		boost::system::error_code ec;
+		boost::filesystem::rename(_incomingPath, blobPath, ec);
+		if (ec)
+		{
+			CreateFanOutDirectories(_rootPath, blobPath);
+			boost::filesystem::rename(_incomingPath, blobPath, ec);
+		}
+		if (ec)
+		{
+			throw CreateBlobFailed("Failed to move incoming blob file", blobPath, ec);
+		}
+		_committed = true;
+		_onCommitted(blobPath);
+	}
+
+private:
+	const boost::filesystem::path _rootPath;
+	const unsigned _fanOutDepth;
+	const std::function<void(const boost::filesystem::path&)> _onCommitted;
+	const boost::filesystem::path _incomingPath;
+	std::ofstream _file;
+	bool _committed = false;
+};
+}
+
+DirectoryBlobStore::DirectoryBlobStore(const boost::filesystem::path& rootPath, unsigned fanOutDepth)
+	: DirectoryBlobStore(Uuid::Create(), rootPath, fanOutDepth)
 {
 }
 
 DirectoryBlobStore::DirectoryBlobStore(const Uuid& id, const nlohmann::json& settings)
-	: DirectoryBlobStore(id, boost::filesystem::path(settings.at("path")))
+	: DirectoryBlobStore(
+		id,
+		boost::filesystem::path(settings.at("path")),
+		settings.value("fanOutDepth", DEFAULT_FAN_OUT_DEPTH))
 {
 }
 
-DirectoryBlobStore::DirectoryBlobStore(const Uuid& id, const boost::filesystem::path& rootPath)
+DirectoryBlobStore::DirectoryBlobStore(const Uuid& id, const boost::filesystem::path& rootPath, unsigned fanOutDepth)
 	: _rootPath(rootPath)
 	, _id(id)
+	, _fanOutDepth(fanOutDepth)
+	, _migratingFromFanOutDepth(-1)
+	, _stopMigration(false)
 {
+	if (_fanOutDepth > MAX_FAN_OUT_DEPTH)
+	{
+		throw DirectoryBlobCreationFailed(
+			"Fan out depth can't be more than " + std::to_string(MAX_FAN_OUT_DEPTH),
+			_rootPath,
+			boost::system::errc::make_error_code(boost::system::errc::invalid_argument));
+	}
+
 	boost::system::error_code ec;
 	boost::filesystem::create_directories(_rootPath, ec);
 	if (ec)
 	{
 		throw DirectoryBlobCreationFailed("Failed to create root path", _rootPath, ec);
 	}
+
+	StartMigration();
 }
 
-void DirectoryBlobStore::CreateBlob(const Address& address, const std::vector<uint8_t>& content)
+DirectoryBlobStore::~DirectoryBlobStore()
+{
+	_stopMigration = true;
+	WaitForMigration();
+}
+
+boost::filesystem::path DirectoryBlobStore::GetBlobPath(
+	const boost::filesystem::path& rootPath,
+	const Address& address,
+	unsigned fanOutDepth)
 {
 	const auto stringAddress = address.ToString();
 
+	// Other algorithms are prefixed by the algorithm, which would put every blob in the same first directory
+	const auto digestStart = stringAddress.length() - 2 * Address::GetDigestSize(address.GetAlgorithm());
+
+	auto blobPath = rootPath;
+	for (unsigned level = 0; level < fanOutDepth; ++level)
+	{
+		blobPath /= stringAddress.substr(digestStart + level * FAN_OUT_CHARACTERS, FAN_OUT_CHARACTERS);
+	}
+	return blobPath / stringAddress;
+}
+
+void DirectoryBlobStore::CreateBlob(const Address& address, const std::vector<uint8_t>& content)
+{
 	// Save the blob
-	const auto blobPath = _rootPath / stringAddress;
+	const auto blobPath = GetBlobPath(_rootPath, address, _fanOutDepth);
 	std::ofstream f(blobPath.string(), std::ios::out | std::ofstream::binary);
 	if (!f)
+	{
+		CreateFanOutDirectories(_rootPath, blobPath);
+		f.clear();
+		f.open(blobPath.string(), std::ios::out | std::ofstream::binary);
+	}
+	if (!f)
 	{
 		throw CreateBlobFailed("Failed to write blob file", blobPath);
 	}
 	std::copy(content.begin(), content.end(), std::ostreambuf_iterator<char>(f));
+	f.close();
+	if (f.fail())
+	{
+		throw CreateBlobFailed("Failed to write blob file", blobPath);
+	}
+	AddUnflushed(blobPath);
+}
+
+std::unique_ptr<BlobWriter> DirectoryBlobStore::CreateBlobWriter()
+{
+	return std::make_unique<DirectoryBlobWriter>(_rootPath, _fanOutDepth, [this](const auto& blobPath) {
+		AddUnflushed(blobPath);
+	});
 }
 
 void DirectoryBlobStore::CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath)
@@ -67,29 +313,303 @@ void DirectoryBlobStore::CreateNamedBlob(const UTF8String& name, const boost::fi
 std::vector<uint8_t> DirectoryBlobStore::GetBlob(const Address& address) const
 {
 	std::vector<uint8_t> result;
-	const auto stringAddress = address.ToString();
-	const auto blobPath = _rootPath / stringAddress;
-
-	std::ifstream f(blobPath.string(), std::ios::in | std::ifstream::binary);
-	if (f.fail())
+	const auto found = ReadBlob(address, [&](const boost::filesystem::path& blobPath) {
+		return ReadBlobFile(blobPath, result);
+	});
+	if (!found)
 	{
 		throw BlobReadException(address);
 	}
+	return result;
+}
 
-	while (!f.eof())
+BlobView DirectoryBlobStore::GetBlobView(const Address& address) const
+{
+	BlobView result;
+	const auto found = ReadBlob(address, [&](const boost::filesystem::path& blobPath) {
+		return MapBlobFile(blobPath, result);
+	});
+	if (!found)
 	{
-		char buffer[4096];
-		f.read(buffer, sizeof(buffer));
-		result.insert(result.end(), buffer, buffer + f.gcount());
+		throw BlobReadException(address);
 	}
+	return result;
+}
 
+std::set<Address> DirectoryBlobStore::FindBlobs(const std::vector<Address>& addresses) const
+{
+	std::set<Address> result;
+	for (const auto& address : addresses)
+	{
+		const auto found = ReadBlob(address, [](const boost::filesystem::path& blobPath) {
+			boost::system::error_code ec;
+			return boost::filesystem::is_regular_file(blobPath, ec);
+		});
+		if (found)
+		{
+			result.insert(address);
+		}
+	}
 	return result;
 }
 
+bool DirectoryBlobStore::ReadBlob(const Address& address, const std::function<bool(const boost::filesystem::path& blobPath)>& read) const
+{
+	const auto blobPath = GetBlobPath(_rootPath, address, _fanOutDepth);
+	if (read(blobPath))
+	{
+		return true;
+	}
+
+	// The blob may not have been moved yet, or been moved between the two reads
+	const auto migratingFromFanOutDepth = _migratingFromFanOutDepth.load();
+	return migratingFromFanOutDepth >= 0
+		&& (read(GetBlobPath(_rootPath, address, migratingFromFanOutDepth)) || read(blobPath));
+}
+
+void DirectoryBlobStore::Flush()
+{
+	std::vector<boost::filesystem::path> blobPaths;
+	{
+		std::unique_lock<std::mutex> lock(_unflushedMutex);
+		blobPaths.swap(_unflushedPaths);
+	}
+
+	for (auto it = blobPaths.begin(); it != blobPaths.end(); ++it)
+	{
+		boost::system::error_code ec;
+		const auto absolutePath = boost::filesystem::absolute(*it);
+		file::fs::FlushFile(file::fs::NativePath(WideToUTF8String(absolutePath.wstring())), ec);
+		if (ec)
+		{
+			// Kept for the next flush to retry
+			std::unique_lock<std::mutex> lock(_unflushedMutex);
+			_unflushedPaths.insert(_unflushedPaths.end(), it, blobPaths.end());
+			throw CreateBlobFailed("Failed to flush blob file", *it, ec);
+		}
+	}
+}
+
+bool DirectoryBlobStore::ListBlobs(const std::function<void(const StoredBlob& blob)>& visit) const
+{
+	boost::system::error_code ec;
+	boost::filesystem::recursive_directory_iterator it(_rootPath, ec);
+	for (; !ec && it != boost::filesystem::recursive_directory_iterator(); it.increment(ec))
+	{
+		const auto path = it->path();
+		if (path.filename().string()[0] == '.')
+		{
+			// Incoming blobs and the layout
+			it.no_push();
+			continue;
+		}
+
+		if (boost::filesystem::is_directory(it->status()))
+		{
+			continue;
+		}
+
+		StoredBlob blob;
+		try
+		{
+			blob.address = Address(path.filename().string());
+		}
+		catch (const InvalidAddressException&)
+		{
+			// Named blobs
+			continue;
+		}
+
+		// Blobs can be moved or deleted while they're listed
+		boost::system::error_code fileEc;
+		blob.sizeBytes = boost::filesystem::file_size(path, fileEc);
+		const auto lastWriteTime = boost::filesystem::last_write_time(path, fileEc);
+		if (fileEc)
+		{
+			continue;
+		}
+		blob.lastWriteUtc = boost::posix_time::from_time_t(lastWriteTime);
+		visit(blob);
+	}
+	if (ec)
+	{
+		throw DirectoryBlobCreationFailed("Failed to list blobs", _rootPath, ec);
+	}
+	return true;
+}
+
+void DirectoryBlobStore::DeleteBlob(const Address& address)
+{
+	std::vector<boost::filesystem::path> blobPaths = { GetBlobPath(_rootPath, address, _fanOutDepth) };
+	const auto migratingFromFanOutDepth = _migratingFromFanOutDepth.load();
+	if (migratingFromFanOutDepth >= 0)
+	{
+		blobPaths.push_back(GetBlobPath(_rootPath, address, migratingFromFanOutDepth));
+	}
+
+	for (const auto& blobPath : blobPaths)
+	{
+		boost::system::error_code ec;
+		boost::filesystem::remove(blobPath, ec);
+		if (ec)
+		{
+			throw DeleteBlobFailed("Failed to delete blob file", blobPath, ec);
+		}
+	}
+}
+
+void DirectoryBlobStore::AddUnflushed(const boost::filesystem::path& blobPath)
+{
+	std::unique_lock<std::mutex> lock(_unflushedMutex);
+	_unflushedPaths.push_back(blobPath);
+}
+
+void DirectoryBlobStore::WaitForMigration()
+{
+	if (_migrationThread.joinable())
+	{
+		_migrationThread.join();
+	}
+}
+
+void DirectoryBlobStore::StartMigration()
+{
+	auto layout = ReadLayout(_rootPath);
+	if (!layout)
+	{
+		// Stores written before the layout was recorded are flat, new stores can use the configured layout
+		if (!boost::filesystem::is_empty(_rootPath))
+		{
+			layout = 0;
+		}
+		else
+		{
+			WriteLayout(_fanOutDepth);
+			layout = _fanOutDepth;
+		}
+	}
+
+	if (*layout != _fanOutDepth)
+	{
+		_migratingFromFanOutDepth = static_cast<int>(*layout);
+		_migrationThread = std::thread(&DirectoryBlobStore::Migrate, this);
+	}
+}
+
+void DirectoryBlobStore::Migrate()
+{
+	BSLIB_LOG_INFO << "Moving blobs in " << _rootPath.string() << " to fan out depth " << _fanOutDepth;
+	try
+	{
+		uint64_t movedCount = 0;
+		std::vector<boost::filesystem::path> directories;
+		boost::system::error_code ec;
+		boost::filesystem::recursive_directory_iterator it(_rootPath, ec);
+		for (; !ec && it != boost::filesystem::recursive_directory_iterator(); it.increment(ec))
+		{
+			if (_stopMigration)
+			{
+				return;
+			}
+
+			const auto path = it->path();
+			if (path.filename().string()[0] == '.')
+			{
+				// Incoming blobs and the layout
+				it.no_push();
+				continue;
+			}
+
+			if (boost::filesystem::is_directory(it->status()))
+			{
+				directories.push_back(path);
+				continue;
+			}
+
+			// Otherwise the iterator checks whether to descend into the file after it's been moved
+			it.no_push();
+
+			boost::optional<Address> address;
+			try
+			{
+				address = Address(path.filename().string());
+			}
+			catch (const InvalidAddressException&)
+			{
+				// Named blobs stay where they are
+				continue;
+			}
+
+			const auto blobPath = GetBlobPath(_rootPath, *address, _fanOutDepth);
+			if (path == blobPath)
+			{
+				continue;
+			}
+
+			boost::system::error_code renameEc;
+			boost::filesystem::rename(path, blobPath, renameEc);
+			if (renameEc)
+			{
+				CreateFanOutDirectories(_rootPath, blobPath);
+				boost::filesystem::rename(path, blobPath, renameEc);
+			}
+			if (renameEc)
+			{
+				throw CreateBlobFailed("Failed to move blob file", blobPath, renameEc);
+			}
+			movedCount++;
+		}
+		if (ec)
+		{
+			throw DirectoryBlobCreationFailed("Failed to list blobs", _rootPath, ec);
+		}
+
+		// Directories from the old layout that are now empty, deepest first
+		for (auto dir = directories.rbegin(); dir != directories.rend(); ++dir)
+		{
+			if (boost::filesystem::is_empty(*dir, ec) && !ec)
+			{
+				boost::filesystem::remove(*dir, ec);
+			}
+		}
+
+		WriteLayout(_fanOutDepth);
+		_migratingFromFanOutDepth = -1;
+		BSLIB_LOG_INFO << "Moved " << movedCount << " blobs in " << _rootPath.string() << " to fan out depth " << _fanOutDepth;
+	}
+	catch (const std::exception& e)
+	{
+		BSLIB_LOG_WARNING << "Failed to move blobs in " << _rootPath.string() << ", will retry when next opened: " << e.what();
+	}
+}
+
+void DirectoryBlobStore::WriteLayout(unsigned fanOutDepth) const
+{
+	// Replaced in one step, so the layout is never read half written
+	const auto layoutPath = _rootPath / LAYOUT_FILENAME;
+	const auto tempPath = _rootPath / (LAYOUT_FILENAME + ".tmp");
+	{
+		std::ofstream f(tempPath.string(), std::ios::out | std::ios::trunc);
+		f << fanOutDepth;
+		if (!f)
+		{
+			throw CreateBlobFailed("Failed to write layout file", tempPath);
+		}
+	}
+
+	boost::system::error_code ec;
+	boost::filesystem::rename(tempPath, layoutPath, ec);
+	if (ec)
+	{
+		throw CreateBlobFailed("Failed to write layout file", layoutPath, ec);
+	}
+}
+
 nlohmann::json DirectoryBlobStore::ConvertToJson() const
 {
 	nlohmann::json result;
 	result["path"] = _rootPath.string();
+	result["fanOutDepth"] = _fanOutDepth;
 	return result;
 }
 
@@ -0,0 +1,498 @@
+#include "bslib/blob/FanOutBlobStore.hpp"
+
+#include "bslib/blob/exceptions.hpp"
+#include "bslib/log.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <set>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+const std::string FanOutBlobStore::TYPE = "fanout";
+
+namespace {
+/**
+ * The writer in one store of a blob being streamed to every store, only used by that store's thread
+ */
+struct StoreWriterState
+{
+	std::unique_ptr<BlobWriter> writer;
+	std::string error;
+};
+}
+
+class FanOutBlobStore::FanOutBlobWriter : public BlobWriter
+{
+public:
+	explicit FanOutBlobWriter(FanOutBlobStore& fanOut)
+		: _fanOut(fanOut)
+		, _committed(false)
+	{
+		for (auto i = 0U; i < _fanOut._stores.size(); ++i)
+		{
+			_states.push_back(std::make_shared<StoreWriterState>());
+		}
+
+		std::unique_lock<std::mutex> lock(_fanOut._mutex);
+		_fanOut.EnqueueForEachStoreNoLock(0, [&](size_t storeIndex) {
+			auto state = _states[storeIndex];
+			auto store = _fanOut._stores[storeIndex];
+			return [state, store]() {
+				try
+				{
+					state->writer = store->CreateBlobWriter();
+				}
+				catch (const std::exception& e)
+				{
+					state->error = e.what();
+				}
+			};
+		});
+	}
+
+	~FanOutBlobWriter()
+	{
+		if (_committed)
+		{
+			return;
+		}
+
+		// Discarded by each store's thread, as it may still be writing to it
+		std::unique_lock<std::mutex> lock(_fanOut._mutex);
+		_fanOut.EnqueueForEachStoreNoLock(0, [&](size_t storeIndex) {
+			auto state = _states[storeIndex];
+			return [state]() {
+				state->writer.reset();
+			};
+		});
+	}
+
+	void Write(const uint8_t* data, size_t size) override
+	{
+		const auto content = std::make_shared<const std::vector<uint8_t>>(data, data + size);
+		std::unique_lock<std::mutex> lock(_fanOut._mutex);
+		_fanOut.WaitForSpaceNoLock(lock, size);
+		_fanOut.EnqueueForEachStoreNoLock(size, [&](size_t storeIndex) {
+			auto state = _states[storeIndex];
+			return [state, content]() {
+				if (!state->writer)
+				{
+					return;
+				}
+				try
+				{
+					state->writer->Write(content->data(), content->size());
+				}
+				catch (const std::exception& e)
+				{
+					state->error = e.what();
+					state->writer.reset();
+				}
+			};
+		});
+	}
+
+	void Commit(const Address& address) override
+	{
+		_committed = true;
+		std::unique_lock<std::mutex> lock(_fanOut._mutex);
+		_fanOut._createdAddresses.push_back(address);
+		_fanOut.EnqueueForEachStoreNoLock(0, [&](size_t storeIndex) {
+			auto state = _states[storeIndex];
+			auto& fanOut = _fanOut;
+			return [state, &fanOut, storeIndex, address]() {
+				if (state->writer)
+				{
+					try
+					{
+						state->writer->Commit(address);
+						state->writer.reset();
+						return;
+					}
+					catch (const std::exception& e)
+					{
+						state->error = e.what();
+						state->writer.reset();
+					}
+				}
+				fanOut.RecordFailure(storeIndex, address, state->error);
+			};
+		});
+	}
+private:
+	FanOutBlobStore& _fanOut;
+	std::vector<std::shared_ptr<StoreWriterState>> _states;
+	bool _committed;
+};
+
+class FanOutBlobStore::SingleStoreWriter : public BlobWriter
+{
+public:
+	explicit SingleStoreWriter(FanOutBlobStore& fanOut)
+		: _fanOut(fanOut)
+		, _inner(fanOut._stores.front()->CreateBlobWriter())
+	{
+	}
+
+	void Write(const uint8_t* data, size_t size) override
+	{
+		_inner->Write(data, size);
+	}
+
+	void Commit(const Address& address) override
+	{
+		_inner->Commit(address);
+		_fanOut.RecordCreated(address);
+	}
+private:
+	FanOutBlobStore& _fanOut;
+	const std::unique_ptr<BlobWriter> _inner;
+};
+
+FanOutBlobStore::FanOutBlobStore(const std::vector<std::shared_ptr<BlobStore>>& stores, uint64_t maxQueuedBytesPerStore)
+	: _id(Uuid::Create())
+	, _stores(stores)
+	, _maxQueuedBytesPerStore(maxQueuedBytesPerStore)
+	, _queues(stores.size())
+	, _stopping(false)
+{
+	for (auto i = 0U; i < _stores.size(); ++i)
+	{
+		_queues[i].store = _stores[i];
+	}
+}
+
+FanOutBlobStore::~FanOutBlobStore()
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_queued.notify_all();
+	for (auto& thread : _threads)
+	{
+		thread.join();
+	}
+}
+
+void FanOutBlobStore::CreateBlob(const Address& address, const std::vector<uint8_t>& content)
+{
+	if (HasSingleStore())
+	{
+		_stores.front()->CreateBlob(address, content);
+		RecordCreated(address);
+		return;
+	}
+
+	// Shared by every store's queue, so the content is only copied once
+	const auto sharedContent = std::make_shared<const std::vector<uint8_t>>(content);
+	std::unique_lock<std::mutex> lock(_mutex);
+	WaitForSpaceNoLock(lock, content.size());
+	_createdAddresses.push_back(address);
+	EnqueueForEachStoreNoLock(content.size(), [&](size_t storeIndex) {
+		auto store = _stores[storeIndex];
+		return [this, store, storeIndex, address, sharedContent]() {
+			try
+			{
+				store->CreateBlob(address, *sharedContent);
+			}
+			catch (const std::exception& e)
+			{
+				RecordFailure(storeIndex, address, e.what());
+			}
+		};
+	});
+}
+
+std::unique_ptr<BlobWriter> FanOutBlobStore::CreateBlobWriter()
+{
+	if (HasSingleStore())
+	{
+		return std::make_unique<SingleStoreWriter>(*this);
+	}
+	return std::make_unique<FanOutBlobWriter>(*this);
+}
+
+void FanOutBlobStore::CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath)
+{
+	// Every store is tried, even if one fails
+	std::exception_ptr error;
+	for (auto& store : _stores)
+	{
+		try
+		{
+			store->CreateNamedBlob(name, sourcePath);
+		}
+		catch (...)
+		{
+			if (!error)
+			{
+				error = std::current_exception();
+			}
+		}
+	}
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+std::vector<uint8_t> FanOutBlobStore::GetBlob(const Address& address) const
+{
+	return GetFromFirstStore(address, &BlobStore::GetBlob);
+}
+
+BlobView FanOutBlobStore::GetBlobView(const Address& address) const
+{
+	return GetFromFirstStore(address, &BlobStore::GetBlobView);
+}
+
+template<typename T>
+T FanOutBlobStore::GetFromFirstStore(const Address& address, T (BlobStore::*get)(const Address& address) const) const
+{
+	for (auto attempt = 0; attempt < 2; ++attempt)
+	{
+		for (const auto& store : _stores)
+		{
+			try
+			{
+				return ((*store).*get)(address);
+			}
+			catch (const std::exception&)
+			{
+				// Try the next store
+			}
+		}
+
+		// Possibly still queued
+		std::unique_lock<std::mutex> lock(_mutex);
+		WaitForQueuesNoLock(lock);
+	}
+	throw BlobReadException(address);
+}
+
+void FanOutBlobStore::Flush()
+{
+	if (HasSingleStore())
+	{
+		// Only blobs that are written by the time the flush starts are known to be covered by it
+		size_t createdCount;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			createdCount = _createdAddresses.size();
+		}
+		_stores.front()->Flush();
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		auto& queue = _queues.front();
+		queue.flushedCount = std::max(queue.flushedCount, createdCount);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	// Flushed in order after the blobs queued before it, so a flush covers every blob created before it's queued
+	const auto createdCount = _createdAddresses.size();
+	EnqueueForEachStoreNoLock(0, [&](size_t storeIndex) {
+		auto store = _stores[storeIndex];
+		return [this, store, storeIndex, createdCount]() {
+			std::string error;
+			try
+			{
+				store->Flush();
+			}
+			catch (const std::exception& e)
+			{
+				error = e.what();
+			}
+
+			std::unique_lock<std::mutex> lock(_mutex);
+			auto& queue = _queues[storeIndex];
+			if (!error.empty())
+			{
+				BSLIB_LOG_WARNING << "Failed to flush blob store " << store->GetId() << ": " << error;
+				for (auto i = queue.flushedCount; i < createdCount; ++i)
+				{
+					queue.failedAddresses.insert(_createdAddresses[i]);
+				}
+			}
+			queue.flushedCount = std::max(queue.flushedCount, createdCount);
+		};
+	});
+	WaitForQueuesNoLock(lock);
+
+	// A blob is only lost if every store failed it
+	for (auto i = 0U; i < createdCount; ++i)
+	{
+		const auto& address = _createdAddresses[i];
+		const auto failedEverywhere = std::all_of(_queues.begin(), _queues.end(), [&](const StoreQueue& queue) {
+			return queue.failedAddresses.find(address) != queue.failedAddresses.end();
+		});
+		if (failedEverywhere)
+		{
+			throw CreateBlobFailed("Blob " + address.ToString() + " couldn't be stored in any blob store", boost::filesystem::path());
+		}
+	}
+}
+
+nlohmann::json FanOutBlobStore::ConvertToJson() const
+{
+	auto stores = nlohmann::json::array();
+	for (const auto& store : _stores)
+	{
+		stores.push_back(store->ConvertToJson());
+	}
+
+	nlohmann::json result;
+	result["stores"] = stores;
+	return result;
+}
+
+BlobStoreStats FanOutBlobStore::GetStats() const
+{
+	BlobStoreStats result;
+	for (const auto& store : _stores)
+	{
+		const auto stats = store->GetStats();
+		result.blobsCreated += stats.blobsCreated;
+		result.contentBytes += stats.contentBytes;
+		result.storedBytes += stats.storedBytes;
+		result.encodeSeconds += stats.encodeSeconds;
+	}
+	return result;
+}
+
+void FanOutBlobStore::RecordStoredBlobs(const std::function<void(const Uuid& storeId, const Address& address)>& record)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	WaitForQueuesNoLock(lock);
+
+	auto recordedCount = _createdAddresses.size();
+	for (auto& queue : _queues)
+	{
+		recordedCount = std::min(recordedCount, queue.flushedCount);
+		if (queue.flushedCount == 0)
+		{
+			continue;
+		}
+
+		const auto storeId = queue.store->GetId();
+		for (auto i = 0U; i < queue.flushedCount; ++i)
+		{
+			const auto& address = _createdAddresses[i];
+			if (queue.failedAddresses.find(address) == queue.failedAddresses.end())
+			{
+				record(storeId, address);
+			}
+		}
+	}
+
+	// Blobs that every store has flushed are forgotten, those that some haven't are recorded again once they have
+	_createdAddresses.erase(_createdAddresses.begin(), _createdAddresses.begin() + recordedCount);
+	const std::set<Address> remaining(_createdAddresses.begin(), _createdAddresses.end());
+	for (auto& queue : _queues)
+	{
+		queue.flushedCount -= recordedCount;
+		for (auto it = queue.failedAddresses.begin(); it != queue.failedAddresses.end();)
+		{
+			it = remaining.find(*it) == remaining.end() ? queue.failedAddresses.erase(it) : std::next(it);
+		}
+	}
+}
+
+void FanOutBlobStore::WaitForSpaceNoLock(std::unique_lock<std::mutex>& lock, uint64_t sizeBytes)
+{
+	// Content larger than the limit is let through on its own, rather than waiting forever
+	_progressed.wait(lock, [&]() {
+		return std::all_of(_queues.begin(), _queues.end(), [&](const StoreQueue& queue) {
+			return queue.queuedBytes == 0 || queue.queuedBytes + sizeBytes <= _maxQueuedBytesPerStore;
+		});
+	});
+}
+
+void FanOutBlobStore::EnqueueForEachStoreNoLock(uint64_t sizeBytes, const std::function<std::function<void()>(size_t storeIndex)>& makeTask)
+{
+	if (_threads.empty())
+	{
+		for (auto i = 0U; i < _queues.size(); ++i)
+		{
+			_threads.emplace_back(&FanOutBlobStore::RunStore, this, i);
+		}
+	}
+
+	for (auto i = 0U; i < _queues.size(); ++i)
+	{
+		Task task;
+		task.run = makeTask(i);
+		task.sizeBytes = sizeBytes;
+		_queues[i].tasks.push_back(std::move(task));
+		_queues[i].queuedBytes += sizeBytes;
+	}
+	_queued.notify_all();
+}
+
+void FanOutBlobStore::WaitForQueuesNoLock(std::unique_lock<std::mutex>& lock) const
+{
+	_progressed.wait(lock, [&]() {
+		return std::all_of(_queues.begin(), _queues.end(), [](const StoreQueue& queue) {
+			return queue.tasks.empty() && !queue.running;
+		});
+	});
+}
+
+void FanOutBlobStore::RecordFailure(size_t storeIndex, const Address& address, const std::string& error)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto& queue = _queues[storeIndex];
+
+	// Only the first failure is logged, as a store that's gone away fails every blob
+	if (queue.failedAddresses.empty())
+	{
+		BSLIB_LOG_WARNING << "Failed to create blob " << address.ToString() << " in blob store " << queue.store->GetId()
+			<< ", it will be copied from another store later: " << error;
+	}
+	queue.failedAddresses.insert(address);
+}
+
+void FanOutBlobStore::RecordCreated(const Address& address)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_createdAddresses.push_back(address);
+}
+
+void FanOutBlobStore::RunStore(size_t storeIndex)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto& queue = _queues[storeIndex];
+	while (true)
+	{
+		_queued.wait(lock, [&]() {
+			return _stopping || !queue.tasks.empty();
+		});
+		if (queue.tasks.empty())
+		{
+			return;
+		}
+
+		auto task = std::move(queue.tasks.front());
+		queue.tasks.pop_front();
+		queue.running = true;
+		lock.unlock();
+		task.run();
+		task.run = nullptr;
+		lock.lock();
+
+		queue.running = false;
+		queue.queuedBytes -= task.sizeBytes;
+		_progressed.notify_all();
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,28 @@
+#include "bslib/blob/Hasher.hpp"
+
+#include "bslib/blob/Blake3Hasher.hpp"
+#include "bslib/blob/Sha1Hasher.hpp"
+
+#include <string>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+std::unique_ptr<Hasher> CreateHasher(AddressAlgorithm algorithm)
+{
+	switch (algorithm)
+	{
+		case AddressAlgorithm::Sha1:
+			return std::make_unique<Sha1Hasher>();
+
+		case AddressAlgorithm::Blake3:
+			return std::make_unique<Blake3Hasher>();
+	}
+
+	throw InvalidAddressException("Unknown address algorithm " + std::to_string(static_cast<int>(algorithm)));
+}
+
+}
+}
+}
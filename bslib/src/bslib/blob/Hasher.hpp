@@ -0,0 +1,44 @@
+#pragma once
+
+#include "bslib/blob/Address.hpp"
+
+#include <boost/core/noncopyable.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+/**
+ * Incremental implementation of one of the address algorithms
+ */
+class Hasher : private boost::noncopyable
+{
+public:
+	virtual ~Hasher() { }
+
+	virtual void Update(const uint8_t* data, size_t size) = 0;
+
+	/**
+	 * Writes Address::GetDigestSize bytes of digest, the hasher can't be updated after this is called
+	 */
+	virtual void Finalize(uint8_t* digest) = 0;
+
+	/**
+	 * Describes the implementation in use, for example whether it's hardware accelerated
+	 */
+	virtual const char* GetImplementationName() const = 0;
+};
+
+/**
+ * Creates the fastest implementation of the algorithm supported by this CPU
+ * \exception InvalidAddressException The algorithm isn't known
+ */
+std::unique_ptr<Hasher> CreateHasher(AddressAlgorithm algorithm);
+
+}
+}
+}
@@ -0,0 +1,341 @@
+#include "bslib/blob/HttpConnection.hpp"
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/asio/buffers_iterator.hpp>
+#include <boost/asio/connect.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+namespace {
+// Most read from the socket at a time
+const size_t READ_SIZE_BYTES = 64 * 1024;
+
+const std::string LINE_END = "\r\n";
+
+// A malformed size throws the same error as a response cut short, so the connection is closed rather than reused part
+// read
+size_t ParseSize(const std::string& text, unsigned base, const char* description)
+{
+	const auto invalid = [&]() {
+		return boost::system::system_error(boost::asio::error::invalid_argument, std::string("Invalid ") + description + " '" + text + "'");
+	};
+	if (text.empty())
+	{
+		throw invalid();
+	}
+
+	size_t size = 0;
+	for (const auto c : text)
+	{
+		unsigned digit;
+		if (c >= '0' && c <= '9')
+		{
+			digit = static_cast<unsigned>(c - '0');
+		}
+		else if (base == 16 && c >= 'a' && c <= 'f')
+		{
+			digit = static_cast<unsigned>(c - 'a' + 10);
+		}
+		else if (base == 16 && c >= 'A' && c <= 'F')
+		{
+			digit = static_cast<unsigned>(c - 'A' + 10);
+		}
+		else
+		{
+			throw invalid();
+		}
+
+		if (size > (std::numeric_limits<size_t>::max() - digit) / base)
+		{
+			throw invalid();
+		}
+		size = size * base + digit;
+	}
+	return size;
+}
+}
+
+HttpConnection::HttpConnection(const std::string& host, const std::string& port, std::chrono::milliseconds timeout)
+	: _host(host)
+	, _port(port)
+	, _timeout(timeout)
+	, _socket(_ioService)
+	, _timer(_ioService)
+	, _connected(false)
+{
+}
+
+HttpResponse HttpConnection::Send(const HttpRequest& request)
+{
+	// Servers close idle connections, which is only found when the next request is sent on one
+	const auto reused = _connected;
+	for (auto attempt = 0;; ++attempt)
+	{
+		try
+		{
+			if (!_connected)
+			{
+				Connect();
+			}
+			Write(request);
+			return Read(request.method == "HEAD");
+		}
+		catch (const boost::system::system_error& e)
+		{
+			Close();
+			const auto description = request.method + " " + request.target + " to " + _host + ":" + _port;
+			if (e.code() == boost::asio::error::timed_out)
+			{
+				// Not sent again here, as the server may only be slow, which the caller knows better how to wait for
+				throw HttpRequestTimedOut(description + " timed out after " + std::to_string(_timeout.count()) + " ms");
+			}
+			if (!reused || attempt > 0)
+			{
+				throw HttpRequestFailed(description + " failed: " + e.what());
+			}
+		}
+	}
+}
+
+void HttpConnection::Connect()
+{
+	boost::asio::ip::tcp::resolver resolver(_ioService);
+	const auto endpoints = resolver.resolve(boost::asio::ip::tcp::resolver::query(_host, _port));
+	boost::system::error_code ec;
+	Await([&](const CompletionHandler& handler) {
+		boost::asio::async_connect(_socket, endpoints, [handler](const boost::system::error_code& connectEc, const auto&) {
+			handler(connectEc, 0);
+		});
+	}, ec);
+	if (ec)
+	{
+		throw boost::system::system_error(ec);
+	}
+	_socket.set_option(boost::asio::ip::tcp::no_delay(true));
+	_connected = true;
+}
+
+void HttpConnection::Close()
+{
+	boost::system::error_code ec;
+	_socket.close(ec);
+	_buffer.consume(_buffer.size());
+	_connected = false;
+}
+
+void HttpConnection::Write(const HttpRequest& request)
+{
+	std::ostringstream header;
+	header << request.method << " " << request.target << " HTTP/1.1\r\n";
+	header << "Host: " << _host << ":" << _port << "\r\n";
+	header << "Content-Length: " << request.bodySize << "\r\n";
+	for (const auto& field : request.headers)
+	{
+		header << field.first << ": " << field.second << "\r\n";
+	}
+	header << "\r\n";
+
+	const auto headerString = header.str();
+	WriteAll(reinterpret_cast<const uint8_t*>(headerString.data()), headerString.size());
+	WriteAll(request.body, request.bodySize);
+}
+
+void HttpConnection::WriteAll(const uint8_t* data, size_t sizeBytes)
+{
+	while (sizeBytes > 0)
+	{
+		boost::system::error_code ec;
+		const auto written = Await([&](const CompletionHandler& handler) {
+			_socket.async_write_some(boost::asio::buffer(data, sizeBytes), handler);
+		}, ec);
+		if (ec)
+		{
+			throw boost::system::system_error(ec);
+		}
+		data += written;
+		sizeBytes -= written;
+	}
+}
+
+HttpResponse HttpConnection::Read(bool isHeadRequest)
+{
+	HttpResponse response;
+	std::istringstream statusLine(ReadLine());
+	std::string version;
+	statusLine >> version >> response.status;
+	if (!statusLine)
+	{
+		throw boost::system::system_error(boost::asio::error::invalid_argument, "Invalid status line");
+	}
+
+	for (auto line = ReadLine(); !line.empty(); line = ReadLine())
+	{
+		const auto colon = line.find(':');
+		if (colon == std::string::npos)
+		{
+			continue;
+		}
+		response.headers[boost::to_lower_copy(line.substr(0, colon))] = boost::trim_copy(line.substr(colon + 1));
+	}
+
+	const auto connection = response.headers.find("connection");
+	const auto keepAlive = connection == response.headers.end() || boost::to_lower_copy(connection->second) != "close";
+
+	const auto transferEncoding = response.headers.find("transfer-encoding");
+	const auto contentLength = response.headers.find("content-length");
+	if (isHeadRequest || response.status == 204 || response.status == 304 || (response.status >= 100 && response.status < 200))
+	{
+		// No body, whatever the length says
+	}
+	else if (transferEncoding != response.headers.end() && boost::to_lower_copy(transferEncoding->second) != "identity")
+	{
+		while (true)
+		{
+			// Any chunk extensions follow the size
+			const auto chunkLine = ReadLine();
+			const auto chunkSize = ParseSize(boost::trim_copy(chunkLine.substr(0, chunkLine.find(';'))), 16, "chunk size");
+			if (chunkSize == 0)
+			{
+				// Trailers, up to the blank line
+				while (!ReadLine().empty())
+				{
+				}
+				break;
+			}
+			ReadBody(chunkSize, response.body);
+			ReadLine();
+		}
+	}
+	else if (contentLength != response.headers.end())
+	{
+		ReadBody(ParseSize(contentLength->second, 10, "Content-Length"), response.body);
+	}
+	else
+	{
+		// The body runs until the server closes the connection
+		while (ReadSome())
+		{
+		}
+		ReadBody(_buffer.size(), response.body);
+		Close();
+		return response;
+	}
+
+	if (!keepAlive)
+	{
+		Close();
+	}
+	return response;
+}
+
+size_t HttpConnection::Await(const std::function<void(const CompletionHandler& handler)>& start, boost::system::error_code& ec)
+{
+	auto completed = false;
+	auto timedOut = false;
+	auto timerFinished = false;
+	size_t sizeBytes = 0;
+
+	_timer.expires_from_now(_timeout);
+	_timer.async_wait([&](const boost::system::error_code& timerEc) {
+		timerFinished = true;
+		if (!timerEc && !completed)
+		{
+			// Ends the operation, which completes with operation_aborted
+			timedOut = true;
+			boost::system::error_code ignored;
+			_socket.close(ignored);
+		}
+	});
+	start([&](const boost::system::error_code& operationEc, size_t operationSizeBytes) {
+		completed = true;
+		ec = operationEc;
+		sizeBytes = operationSizeBytes;
+	});
+
+	// Both handlers are run before returning, so neither is left to run during the next operation
+	_ioService.reset();
+	while (!completed)
+	{
+		_ioService.run_one();
+	}
+	_timer.cancel();
+	while (!timerFinished)
+	{
+		_ioService.run_one();
+	}
+
+	if (timedOut)
+	{
+		throw boost::system::system_error(boost::asio::error::timed_out);
+	}
+	return sizeBytes;
+}
+
+bool HttpConnection::ReadSome()
+{
+	boost::system::error_code ec;
+	const auto sizeBytes = Await([&](const CompletionHandler& handler) {
+		_socket.async_read_some(_buffer.prepare(READ_SIZE_BYTES), handler);
+	}, ec);
+	if (ec == boost::asio::error::eof)
+	{
+		return false;
+	}
+	if (ec)
+	{
+		throw boost::system::system_error(ec);
+	}
+	_buffer.commit(sizeBytes);
+	return true;
+}
+
+void HttpConnection::Fill(size_t sizeBytes)
+{
+	while (_buffer.size() < sizeBytes)
+	{
+		if (!ReadSome())
+		{
+			throw boost::system::system_error(boost::asio::error::eof);
+		}
+	}
+}
+
+std::string HttpConnection::ReadLine()
+{
+	while (true)
+	{
+		const auto begin = boost::asio::buffers_begin(_buffer.data());
+		const auto end = boost::asio::buffers_end(_buffer.data());
+		const auto lineEnd = std::search(begin, end, LINE_END.begin(), LINE_END.end());
+		if (lineEnd != end)
+		{
+			std::string line(begin, lineEnd);
+			_buffer.consume(static_cast<size_t>(lineEnd - begin) + LINE_END.size());
+			return line;
+		}
+
+		if (!ReadSome())
+		{
+			throw boost::system::system_error(boost::asio::error::eof);
+		}
+	}
+}
+
+void HttpConnection::ReadBody(size_t sizeBytes, std::vector<uint8_t>& body)
+{
+	Fill(sizeBytes);
+	const auto begin = boost::asio::buffers_begin(_buffer.data());
+	body.insert(body.end(), begin, begin + sizeBytes);
+	_buffer.consume(sizeBytes);
+}
+
+}
+}
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "bslib/blob/BlobStore.hpp"
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/streambuf.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+class HttpRequestFailed : public BlobStoreError
+{
+public:
+	explicit HttpRequestFailed(const std::string& msg)
+		: BlobStoreError(msg)
+	{
+	}
+};
+
+/**
+ * The server didn't answer in time, which may only be a passing delay, so the request can be sent again
+ */
+class HttpRequestTimedOut : public HttpRequestFailed
+{
+public:
+	explicit HttpRequestTimedOut(const std::string& msg)
+		: HttpRequestFailed(msg)
+	{
+	}
+};
+
+struct HttpRequest
+{
+	std::string method;
+
+	// Path and query, already encoded
+	std::string target;
+	std::map<std::string, std::string> headers;
+
+	// Not owned, so it must outlive sending the request
+	const uint8_t* body = nullptr;
+	size_t bodySize = 0;
+};
+
+struct HttpResponse
+{
+	unsigned status = 0;
+
+	// Keyed by lowercase name
+	std::map<std::string, std::string> headers;
+	std::vector<uint8_t> body;
+
+	bool IsSuccess() const { return status >= 200 && status < 300; }
+	std::string GetBodyString() const { return std::string(body.begin(), body.end()); }
+};
+
+/**
+ * A connection to an HTTP/1.1 server that's kept open between requests, so a request doesn't wait for a new
+ * connection. Requests are sent one at a time and block until the whole response is read.
+ * \remarks Not thread safe, connections are pooled so each is used by one thread at a time
+ */
+class HttpConnection
+{
+public:
+	/**
+	 * \param timeout The longest connecting, or any one read or write, can take, so a large body only times out if
+	 * the server stops taking or sending it
+	 */
+	HttpConnection(const std::string& host, const std::string& port, std::chrono::milliseconds timeout);
+
+	/**
+	 * Sends a request and reads its response, connecting first if the connection isn't open. A request on a
+	 * connection that the server has since closed is sent again on a new connection.
+	 * \exception HttpRequestTimedOut The server didn't accept the connection, take the request or answer in time
+	 * \exception HttpRequestFailed The server couldn't be reached, or the response couldn't be read
+	 */
+	HttpResponse Send(const HttpRequest& request);
+private:
+	typedef std::function<void(const boost::system::error_code& ec, size_t sizeBytes)> CompletionHandler;
+
+	void Connect();
+	void Close();
+	void Write(const HttpRequest& request);
+	void WriteAll(const uint8_t* data, size_t sizeBytes);
+	HttpResponse Read(bool isHeadRequest);
+
+	/**
+	 * Runs an asynchronous operation on the socket until it completes, closing the socket if it takes longer than the
+	 * timeout
+	 * \param start Starts the operation, which must call the given handler when it completes
+	 * \param ec Set to the operation's error
+	 * \return The number of bytes the operation transferred
+	 * \exception boost::system::system_error The operation timed out, with boost::asio::error::timed_out
+	 */
+	size_t Await(const std::function<void(const CompletionHandler& handler)>& start, boost::system::error_code& ec);
+
+	/**
+	 * Reads whatever the server has sent next into the buffer
+	 * \return false if the server has closed the connection
+	 */
+	bool ReadSome();
+
+	/**
+	 * Reads until the buffer holds at least the given number of bytes
+	 */
+	void Fill(size_t sizeBytes);
+
+	/**
+	 * Reads a line, without its line ending
+	 */
+	std::string ReadLine();
+	void ReadBody(size_t sizeBytes, std::vector<uint8_t>& body);
+
+	const std::string _host;
+	const std::string _port;
+	const std::chrono::milliseconds _timeout;
+	boost::asio::io_service _ioService;
+	boost::asio::ip::tcp::socket _socket;
+	boost::asio::steady_timer _timer;
+	boost::asio::streambuf _buffer;
+	bool _connected;
+};
+
+}
+}
+}
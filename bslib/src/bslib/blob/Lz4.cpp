@@ -0,0 +1,196 @@
+#include "bslib/blob/Lz4.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+namespace {
+// Limits set by the block format, see https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+const size_t MIN_MATCH = 4;
+const size_t LAST_LITERALS = 5;
+const size_t MATCH_SEARCH_LIMIT = 12;
+const size_t MAX_OFFSET = 65535;
+const uint8_t RUN_MASK = 15;
+
+const unsigned HASH_BITS = 16;
+
+uint32_t Read32(const uint8_t* data)
+{
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+uint32_t Hash(uint32_t sequence)
+{
+	return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+void WriteLength(std::vector<uint8_t>& output, size_t length)
+{
+	for (; length >= 255; length -= 255)
+	{
+		output.push_back(255);
+	}
+	output.push_back(static_cast<uint8_t>(length));
+}
+
+void WriteLiterals(std::vector<uint8_t>& output, const uint8_t* literals, size_t count)
+{
+	if (count >= RUN_MASK)
+	{
+		WriteLength(output, count - RUN_MASK);
+	}
+	output.insert(output.end(), literals, literals + count);
+}
+
+bool ReadLength(const uint8_t* input, size_t inputSize, size_t& position, size_t& length)
+{
+	uint8_t next;
+	do
+	{
+		if (position >= inputSize)
+		{
+			return false;
+		}
+		next = input[position++];
+		length += next;
+	} while (next == 255);
+	return true;
+}
+}
+
+void Lz4CompressBlock(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed)
+{
+	compressed.clear();
+	compressed.reserve(size + size / 255 + 16);
+
+	size_t anchor = 0;
+	if (size > MATCH_SEARCH_LIMIT)
+	{
+		// Positions are stored plus one, so zero is empty
+		std::vector<size_t> table(static_cast<size_t>(1) << HASH_BITS, 0);
+		const auto matchEndLimit = size - LAST_LITERALS;
+		const auto matchStartLimit = size - MATCH_SEARCH_LIMIT;
+
+		size_t position = 0;
+		while (position <= matchStartLimit)
+		{
+			const auto sequence = Read32(data + position);
+			auto& entry = table[Hash(sequence)];
+			const auto candidate = entry;
+			entry = position + 1;
+			if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || Read32(data + candidate - 1) != sequence)
+			{
+				// Step further through data that isn't matching, so incompressible data is passed over quickly
+				position += 1 + ((position - anchor) >> 6);
+				continue;
+			}
+
+			auto matchStart = position;
+			auto reference = candidate - 1;
+			while (matchStart > anchor && reference > 0 && data[matchStart - 1] == data[reference - 1])
+			{
+				--matchStart;
+				--reference;
+			}
+
+			auto matchEnd = position + MIN_MATCH;
+			while (matchEnd < matchEndLimit && data[matchEnd] == data[reference + (matchEnd - matchStart)])
+			{
+				++matchEnd;
+			}
+
+			const auto literalCount = matchStart - anchor;
+			const auto matchLength = matchEnd - matchStart - MIN_MATCH;
+			const auto offset = matchStart - reference;
+			compressed.push_back(static_cast<uint8_t>(
+				(std::min<size_t>(literalCount, RUN_MASK) << 4) | std::min<size_t>(matchLength, RUN_MASK)));
+			WriteLiterals(compressed, data + anchor, literalCount);
+			compressed.push_back(static_cast<uint8_t>(offset & 0xFF));
+			compressed.push_back(static_cast<uint8_t>(offset >> 8));
+			if (matchLength >= RUN_MASK)
+			{
+				WriteLength(compressed, matchLength - RUN_MASK);
+			}
+
+			anchor = matchEnd;
+			position = matchEnd;
+		}
+	}
+
+	// The block always ends with literals
+	const auto literalCount = size - anchor;
+	compressed.push_back(static_cast<uint8_t>(std::min<size_t>(literalCount, RUN_MASK) << 4));
+	WriteLiterals(compressed, data + anchor, literalCount);
+}
+
+bool Lz4DecompressBlock(const uint8_t* compressed, size_t compressedSize, uint8_t* decompressed, size_t decompressedSize)
+{
+	size_t input = 0;
+	size_t output = 0;
+	while (input < compressedSize)
+	{
+		const auto token = compressed[input++];
+
+		size_t literalCount = token >> 4;
+		if (literalCount == RUN_MASK && !ReadLength(compressed, compressedSize, input, literalCount))
+		{
+			return false;
+		}
+		if (literalCount > compressedSize - input || literalCount > decompressedSize - output)
+		{
+			return false;
+		}
+		if (literalCount > 0)
+		{
+			std::memcpy(decompressed + output, compressed + input, literalCount);
+		}
+		input += literalCount;
+		output += literalCount;
+
+		// The last sequence has no match
+		if (input == compressedSize)
+		{
+			break;
+		}
+
+		if (compressedSize - input < 2)
+		{
+			return false;
+		}
+		const size_t offset = compressed[input] | (static_cast<size_t>(compressed[input + 1]) << 8);
+		input += 2;
+		if (offset == 0 || offset > output)
+		{
+			return false;
+		}
+
+		size_t matchLength = token & RUN_MASK;
+		if (matchLength == RUN_MASK && !ReadLength(compressed, compressedSize, input, matchLength))
+		{
+			return false;
+		}
+		matchLength += MIN_MATCH;
+		if (matchLength > decompressedSize - output)
+		{
+			return false;
+		}
+
+		// Matches may overlap the output they're copying, such as a run of one repeated byte, so copy forwards a byte at a time
+		const auto match = decompressed + output - offset;
+		for (size_t i = 0; i < matchLength; ++i)
+		{
+			decompressed[output + i] = match[i];
+		}
+		output += matchLength;
+	}
+	return output == decompressedSize;
+}
+
+}
+}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+/**
+ * Compresses data into a single block of the LZ4 block format (without the LZ4 frame), replacing the contents of compressed.
+ * This favours speed over ratio, matches are found with a single probe of a hash table.
+ */
+void Lz4CompressBlock(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed);
+
+/**
+ * Decompresses a block created by Lz4CompressBlock, or any other LZ4 block.
+ * \return false if the block is malformed or doesn't decompress to exactly decompressedSize bytes
+ */
+bool Lz4DecompressBlock(const uint8_t* compressed, size_t compressedSize, uint8_t* decompressed, size_t decompressedSize);
+
+}
+}
+}
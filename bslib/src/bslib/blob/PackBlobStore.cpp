@@ -0,0 +1,682 @@
+#include "bslib/blob/PackBlobStore.hpp"
+
+#include "bslib/blob/exceptions.hpp"
+#include "bslib/file/fs/operations.hpp"
+#include "bslib/log.hpp"
+#include "bslib/unicode.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+const std::string PackBlobStore::TYPE = "pack";
+const uint64_t PackBlobStore::DEFAULT_MAX_PACK_SIZE_BYTES = 256 * 1024 * 1024;
+
+namespace {
+const char PACK_MAGIC[4] = { 'B', 'S', 'P', 'K' };
+const char INDEX_MAGIC[4] = { 'B', 'S', 'P', 'I' };
+const uint32_t FILE_VERSION = 1;
+const uint64_t PACK_HEADER_SIZE_BYTES = sizeof(PACK_MAGIC) + sizeof(FILE_VERSION);
+
+// Starts every record in a pack, followed by the size of the encoded address, the encoded address, the content size and the content
+const uint32_t RECORD_MAGIC = 0x52505342;
+
+const std::string PACK_PREFIX = "pack-";
+const std::string PACK_EXTENSION = ".pack";
+const std::string INDEX_EXTENSION = ".idx";
+const std::string INCOMING_PREFIX = ".incoming-";
+
+template <typename T>
+void Write(std::ostream& output, const T& value)
+{
+	output.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool Read(std::istream& input, T& value)
+{
+	return static_cast<bool>(input.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+void WriteAddress(std::ostream& output, const Address& address)
+{
+	const auto binaryAddress = address.ToBinary();
+	Write(output, static_cast<uint8_t>(binaryAddress.size()));
+	output.write(reinterpret_cast<const char*>(&binaryAddress[0]), binaryAddress.size());
+}
+
+bool ReadAddress(std::istream& input, Address& address)
+{
+	uint8_t addressSize;
+	uint8_t addressBytes[1 + Address::MAX_DIGEST_SIZE_BYTES];
+	if (!Read(input, addressSize) || addressSize > sizeof(addressBytes)
+		|| !input.read(reinterpret_cast<char*>(addressBytes), addressSize))
+	{
+		return false;
+	}
+
+	try
+	{
+		address = Address(addressBytes, addressSize);
+	}
+	catch (const InvalidAddressException&)
+	{
+		return false;
+	}
+	return true;
+}
+
+uint64_t GetRecordHeaderSize(const Address& address)
+{
+	return sizeof(RECORD_MAGIC) + sizeof(uint8_t) + address.ToBinary().size() + sizeof(uint64_t);
+}
+
+/**
+ * \return The number of the pack at the given path, or boost::none if the path isn't a pack
+ */
+boost::optional<uint32_t> ParsePackNumber(const boost::filesystem::path& path)
+{
+	const auto fileName = path.filename().string();
+	if (fileName.size() <= PACK_PREFIX.size() + PACK_EXTENSION.size()
+		|| fileName.compare(0, PACK_PREFIX.size(), PACK_PREFIX) != 0
+		|| fileName.compare(fileName.size() - PACK_EXTENSION.size(), PACK_EXTENSION.size(), PACK_EXTENSION) != 0)
+	{
+		return boost::none;
+	}
+
+	const auto digits = fileName.substr(PACK_PREFIX.size(), fileName.size() - PACK_PREFIX.size() - PACK_EXTENSION.size());
+	if (digits.size() > 9 || !std::all_of(digits.begin(), digits.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; }))
+	{
+		return boost::none;
+	}
+	return static_cast<uint32_t>(std::stoul(digits));
+}
+}
+
+/**
+ * Spools content to a file in the store, which is appended to the active pack on commit
+ */
+class PackBlobStore::Writer : public BlobWriter
+{
+public:
+	explicit Writer(PackBlobStore& store)
+		: _store(store)
+		, _incomingPath(store._rootPath / (INCOMING_PREFIX + Uuid::Create().ToDashlessString()))
+		, _file(_incomingPath, std::ios::out | std::ios::binary)
+	{
+		if (!_file)
+		{
+			throw CreateBlobFailed("Failed to create incoming blob file", _incomingPath);
+		}
+	}
+
+	~Writer()
+	{
+		if (_file.is_open())
+		{
+			_file.close();
+		}
+
+		boost::system::error_code ec;
+		boost::filesystem::remove(_incomingPath, ec);
+	}
+
+	void Write(const uint8_t* data, size_t size) override
+	{
+		_file.write(reinterpret_cast<const char*>(data), size);
+		if (!_file)
+		{
+			throw CreateBlobFailed("Failed to write incoming blob file", _incomingPath);
+		}
+	}
+
+	void Commit(const Address& address) override
+	{
+		_file.close();
+		if (_file.fail())
+		{
+			throw CreateBlobFailed("Failed to write incoming blob file", _incomingPath);
+		}
+
+		boost::filesystem::ifstream input(_incomingPath, std::ios::in | std::ios::binary);
+		boost::system::error_code ec;
+		const auto sizeBytes = boost::filesystem::file_size(_incomingPath, ec);
+		if (!input || ec)
+		{
+			throw CreateBlobFailed("Failed to read incoming blob file", _incomingPath, ec);
+		}
+
+		std::unique_lock<std::mutex> lock(_store._mutex);
+		if (_store.FindNoLock(address))
+		{
+			return;
+		}
+
+		_store.AppendNoLock(address, sizeBytes, [&](std::ostream& output) {
+			char buffer[64 * 1024];
+			auto copiedBytes = 0ULL;
+			while (input.read(buffer, sizeof(buffer)) || input.gcount() > 0)
+			{
+				output.write(buffer, input.gcount());
+				copiedBytes += static_cast<uint64_t>(input.gcount());
+			}
+
+			// The file changing under the writer would leave the record's size wrong
+			if (copiedBytes != sizeBytes)
+			{
+				output.setstate(std::ios::failbit);
+			}
+		});
+	}
+
+private:
+	PackBlobStore& _store;
+	const boost::filesystem::path _incomingPath;
+	boost::filesystem::ofstream _file;
+};
+
+PackBlobStore::PackBlobStore(const boost::filesystem::path& rootPath, uint64_t maxPackSizeBytes)
+	: PackBlobStore(Uuid::Create(), rootPath, maxPackSizeBytes)
+{
+}
+
+PackBlobStore::PackBlobStore(const Uuid& id, const nlohmann::json& settings)
+	: PackBlobStore(
+		id,
+		boost::filesystem::path(settings.at("path").get<std::string>()),
+		settings.value("maxPackSizeBytes", DEFAULT_MAX_PACK_SIZE_BYTES))
+{
+}
+
+PackBlobStore::PackBlobStore(const Uuid& id, const boost::filesystem::path& rootPath, uint64_t maxPackSizeBytes)
+	: _rootPath(rootPath)
+	, _id(id)
+	, _maxPackSizeBytes(maxPackSizeBytes)
+	, _sealedPackCount(0)
+	, _activePackNumber(1)
+	, _activePackSizeBytes(0)
+{
+	Open();
+}
+
+void PackBlobStore::Open()
+{
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(_rootPath, ec);
+	if (ec)
+	{
+		throw PackBlobStoreOpenFailed("Failed to create root path", _rootPath, ec);
+	}
+
+	std::vector<uint32_t> packNumbers;
+	for (boost::filesystem::directory_iterator itr(_rootPath, ec); !ec && itr != boost::filesystem::directory_iterator(); itr.increment(ec))
+	{
+		const auto& path = itr->path();
+		const auto packNumber = ParsePackNumber(path);
+		if (packNumber)
+		{
+			packNumbers.push_back(packNumber.value());
+		}
+		else if (path.filename().string().compare(0, INCOMING_PREFIX.size(), INCOMING_PREFIX) == 0)
+		{
+			// Left behind by a writer that never finished
+			boost::system::error_code removeEc;
+			boost::filesystem::remove(path, removeEc);
+		}
+	}
+	if (ec)
+	{
+		throw PackBlobStoreOpenFailed("Failed to list packs", _rootPath, ec);
+	}
+	std::sort(packNumbers.begin(), packNumbers.end());
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto foundActivePack = false;
+	for (const auto packNumber : packNumbers)
+	{
+		std::vector<IndexEntry> entries;
+		if (LoadIndex(packNumber, entries))
+		{
+			_sealedIndex.insert(_sealedIndex.end(), entries.begin(), entries.end());
+			_sealedPackCount++;
+		}
+		else if (packNumber == packNumbers.back())
+		{
+			// The last pack is only sealed once it's full, so its index is rebuilt from its records
+			const auto packSizeBytes = ScanPack(packNumber, entries);
+			boost::system::error_code sizeEc;
+			if (packSizeBytes == 0 && boost::filesystem::file_size(GetPackPath(packNumber), sizeEc) != 0)
+			{
+				// Not recognised as a pack, so it's left as it is for someone to look at rather than truncated to append to
+				BSLIB_LOG_ERROR << "Pack " << GetPackPath(packNumber).string() << " isn't a valid pack, starting a new pack after it";
+				continue;
+			}
+
+			_activePackNumber = packNumber;
+			_activePackSizeBytes = packSizeBytes;
+			for (const auto& entry : entries)
+			{
+				_activeIndex.insert(std::make_pair(entry.address, entry.location));
+			}
+			foundActivePack = true;
+		}
+		else
+		{
+			BSLIB_LOG_WARNING << "Rebuilding the index of pack " << GetPackPath(packNumber).string();
+			ScanPack(packNumber, entries);
+			WriteIndex(packNumber, entries);
+			_sealedIndex.insert(_sealedIndex.end(), entries.begin(), entries.end());
+			_sealedPackCount++;
+		}
+	}
+	std::sort(_sealedIndex.begin(), _sealedIndex.end());
+
+	if (!foundActivePack)
+	{
+		_activePackNumber = packNumbers.empty() ? 1 : packNumbers.back() + 1;
+		_activePackSizeBytes = 0;
+	}
+	OpenActivePackNoLock();
+}
+
+void PackBlobStore::CreateBlob(const Address& address, const std::vector<uint8_t>& content)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (FindNoLock(address))
+	{
+		return;
+	}
+
+	AppendNoLock(address, content.size(), [&](std::ostream& output) {
+		if (!content.empty())
+		{
+			output.write(reinterpret_cast<const char*>(&content[0]), content.size());
+		}
+	});
+}
+
+std::unique_ptr<BlobWriter> PackBlobStore::CreateBlobWriter()
+{
+	return std::make_unique<Writer>(*this);
+}
+
+void PackBlobStore::CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath)
+{
+	const auto blobPath = _rootPath / boost::filesystem::path(UTF8ToWideString(name));
+	boost::system::error_code ec;
+	boost::filesystem::copy_file(sourcePath, blobPath, boost::filesystem::copy_option::overwrite_if_exists, ec);
+	if (ec)
+	{
+		throw CreateBlobFailed("Failed to write named blob file", blobPath, ec);
+	}
+}
+
+std::vector<uint8_t> PackBlobStore::GetBlob(const Address& address) const
+{
+	boost::optional<Location> location;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		location = FindNoLock(address);
+	}
+	if (!location)
+	{
+		throw BlobReadException(address);
+	}
+
+	// Packs are only ever appended to, so the blob can be read without holding the lock
+	boost::filesystem::ifstream input(GetPackPath(location->packNumber), std::ios::in | std::ios::binary);
+	if (!input || !input.seekg(location->offset))
+	{
+		throw BlobReadException(address);
+	}
+
+	std::vector<uint8_t> result(static_cast<size_t>(location->sizeBytes));
+	if (!result.empty() && !input.read(reinterpret_cast<char*>(&result[0]), result.size()))
+	{
+		throw BlobReadException(address);
+	}
+	return result;
+}
+
+void PackBlobStore::Flush()
+{
+	std::set<uint32_t> packNumbers;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		packNumbers.swap(_unflushedPacks);
+	}
+
+	// Appends are already flushed from the stream, so this can run while more blobs are appended
+	for (auto it = packNumbers.begin(); it != packNumbers.end(); ++it)
+	{
+		const auto packPath = GetPackPath(*it);
+		boost::system::error_code ec;
+		file::fs::FlushFile(file::fs::NativePath(WideToUTF8String(boost::filesystem::absolute(packPath).wstring())), ec);
+		if (ec)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_unflushedPacks.insert(it, packNumbers.end());
+			throw CreateBlobFailed("Failed to flush pack", packPath, ec);
+		}
+	}
+}
+
+nlohmann::json PackBlobStore::ConvertToJson() const
+{
+	nlohmann::json result;
+	result["path"] = _rootPath.string();
+	result["maxPackSizeBytes"] = _maxPackSizeBytes;
+	return result;
+}
+
+uint64_t PackBlobStore::GetBlobCount() const
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	return _sealedIndex.size() + _activeIndex.size();
+}
+
+unsigned PackBlobStore::GetPackCount() const
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	return _sealedPackCount + 1;
+}
+
+boost::filesystem::path PackBlobStore::GetPackPath(uint32_t packNumber) const
+{
+	return _rootPath / (boost::format("%1%%2$08d%3%") % PACK_PREFIX % packNumber % PACK_EXTENSION).str();
+}
+
+boost::filesystem::path PackBlobStore::GetIndexPath(uint32_t packNumber) const
+{
+	return _rootPath / (boost::format("%1%%2$08d%3%") % PACK_PREFIX % packNumber % INDEX_EXTENSION).str();
+}
+
+bool PackBlobStore::LoadIndex(uint32_t packNumber, std::vector<IndexEntry>& entries) const
+{
+	boost::filesystem::ifstream input(GetIndexPath(packNumber), std::ios::in | std::ios::binary);
+	if (!input)
+	{
+		return false;
+	}
+
+	char magic[sizeof(INDEX_MAGIC)];
+	uint32_t version;
+	uint64_t packSizeBytes;
+	uint64_t count;
+	if (!input.read(magic, sizeof(magic))
+		|| std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0
+		|| !Read(input, version)
+		|| version != FILE_VERSION
+		|| !Read(input, packSizeBytes)
+		|| !Read(input, count))
+	{
+		return false;
+	}
+
+	// An index is only good for the pack it was written for
+	boost::system::error_code ec;
+	if (boost::filesystem::file_size(GetPackPath(packNumber), ec) != packSizeBytes || ec)
+	{
+		return false;
+	}
+
+	for (auto i = 0ULL; i < count; ++i)
+	{
+		IndexEntry entry;
+		entry.location.packNumber = packNumber;
+		if (!ReadAddress(input, entry.address)
+			|| !Read(input, entry.location.offset)
+			|| !Read(input, entry.location.sizeBytes)
+			|| entry.location.offset > packSizeBytes
+			|| entry.location.sizeBytes > packSizeBytes - entry.location.offset)
+		{
+			entries.clear();
+			return false;
+		}
+		entries.push_back(entry);
+	}
+	return true;
+}
+
+void PackBlobStore::WriteIndex(uint32_t packNumber, std::vector<IndexEntry> entries) const
+{
+	std::sort(entries.begin(), entries.end());
+
+	boost::system::error_code ec;
+	const auto packSizeBytes = boost::filesystem::file_size(GetPackPath(packNumber), ec);
+	const auto indexPath = GetIndexPath(packNumber);
+	if (ec)
+	{
+		throw CreateBlobFailed("Failed to get the size of the pack being indexed", GetPackPath(packNumber), ec);
+	}
+
+	// Write then swap, such that a crash mid-write never leaves a truncated index behind
+	auto tempPath = indexPath;
+	tempPath += ".tmp";
+	{
+		boost::filesystem::ofstream output(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		output.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+		Write(output, FILE_VERSION);
+		Write(output, packSizeBytes);
+		Write(output, static_cast<uint64_t>(entries.size()));
+		for (const auto& entry : entries)
+		{
+			WriteAddress(output, entry.address);
+			Write(output, entry.location.offset);
+			Write(output, entry.location.sizeBytes);
+		}
+
+		output.close();
+		if (!output)
+		{
+			throw CreateBlobFailed("Failed to write pack index", tempPath);
+		}
+	}
+
+	boost::filesystem::rename(tempPath, indexPath, ec);
+	if (ec)
+	{
+		throw CreateBlobFailed("Failed to move pack index", indexPath, ec);
+	}
+}
+
+uint64_t PackBlobStore::ScanPack(uint32_t packNumber, std::vector<IndexEntry>& entries) const
+{
+	const auto packPath = GetPackPath(packNumber);
+	boost::filesystem::ifstream input(packPath, std::ios::in | std::ios::binary);
+	boost::system::error_code ec;
+	const auto packSizeBytes = boost::filesystem::file_size(packPath, ec);
+
+	char magic[sizeof(PACK_MAGIC)];
+	uint32_t version;
+	if (ec
+		|| !input.read(magic, sizeof(magic))
+		|| std::memcmp(magic, PACK_MAGIC, sizeof(magic)) != 0
+		|| !Read(input, version)
+		|| version != FILE_VERSION)
+	{
+		if (!ec && packSizeBytes > 0)
+		{
+			BSLIB_LOG_WARNING << "Ignoring pack without a valid header " << packPath.string();
+		}
+		return 0;
+	}
+
+	// Stops at the first incomplete record, which is all that's lost if the process died while appending
+	auto end = PACK_HEADER_SIZE_BYTES;
+	for (;;)
+	{
+		uint32_t recordMagic;
+		IndexEntry entry;
+		if (!Read(input, recordMagic)
+			|| recordMagic != RECORD_MAGIC
+			|| !ReadAddress(input, entry.address)
+			|| !Read(input, entry.location.sizeBytes))
+		{
+			break;
+		}
+
+		entry.location.packNumber = packNumber;
+		entry.location.offset = end + GetRecordHeaderSize(entry.address);
+		if (entry.location.offset > packSizeBytes || entry.location.sizeBytes > packSizeBytes - entry.location.offset)
+		{
+			break;
+		}
+
+		entries.push_back(entry);
+		end = entry.location.offset + entry.location.sizeBytes;
+		if (!input.seekg(end))
+		{
+			break;
+		}
+	}
+
+	if (end < packSizeBytes)
+	{
+		BSLIB_LOG_WARNING << "Ignoring " << (packSizeBytes - end) << " bytes after the last complete record in " << packPath.string();
+	}
+	return end;
+}
+
+boost::optional<PackBlobStore::Location> PackBlobStore::FindNoLock(const Address& address) const
+{
+	const auto active = _activeIndex.find(address);
+	if (active != _activeIndex.end())
+	{
+		return active->second;
+	}
+
+	IndexEntry needle;
+	needle.address = address;
+	const auto sealed = std::lower_bound(_sealedIndex.begin(), _sealedIndex.end(), needle);
+	if (sealed != _sealedIndex.end() && sealed->address == address)
+	{
+		return sealed->location;
+	}
+	return boost::none;
+}
+
+void PackBlobStore::AppendNoLock(const Address& address, uint64_t sizeBytes, const std::function<void(std::ostream&)>& writeContent)
+{
+	Location location;
+	location.packNumber = _activePackNumber;
+	location.offset = _activePackSizeBytes + GetRecordHeaderSize(address);
+	location.sizeBytes = sizeBytes;
+
+	Write(_activePack, RECORD_MAGIC);
+	WriteAddress(_activePack, address);
+	Write(_activePack, sizeBytes);
+	writeContent(_activePack);
+	_activePack.flush();
+	if (!_activePack)
+	{
+		const auto packPath = GetPackPath(_activePackNumber);
+		try
+		{
+			// Cut off the partial record, so the next append doesn't land after it
+			OpenActivePackNoLock();
+		}
+		catch (const CreateBlobFailed& e)
+		{
+			BSLIB_LOG_WARNING << "Failed to reopen pack after a failed append: " << e.what();
+		}
+		throw CreateBlobFailed("Failed to append blob to pack", packPath);
+	}
+
+	_activeIndex.insert(std::make_pair(address, location));
+	_activePackSizeBytes = location.offset + sizeBytes;
+	_unflushedPacks.insert(_activePackNumber);
+
+	if (_activePackSizeBytes >= _maxPackSizeBytes)
+	{
+		try
+		{
+			SealNoLock();
+		}
+		catch (const CreateBlobFailed& e)
+		{
+			// The blob is safely stored, the pack is sealed on a later append instead
+			BSLIB_LOG_WARNING << "Failed to seal pack: " << e.what();
+		}
+	}
+}
+
+void PackBlobStore::OpenActivePackNoLock()
+{
+	const auto packPath = GetPackPath(_activePackNumber);
+	if (_activePack.is_open())
+	{
+		_activePack.close();
+	}
+	_activePack.clear();
+
+	// Drops anything after the last complete record, such as a blob that was being appended when the process died
+	boost::system::error_code ec;
+	if (boost::filesystem::exists(packPath, ec))
+	{
+		boost::filesystem::resize_file(packPath, _activePackSizeBytes, ec);
+		if (ec)
+		{
+			throw CreateBlobFailed("Failed to truncate pack", packPath, ec);
+		}
+	}
+
+	_activePack.open(packPath, std::ios::out | std::ios::binary | std::ios::app);
+	if (!_activePack)
+	{
+		throw CreateBlobFailed("Failed to open pack", packPath);
+	}
+
+	if (_activePackSizeBytes == 0)
+	{
+		_activePack.write(PACK_MAGIC, sizeof(PACK_MAGIC));
+		Write(_activePack, FILE_VERSION);
+		_activePack.flush();
+		if (!_activePack)
+		{
+			throw CreateBlobFailed("Failed to write pack header", packPath);
+		}
+		_activePackSizeBytes = PACK_HEADER_SIZE_BYTES;
+	}
+}
+
+void PackBlobStore::SealNoLock()
+{
+	std::vector<IndexEntry> entries;
+	entries.reserve(_activeIndex.size());
+	for (const auto& active : _activeIndex)
+	{
+		IndexEntry entry;
+		entry.address = active.first;
+		entry.location = active.second;
+		entries.push_back(entry);
+	}
+
+	// Written before anything changes, so the pack stays active if this fails
+	WriteIndex(_activePackNumber, entries);
+
+	std::vector<IndexEntry> sealedIndex;
+	sealedIndex.reserve(_sealedIndex.size() + entries.size());
+	std::merge(_sealedIndex.begin(), _sealedIndex.end(), entries.begin(), entries.end(), std::back_inserter(sealedIndex));
+	_sealedIndex.swap(sealedIndex);
+	_sealedPackCount++;
+	_activeIndex.clear();
+
+	_activePackNumber++;
+	_activePackSizeBytes = 0;
+	OpenActivePackNoLock();
+}
+
+}
+}
+}
@@ -0,0 +1,709 @@
+#include "bslib/blob/S3BlobStore.hpp"
+
+#include "bslib/blob/HttpConnection.hpp"
+#include "bslib/blob/Sha256.hpp"
+#include "bslib/blob/exceptions.hpp"
+#include "bslib/date_time.hpp"
+#include "bslib/log.hpp"
+#include "bslib/ObjectPool.hpp"
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/optional.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+const std::string S3BlobStore::TYPE = "s3";
+
+namespace {
+// Named blobs are kept apart from the blobs named after their address, so they aren't listed
+const std::string NAMED_BLOB_PREFIX = "named/";
+
+// Content isn't signed, so it needn't be hashed before it's sent
+const std::string UNSIGNED_PAYLOAD = "UNSIGNED-PAYLOAD";
+const std::string SIGNED_HEADERS = "host;x-amz-content-sha256;x-amz-date";
+
+// Times a request that times out is sent, every request is keyed such that sending it again does no harm
+const unsigned MAX_REQUEST_ATTEMPTS = 3;
+
+bool IsUnreserved(char c)
+{
+	return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+		|| c == '-' || c == '_' || c == '.' || c == '~';
+}
+
+std::string UriEncode(const std::string& value, bool encodeSlash)
+{
+	std::ostringstream result;
+	result << std::uppercase << std::hex << std::setfill('0');
+	for (const auto c : value)
+	{
+		if (IsUnreserved(c) || (c == '/' && !encodeSlash))
+		{
+			result << c;
+		}
+		else
+		{
+			result << '%' << std::setw(2) << static_cast<unsigned>(static_cast<unsigned char>(c));
+		}
+	}
+	return result.str();
+}
+
+/**
+ * Encodes the query in order of name, which is also the order it's signed in
+ */
+std::string ToQueryString(const std::map<std::string, std::string>& query)
+{
+	std::string result;
+	for (const auto& parameter : query)
+	{
+		if (!result.empty())
+		{
+			result += "&";
+		}
+		result += UriEncode(parameter.first, true) + "=" + UriEncode(parameter.second, true);
+	}
+	return result;
+}
+
+/**
+ * Signs a request with AWS Signature Version 4, for the given host as it's sent in the host header
+ */
+void Sign(
+	HttpRequest& request,
+	const std::string& path,
+	const std::string& queryString,
+	const std::string& host,
+	const S3BlobStoreSettings& settings)
+{
+	const auto timestamp = boost::posix_time::to_iso_string(boost::posix_time::second_clock::universal_time()) + "Z";
+	const auto date = timestamp.substr(0, 8);
+	request.headers["x-amz-date"] = timestamp;
+	request.headers["x-amz-content-sha256"] = UNSIGNED_PAYLOAD;
+
+	std::ostringstream canonicalRequest;
+	canonicalRequest << request.method << "\n"
+		<< path << "\n"
+		<< queryString << "\n"
+		<< "host:" << host << "\n"
+		<< "x-amz-content-sha256:" << UNSIGNED_PAYLOAD << "\n"
+		<< "x-amz-date:" << timestamp << "\n"
+		<< "\n"
+		<< SIGNED_HEADERS << "\n"
+		<< UNSIGNED_PAYLOAD;
+	Sha256 canonicalRequestHash;
+	canonicalRequestHash.Update(canonicalRequest.str());
+
+	const auto scope = date + "/" + settings.region + "/s3/aws4_request";
+	const auto stringToSign = "AWS4-HMAC-SHA256\n" + timestamp + "\n" + scope + "\n" + ToHexString(canonicalRequestHash.Finalize());
+
+	auto signingKey = HmacSha256("AWS4" + settings.secretAccessKey, date);
+	signingKey = HmacSha256(signingKey, settings.region);
+	signingKey = HmacSha256(signingKey, "s3");
+	signingKey = HmacSha256(signingKey, "aws4_request");
+	request.headers["Authorization"] = "AWS4-HMAC-SHA256 Credential=" + settings.accessKeyId + "/" + scope
+		+ ", SignedHeaders=" + SIGNED_HEADERS
+		+ ", Signature=" + ToHexString(HmacSha256(signingKey, stringToSign));
+}
+
+boost::property_tree::ptree ParseXml(const HttpResponse& response)
+{
+	std::istringstream stream(response.GetBodyString());
+	boost::property_tree::ptree tree;
+	boost::property_tree::read_xml(stream, tree);
+	return tree;
+}
+
+/**
+ * Splits an endpoint into its host and port, which is 80 if it's not given
+ * \exception BlobStoreError The endpoint isn't a host and port
+ */
+std::pair<std::string, std::string> SplitEndpoint(std::string endpoint)
+{
+	if (boost::starts_with(endpoint, "http://"))
+	{
+		endpoint = endpoint.substr(7);
+	}
+	if (endpoint.empty() || endpoint.find('/') != std::string::npos)
+	{
+		throw BlobStoreError("S3 blob store endpoint " + endpoint + " isn't a host and port");
+	}
+
+	const auto colon = endpoint.rfind(':');
+	if (colon == std::string::npos)
+	{
+		return std::make_pair(endpoint, std::string("80"));
+	}
+	return std::make_pair(endpoint.substr(0, colon), endpoint.substr(colon + 1));
+}
+
+/**
+ * Describes a response that failed, the body of which holds the server's error
+ */
+std::string DescribeFailure(const HttpResponse& response)
+{
+	return "HTTP " + std::to_string(response.status) + " " + response.GetBodyString();
+}
+
+/**
+ * Reads part of a file into the given buffer, opening the file for each part as parts are read on several threads at once
+ * \exception CreateBlobFailed The file couldn't be read
+ */
+const uint8_t* ReadFilePart(const boost::filesystem::path& path, uint64_t offset, size_t size, std::vector<uint8_t>& buffer)
+{
+	boost::filesystem::ifstream file(path, std::ios::in | std::ios::binary);
+	file.seekg(offset);
+	buffer.resize(size);
+	file.read(reinterpret_cast<char*>(buffer.data()), size);
+	if (!file)
+	{
+		throw CreateBlobFailed("Failed to read blob file", path);
+	}
+	return buffer.data();
+}
+}
+
+/**
+ * Holds content in memory, or in a temporary file once it reaches the multipart threshold, until it's put on commit
+ */
+class S3BlobStore::Writer : public BlobWriter
+{
+public:
+	explicit Writer(S3BlobStore& store)
+		: _store(store)
+		, _spooledBytes(0)
+	{
+	}
+
+	~Writer()
+	{
+		if (_file.is_open())
+		{
+			_file.close();
+		}
+
+		if (!_spoolPath.empty())
+		{
+			boost::system::error_code ec;
+			boost::filesystem::remove(_spoolPath, ec);
+		}
+	}
+
+	void Write(const uint8_t* data, size_t size) override
+	{
+		if (_spoolPath.empty())
+		{
+			if (_content.size() + size < _store._settings.multipartThresholdBytes)
+			{
+				_content.insert(_content.end(), data, data + size);
+				return;
+			}
+			Spool();
+		}
+		WriteSpool(data, size);
+	}
+
+	void Commit(const Address& address) override
+	{
+		if (_spoolPath.empty())
+		{
+			_store.CreateBlob(address, _content);
+			return;
+		}
+
+		_file.close();
+		if (_file.fail())
+		{
+			throw CreateBlobFailed("Failed to write spooled blob file", _spoolPath);
+		}
+		_store.PutObjectInParts(_store.GetBlobKey(address), _spooledBytes, [&](uint64_t offset, size_t size, std::vector<uint8_t>& buffer) {
+			return ReadFilePart(_spoolPath, offset, size, buffer);
+		});
+	}
+
+private:
+	/**
+	 * Moves the content written so far to a new temporary file, which the rest of the content is written to
+	 */
+	void Spool()
+	{
+		boost::system::error_code ec;
+		const auto directory = boost::filesystem::temp_directory_path(ec);
+		if (ec)
+		{
+			throw CreateBlobFailed("Failed to find the temporary directory to spool a blob to", directory, ec);
+		}
+
+		_spoolPath = directory / ("bslib-s3-" + Uuid::Create().ToDashlessString());
+		_file.open(_spoolPath, std::ios::out | std::ios::binary);
+		if (!_file)
+		{
+			throw CreateBlobFailed("Failed to create spooled blob file", _spoolPath);
+		}
+		WriteSpool(_content.data(), _content.size());
+		std::vector<uint8_t>().swap(_content);
+	}
+
+	void WriteSpool(const uint8_t* data, size_t size)
+	{
+		_file.write(reinterpret_cast<const char*>(data), size);
+		if (!_file)
+		{
+			throw CreateBlobFailed("Failed to write spooled blob file", _spoolPath);
+		}
+		_spooledBytes += size;
+	}
+
+	S3BlobStore& _store;
+	std::vector<uint8_t> _content;
+	boost::filesystem::path _spoolPath;
+	boost::filesystem::ofstream _file;
+	uint64_t _spooledBytes;
+};
+
+struct S3BlobStore::Connections
+{
+	Connections(const std::pair<std::string, std::string>& endpoint, unsigned capacity, std::chrono::milliseconds timeout)
+		: host(endpoint.first)
+		, port(endpoint.second)
+		, pool(capacity, [endpoint, timeout]() {
+			return std::make_unique<HttpConnection>(endpoint.first, endpoint.second, timeout);
+		})
+	{
+	}
+
+	const std::string host;
+	const std::string port;
+	ObjectPool<HttpConnection> pool;
+};
+
+S3BlobStore::S3BlobStore(const S3BlobStoreSettings& settings)
+	: S3BlobStore(Uuid::Create(), settings)
+{
+}
+
+S3BlobStore::S3BlobStore(const Uuid& id, const nlohmann::json& settings)
+	: S3BlobStore(id, ParseSettings(settings))
+{
+}
+
+S3BlobStore::S3BlobStore(const Uuid& id, const S3BlobStoreSettings& settings)
+	: _id(id)
+	, _settings(settings)
+	, _connections(std::make_unique<Connections>(SplitEndpoint(settings.endpoint), settings.maxConnections, settings.timeout))
+{
+	if (_settings.bucket.empty() || _settings.maxConnections == 0 || _settings.partSizeBytes == 0)
+	{
+		throw BlobStoreError("S3 blob stores need a bucket, and a number of connections and part size above 0");
+	}
+}
+
+S3BlobStore::~S3BlobStore()
+{
+}
+
+void S3BlobStore::CreateBlob(const Address& address, const std::vector<uint8_t>& content)
+{
+	const auto key = GetBlobKey(address);
+	if (content.size() < _settings.multipartThresholdBytes)
+	{
+		PutObject(key, content.data(), content.size());
+		return;
+	}
+
+	PutObjectInParts(key, content.size(), [&](uint64_t offset, size_t, std::vector<uint8_t>&) {
+		return content.data() + offset;
+	});
+}
+
+std::unique_ptr<BlobWriter> S3BlobStore::CreateBlobWriter()
+{
+	return std::make_unique<Writer>(*this);
+}
+
+void S3BlobStore::CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath)
+{
+	boost::system::error_code ec;
+	const auto sizeBytes = boost::filesystem::file_size(sourcePath, ec);
+	if (ec)
+	{
+		throw CreateBlobFailed("Failed to get the size of named blob file", sourcePath, ec);
+	}
+
+	const auto readPart = [&](uint64_t offset, size_t size, std::vector<uint8_t>& buffer) {
+		return ReadFilePart(sourcePath, offset, size, buffer);
+	};
+
+	const auto key = _settings.prefix + NAMED_BLOB_PREFIX + name;
+	if (sizeBytes < _settings.multipartThresholdBytes)
+	{
+		std::vector<uint8_t> content;
+		const auto data = readPart(0, static_cast<size_t>(sizeBytes), content);
+		PutObject(key, data, content.size());
+		return;
+	}
+
+	PutObjectInParts(key, sizeBytes, readPart);
+}
+
+std::vector<uint8_t> S3BlobStore::GetBlob(const Address& address) const
+{
+	HttpResponse response;
+	try
+	{
+		response = Send("GET", GetBlobKey(address), {});
+	}
+	catch (const HttpRequestFailed& e)
+	{
+		BSLIB_LOG_DEBUG << e.what();
+		throw BlobReadException(address);
+	}
+
+	if (!response.IsSuccess())
+	{
+		BSLIB_LOG_DEBUG << "Failed to get blob " << address.ToString() << " from bucket " << _settings.bucket << ", " << DescribeFailure(response);
+		throw BlobReadException(address);
+	}
+	return std::move(response.body);
+}
+
+std::set<Address> S3BlobStore::FindBlobs(const std::vector<Address>& addresses) const
+{
+	// Not a vector<bool>, as each element is set by a different thread
+	std::vector<uint8_t> found(addresses.size(), 0);
+	RunConcurrently(addresses.size(), [&](size_t index) {
+		const auto response = Send("HEAD", GetBlobKey(addresses[index]), {});
+		if (response.IsSuccess())
+		{
+			found[index] = 1;
+		}
+		else if (response.status != 404)
+		{
+			throw BlobStoreError("Failed to check for blob " + addresses[index].ToString() + " in bucket " + _settings.bucket + ", " + DescribeFailure(response));
+		}
+	});
+
+	std::set<Address> result;
+	for (size_t i = 0; i < addresses.size(); ++i)
+	{
+		if (found[i])
+		{
+			result.insert(addresses[i]);
+		}
+	}
+	return result;
+}
+
+bool S3BlobStore::ListBlobs(const std::function<void(const StoredBlob& blob)>& visit) const
+{
+	boost::optional<std::string> continuationToken;
+	do
+	{
+		// Listed a level at a time, so named blobs aren't listed
+		std::map<std::string, std::string> query = {
+			{ "list-type", "2" },
+			{ "prefix", _settings.prefix },
+			{ "delimiter", "/" }
+		};
+		if (continuationToken)
+		{
+			query["continuation-token"] = *continuationToken;
+		}
+
+		const auto response = Send("GET", "", query);
+		if (!response.IsSuccess())
+		{
+			throw BlobStoreError("Failed to list bucket " + _settings.bucket + ", " + DescribeFailure(response));
+		}
+
+		boost::property_tree::ptree listing;
+		try
+		{
+			listing = ParseXml(response).get_child("ListBucketResult");
+		}
+		catch (const boost::property_tree::ptree_error& e)
+		{
+			throw BlobStoreError("Failed to read the listing of bucket " + _settings.bucket + ", " + e.what());
+		}
+
+		for (const auto& child : listing)
+		{
+			if (child.first != "Contents")
+			{
+				continue;
+			}
+
+			StoredBlob blob;
+			try
+			{
+				blob.address = Address(child.second.get<std::string>("Key").substr(_settings.prefix.size()));
+			}
+			catch (const std::exception&)
+			{
+				// Not a blob this store created
+				continue;
+			}
+			blob.sizeBytes = child.second.get<uint64_t>("Size", 0);
+			blob.lastWriteUtc = FromIso8601Utc(child.second.get<std::string>("LastModified", "1970-01-01T00:00:00Z"));
+			visit(blob);
+		}
+
+		continuationToken = boost::none;
+		if (listing.get<std::string>("IsTruncated", "false") == "true")
+		{
+			continuationToken = listing.get_optional<std::string>("NextContinuationToken");
+		}
+	} while (continuationToken);
+	return true;
+}
+
+void S3BlobStore::DeleteBlob(const Address& address)
+{
+	const auto key = GetBlobKey(address);
+	HttpResponse response;
+	try
+	{
+		response = Send("DELETE", key, {});
+	}
+	catch (const HttpRequestFailed& e)
+	{
+		throw DeleteBlobFailed(e.what(), boost::filesystem::path(key));
+	}
+
+	if (!response.IsSuccess() && response.status != 404)
+	{
+		throw DeleteBlobFailed("Failed to delete blob from bucket " + _settings.bucket + ", " + DescribeFailure(response), boost::filesystem::path(key));
+	}
+}
+
+nlohmann::json S3BlobStore::ConvertToJson() const
+{
+	nlohmann::json result;
+	result["endpoint"] = _settings.endpoint;
+	result["bucket"] = _settings.bucket;
+	result["region"] = _settings.region;
+	result["prefix"] = _settings.prefix;
+	result["accessKeyId"] = _settings.accessKeyId;
+	result["secretAccessKey"] = _settings.secretAccessKey;
+	result["maxConnections"] = _settings.maxConnections;
+	result["multipartThresholdBytes"] = _settings.multipartThresholdBytes;
+	result["partSizeBytes"] = _settings.partSizeBytes;
+	result["timeoutMilliseconds"] = static_cast<int64_t>(_settings.timeout.count());
+	return result;
+}
+
+S3BlobStoreSettings S3BlobStore::ParseSettings(const nlohmann::json& settings)
+{
+	S3BlobStoreSettings result;
+	result.endpoint = settings.at("endpoint").get<std::string>();
+	result.bucket = settings.at("bucket").get<std::string>();
+	result.region = settings.value("region", result.region);
+	result.prefix = settings.value("prefix", result.prefix);
+	result.accessKeyId = settings.value("accessKeyId", result.accessKeyId);
+	result.secretAccessKey = settings.value("secretAccessKey", result.secretAccessKey);
+	result.maxConnections = settings.value("maxConnections", result.maxConnections);
+	result.multipartThresholdBytes = settings.value("multipartThresholdBytes", result.multipartThresholdBytes);
+	result.partSizeBytes = settings.value("partSizeBytes", result.partSizeBytes);
+	result.timeout = std::chrono::milliseconds(
+		settings.value("timeoutMilliseconds", static_cast<int64_t>(result.timeout.count())));
+	return result;
+}
+
+HttpResponse S3BlobStore::Send(
+	const std::string& method,
+	const std::string& key,
+	const std::map<std::string, std::string>& query,
+	const uint8_t* body,
+	size_t bodySize) const
+{
+	// Path style, so the bucket needn't resolve as a host
+	auto path = "/" + UriEncode(_settings.bucket, true);
+	if (!key.empty())
+	{
+		path += "/" + UriEncode(key, false);
+	}
+	const auto queryString = ToQueryString(query);
+
+	HttpRequest request;
+	request.method = method;
+	request.target = queryString.empty() ? path : path + "?" + queryString;
+	request.body = body;
+	request.bodySize = bodySize;
+	if (!_settings.accessKeyId.empty())
+	{
+		Sign(request, path, queryString, _connections->host + ":" + _connections->port, _settings);
+	}
+
+	for (auto attempt = 1U;; ++attempt)
+	{
+		try
+		{
+			auto connection = _connections->pool.Acquire();
+			return connection->Send(request);
+		}
+		catch (const HttpRequestTimedOut& e)
+		{
+			if (attempt >= MAX_REQUEST_ATTEMPTS)
+			{
+				throw;
+			}
+			BSLIB_LOG_WARNING << e.what() << ", sending it again";
+		}
+	}
+}
+
+void S3BlobStore::PutObject(const std::string& key, const uint8_t* data, size_t size)
+{
+	const auto response = Send("PUT", key, {}, data, size);
+	if (!response.IsSuccess())
+	{
+		throw CreateBlobFailed("Failed to put " + key + " in bucket " + _settings.bucket + ", " + DescribeFailure(response), boost::filesystem::path(key));
+	}
+}
+
+void S3BlobStore::PutObjectInParts(
+	const std::string& key,
+	uint64_t sizeBytes,
+	const std::function<const uint8_t*(uint64_t offset, size_t size, std::vector<uint8_t>& buffer)>& getPart)
+{
+	const auto initiated = Send("POST", key, { { "uploads", "" } });
+	boost::optional<std::string> uploadId;
+	if (initiated.IsSuccess())
+	{
+		try
+		{
+			uploadId = ParseXml(initiated).get_optional<std::string>("InitiateMultipartUploadResult.UploadId");
+		}
+		catch (const boost::property_tree::ptree_error&)
+		{
+		}
+	}
+	if (!uploadId)
+	{
+		throw CreateBlobFailed("Failed to start uploading " + key + " to bucket " + _settings.bucket + ", " + DescribeFailure(initiated), boost::filesystem::path(key));
+	}
+
+	try
+	{
+		const auto partCount = static_cast<size_t>((sizeBytes + _settings.partSizeBytes - 1) / _settings.partSizeBytes);
+		std::vector<std::string> etags(partCount);
+		RunConcurrently(partCount, [&](size_t index) {
+			const auto offset = index * _settings.partSizeBytes;
+			const auto size = static_cast<size_t>(std::min(_settings.partSizeBytes, sizeBytes - offset));
+			std::vector<uint8_t> buffer;
+			const auto data = getPart(offset, size, buffer);
+
+			const auto response = Send("PUT", key, { { "partNumber", std::to_string(index + 1) }, { "uploadId", *uploadId } }, data, size);
+			const auto etag = response.headers.find("etag");
+			if (!response.IsSuccess() || etag == response.headers.end())
+			{
+				throw CreateBlobFailed("Failed to upload part " + std::to_string(index + 1) + " of " + key + " to bucket " + _settings.bucket + ", " + DescribeFailure(response), boost::filesystem::path(key));
+			}
+			etags[index] = etag->second;
+		});
+
+		std::ostringstream completion;
+		completion << "<CompleteMultipartUpload>";
+		for (size_t i = 0; i < partCount; ++i)
+		{
+			completion << "<Part><PartNumber>" << (i + 1) << "</PartNumber><ETag>" << etags[i] << "</ETag></Part>";
+		}
+		completion << "</CompleteMultipartUpload>";
+		const auto completionBody = completion.str();
+		const auto completed = Send(
+			"POST",
+			key,
+			{ { "uploadId", *uploadId } },
+			reinterpret_cast<const uint8_t*>(completionBody.data()),
+			completionBody.size());
+
+		// Completing can fail after the server has started to respond, which it reports in the body
+		if (!completed.IsSuccess() || completed.GetBodyString().find("<Error>") != std::string::npos)
+		{
+			throw CreateBlobFailed("Failed to complete uploading " + key + " to bucket " + _settings.bucket + ", " + DescribeFailure(completed), boost::filesystem::path(key));
+		}
+	}
+	catch (const std::exception&)
+	{
+		// Otherwise the parts are kept, and charged for, until the bucket's lifecycle removes them
+		try
+		{
+			Send("DELETE", key, { { "uploadId", *uploadId } });
+		}
+		catch (const std::exception& e)
+		{
+			BSLIB_LOG_WARNING << "Failed to abort uploading " << key << " to bucket " << _settings.bucket << ": " << e.what();
+		}
+		throw;
+	}
+}
+
+void S3BlobStore::RunConcurrently(size_t count, const std::function<void(size_t index)>& run) const
+{
+	const auto threadCount = std::min<size_t>(_settings.maxConnections, count);
+
+	// Each thread takes the next index, so a slow request doesn't hold up the requests behind it
+	std::atomic<size_t> next(0);
+	std::mutex errorMutex;
+	std::exception_ptr error;
+	const auto runNext = [&]() {
+		for (auto i = next++; i < count; i = next++)
+		{
+			try
+			{
+				run(i);
+			}
+			catch (...)
+			{
+				std::unique_lock<std::mutex> lock(errorMutex);
+				if (!error)
+				{
+					error = std::current_exception();
+				}
+				next = count;
+				return;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < threadCount; ++i)
+	{
+		threads.emplace_back(runNext);
+	}
+	runNext();
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+std::string S3BlobStore::GetBlobKey(const Address& address) const
+{
+	return _settings.prefix + address.ToString();
+}
+
+}
+}
+}
@@ -0,0 +1,296 @@
+#include "bslib/blob/Sha1Hasher.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BSLIB_SHA1_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BSLIB_TARGET_SHA
+#else
+#include <cpuid.h>
+#define BSLIB_TARGET_SHA __attribute__((target("sha,ssse3,sse4.1")))
+#endif
+#include <immintrin.h>
+#endif
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+namespace {
+
+inline uint32_t RotateLeft(uint32_t value, int bits)
+{
+	return (value << bits) | (value >> (32 - bits));
+}
+
+void CompressPortable(uint32_t* state, const uint8_t* blocks, size_t blockCount)
+{
+	for (size_t block = 0; block < blockCount; ++block, blocks += 64)
+	{
+		uint32_t w[80];
+		for (auto i = 0; i < 16; ++i)
+		{
+			w[i] = (static_cast<uint32_t>(blocks[i * 4]) << 24) |
+				(static_cast<uint32_t>(blocks[i * 4 + 1]) << 16) |
+				(static_cast<uint32_t>(blocks[i * 4 + 2]) << 8) |
+				static_cast<uint32_t>(blocks[i * 4 + 3]);
+		}
+		for (auto i = 16; i < 80; ++i)
+		{
+			w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+		}
+
+		auto a = state[0];
+		auto b = state[1];
+		auto c = state[2];
+		auto d = state[3];
+		auto e = state[4];
+		const auto round = [&](uint32_t f, uint32_t k, uint32_t wi) {
+			const auto temp = RotateLeft(a, 5) + f + e + k + wi;
+			e = d;
+			d = c;
+			c = RotateLeft(b, 30);
+			b = a;
+			a = temp;
+		};
+
+		for (auto i = 0; i < 20; ++i)
+		{
+			round((b & c) | (~b & d), 0x5A827999, w[i]);
+		}
+		for (auto i = 20; i < 40; ++i)
+		{
+			round(b ^ c ^ d, 0x6ED9EBA1, w[i]);
+		}
+		for (auto i = 40; i < 60; ++i)
+		{
+			round((b & c) | (b & d) | (c & d), 0x8F1BBCDC, w[i]);
+		}
+		for (auto i = 60; i < 80; ++i)
+		{
+			round(b ^ c ^ d, 0xCA62C1D6, w[i]);
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+}
+
+#ifdef BSLIB_SHA1_X86
+
+/**
+ * Four rounds of SHA-1 with the SHA extensions, the message schedule for later groups is calculated as it goes
+ */
+template<int Group>
+BSLIB_TARGET_SHA inline void Sha1RoundGroup(__m128i& abcd, __m128i& e0, __m128i& e1, __m128i* message)
+{
+	auto& current = Group % 2 == 0 ? e0 : e1;
+	auto& next = Group % 2 == 0 ? e1 : e0;
+
+	if (Group == 0)
+	{
+		current = _mm_add_epi32(current, message[0]);
+	}
+	else
+	{
+		current = _mm_sha1nexte_epu32(current, message[Group % 4]);
+	}
+	next = abcd;
+	if (Group >= 3 && Group <= 18)
+	{
+		message[(Group + 1) % 4] = _mm_sha1msg2_epu32(message[(Group + 1) % 4], message[Group % 4]);
+	}
+	abcd = _mm_sha1rnds4_epu32(abcd, current, Group / 5);
+	if (Group >= 1 && Group <= 16)
+	{
+		message[(Group + 3) % 4] = _mm_sha1msg1_epu32(message[(Group + 3) % 4], message[Group % 4]);
+	}
+	if (Group >= 2 && Group <= 17)
+	{
+		message[(Group + 2) % 4] = _mm_xor_si128(message[(Group + 2) % 4], message[Group % 4]);
+	}
+}
+
+BSLIB_TARGET_SHA void CompressSha(uint32_t* state, const uint8_t* blocks, size_t blockCount)
+{
+	const auto byteSwap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+	auto abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+	auto e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+	__m128i e1;
+	__m128i message[4];
+
+	for (size_t block = 0; block < blockCount; ++block, blocks += 64)
+	{
+		const auto abcdSave = abcd;
+		const auto e0Save = e0;
+
+		for (auto i = 0; i < 4; ++i)
+		{
+			message[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + i * 16)), byteSwap);
+		}
+
+		Sha1RoundGroup<0>(abcd, e0, e1, message);
+		Sha1RoundGroup<1>(abcd, e0, e1, message);
+		Sha1RoundGroup<2>(abcd, e0, e1, message);
+		Sha1RoundGroup<3>(abcd, e0, e1, message);
+		Sha1RoundGroup<4>(abcd, e0, e1, message);
+		Sha1RoundGroup<5>(abcd, e0, e1, message);
+		Sha1RoundGroup<6>(abcd, e0, e1, message);
+		Sha1RoundGroup<7>(abcd, e0, e1, message);
+		Sha1RoundGroup<8>(abcd, e0, e1, message);
+		Sha1RoundGroup<9>(abcd, e0, e1, message);
+		Sha1RoundGroup<10>(abcd, e0, e1, message);
+		Sha1RoundGroup<11>(abcd, e0, e1, message);
+		Sha1RoundGroup<12>(abcd, e0, e1, message);
+		Sha1RoundGroup<13>(abcd, e0, e1, message);
+		Sha1RoundGroup<14>(abcd, e0, e1, message);
+		Sha1RoundGroup<15>(abcd, e0, e1, message);
+		Sha1RoundGroup<16>(abcd, e0, e1, message);
+		Sha1RoundGroup<17>(abcd, e0, e1, message);
+		Sha1RoundGroup<18>(abcd, e0, e1, message);
+		Sha1RoundGroup<19>(abcd, e0, e1, message);
+
+		e0 = _mm_sha1nexte_epu32(e0, e0Save);
+		abcd = _mm_add_epi32(abcd, abcdSave);
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1B));
+	state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+bool DetectShaExtensions()
+{
+	// SSSE3 and SSE4.1 are in leaf 1 ECX, SHA is in leaf 7 EBX
+	const auto ssse3 = 1u << 9;
+	const auto sse41 = 1u << 19;
+	const auto sha = 1u << 29;
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+	__cpuid(info, 1);
+	const auto leaf1Ecx = static_cast<unsigned>(info[2]);
+	__cpuidex(info, 7, 0);
+	const auto leaf7Ebx = static_cast<unsigned>(info[1]);
+#else
+	unsigned eax, ebx, ecx, edx;
+	if (__get_cpuid_max(0, nullptr) < 7)
+	{
+		return false;
+	}
+	__cpuid(1, eax, ebx, ecx, edx);
+	const auto leaf1Ecx = ecx;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	const auto leaf7Ebx = ebx;
+#endif
+	return (leaf1Ecx & ssse3) && (leaf1Ecx & sse41) && (leaf7Ebx & sha);
+}
+
+#endif
+
+}
+
+Sha1Hasher::Sha1Hasher(bool hardwareAccelerated)
+	: _hardwareAccelerated(hardwareAccelerated && IsHardwareAccelerationSupported())
+#ifdef BSLIB_SHA1_X86
+	, _compress(_hardwareAccelerated ? CompressSha : CompressPortable)
+#else
+	, _compress(CompressPortable)
+#endif
+	, _state({ { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 } })
+	, _blockSize(0)
+	, _totalBytes(0)
+{
+}
+
+void Sha1Hasher::Update(const uint8_t* data, size_t size)
+{
+	_totalBytes += size;
+
+	if (_blockSize > 0)
+	{
+		const auto copySize = std::min(size, BLOCK_SIZE_BYTES - _blockSize);
+		std::memcpy(&_block[_blockSize], data, copySize);
+		_blockSize += copySize;
+		data += copySize;
+		size -= copySize;
+		if (_blockSize < BLOCK_SIZE_BYTES)
+		{
+			return;
+		}
+		_compress(&_state[0], &_block[0], 1);
+		_blockSize = 0;
+	}
+
+	// Whole blocks straight from the caller's buffer
+	const auto blockCount = size / BLOCK_SIZE_BYTES;
+	if (blockCount > 0)
+	{
+		_compress(&_state[0], data, blockCount);
+		data += blockCount * BLOCK_SIZE_BYTES;
+		size -= blockCount * BLOCK_SIZE_BYTES;
+	}
+
+	if (size > 0)
+	{
+		std::memcpy(&_block[0], data, size);
+		_blockSize = size;
+	}
+}
+
+void Sha1Hasher::Finalize(uint8_t* digest)
+{
+	const auto totalBits = _totalBytes * 8;
+
+	// Pad with a one bit, zeros and the length in bits, so the length ends a block
+	_block[_blockSize++] = 0x80;
+	if (_blockSize > BLOCK_SIZE_BYTES - 8)
+	{
+		std::fill(_block.begin() + _blockSize, _block.end(), 0);
+		_compress(&_state[0], &_block[0], 1);
+		_blockSize = 0;
+	}
+	std::fill(_block.begin() + _blockSize, _block.end() - 8, 0);
+	for (auto i = 0; i < 8; ++i)
+	{
+		_block[BLOCK_SIZE_BYTES - 1 - i] = static_cast<uint8_t>(totalBits >> (i * 8));
+	}
+	_compress(&_state[0], &_block[0], 1);
+
+	for (size_t i = 0; i < _state.size(); ++i)
+	{
+		digest[i * 4] = static_cast<uint8_t>(_state[i] >> 24);
+		digest[i * 4 + 1] = static_cast<uint8_t>(_state[i] >> 16);
+		digest[i * 4 + 2] = static_cast<uint8_t>(_state[i] >> 8);
+		digest[i * 4 + 3] = static_cast<uint8_t>(_state[i]);
+	}
+}
+
+const char* Sha1Hasher::GetImplementationName() const
+{
+	return _hardwareAccelerated ? "SHA-1 (SHA extensions)" : "SHA-1 (portable)";
+}
+
+bool Sha1Hasher::IsHardwareAccelerationSupported()
+{
+#ifdef BSLIB_SHA1_X86
+	static const auto supported = DetectShaExtensions();
+	return supported;
+#else
+	return false;
+#endif
+}
+
+}
+}
+}
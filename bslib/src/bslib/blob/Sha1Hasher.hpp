@@ -0,0 +1,43 @@
+#pragma once
+
+#include "bslib/blob/Hasher.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+/**
+ * SHA-1, using the x86 SHA extensions when the CPU has them
+ */
+class Sha1Hasher : public Hasher
+{
+public:
+	explicit Sha1Hasher(bool hardwareAccelerated = IsHardwareAccelerationSupported());
+
+	void Update(const uint8_t* data, size_t size) override;
+	void Finalize(uint8_t* digest) override;
+	const char* GetImplementationName() const override;
+
+	/**
+	 * Whether this CPU supports the SHA extensions
+	 */
+	static bool IsHardwareAccelerationSupported();
+private:
+	typedef void (*CompressFunction)(uint32_t* state, const uint8_t* blocks, size_t blockCount);
+
+	static const size_t BLOCK_SIZE_BYTES = 64;
+
+	const bool _hardwareAccelerated;
+	const CompressFunction _compress;
+	std::array<uint32_t, 5> _state;
+	std::array<uint8_t, BLOCK_SIZE_BYTES> _block;
+	size_t _blockSize;
+	uint64_t _totalBytes;
+};
+
+}
+}
+}
@@ -0,0 +1,198 @@
+#include "bslib/blob/Sha256.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+namespace {
+const uint32_t ROUND_CONSTANTS[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline uint32_t RotateRight(uint32_t value, int bits)
+{
+	return (value >> bits) | (value << (32 - bits));
+}
+}
+
+Sha256::Sha256()
+	: _state{ { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 } }
+	, _blockSize(0)
+	, _totalBytes(0)
+{
+}
+
+void Sha256::Update(const uint8_t* data, size_t size)
+{
+	_totalBytes += size;
+	while (size > 0)
+	{
+		const auto count = std::min(size, BLOCK_SIZE_BYTES - _blockSize);
+		std::copy(data, data + count, _block.begin() + _blockSize);
+		_blockSize += count;
+		data += count;
+		size -= count;
+		if (_blockSize == BLOCK_SIZE_BYTES)
+		{
+			Compress(_block.data());
+			_blockSize = 0;
+		}
+	}
+}
+
+void Sha256::Update(const std::string& data)
+{
+	Update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+Sha256::Digest Sha256::Finalize()
+{
+	const auto totalBits = _totalBytes * 8;
+	const uint8_t pad = 0x80;
+	Update(&pad, 1);
+	const uint8_t zero = 0;
+	while (_blockSize != BLOCK_SIZE_BYTES - 8)
+	{
+		Update(&zero, 1);
+	}
+
+	uint8_t length[8];
+	for (auto i = 0; i < 8; ++i)
+	{
+		length[i] = static_cast<uint8_t>(totalBits >> (56 - i * 8));
+	}
+	Update(length, sizeof(length));
+
+	Digest digest;
+	for (auto i = 0; i < 8; ++i)
+	{
+		digest[i * 4] = static_cast<uint8_t>(_state[i] >> 24);
+		digest[i * 4 + 1] = static_cast<uint8_t>(_state[i] >> 16);
+		digest[i * 4 + 2] = static_cast<uint8_t>(_state[i] >> 8);
+		digest[i * 4 + 3] = static_cast<uint8_t>(_state[i]);
+	}
+	return digest;
+}
+
+void Sha256::Compress(const uint8_t* block)
+{
+	uint32_t w[64];
+	for (auto i = 0; i < 16; ++i)
+	{
+		w[i] = (static_cast<uint32_t>(block[i * 4]) << 24) |
+			(static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
+			(static_cast<uint32_t>(block[i * 4 + 2]) << 8) |
+			static_cast<uint32_t>(block[i * 4 + 3]);
+	}
+	for (auto i = 16; i < 64; ++i)
+	{
+		const auto s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		const auto s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	auto a = _state[0];
+	auto b = _state[1];
+	auto c = _state[2];
+	auto d = _state[3];
+	auto e = _state[4];
+	auto f = _state[5];
+	auto g = _state[6];
+	auto h = _state[7];
+	for (auto i = 0; i < 64; ++i)
+	{
+		const auto s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+		const auto choose = (e & f) ^ (~e & g);
+		const auto temp1 = h + s1 + choose + ROUND_CONSTANTS[i] + w[i];
+		const auto s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+		const auto majority = (a & b) ^ (a & c) ^ (b & c);
+		const auto temp2 = s0 + majority;
+		h = g;
+		g = f;
+		f = e;
+		e = d + temp1;
+		d = c;
+		c = b;
+		b = a;
+		a = temp1 + temp2;
+	}
+
+	_state[0] += a;
+	_state[1] += b;
+	_state[2] += c;
+	_state[3] += d;
+	_state[4] += e;
+	_state[5] += f;
+	_state[6] += g;
+	_state[7] += h;
+}
+
+Sha256::Digest HmacSha256(const uint8_t* key, size_t keySize, const std::string& message)
+{
+	const size_t blockSize = 64;
+	std::array<uint8_t, blockSize> paddedKey = {};
+	if (keySize > blockSize)
+	{
+		Sha256 keyHash;
+		keyHash.Update(key, keySize);
+		const auto digest = keyHash.Finalize();
+		std::copy(digest.begin(), digest.end(), paddedKey.begin());
+	}
+	else
+	{
+		std::copy(key, key + keySize, paddedKey.begin());
+	}
+
+	std::array<uint8_t, blockSize> innerPad;
+	std::array<uint8_t, blockSize> outerPad;
+	for (size_t i = 0; i < blockSize; ++i)
+	{
+		innerPad[i] = paddedKey[i] ^ 0x36;
+		outerPad[i] = paddedKey[i] ^ 0x5c;
+	}
+
+	Sha256 inner;
+	inner.Update(innerPad.data(), innerPad.size());
+	inner.Update(message);
+	const auto innerDigest = inner.Finalize();
+
+	Sha256 outer;
+	outer.Update(outerPad.data(), outerPad.size());
+	outer.Update(innerDigest.data(), innerDigest.size());
+	return outer.Finalize();
+}
+
+Sha256::Digest HmacSha256(const std::string& key, const std::string& message)
+{
+	return HmacSha256(reinterpret_cast<const uint8_t*>(key.data()), key.size(), message);
+}
+
+Sha256::Digest HmacSha256(const Sha256::Digest& key, const std::string& message)
+{
+	return HmacSha256(key.data(), key.size(), message);
+}
+
+std::string ToHexString(const Sha256::Digest& digest)
+{
+	std::ostringstream result;
+	for (const auto c : digest)
+	{
+		result << std::setfill('0') << std::setw(2) << std::hex << static_cast<uint16_t>(c);
+	}
+	return result.str();
+}
+
+}
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+/**
+ * SHA-256, which isn't an address algorithm but is needed to sign requests to object stores
+ */
+class Sha256
+{
+public:
+	static const size_t DIGEST_SIZE_BYTES = 32;
+	typedef std::array<uint8_t, DIGEST_SIZE_BYTES> Digest;
+
+	Sha256();
+
+	void Update(const uint8_t* data, size_t size);
+	void Update(const std::string& data);
+
+	/**
+	 * Gets the digest, the hash can't be updated after this is called
+	 */
+	Digest Finalize();
+private:
+	static const size_t BLOCK_SIZE_BYTES = 64;
+
+	void Compress(const uint8_t* block);
+
+	std::array<uint32_t, 8> _state;
+	std::array<uint8_t, BLOCK_SIZE_BYTES> _block;
+	size_t _blockSize;
+	uint64_t _totalBytes;
+};
+
+/**
+ * Keyed hash of a message, as RFC 2104
+ */
+Sha256::Digest HmacSha256(const uint8_t* key, size_t keySize, const std::string& message);
+Sha256::Digest HmacSha256(const std::string& key, const std::string& message);
+Sha256::Digest HmacSha256(const Sha256::Digest& key, const std::string& message);
+
+/**
+ * Formats a digest as lowercase hex
+ */
+std::string ToHexString(const Sha256::Digest& digest);
+
+}
+}
+}
@@ -0,0 +1,217 @@
+#include "bslib/blob/StoreBlobRepository.hpp"
+
+#include "bslib/blob/exceptions.hpp"
+#include "bslib/date_time.hpp"
+#include "bslib/sqlitepp/exceptions.hpp"
+#include "bslib/sqlitepp/sqlitepp.hpp"
+
+#include <boost/format.hpp>
+#include <sqlite3.h>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+namespace {
+enum GetBlobsMissingFromStoreColumnIndex
+{
+	GetBlobsMissingFromStore_ColumnIndex_Address = 0
+};
+
+enum GetStoreBlobsColumnIndex
+{
+	GetStoreBlobs_ColumnIndex_BlobAddress = 0
+};
+
+enum GetDamagedBlobsColumnIndex
+{
+	GetDamagedBlobs_ColumnIndex_BlobAddress = 0
+};
+
+enum GetScrubCursorColumnIndex
+{
+	GetScrubCursor_ColumnIndex_AfterAddress = 0
+};
+
+// An empty blob sorts before every address, so the first page starts from it
+const uint8_t EMPTY_ADDRESS = 0;
+
+void StepOrThrow(const sqlitepp::ScopedStatement& statement)
+{
+	const auto stepResult = sqlite3_step(statement);
+	if (stepResult != SQLITE_DONE)
+	{
+		throw ExecuteFailedException(stepResult);
+	}
+}
+
+std::vector<Address> ReadAddresses(const sqlitepp::ScopedStatement& statement, int columnIndex)
+{
+	std::vector<Address> result;
+	auto stepResult = 0;
+	while ((stepResult = sqlite3_step(statement)) == SQLITE_ROW)
+	{
+		const auto addressBytesCount = sqlite3_column_bytes(statement, columnIndex);
+		const auto addressBytes = sqlite3_column_blob(statement, columnIndex);
+		result.push_back(Address(addressBytes, addressBytesCount));
+	}
+	if (stepResult != SQLITE_DONE)
+	{
+		throw ExecuteFailedException(stepResult);
+	}
+	return result;
+}
+}
+
+StoreBlobRepository::StoreBlobRepository(const sqlitepp::ScopedSqlite3Object& connection)
+	: _db(connection)
+{
+	sqlitepp::prepare_or_throw(_db, "INSERT OR IGNORE INTO StoreBlob (StoreId, BlobAddress) VALUES (:StoreId, :BlobAddress)", _insertStoreBlobStatement);
+	sqlitepp::prepare_or_throw(_db, "DELETE FROM DamagedBlob WHERE StoreId = :StoreId AND BlobAddress = :BlobAddress", _removeDamagedBlobStatement);
+	sqlitepp::prepare_or_throw(_db, R"(
+		SELECT Address FROM Blob
+		WHERE Address > :After
+		AND NOT EXISTS (SELECT 1 FROM StoreBlob WHERE StoreId = :StoreId AND BlobAddress = Blob.Address)
+		AND NOT EXISTS (SELECT 1 FROM BlobChunk WHERE BlobAddress = Blob.Address)
+		ORDER BY Address
+		LIMIT :Limit
+	)", _getBlobsMissingFromStoreStatement);
+	sqlitepp::prepare_or_throw(_db, R"(
+		SELECT BlobAddress FROM StoreBlob
+		WHERE StoreId = :StoreId AND BlobAddress > :After
+		ORDER BY BlobAddress
+		LIMIT :Limit
+	)", _getStoreBlobsStatement);
+	sqlitepp::prepare_or_throw(_db, R"(
+		INSERT OR REPLACE INTO DamagedBlob (StoreId, BlobAddress, Damage, DetectedUtc)
+		VALUES (:StoreId, :BlobAddress, :Damage, :DetectedUtc)
+	)", _insertDamagedBlobStatement);
+	sqlitepp::prepare_or_throw(_db, "DELETE FROM StoreBlob WHERE StoreId = :StoreId AND BlobAddress = :BlobAddress", _removeStoreBlobStatement);
+	sqlitepp::prepare_or_throw(_db, R"(
+		SELECT BlobAddress FROM DamagedBlob
+		UNION
+		SELECT BlobAddress FROM BlobChunk WHERE ChunkAddress IN (SELECT BlobAddress FROM DamagedBlob)
+	)", _getDamagedBlobsStatement);
+	sqlitepp::prepare_or_throw(_db, "SELECT AfterAddress FROM ScrubCursor WHERE StoreId = :StoreId", _getScrubCursorStatement);
+	sqlitepp::prepare_or_throw(_db, "INSERT OR REPLACE INTO ScrubCursor (StoreId, AfterAddress) VALUES (:StoreId, :AfterAddress)", _setScrubCursorStatement);
+	sqlitepp::prepare_or_throw(_db, "DELETE FROM ScrubCursor WHERE StoreId = :StoreId", _removeScrubCursorStatement);
+	sqlitepp::prepare_or_throw(_db, "DELETE FROM StoreBlob WHERE BlobAddress NOT IN (SELECT Address FROM Blob)", _removeUnknownBlobsStatement);
+	sqlitepp::prepare_or_throw(_db, "DELETE FROM DamagedBlob WHERE BlobAddress NOT IN (SELECT Address FROM Blob)", _removeUnknownDamagedBlobsStatement);
+}
+
+void StoreBlobRepository::AddStoreBlob(const Uuid& storeId, const Address& address)
+{
+	// Both have to be kept in scope until SQLite has finished as we've opted not to make a copy
+	const auto binaryStoreId = storeId.ToArray();
+	const auto binaryAddress = address.ToBinary();
+	sqlitepp::ScopedStatementReset reset(_insertStoreBlobStatement);
+	sqlitepp::BindByParameterNameBlob(_insertStoreBlobStatement, ":StoreId", &binaryStoreId[0], binaryStoreId.size());
+	sqlitepp::BindByParameterNameBlob(_insertStoreBlobStatement, ":BlobAddress", &binaryAddress[0], binaryAddress.size());
+
+	const auto stepResult = sqlite3_step(_insertStoreBlobStatement);
+	if (stepResult != SQLITE_DONE)
+	{
+		throw AddBlobFailedException((boost::format("Failed to execute statement for insert blob %1% in store %2%. SQLite error %3%") % address.ToString() % storeId.ToString() % stepResult).str());
+	}
+
+	sqlitepp::ScopedStatementReset removeDamageReset(_removeDamagedBlobStatement);
+	sqlitepp::BindByParameterNameBlob(_removeDamagedBlobStatement, ":StoreId", &binaryStoreId[0], binaryStoreId.size());
+	sqlitepp::BindByParameterNameBlob(_removeDamagedBlobStatement, ":BlobAddress", &binaryAddress[0], binaryAddress.size());
+	StepOrThrow(_removeDamagedBlobStatement);
+}
+
+std::vector<Address> StoreBlobRepository::GetBlobsMissingFromStore(const Uuid& storeId, const boost::optional<Address>& after, unsigned limit) const
+{
+	const auto binaryAfter = after ? after->ToBinary() : std::vector<uint8_t>();
+	const auto binaryStoreId = storeId.ToArray();
+	sqlitepp::ScopedStatementReset reset(_getBlobsMissingFromStoreStatement);
+	sqlitepp::BindByParameterNameBlob(_getBlobsMissingFromStoreStatement, ":After", binaryAfter.empty() ? &EMPTY_ADDRESS : &binaryAfter[0], binaryAfter.size());
+	sqlitepp::BindByParameterNameBlob(_getBlobsMissingFromStoreStatement, ":StoreId", &binaryStoreId[0], binaryStoreId.size());
+	sqlitepp::BindByParameterNameInt64(_getBlobsMissingFromStoreStatement, ":Limit", limit);
+	return ReadAddresses(_getBlobsMissingFromStoreStatement, GetBlobsMissingFromStore_ColumnIndex_Address);
+}
+
+std::vector<Address> StoreBlobRepository::GetStoreBlobs(const Uuid& storeId, const boost::optional<Address>& after, unsigned limit) const
+{
+	const auto binaryAfter = after ? after->ToBinary() : std::vector<uint8_t>();
+	const auto binaryStoreId = storeId.ToArray();
+	sqlitepp::ScopedStatementReset reset(_getStoreBlobsStatement);
+	sqlitepp::BindByParameterNameBlob(_getStoreBlobsStatement, ":StoreId", &binaryStoreId[0], binaryStoreId.size());
+	sqlitepp::BindByParameterNameBlob(_getStoreBlobsStatement, ":After", binaryAfter.empty() ? &EMPTY_ADDRESS : &binaryAfter[0], binaryAfter.size());
+	sqlitepp::BindByParameterNameInt64(_getStoreBlobsStatement, ":Limit", limit);
+	return ReadAddresses(_getStoreBlobsStatement, GetStoreBlobs_ColumnIndex_BlobAddress);
+}
+
+void StoreBlobRepository::AddDamagedBlob(const Uuid& storeId, const Address& address, BlobDamage damage)
+{
+	const auto binaryStoreId = storeId.ToArray();
+	const auto binaryAddress = address.ToBinary();
+	sqlitepp::ScopedStatementReset reset(_insertDamagedBlobStatement);
+	sqlitepp::BindByParameterNameBlob(_insertDamagedBlobStatement, ":StoreId", &binaryStoreId[0], binaryStoreId.size());
+	sqlitepp::BindByParameterNameBlob(_insertDamagedBlobStatement, ":BlobAddress", &binaryAddress[0], binaryAddress.size());
+	sqlitepp::BindByParameterNameInt64(_insertDamagedBlobStatement, ":Damage", static_cast<int64_t>(damage));
+	sqlitepp::BindByParameterNameInt64(_insertDamagedBlobStatement, ":DetectedUtc", GetSecondsSinceEpoch(boost::posix_time::second_clock::universal_time()));
+
+	const auto stepResult = sqlite3_step(_insertDamagedBlobStatement);
+	if (stepResult != SQLITE_DONE)
+	{
+		throw AddBlobFailedException((boost::format("Failed to execute statement for insert damaged blob %1% in store %2%. SQLite error %3%") % address.ToString() % storeId.ToString() % stepResult).str());
+	}
+
+	sqlitepp::ScopedStatementReset removeReset(_removeStoreBlobStatement);
+	sqlitepp::BindByParameterNameBlob(_removeStoreBlobStatement, ":StoreId", &binaryStoreId[0], binaryStoreId.size());
+	sqlitepp::BindByParameterNameBlob(_removeStoreBlobStatement, ":BlobAddress", &binaryAddress[0], binaryAddress.size());
+	StepOrThrow(_removeStoreBlobStatement);
+}
+
+std::set<Address> StoreBlobRepository::GetDamagedBlobs() const
+{
+	sqlitepp::ScopedStatementReset reset(_getDamagedBlobsStatement);
+	const auto addresses = ReadAddresses(_getDamagedBlobsStatement, GetDamagedBlobs_ColumnIndex_BlobAddress);
+	return std::set<Address>(addresses.begin(), addresses.end());
+}
+
+boost::optional<Address> StoreBlobRepository::GetScrubCursor(const Uuid& storeId) const
+{
+	const auto binaryStoreId = storeId.ToArray();
+	sqlitepp::ScopedStatementReset reset(_getScrubCursorStatement);
+	sqlitepp::BindByParameterNameBlob(_getScrubCursorStatement, ":StoreId", &binaryStoreId[0], binaryStoreId.size());
+	const auto addresses = ReadAddresses(_getScrubCursorStatement, GetScrubCursor_ColumnIndex_AfterAddress);
+	if (addresses.empty())
+	{
+		return boost::none;
+	}
+	return addresses.front();
+}
+
+void StoreBlobRepository::SetScrubCursor(const Uuid& storeId, const boost::optional<Address>& after)
+{
+	const auto binaryStoreId = storeId.ToArray();
+	if (!after)
+	{
+		sqlitepp::ScopedStatementReset reset(_removeScrubCursorStatement);
+		sqlitepp::BindByParameterNameBlob(_removeScrubCursorStatement, ":StoreId", &binaryStoreId[0], binaryStoreId.size());
+		StepOrThrow(_removeScrubCursorStatement);
+		return;
+	}
+
+	const auto binaryAfter = after->ToBinary();
+	sqlitepp::ScopedStatementReset reset(_setScrubCursorStatement);
+	sqlitepp::BindByParameterNameBlob(_setScrubCursorStatement, ":StoreId", &binaryStoreId[0], binaryStoreId.size());
+	sqlitepp::BindByParameterNameBlob(_setScrubCursorStatement, ":AfterAddress", &binaryAfter[0], binaryAfter.size());
+	StepOrThrow(_setScrubCursorStatement);
+}
+
+void StoreBlobRepository::RemoveUnknownBlobs()
+{
+	{
+		sqlitepp::ScopedStatementReset reset(_removeUnknownBlobsStatement);
+		StepOrThrow(_removeUnknownBlobsStatement);
+	}
+	sqlitepp::ScopedStatementReset reset(_removeUnknownDamagedBlobsStatement);
+	StepOrThrow(_removeUnknownDamagedBlobsStatement);
+}
+
+}
+}
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "bslib/blob/Address.hpp"
+#include "bslib/blob/ScrubSettings.hpp"
+#include "bslib/sqlitepp/handles.hpp"
+#include "bslib/Uuid.hpp"
+
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+/**
+ * Maintains which blob stores each blob has been stored in, and the blobs that scrubbing found damaged in them
+ */
+class StoreBlobRepository
+{
+public:
+	/**
+	 * Creates a new store blob repository given an existing database connection
+	 */
+	explicit StoreBlobRepository(const sqlitepp::ScopedSqlite3Object& connection);
+
+	/**
+	 * Records that a blob is stored durably in a store, does nothing if it's already recorded. Any damage recorded for
+	 * the blob in the store is removed, as it's been stored again.
+	 * \throws AddBlobFailedException The blob couldn't be recorded
+	 */
+	void AddStoreBlob(const Uuid& storeId, const Address& address);
+
+	/**
+	 * Gets blobs that are recorded in the given store, in order of address
+	 * \param after Only blobs with a greater address are returned, for getting the next page
+	 * \param limit The maximum number of blobs to return
+	 */
+	std::vector<Address> GetStoreBlobs(const Uuid& storeId, const boost::optional<Address>& after, unsigned limit) const;
+
+	/**
+	 * Records that a blob is damaged in a store, which is then no longer recorded as stored in it so that it's copied
+	 * to the store again
+	 * \throws AddBlobFailedException The damage couldn't be recorded
+	 */
+	void AddDamagedBlob(const Uuid& storeId, const Address& address, BlobDamage damage);
+
+	/**
+	 * Gets blobs that are damaged in any store, and the blobs stored in chunks that include one
+	 */
+	std::set<Address> GetDamagedBlobs() const;
+
+	/**
+	 * Gets the address of the last blob scrubbed in the given store, or none to scrub it from the beginning
+	 */
+	boost::optional<Address> GetScrubCursor(const Uuid& storeId) const;
+
+	/**
+	 * Sets the address of the last blob scrubbed in the given store, none starts the next scrub from the beginning
+	 * \throws ExecuteFailedException The cursor couldn't be saved
+	 */
+	void SetScrubCursor(const Uuid& storeId, const boost::optional<Address>& after);
+
+	/**
+	 * Gets blobs that aren't recorded in the given store, in order of address. Blobs stored in chunks are skipped, as
+	 * only their chunks are stored.
+	 * \param after Only blobs with a greater address are returned, for getting the next page
+	 * \param limit The maximum number of blobs to return
+	 */
+	std::vector<Address> GetBlobsMissingFromStore(const Uuid& storeId, const boost::optional<Address>& after, unsigned limit) const;
+
+	/**
+	 * Removes the records and damage of blobs that are no longer known, such as after they're removed as unreferenced
+	 * \throws ExecuteFailedException The records couldn't be removed
+	 */
+	void RemoveUnknownBlobs();
+private:
+	const sqlitepp::ScopedSqlite3Object& _db;
+	sqlitepp::ScopedStatement _insertStoreBlobStatement;
+	sqlitepp::ScopedStatement _removeDamagedBlobStatement;
+	sqlitepp::ScopedStatement _getBlobsMissingFromStoreStatement;
+	sqlitepp::ScopedStatement _getStoreBlobsStatement;
+	sqlitepp::ScopedStatement _insertDamagedBlobStatement;
+	sqlitepp::ScopedStatement _removeStoreBlobStatement;
+	sqlitepp::ScopedStatement _getDamagedBlobsStatement;
+	sqlitepp::ScopedStatement _getScrubCursorStatement;
+	sqlitepp::ScopedStatement _setScrubCursorStatement;
+	sqlitepp::ScopedStatement _removeScrubCursorStatement;
+	sqlitepp::ScopedStatement _removeUnknownBlobsStatement;
+	sqlitepp::ScopedStatement _removeUnknownDamagedBlobsStatement;
+};
+
+}
+}
+}
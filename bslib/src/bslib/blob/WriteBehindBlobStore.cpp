@@ -0,0 +1,340 @@
+#include "bslib/blob/WriteBehindBlobStore.hpp"
+
+#include "bslib/blob/exceptions.hpp"
+#include "bslib/log.hpp"
+
+#include <algorithm>
+
+namespace af {
+namespace bslib {
+namespace blob {
+
+const std::string WriteBehindBlobStore::SETTINGS_KEY = "writeBehind";
+
+class WriteBehindBlobStore::Writer : public BlobWriter
+{
+public:
+	explicit Writer(WriteBehindBlobStore& store)
+		: _store(store)
+		, _inner(store._inner->CreateBlobWriter())
+	{
+	}
+
+	void Write(const uint8_t* data, size_t size) override
+	{
+		_inner->Write(data, size);
+	}
+
+	void Commit(const Address& address) override
+	{
+		_inner->Commit(address);
+
+		// Takes a sequence number that's already written, so the next flush covers it
+		std::unique_lock<std::mutex> lock(_store._mutex);
+		_store._nextSequence++;
+		_store._progressed.notify_all();
+	}
+
+private:
+	WriteBehindBlobStore& _store;
+	const std::unique_ptr<BlobWriter> _inner;
+};
+
+WriteBehindBlobStore::WriteBehindBlobStore(std::shared_ptr<BlobStore> inner, const WriteBehindBlobStoreSettings& settings)
+	: _inner(inner)
+	, _settings(settings)
+	, _pendingBytes(0)
+	, _nextSequence(1)
+	, _flushedSequence(0)
+	, _flushPending(false)
+	, _stopWriters(false)
+	, _stopFlusher(false)
+{
+	for (auto i = 0U; i < std::max(_settings.writerThreads, 1U); ++i)
+	{
+		_writers.emplace_back(&WriteBehindBlobStore::RunWriter, this);
+	}
+	_flusher = std::thread(&WriteBehindBlobStore::RunFlusher, this);
+}
+
+WriteBehindBlobStore::WriteBehindBlobStore(std::shared_ptr<BlobStore> inner, const nlohmann::json& settings)
+	: WriteBehindBlobStore(inner, ParseSettings(settings))
+{
+}
+
+WriteBehindBlobStore::~WriteBehindBlobStore()
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_stopWriters = true;
+	}
+	_queued.notify_all();
+	for (auto& writer : _writers)
+	{
+		writer.join();
+	}
+
+	// Only stopped once everything is written, so its last flush covers every blob
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_stopFlusher = true;
+	}
+	_flushRequested.notify_all();
+	_flusher.join();
+
+	auto errors = _writeErrors;
+	if (_flushError)
+	{
+		errors.emplace(_flushedSequence + 1, _flushError);
+	}
+	if (!errors.empty())
+	{
+		try
+		{
+			std::rethrow_exception(errors.begin()->second);
+		}
+		catch (const std::exception& e)
+		{
+			BSLIB_LOG_WARNING << "Blob store closed after failing to write blobs that weren't flushed: " << e.what();
+		}
+	}
+}
+
+WriteBehindBlobStoreSettings WriteBehindBlobStore::ParseSettings(const nlohmann::json& settings)
+{
+	WriteBehindBlobStoreSettings result;
+	result.writerThreads = settings.value("writerThreads", result.writerThreads);
+	result.maxInFlightBytes = settings.value("maxInFlightBytes", result.maxInFlightBytes);
+	result.flushInterval = std::chrono::milliseconds(
+		settings.value("flushIntervalMilliseconds", static_cast<int64_t>(result.flushInterval.count())));
+	return result;
+}
+
+void WriteBehindBlobStore::CreateBlob(const Address& address, const std::vector<uint8_t>& content)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (_pendingContent.find(address) != _pendingContent.end())
+	{
+		return;
+	}
+
+	// A blob larger than the budget is let through on its own, rather than waiting forever
+	_progressed.wait(lock, [&]() {
+		return _pendingBytes == 0 || _pendingBytes + content.size() <= _settings.maxInFlightBytes;
+	});
+
+	PendingBlob blob;
+	blob.sequence = _nextSequence++;
+	blob.address = address;
+	blob.content = std::make_shared<const std::vector<uint8_t>>(content);
+	_pendingContent[address] = blob.content;
+	_pendingSequences.insert(blob.sequence);
+	_pendingBytes += content.size();
+	_queue.push_back(std::move(blob));
+	_queued.notify_one();
+}
+
+std::unique_ptr<BlobWriter> WriteBehindBlobStore::CreateBlobWriter()
+{
+	return std::make_unique<Writer>(*this);
+}
+
+void WriteBehindBlobStore::CreateNamedBlob(const UTF8String& name, const boost::filesystem::path& sourcePath)
+{
+	_inner->CreateNamedBlob(name, sourcePath);
+}
+
+std::vector<uint8_t> WriteBehindBlobStore::GetBlob(const Address& address) const
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		const auto pending = _pendingContent.find(address);
+		if (pending != _pendingContent.end())
+		{
+			return *pending->second;
+		}
+	}
+
+	// Anything that's no longer pending has been written
+	return _inner->GetBlob(address);
+}
+
+BlobView WriteBehindBlobStore::GetBlobView(const Address& address) const
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		const auto pending = _pendingContent.find(address);
+		if (pending != _pendingContent.end())
+		{
+			const auto& content = pending->second;
+			return BlobView(content, content->data(), content->size());
+		}
+	}
+	return _inner->GetBlobView(address);
+}
+
+std::set<Address> WriteBehindBlobStore::FindBlobs(const std::vector<Address>& addresses) const
+{
+	// Checked before the inner store, so a blob that's written in between is found in one or the other
+	std::set<Address> result;
+	std::vector<Address> unqueuedAddresses;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		for (const auto& address : addresses)
+		{
+			if (_pendingContent.count(address) > 0)
+			{
+				result.insert(address);
+			}
+			else
+			{
+				unqueuedAddresses.push_back(address);
+			}
+		}
+	}
+
+	const auto stored = _inner->FindBlobs(unqueuedAddresses);
+	result.insert(stored.begin(), stored.end());
+	return result;
+}
+
+void WriteBehindBlobStore::Flush()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	const auto sequence = _nextSequence - 1;
+	_progressed.wait(lock, [&]() {
+		return GetWrittenSequenceNoLock() >= sequence;
+	});
+	ThrowIfFailedNoLock(sequence);
+	if (_flushedSequence >= sequence)
+	{
+		return;
+	}
+
+	// Callers that ask at the same time share a flush. A failure of an earlier flush is forgotten, as the blobs it
+	// didn't flush are flushed again
+	_flushError = nullptr;
+	_flushPending = true;
+	_flushRequested.notify_one();
+	_progressed.wait(lock, [&]() {
+		return _flushError || _flushedSequence >= sequence;
+	});
+	if (_flushedSequence < sequence)
+	{
+		const auto error = _flushError;
+		_flushError = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+nlohmann::json WriteBehindBlobStore::ConvertToJson() const
+{
+	auto result = _inner->ConvertToJson();
+	nlohmann::json settings;
+	settings["writerThreads"] = _settings.writerThreads;
+	settings["maxInFlightBytes"] = _settings.maxInFlightBytes;
+	settings["flushIntervalMilliseconds"] = static_cast<int64_t>(_settings.flushInterval.count());
+	result[SETTINGS_KEY] = settings;
+	return result;
+}
+
+void WriteBehindBlobStore::RunWriter()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_queued.wait(lock, [&]() {
+			return _stopWriters || !_queue.empty();
+		});
+		if (_queue.empty())
+		{
+			return;
+		}
+
+		auto blob = std::move(_queue.front());
+		_queue.pop_front();
+
+		std::exception_ptr error;
+		lock.unlock();
+		try
+		{
+			_inner->CreateBlob(blob.address, *blob.content);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+		lock.lock();
+
+		if (error)
+		{
+			_writeErrors[blob.sequence] = error;
+		}
+		_pendingContent.erase(blob.address);
+		_pendingSequences.erase(blob.sequence);
+		_pendingBytes -= blob.content->size();
+		_progressed.notify_all();
+	}
+}
+
+void WriteBehindBlobStore::RunFlusher()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_flushRequested.wait_for(lock, _settings.flushInterval, [&]() {
+			return _flushPending || _stopFlusher;
+		});
+		_flushPending = false;
+
+		const auto sequence = GetWrittenSequenceNoLock();
+		if (sequence > _flushedSequence)
+		{
+			std::exception_ptr error;
+			lock.unlock();
+			try
+			{
+				_inner->Flush();
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+			lock.lock();
+
+			// A failed flush is tried again at the next interval
+			_flushError = error;
+			if (!error)
+			{
+				_flushedSequence = std::max(_flushedSequence, sequence);
+			}
+			_progressed.notify_all();
+		}
+
+		if (_stopFlusher)
+		{
+			return;
+		}
+	}
+}
+
+uint64_t WriteBehindBlobStore::GetWrittenSequenceNoLock() const
+{
+	return _pendingSequences.empty() ? _nextSequence - 1 : *_pendingSequences.begin() - 1;
+}
+
+void WriteBehindBlobStore::ThrowIfFailedNoLock(uint64_t sequence)
+{
+	const auto end = _writeErrors.upper_bound(sequence);
+	if (end == _writeErrors.begin())
+	{
+		return;
+	}
+	const auto error = _writeErrors.begin()->second;
+	_writeErrors.erase(_writeErrors.begin(), end);
+	std::rethrow_exception(error);
+}
+
+}
+}
+}
@@ -58,6 +58,15 @@ public:
 	}
 };
 
+class BlobAddressFilterSaveFailedException : public std::runtime_error
+{
+public:
+	explicit BlobAddressFilterSaveFailedException(const std::string& path)
+		: std::runtime_error("Failed to save the blob address filter to " + path)
+	{
+	}
+};
+
 }
 }
 }
\ No newline at end of file
@@ -1,55 +1,409 @@
 #include "bslib/file/FileAdder.hpp"
 
+#include "bslib/blob/AddressCalculator.hpp"
 #include "bslib/blob/BlobStore.hpp"
 #include "bslib/blob/BlobInfoRepository.hpp"
+#include "bslib/blob/BlobWriter.hpp"
+#include "bslib/blob/ContentChunker.hpp"
+#include "bslib/BoundedQueue.hpp"
 #include "bslib/file/exceptions.hpp"
 #include "bslib/file/FileEventStreamRepository.hpp"
+#include "bslib/file/FilePathIndex.hpp"
 #include "bslib/file/FilePathRepository.hpp"
 #include "bslib/file/fs/operations.hpp"
+#include "bslib/log.hpp"
 
 #include <boost/filesystem.hpp>
 
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <istream>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <thread>
 
 namespace af {
 namespace bslib {
 namespace file {
 
+namespace {
+
+// Thrown on the scanner and reader threads to unwind once the pipeline has been shut down
+struct PipelineClosed
+{
+};
+
+/**
+ * Logs what the store did between the two snapshots of its counters, if it counts anything
+ */
+void LogStoreStats(const blob::BlobStoreStats& before, const blob::BlobStoreStats& after)
+{
+	blob::BlobStoreStats run;
+	run.blobsCreated = after.blobsCreated - before.blobsCreated;
+	run.contentBytes = after.contentBytes - before.contentBytes;
+	run.storedBytes = after.storedBytes - before.storedBytes;
+	run.encodeSeconds = after.encodeSeconds - before.encodeSeconds;
+	if (run.blobsCreated == 0)
+	{
+		return;
+	}
+
+	BSLIB_LOG_INFO << "Stored " << run.blobsCreated << " blobs of " << run.contentBytes << " bytes as " << run.storedBytes
+		<< " bytes, compression ratio " << run.GetCompressionRatio() << " at " << run.GetEncodeMegabytesPerSecond() << " MB/s";
+}
+
+std::unique_ptr<FileEvent> ToPointer(const boost::optional<FileEvent>& fileEvent)
+{
+	return fileEvent ? std::unique_ptr<FileEvent>(new FileEvent(fileEvent.value())) : nullptr;
+}
+
+boost::optional<FileEvent> ToOptional(const std::unique_ptr<FileEvent>& fileEvent)
+{
+	if (!fileEvent)
+	{
+		return boost::none;
+	}
+	return *fileEvent;
+}
+
+// Paths remembered by a streaming scan before they're forgotten, as the scan otherwise remembers every path it changes
+const std::size_t MAX_STREAMING_KNOWN_PATHS = 1000000;
+
+struct SortedEntry
+{
+	fs::NativePath path;
+	fs::FileStatus status;
+
+	// Links to directories are visited but not descended into, as with a recursive directory iterator
+	bool descend;
+};
+
+/**
+ * Lists a directory, with directories given a trailing slash such that a depth first walk visiting entries in order of
+ * their full paths visits paths in the same order as the catalog sorts them. Entries are returned in reverse order, so
+ * they can be popped off the back.
+ */
+std::vector<SortedEntry> ListDirectorySorted(const fs::NativePath& directoryPath, boost::system::error_code& ec)
+{
+	std::vector<SortedEntry> entries;
+	boost::filesystem::directory_iterator itr(directoryPath.ToExtendedString(), ec);
+	if (ec)
+	{
+		return entries;
+	}
+
+	boost::system::error_code incrementEc;
+	for (; itr != boost::filesystem::directory_iterator(); itr.increment(incrementEc))
+	{
+		if (incrementEc)
+		{
+			// The entries that weren't listed have no paths to raise events for, so the failure is logged against the directory
+			BSLIB_LOG_WARNING << "Failed to list the rest of " << directoryPath.ToString() << ": " << incrementEc.message();
+			break;
+		}
+
+		fs::NativePath path(WideToUTF8String(itr->path().wstring()));
+		boost::system::error_code statusEc;
+		auto status = fs::GetFileStatus(*itr, statusEc);
+		if (statusEc)
+		{
+			status = fs::GetFileStatus(path);
+		}
+
+		if (status.IsDirectory())
+		{
+			path.EnsureTrailingSlash();
+		}
+
+		const auto descend = status.IsDirectory() && !boost::filesystem::is_symlink(itr->symlink_status(statusEc));
+		entries.push_back(SortedEntry{ path, status, descend });
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const SortedEntry& lhs, const SortedEntry& rhs) {
+		return rhs.path < lhs.path;
+	});
+	return entries;
+}
+
+}
+
+/**
+ * Outcome of reading a file, produced by a reader and consumed when the file's events are emitted
+ */
+struct FileAdder::FileReadResult
+{
+	boost::optional<fs::FileMetadata> metadata;
+
+	// metadata matches the previous event so the content wasn't read
+	bool unchanged = false;
+	bool failedToRead = false;
+
+	boost::optional<blob::Address> address;
+	uint64_t sizeBytes = 0;
+
+	// holds the whole content when not chunking, until it's known whether the blob is new
+	std::unique_ptr<blob::BlobWriter> blobWriter;
+	std::vector<blob::Address> chunkAddresses;
+
+	// raised while reading, rethrown on the calling thread
+	std::exception_ptr exception;
+};
+
+/**
+ * State shared between the stages of a pipelined add.
+ *
+ * The scanner walks the source and hands files to the readers, which read and hash their content. Everything
+ * that touches the database happens on the calling thread, which owns the unit of work, in the order the scanner
+ * found the paths so the emitted events are the same as a single threaded add. New chunks are written to the blob
+ * store by the store writers.
+ */
+struct FileAdder::Pipeline
+{
+	struct Job
+	{
+		uint64_t sequence = 0;
+		fs::NativePath path;
+		fs::FileStatus status;
+		std::unique_ptr<FileEvent> previousEvent;
+	};
+
+	struct Message
+	{
+		enum class Type
+		{
+			Event,
+			File,
+			Chunk,
+			FileRead,
+			ScanComplete,
+			Call
+		};
+
+		Type type = Type::Event;
+		uint64_t sequence = 0;
+
+		// Event
+		std::unique_ptr<FileEvent> event;
+
+		// File
+		fs::NativePath path;
+		std::unique_ptr<FileEvent> previousEvent;
+
+		// Chunk
+		blob::Address chunkAddress;
+		std::vector<uint8_t> chunkContent;
+
+		// FileRead
+		std::unique_ptr<FileReadResult> result;
+
+		// ScanComplete
+		std::exception_ptr exception;
+
+		// Call
+		std::function<void()> call;
+	};
+
+	struct StoreWrite
+	{
+		blob::Address address;
+		std::vector<uint8_t> content;
+	};
+
+	/**
+	 * A path waiting for its events to be emitted
+	 */
+	struct Slot
+	{
+		std::unique_ptr<FileEvent> event;
+		fs::NativePath path;
+		std::unique_ptr<FileEvent> previousEvent;
+		std::unique_ptr<FileReadResult> result;
+	};
+
+	explicit Pipeline(size_t depth)
+		: depth(std::max<size_t>(depth, 1))
+		, inbox(this->depth)
+		, work(this->depth)
+		, writes(this->depth)
+		, closed(false)
+		, inFlight(0)
+		, nextSequence(0)
+		, callPending(false)
+		, nextToComplete(0)
+	{
+	}
+
+	~Pipeline()
+	{
+		Close();
+		for (auto& thread : threads)
+		{
+			if (thread.joinable())
+			{
+				thread.join();
+			}
+		}
+	}
+
+	/**
+	 * Waits until fewer than depth paths are in flight
+	 * \return Sequence number for the path
+	 */
+	uint64_t AcquireSlot()
+	{
+		std::unique_lock<std::mutex> lock(windowMutex);
+		windowAvailable.wait(lock, [&]() {
+			return closed || inFlight < depth;
+		});
+
+		if (closed)
+		{
+			throw PipelineClosed();
+		}
+
+		++inFlight;
+		return nextSequence++;
+	}
+
+	void ReleaseSlot()
+	{
+		std::unique_lock<std::mutex> lock(windowMutex);
+		--inFlight;
+		windowAvailable.notify_one();
+	}
+
+	void SetStoreError(std::exception_ptr exception)
+	{
+		std::unique_lock<std::mutex> lock(windowMutex);
+		if (!storeError)
+		{
+			storeError = exception;
+		}
+	}
+
+	std::exception_ptr GetStoreError()
+	{
+		std::unique_lock<std::mutex> lock(windowMutex);
+		return storeError;
+	}
+
+	/**
+	 * Runs a function on the calling thread, which owns the unit of work's connection, and waits for it to finish
+	 */
+	void CallOnCallingThread(std::function<void()> call)
+	{
+		{
+			std::unique_lock<std::mutex> lock(windowMutex);
+			callPending = true;
+			callException = nullptr;
+		}
+
+		Message message;
+		message.type = Message::Type::Call;
+		message.call = std::move(call);
+		if (!inbox.Push(std::move(message)))
+		{
+			throw PipelineClosed();
+		}
+
+		std::unique_lock<std::mutex> lock(windowMutex);
+		callCompleted.wait(lock, [&]() {
+			return closed || !callPending;
+		});
+
+		if (callPending)
+		{
+			throw PipelineClosed();
+		}
+		if (callException)
+		{
+			std::rethrow_exception(callException);
+		}
+	}
+
+	void CompleteCall(std::exception_ptr exception)
+	{
+		std::unique_lock<std::mutex> lock(windowMutex);
+		callPending = false;
+		callException = exception;
+		callCompleted.notify_all();
+	}
+
+	void Close()
+	{
+		{
+			std::unique_lock<std::mutex> lock(windowMutex);
+			closed = true;
+			windowAvailable.notify_all();
+			callCompleted.notify_all();
+		}
+		inbox.Close();
+		work.Close();
+		writes.Close();
+	}
+
+	const size_t depth;
+
+	// Everything the calling thread acts on, in the order it was produced
+	BoundedQueue<Message> inbox;
+
+	// Files waiting for a reader
+	BoundedQueue<Job> work;
+
+	// New chunks waiting to be written to the blob store
+	BoundedQueue<StoreWrite> writes;
+
+	std::vector<std::thread> threads;
+	std::thread* scanner = nullptr;
+	std::vector<std::thread*> readers;
+	std::vector<std::thread*> writers;
+
+	std::mutex windowMutex;
+	std::condition_variable windowAvailable;
+	bool closed;
+	size_t inFlight;
+	uint64_t nextSequence;
+	std::exception_ptr storeError;
+
+	// A call from the scanner waiting to be run on the calling thread
+	std::condition_variable callCompleted;
+	bool callPending;
+	std::exception_ptr callException;
+
+	// Only used on the calling thread
+	std::map<uint64_t, Slot> slots;
+	uint64_t nextToComplete;
+};
+
 FileAdder::FileAdder(
 	const Uuid& backupRunId,
 	std::shared_ptr<blob::BlobStore> blobStore,
 	blob::BlobInfoRepository& blobInfoRepository,
 	FileEventStreamRepository& fileEventStreamRepository,
-	FilePathRepository& filePathRepository)
-	: _backupRunId(backupRunId)
+	FilePathRepository& filePathRepository,
+	const std::set<blob::Address>& damagedBlobAddresses,
+	const FileAdderSettings& settings)
+	: _knownPaths(new FilePathIndex())
+	, _backupRunId(backupRunId)
 	, _blobStore(blobStore)
 	, _blobInfoRepository(blobInfoRepository)
 	, _fileEventStreamRepository(fileEventStreamRepository)
 	, _filePathRepository(filePathRepository)
+	, _previousEventBatchSize(fileEventStreamRepository.GetInsertBatchSize())
+	, _damagedBlobAddresses(damagedBlobAddresses)
+	, _settings(settings)
+	, _readBuffer(READ_BUFFER_SIZE_BYTES)
+	, _pipeline(nullptr)
 {
+	_fileEventStreamRepository.SetInsertBatchSize(_settings.eventBatchSize);
 }
 
-boost::optional<blob::Address> FileAdder::SaveFileContents(const fs::NativePath& sourcePath)
+FileAdder::~FileAdder()
 {
-	// TODO: ffs should really support files so they don't have to be read into memory. Or at least streaming...
-	auto file = OpenFileRead(sourcePath);
-
-	if (!file)
-	{
-		EmitEvent(RegularFileEvent(_backupRunId, sourcePath, boost::none, FileEventAction::FailedToRead));
-		return boost::none;
-	}
-
-	const auto content = std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
-	const auto blobAddress = blob::Address::CalculateFromContent(content);
-	const auto existingBlob = _blobInfoRepository.FindBlob(blobAddress);
-	if (!existingBlob)
-	{
-		_blobStore->CreateBlob(blobAddress, content);
-		_blobInfoRepository.AddBlob(blob::BlobInfo(blobAddress, content.size()));
-	}
-	return blobAddress;
+	_fileEventStreamRepository.SetInsertBatchSize(_previousEventBatchSize);
 }
 
 void FileAdder::Add(const UTF8String& sourcePath)
@@ -60,102 +414,544 @@ void FileAdder::Add(const UTF8String& sourcePath)
 	// Ensure forward slashes are back slashes (if applicable)
 	absolutePath.MakePreferred();
 
-	if (!fs::Exists(absolutePath))
+	const auto status = fs::GetFileStatus(absolutePath);
+	if (!status.Exists())
 	{
 		throw PathNotFoundException(absolutePath.ToString());
 	}
 
-	if (fs::IsRegularFile(absolutePath))
+	const auto storeStatsBefore = _blobStore->GetStats();
+
+	if (status.IsRegularFile())
 	{
 		const auto previousEvent = _fileEventStreamRepository.FindLastChangedEvent(absolutePath);
-		VisitPath(absolutePath, previousEvent);
+		Run([&]() {
+			VisitPath(absolutePath, status, previousEvent);
+		});
 	}
-	else if (fs::IsDirectory(absolutePath))
+	else if (status.IsDirectory())
 	{
-		ScanDirectory(absolutePath.EnsureTrailingSlashCopy());
+		const auto directoryPath = absolutePath.EnsureTrailingSlashCopy();
+		if (_settings.streamingScan)
+		{
+			const auto lastChangeEvents = _fileEventStreamRepository.OpenLastChangedEventsUnderPath(directoryPath);
+			Run([&]() {
+				ScanDirectorySorted(directoryPath, status, [&]() {
+					// The cursor reads through the unit of work's connection, so its batches are read on the calling thread
+					if (_pipeline && lastChangeEvents->NeedsFetch())
+					{
+						_pipeline->CallOnCallingThread([&]() { lastChangeEvents->Fetch(); });
+					}
+					return lastChangeEvents->Next();
+				});
+			});
+		}
+		else
+		{
+			auto lastChangeEvents = _fileEventStreamRepository.GetLastChangedEventsUnderPath(directoryPath);
+			_filePathRepository.LoadPathTree(directoryPath, *_knownPaths);
+			Run([&]() {
+				ScanDirectory(directoryPath, status, lastChangeEvents);
+			});
+		}
 	}
 	else
 	{
 		throw SourcePathNotSupportedException(absolutePath.ToString());
 	}
+
+	LogStoreStats(storeStatsBefore, _blobStore->GetStats());
 }
 
-void FileAdder::ScanDirectory(const fs::NativePath& sourcePath)
+void FileAdder::Run(const std::function<void()>& scan)
 {
-	auto lastChangeEvents = _fileEventStreamRepository.GetLastChangedEventsUnderPath(sourcePath);
+	if (_settings.readerThreads == 0)
+	{
+		scan();
+		return;
+	}
 
-	// The directory itself
-	VisitPath(sourcePath, FindPreviousEvent(lastChangeEvents, sourcePath));
+	RunPipeline(scan);
+}
 
-	// Scan for changes to files on disk
-	boost::system::error_code ec;
-	boost::filesystem::recursive_directory_iterator itr(sourcePath.ToExtendedString(), ec);
-	if (ec)
+void FileAdder::RunPipeline(const std::function<void()>& scan)
+{
+	Pipeline pipeline(_settings.pipelineDepth);
+	_pipeline = &pipeline;
+
+	try
+	{
+		pipeline.threads.reserve(1 + _settings.readerThreads + _settings.storeWriterThreads);
+
+		for (unsigned i = 0; i < _settings.storeWriterThreads; ++i)
+		{
+			pipeline.threads.emplace_back([this, &pipeline]() {
+				Pipeline::StoreWrite write;
+				while (pipeline.writes.Pop(write))
+				{
+					try
+					{
+						_blobStore->CreateBlob(write.address, write.content);
+					}
+					catch (...)
+					{
+						pipeline.SetStoreError(std::current_exception());
+						pipeline.writes.Close();
+					}
+				}
+			});
+			pipeline.writers.push_back(&pipeline.threads.back());
+		}
+
+		for (unsigned i = 0; i < _settings.readerThreads; ++i)
+		{
+			pipeline.threads.emplace_back([this, &pipeline]() {
+				std::vector<uint8_t> readBuffer(READ_BUFFER_SIZE_BYTES);
+				std::vector<uint8_t> chunkBuffer;
+				Pipeline::Job job;
+				while (pipeline.work.Pop(job))
+				{
+					const auto sequence = job.sequence;
+					const auto chunkSink = [&](const blob::Address& address, std::vector<uint8_t>& content) {
+						Pipeline::Message message;
+						message.type = Pipeline::Message::Type::Chunk;
+						message.sequence = sequence;
+						message.chunkAddress = address;
+						message.chunkContent.swap(content);
+						if (!pipeline.inbox.Push(std::move(message)))
+						{
+							throw PipelineClosed();
+						}
+					};
+
+					std::unique_ptr<FileReadResult> result(new FileReadResult());
+					try
+					{
+						*result = ReadFile(job.path, job.status, ToOptional(job.previousEvent), readBuffer, chunkBuffer, chunkSink);
+					}
+					catch (const PipelineClosed&)
+					{
+						return;
+					}
+					catch (...)
+					{
+						result->exception = std::current_exception();
+					}
+
+					Pipeline::Message message;
+					message.type = Pipeline::Message::Type::FileRead;
+					message.sequence = sequence;
+					message.result = std::move(result);
+					if (!pipeline.inbox.Push(std::move(message)))
+					{
+						return;
+					}
+				}
+			});
+			pipeline.readers.push_back(&pipeline.threads.back());
+		}
+
+		pipeline.threads.emplace_back([&scan, &pipeline]() {
+			std::exception_ptr exception;
+			try
+			{
+				scan();
+			}
+			catch (const PipelineClosed&)
+			{
+				return;
+			}
+			catch (...)
+			{
+				exception = std::current_exception();
+			}
+
+			Pipeline::Message message;
+			message.type = Pipeline::Message::Type::ScanComplete;
+			message.exception = exception;
+			{
+				std::unique_lock<std::mutex> lock(pipeline.windowMutex);
+				message.sequence = pipeline.nextSequence;
+			}
+			pipeline.inbox.Push(std::move(message));
+		});
+		pipeline.scanner = &pipeline.threads.back();
+
+		// Catalog everything on this thread, in the order it was scanned
+		bool scanComplete = false;
+		uint64_t scannedCount = 0;
+		Pipeline::Message message;
+		while (!scanComplete || pipeline.nextToComplete < scannedCount)
+		{
+			if (!pipeline.inbox.Pop(message))
+			{
+				break;
+			}
+
+			switch (message.type)
+			{
+				case Pipeline::Message::Type::Event:
+					pipeline.slots[message.sequence].event = std::move(message.event);
+					break;
+
+				case Pipeline::Message::Type::File:
+				{
+					auto& slot = pipeline.slots[message.sequence];
+					slot.path = message.path;
+					slot.previousEvent = std::move(message.previousEvent);
+					break;
+				}
+
+				case Pipeline::Message::Type::Chunk:
+					SaveChunk(message.chunkAddress, message.chunkContent);
+					break;
+
+				case Pipeline::Message::Type::FileRead:
+					pipeline.slots[message.sequence].result = std::move(message.result);
+					break;
+
+				case Pipeline::Message::Type::ScanComplete:
+					if (message.exception)
+					{
+						std::rethrow_exception(message.exception);
+					}
+					scanComplete = true;
+					scannedCount = message.sequence;
+					break;
+
+				case Pipeline::Message::Type::Call:
+					try
+					{
+						message.call();
+						pipeline.CompleteCall(nullptr);
+					}
+					catch (...)
+					{
+						pipeline.CompleteCall(std::current_exception());
+					}
+					break;
+			}
+
+			// Emit events for the paths at the head of the scan order that are ready
+			for (;;)
+			{
+				const auto it = pipeline.slots.find(pipeline.nextToComplete);
+				if (it == pipeline.slots.end())
+				{
+					break;
+				}
+
+				auto& slot = it->second;
+				if (slot.event)
+				{
+					EmitEvent(*slot.event);
+				}
+				else if (slot.result)
+				{
+					CompleteFile(slot.path, ToOptional(slot.previousEvent), *slot.result);
+				}
+				else
+				{
+					break;
+				}
+
+				pipeline.slots.erase(it);
+				++pipeline.nextToComplete;
+				pipeline.ReleaseSlot();
+			}
+		}
+
+		// Let the writers drain what's queued before checking whether any failed
+		pipeline.work.Close();
+		for (const auto reader : pipeline.readers)
+		{
+			reader->join();
+		}
+		pipeline.writes.Close();
+		for (const auto writer : pipeline.writers)
+		{
+			writer->join();
+		}
+
+		const auto storeError = pipeline.GetStoreError();
+		if (storeError)
+		{
+			std::rethrow_exception(storeError);
+		}
+	}
+	catch (...)
+	{
+		_pipeline = nullptr;
+		throw;
+	}
+
+	_pipeline = nullptr;
+}
+
+void FileAdder::QueueEvent(const FileEvent& fileEvent)
+{
+	if (!_pipeline)
 	{
-		EmitEvent(DirectoryEvent(_backupRunId, sourcePath, FileEventAction::FailedToRead));
+		EmitEvent(fileEvent);
 		return;
 	}
 
-	for (; itr != boost::filesystem::end(itr); itr.increment(ec))
+	Pipeline::Message message;
+	message.type = Pipeline::Message::Type::Event;
+	message.sequence = _pipeline->AcquireSlot();
+	message.event.reset(new FileEvent(fileEvent));
+	if (!_pipeline->inbox.Push(std::move(message)))
+	{
+		throw PipelineClosed();
+	}
+}
+
+void FileAdder::QueueFile(const fs::NativePath& sourcePath, const fs::FileStatus& status, const boost::optional<FileEvent>& previousEvent)
+{
+	if (!_pipeline)
+	{
+		auto result = ReadFile(sourcePath, status, previousEvent, _readBuffer, _chunkBuffer,
+			[this](const blob::Address& address, std::vector<uint8_t>& content) {
+				SaveChunk(address, content);
+			});
+		CompleteFile(sourcePath, previousEvent, result);
+		return;
+	}
+
+	// The calling thread has to know about the file before a reader can send it any chunks
+	Pipeline::Message message;
+	message.type = Pipeline::Message::Type::File;
+	message.sequence = _pipeline->AcquireSlot();
+	message.path = sourcePath;
+	message.previousEvent = ToPointer(previousEvent);
+
+	Pipeline::Job job;
+	job.sequence = message.sequence;
+	job.path = sourcePath;
+	job.status = status;
+	job.previousEvent = ToPointer(previousEvent);
+
+	if (!_pipeline->inbox.Push(std::move(message)) || !_pipeline->work.Push(std::move(job)))
+	{
+		throw PipelineClosed();
+	}
+}
+
+FileAdder::FileReadResult FileAdder::ReadFile(
+	const fs::NativePath& sourcePath,
+	const fs::FileStatus& status,
+	const boost::optional<FileEvent>& previousEvent,
+	std::vector<uint8_t>& readBuffer,
+	std::vector<uint8_t>& chunkBuffer,
+	const ChunkSink& chunkSink) const
+{
+	FileReadResult result;
+
+	// Read before the content so that a change made while the content is being read is picked up by the next run
+	// Only queried if the scan didn't already, as directory listings only provide the type
+	result.metadata = status.metadata;
+	if (!result.metadata)
 	{
+		boost::system::error_code ec;
+		result.metadata = fs::GetFileMetadata(sourcePath, ec);
 		if (ec)
 		{
-			// TODO: log this, we don't have a path as the increment failed so an event can't be raised
-			continue;
+			result.metadata = boost::none;
 		}
+	}
 
-		fs::NativePath path(WideToUTF8String(itr->path().wstring()));
+	const auto previousContentKnown = previousEvent &&
+		(previousEvent->action == FileEventAction::ChangedAdded || previousEvent->action == FileEventAction::ChangedModified);
+	// Damaged content is read again, so it can be stored again
+	if (!_settings.paranoid && result.metadata && previousContentKnown && previousEvent->metadata == result.metadata &&
+		!(previousEvent->contentBlobAddress && IsDamaged(*previousEvent->contentBlobAddress)))
+	{
+		result.unchanged = true;
+		return result;
+	}
 
-		// Directories should always be processed with a slash
-		if (fs::IsDirectory(path))
+	auto file = OpenFileRead(sourcePath);
+	if (!file)
+	{
+		result.failedToRead = true;
+		return result;
+	}
+
+	const auto read = _settings.contentDefinedChunking
+		? ReadChunkedContents(file, result, readBuffer, chunkBuffer, chunkSink)
+		: ReadWholeContents(file, result, readBuffer);
+	if (!read)
+	{
+		result.failedToRead = true;
+	}
+	return result;
+}
+
+bool FileAdder::ReadWholeContents(std::istream& file, FileReadResult& result, std::vector<uint8_t>& readBuffer) const
+{
+	// Stream the content into the store while hashing, the address is only known once the whole file is read
+	result.blobWriter = _blobStore->CreateBlobWriter();
+	blob::AddressCalculator addressCalculator(_settings.addressAlgorithm);
+	while (file)
+	{
+		file.read(reinterpret_cast<char*>(&readBuffer[0]), readBuffer.size());
+		const auto bytesRead = static_cast<size_t>(file.gcount());
+		if (bytesRead == 0)
 		{
-			path.EnsureTrailingSlash();
+			break;
 		}
 
-		VisitPath(path, FindPreviousEvent(lastChangeEvents, path));
-		lastChangeEvents.erase(path);
+		addressCalculator.Update(&readBuffer[0], bytesRead);
+		result.blobWriter->Write(&readBuffer[0], bytesRead);
+		result.sizeBytes += bytesRead;
 	}
 
-	// Work out what happend to paths we once knew about but haven't seen again
-	for (const auto& previousEvent : lastChangeEvents)
+	if (file.bad())
 	{
-		VisitPath(previousEvent.first, previousEvent.second);
+		result.blobWriter.reset();
+		return false;
 	}
+
+	result.address = addressCalculator.Finalize();
+	return true;
 }
 
-void FileAdder::VisitPath(const fs::NativePath& sourcePath, const boost::optional<FileEvent>& previousEvent)
+bool FileAdder::ReadChunkedContents(
+	std::istream& file,
+	FileReadResult& result,
+	std::vector<uint8_t>& readBuffer,
+	std::vector<uint8_t>& chunkBuffer,
+	const ChunkSink& chunkSink) const
 {
-	if (!fs::Exists(sourcePath))
+	blob::ContentChunker chunker(_settings.minChunkSizeBytes, _settings.averageChunkSizeBytes, _settings.maxChunkSizeBytes);
+	blob::AddressCalculator addressCalculator(_settings.addressAlgorithm);
+	chunkBuffer.clear();
+
+	const auto saveChunk = [&]() {
+		const auto chunkAddress = blob::Address::CalculateFromContent(chunkBuffer, _settings.addressAlgorithm);
+		result.chunkAddresses.push_back(chunkAddress);
+		chunkSink(chunkAddress, chunkBuffer);
+		chunkBuffer.clear();
+	};
+
+	while (file)
 	{
-		if (previousEvent && previousEvent->action != FileEventAction::ChangedRemoved)
+		file.read(reinterpret_cast<char*>(&readBuffer[0]), readBuffer.size());
+		const auto bytesRead = static_cast<size_t>(file.gcount());
+		if (bytesRead == 0)
 		{
-			EmitEvent(FileEvent(_backupRunId, sourcePath, previousEvent->type, previousEvent->contentBlobAddress, FileEventAction::ChangedRemoved));
+			break;
+		}
+
+		addressCalculator.Update(&readBuffer[0], bytesRead);
+		result.sizeBytes += bytesRead;
+
+		auto data = &readBuffer[0];
+		auto remaining = bytesRead;
+		while (remaining > 0)
+		{
+			const auto chunkBytes = chunker.Next(data, remaining);
+			chunkBuffer.insert(chunkBuffer.end(), data, data + chunkBytes);
+			data += chunkBytes;
+			remaining -= chunkBytes;
+
+			if (chunker.IsChunkComplete())
+			{
+				saveChunk();
+			}
 		}
-		return;
 	}
 
-	if (fs::IsRegularFile(sourcePath))
+	if (file.bad())
 	{
-		VisitFile(sourcePath, previousEvent);
+		return false;
 	}
-	else if (fs::IsDirectory(sourcePath))
+
+	// The tail of the file, or an empty file, is the last chunk
+	if (!chunkBuffer.empty() || result.chunkAddresses.empty())
 	{
-		VisitDirectory(sourcePath, previousEvent);
+		saveChunk();
+	}
+
+	result.address = addressCalculator.Finalize();
+	return true;
+}
+
+void FileAdder::SaveChunk(const blob::Address& address, std::vector<uint8_t>& content)
+{
+	if (_blobInfoRepository.FindBlob(address))
+	{
+		if (!IsDamaged(address))
+		{
+			return;
+		}
 	}
 	else
 	{
-		EmitEvent(FileEvent(_backupRunId, sourcePath, FileType::Unsupported, boost::none, FileEventAction::Unsupported));
+		_blobInfoRepository.AddBlob(blob::BlobInfo(address, content.size()));
+	}
+
+	if (!_pipeline || _pipeline->writers.empty())
+	{
+		_blobStore->CreateBlob(address, content);
+		return;
+	}
+
+	Pipeline::StoreWrite write;
+	write.address = address;
+	write.content.swap(content);
+	if (!_pipeline->writes.Push(std::move(write)))
+	{
+		// Only closed early when a write failed
+		std::rethrow_exception(_pipeline->GetStoreError());
 	}
 }
 
-void FileAdder::VisitFile(const fs::NativePath& sourcePath, const boost::optional<FileEvent>& previousEvent)
+bool FileAdder::IsDamaged(const blob::Address& address) const
+{
+	return _damagedBlobAddresses.find(address) != _damagedBlobAddresses.end();
+}
+
+void FileAdder::CompleteFile(const fs::NativePath& sourcePath, const boost::optional<FileEvent>& previousEvent, FileReadResult& result)
 {
-	const auto blobAddress = SaveFileContents(sourcePath);
-	if (!blobAddress)
+	if (result.exception)
 	{
+		std::rethrow_exception(result.exception);
+	}
+
+	if (result.unchanged)
+	{
+		EmitEvent(RegularFileEvent(_backupRunId, sourcePath, previousEvent->contentBlobAddress, FileEventAction::Unchanged, result.metadata));
+		return;
+	}
+
+	if (result.failedToRead)
+	{
+		EmitEvent(RegularFileEvent(_backupRunId, sourcePath, boost::none, FileEventAction::FailedToRead));
 		return;
 	}
 
+	const auto blobAddress = result.address.value();
+	if (result.blobWriter)
+	{
+		const auto known = _blobInfoRepository.FindBlob(blobAddress) != nullptr;
+		if (!known || IsDamaged(blobAddress))
+		{
+			result.blobWriter->Commit(blobAddress);
+		}
+		if (!known)
+		{
+			_blobInfoRepository.AddBlob(blob::BlobInfo(blobAddress, result.sizeBytes));
+		}
+		result.blobWriter.reset();
+	}
+	else if (result.chunkAddresses.size() > 1 && !_blobInfoRepository.FindBlob(blobAddress))
+	{
+		// Content that fits in a single chunk is stored as a normal blob, which the chunk already is
+		_blobInfoRepository.AddBlob(blob::BlobInfo(blobAddress, result.sizeBytes));
+		_blobInfoRepository.AddBlobChunks(blobAddress, result.chunkAddresses);
+	}
+
 	// Assume added
 	auto action = FileEventAction::ChangedAdded;
 	if (previousEvent)
@@ -166,7 +962,7 @@ void FileAdder::VisitFile(const fs::NativePath& sourcePath, const boost::optiona
 			case FileEventAction::ChangedModified:
 				if (previousEvent->contentBlobAddress == blobAddress)
 				{
-					EmitEvent(RegularFileEvent(_backupRunId, sourcePath, previousEvent->contentBlobAddress, FileEventAction::Unchanged));
+					EmitEvent(RegularFileEvent(_backupRunId, sourcePath, previousEvent->contentBlobAddress, FileEventAction::Unchanged, result.metadata));
 					return;
 				}
 				action = FileEventAction::ChangedModified;
@@ -177,14 +973,163 @@ void FileAdder::VisitFile(const fs::NativePath& sourcePath, const boost::optiona
 		}
 	}
 
-	EmitEvent(RegularFileEvent(_backupRunId, sourcePath, blobAddress, action));
+	EmitEvent(RegularFileEvent(_backupRunId, sourcePath, blobAddress, action, result.metadata));
+}
+
+void FileAdder::ScanDirectory(
+	const fs::NativePath& sourcePath,
+	const fs::FileStatus& status,
+	std::map<fs::NativePath, FileEvent>& lastChangeEvents)
+{
+	// The directory itself
+	VisitPath(sourcePath, status, FindPreviousEvent(lastChangeEvents, sourcePath));
+
+	// Scan for changes to files on disk
+	boost::system::error_code ec;
+	boost::filesystem::recursive_directory_iterator itr(sourcePath.ToExtendedString(), ec);
+	if (ec)
+	{
+		QueueEvent(DirectoryEvent(_backupRunId, sourcePath, FileEventAction::FailedToRead));
+		return;
+	}
+
+	for (; itr != boost::filesystem::end(itr); itr.increment(ec))
+	{
+		if (ec)
+		{
+			// TODO: log this, we don't have a path as the increment failed so an event can't be raised
+			continue;
+		}
+
+		fs::NativePath path(WideToUTF8String(itr->path().wstring()));
+		auto entryStatus = fs::GetFileStatus(*itr, ec);
+		if (ec)
+		{
+			entryStatus = fs::GetFileStatus(path);
+		}
+
+		// Directories should always be processed with a slash
+		if (entryStatus.IsDirectory())
+		{
+			path.EnsureTrailingSlash();
+		}
+
+		VisitPath(path, entryStatus, FindPreviousEvent(lastChangeEvents, path));
+		lastChangeEvents.erase(path);
+	}
+
+	// Work out what happend to paths we once knew about but haven't seen again
+	for (const auto& previousEvent : lastChangeEvents)
+	{
+		VisitPath(previousEvent.first, fs::GetFileStatus(previousEvent.first), previousEvent.second);
+	}
+}
+
+void FileAdder::ScanDirectorySorted(
+	const fs::NativePath& sourcePath,
+	const fs::FileStatus& status,
+	const std::function<std::unique_ptr<FileEvent>()>& nextLastChangeEvent)
+{
+	// The walk and the last change events are both in path order, so each path's previous event is found by advancing
+	// through the events in step with the walk. Events that are passed over are for paths the walk didn't find.
+	auto lastChangeEvent = nextLastChangeEvent();
+	const auto advance = [&]() {
+		// A path may have been stored with more than one type, the first is used as when loading them into a map
+		const auto fullPath = lastChangeEvent->fullPath;
+		do
+		{
+			lastChangeEvent = nextLastChangeEvent();
+		} while (lastChangeEvent && lastChangeEvent->fullPath == fullPath);
+	};
+	const auto visitUnseen = [&]() {
+		VisitPath(lastChangeEvent->fullPath, fs::GetFileStatus(lastChangeEvent->fullPath), ToOptional(lastChangeEvent));
+		advance();
+	};
+	const auto visit = [&](const fs::NativePath& path, const fs::FileStatus& pathStatus) {
+		while (lastChangeEvent && lastChangeEvent->fullPath < path)
+		{
+			visitUnseen();
+		}
+
+		boost::optional<FileEvent> previousEvent;
+		if (lastChangeEvent && lastChangeEvent->fullPath == path)
+		{
+			previousEvent = ToOptional(lastChangeEvent);
+			advance();
+		}
+		VisitPath(path, pathStatus, previousEvent);
+	};
+
+	// The directory itself
+	visit(sourcePath, status);
+
+	boost::system::error_code ec;
+	auto entries = ListDirectorySorted(sourcePath, ec);
+	if (ec)
+	{
+		QueueEvent(DirectoryEvent(_backupRunId, sourcePath, FileEventAction::FailedToRead));
+		return;
+	}
+
+	// Only the directories on the way to the current path are listed at once
+	std::vector<std::vector<SortedEntry>> openDirectories;
+	openDirectories.push_back(std::move(entries));
+	while (!openDirectories.empty())
+	{
+		auto& directory = openDirectories.back();
+		if (directory.empty())
+		{
+			openDirectories.pop_back();
+			continue;
+		}
+
+		const auto entry = std::move(directory.back());
+		directory.pop_back();
+		visit(entry.path, entry.status);
+		if (entry.descend)
+		{
+			// Unreadable directories are passed over, as with a recursive directory iterator
+			openDirectories.push_back(ListDirectorySorted(entry.path, ec));
+		}
+	}
+
+	// Work out what happened to paths we once knew about but haven't seen again
+	while (lastChangeEvent)
+	{
+		visitUnseen();
+	}
+}
+
+void FileAdder::VisitPath(const fs::NativePath& sourcePath, const fs::FileStatus& status, const boost::optional<FileEvent>& previousEvent)
+{
+	if (!status.Exists())
+	{
+		if (previousEvent && previousEvent->action != FileEventAction::ChangedRemoved)
+		{
+			QueueEvent(FileEvent(_backupRunId, sourcePath, previousEvent->type, previousEvent->contentBlobAddress, FileEventAction::ChangedRemoved));
+		}
+		return;
+	}
+
+	if (status.IsRegularFile())
+	{
+		QueueFile(sourcePath, status, previousEvent);
+	}
+	else if (status.IsDirectory())
+	{
+		VisitDirectory(sourcePath, previousEvent);
+	}
+	else
+	{
+		QueueEvent(FileEvent(_backupRunId, sourcePath, FileType::Unsupported, boost::none, FileEventAction::Unsupported));
+	}
 }
 
 void FileAdder::VisitDirectory(const fs::NativePath& sourcePath, const boost::optional<FileEvent>& previousEvent)
 {
 	if (!previousEvent)
 	{
-		EmitEvent(DirectoryEvent(_backupRunId, sourcePath.EnsureTrailingSlashCopy(), FileEventAction::ChangedAdded));
+		QueueEvent(DirectoryEvent(_backupRunId, sourcePath.EnsureTrailingSlashCopy(), FileEventAction::ChangedAdded));
 	}
 }
 
@@ -202,8 +1147,16 @@ boost::optional<FileEvent> FileAdder::FindPreviousEvent(
 
 void FileAdder::EmitEvent(const FileEvent& fileEvent)
 {
-	const auto pathId = _filePathRepository.AddPathTree(fileEvent.fullPath, fileEvent.type, _knownPaths);
-	_emittedEvents.push_back(fileEvent);
+	if (_settings.streamingScan && _knownPaths->GetSize() >= MAX_STREAMING_KNOWN_PATHS)
+	{
+		_knownPaths->Clear();
+	}
+
+	const auto pathId = _filePathRepository.AddPathTree(fileEvent.fullPath, fileEvent.type, *_knownPaths);
+	if (!_settings.streamingScan)
+	{
+		_emittedEvents.push_back(fileEvent);
+	}
 	_fileEventStreamRepository.AddEvent(fileEvent, pathId);
 	_eventManager.Publish(fileEvent);
 }
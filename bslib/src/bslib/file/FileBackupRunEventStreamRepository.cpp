@@ -70,7 +70,7 @@ void FileBackupRunEventStreamRepository::AddEvent(const FileBackupRunEvent& back
 	}
 }
 
-std::vector<FileBackupRunEvent> FileBackupRunEventStreamRepository::SearchByRun(const FileBackupRunSearchCriteria& criteria, unsigned skipRuns, unsigned uniqueRunLimit) const
+SearchPage<FileBackupRunEvent> FileBackupRunEventStreamRepository::SearchByRun(const FileBackupRunSearchCriteria& criteria, const PageToken& pageToken, unsigned uniqueRunLimit) const
 {
 	sqlitepp::ScopedStatement statement;
 
@@ -86,22 +86,34 @@ std::vector<FileBackupRunEvent> FileBackupRunEventStreamRepository::SearchByRun(
 	{
 		queryss << " AND BackupRunId = X'" << criteria.runId->ToDashlessString() << "' ";
 	}
+	// Runs are paged by the id of their started event
+	const auto& lastStartedId = pageToken.GetLastKey();
+	if (lastStartedId)
+	{
+		queryss << " AND Id < " << lastStartedId.value();
+	}
 	queryss << R"(
 			ORDER BY Id DESC
-			LIMIT :Skip, :PageSize
+			LIMIT :PageSize
 		)
 		ORDER BY Id DESC)";
 	const auto query = queryss.str();
 	sqlitepp::prepare_or_throw(_db, query.c_str(), statement);
-	sqlitepp::BindByParameterNameInt32(statement, ":Skip", static_cast<int32_t>(skipRuns));
 	sqlitepp::BindByParameterNameInt32(statement, ":PageSize", static_cast<int32_t>(uniqueRunLimit));
 	sqlitepp::BindByParameterNameInt32(statement, ":Action", static_cast<int32_t>(FileBackupRunEventAction::Started));
 
-	std::vector<FileBackupRunEvent> result;
+	SearchPage<FileBackupRunEvent> result;
+	result.nextPageToken = pageToken;
 	auto stepResult = 0;
 	while ((stepResult = sqlite3_step(statement)) == SQLITE_ROW)
 	{
-		result.push_back(MapRowToEvent(statement));
+		const auto runEvent = MapRowToEvent(statement);
+		if (runEvent.action == FileBackupRunEventAction::Started)
+		{
+			// Events are newest first, so the last started event is that of the oldest run on the page
+			result.nextPageToken = PageToken(sqlite3_column_int64(statement, GetFileBackupRunEvent_ColumnIndex_Id));
+		}
+		result.results.push_back(runEvent);
 	}
 
 	return result;
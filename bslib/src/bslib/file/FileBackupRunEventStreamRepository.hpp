@@ -2,6 +2,7 @@
 
 #include "bslib/file/FileBackupRunEvent.hpp"
 #include "bslib/file/FileBackupRunSearchCriteria.hpp"
+#include "bslib/file/PageToken.hpp"
 #include "bslib/sqlitepp/handles.hpp"
 
 #include <vector>
@@ -34,9 +35,10 @@ public:
 	/**
 	 * Search for a list of events. All events matching the *run* in the criteria will be returned.
 	 * \remarks "By run" ensures the results will not span runs across multiple pages, making it a PITA to work with results
-	 * Note that only *started* runs will be considered.
+	 * Note that only *started* runs will be considered, most recently started first.
+	 * \param pageToken Where to continue from, the next page token of the previous page
 	 */
-	std::vector<FileBackupRunEvent> SearchByRun(const FileBackupRunSearchCriteria& criteria, unsigned skipRuns, unsigned uniqueRunLimit) const;
+	SearchPage<FileBackupRunEvent> SearchByRun(const FileBackupRunSearchCriteria& criteria, const PageToken& pageToken, unsigned uniqueRunLimit) const;
 
 	/**
 	 * Gets file backup events by the given run id.
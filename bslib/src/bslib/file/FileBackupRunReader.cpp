@@ -27,14 +27,14 @@ FileBackupRunReader::FileBackupRunReader(
 {
 }
 
-FileBackupRunReader::ResultsPage FileBackupRunReader::Search(const FileBackupRunSearchCriteria& criteria, unsigned skip, unsigned pageSize, bool includeRunEvents) const
+FileBackupRunReader::ResultsPage FileBackupRunReader::Search(const FileBackupRunSearchCriteria& criteria, const PageToken& pageToken, unsigned pageSize, bool includeRunEvents) const
 {
 	// Maintain order of summaries based on the first-seen backup event
 	std::vector<Uuid> summaryOrder;
 	std::map<Uuid, BackupSummary> summaries;
 
-	const auto events = _backupRunEventRepository.SearchByRun(criteria, skip, pageSize);
-	for (const auto& ev : events)
+	const auto events = _backupRunEventRepository.SearchByRun(criteria, pageToken, pageSize);
+	for (const auto& ev : events.results)
 	{
 		auto it = summaries.find(ev.runId);
 		if (it == summaries.end())
@@ -82,8 +82,7 @@ FileBackupRunReader::ResultsPage FileBackupRunReader::Search(const FileBackupRun
 		}
 		page.backups.push_back(summary);
 	}
-	const unsigned summariesSize = static_cast<unsigned>(summaryOrder.size());
-	page.nextPageSkip = skip + std::min(summariesSize, pageSize);
+	page.nextPageToken = events.nextPageToken;
 	page.totalBackups = _backupRunEventRepository.GetBackupCount();
 	return page;
 }
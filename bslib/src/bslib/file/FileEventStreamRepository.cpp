@@ -11,6 +11,7 @@
 #include <boost/format.hpp>
 #include <sqlite3.h>
 
+#include <algorithm>
 #include <memory>
 #include <sstream>
 #include <utility>
@@ -29,9 +30,148 @@ enum GetObjectColumnIndex
 	GetFileEvent_ColumnIndex_Action,
 	GetFileEvent_ColumnIndex_FileType,
 	GetFileEvent_ColumnIndex_BackupRunId,
-	GetFileEvent_ColumnIndex_DateTimeUtc
+	GetFileEvent_ColumnIndex_DateTimeUtc,
+	GetFileEvent_ColumnIndex_SizeBytes,
+	GetFileEvent_ColumnIndex_ModifiedTime,
+	GetFileEvent_ColumnIndex_ChangedTime,
+	GetFileEvent_ColumnIndex_FileId
 };
 
+const std::string INSERT_EVENT_COLUMNS = "INSERT INTO FileEvent (PathId, ContentBlobAddress, Action, BackupRunId, DateTimeUtc, SizeBytes, ModifiedTime, ChangedTime, FileId) VALUES ";
+const unsigned INSERT_EVENT_COLUMN_COUNT = 9;
+
+/**
+ * Inserts the given number of events, with all parameters bound by index
+ */
+std::string BuildInsertEventsQuery(unsigned rowCount)
+{
+	std::stringstream ss;
+	ss << INSERT_EVENT_COLUMNS;
+	for (unsigned i = 0; i < rowCount; ++i)
+	{
+		ss << (i == 0 ? "" : ", ") << "(?, ?, ?, ?, ?, ?, ?, ?, ?)";
+	}
+	return ss.str();
+}
+
+/**
+ * Joins each path's last changed event from PathState, and the metadata of the latest observation of a file's content
+ * onto an added or modified event, which may come from a later unchanged event. This lets the file adder skip files
+ * whose metadata changed without their content changing.
+ */
+const std::string LAST_CHANGED_EVENT_JOIN = R"(
+		JOIN PathState ON PathState.PathId = FilePath.Id
+		JOIN FileEvent ON FileEvent.Id = PathState.LastChangedEventId
+		LEFT OUTER JOIN FileEvent AS Observed ON FileEvent.Action IN (0, 1) AND Observed.Id = PathState.LastObservedEventId)";
+
+/**
+ * Last changed event of each path in a range of full paths, ordered to match a sorted walk of the file system. Paths are
+ * scanned through their unique (FullPath, FileType) index rather than recursing through parents, and events added after
+ * :LastEventId are ignored so that a scan adding events as it reads doesn't see its own. Only the paths whose state
+ * has changed since then are looked up in their history. Read in batches, each continuing after the last path and type
+ * of the one before.
+ */
+const std::string LAST_CHANGED_EVENTS_IN_RANGE_QUERY = R"(
+		SELECT FileEvent.Id, FilePath.Id, FilePath.FullPath, FileEvent.ContentBlobAddress, FileEvent.Action, FilePath.FileType, FileEvent.BackupRunId, FileEvent.DateTimeUtc, Observed.SizeBytes, Observed.ModifiedTime, Observed.ChangedTime, Observed.FileId FROM FilePath
+		JOIN PathState ON PathState.PathId = FilePath.Id
+		JOIN FileEvent ON FileEvent.Id = CASE WHEN PathState.LastChangedEventId <= :LastEventId THEN PathState.LastChangedEventId ELSE (
+			SELECT MAX(Last.Id) FROM FileEvent AS Last WHERE Last.PathId = FilePath.Id AND Last.Action IN (0, 1, 2) AND Last.Id <= :LastEventId
+		) END
+		LEFT OUTER JOIN FileEvent AS Observed ON FileEvent.Action IN (0, 1) AND Observed.Id = CASE WHEN PathState.LastObservedEventId <= :LastEventId THEN PathState.LastObservedEventId ELSE (
+			SELECT MAX(Later.Id) FROM FileEvent AS Later WHERE Later.PathId = FileEvent.PathId AND Later.Action IN (0, 1, 5) AND Later.Id <= :LastEventId
+		) END
+		WHERE FilePath.FullPath >= :LowerBound AND FilePath.FullPath < :UpperBound
+			AND (FilePath.FullPath > :LowerBound OR FilePath.FileType > :LowerBoundType)
+		ORDER BY FilePath.FullPath, FilePath.FileType
+		LIMIT :Limit
+	)";
+
+const std::set<FileEventAction> CHANGED_ACTIONS {
+	FileEventAction::ChangedAdded,
+	FileEventAction::ChangedModified,
+	FileEventAction::ChangedRemoved
+};
+
+const std::set<FileEventAction> OBSERVED_ACTIONS {
+	FileEventAction::ChangedAdded,
+	FileEventAction::ChangedModified,
+	FileEventAction::Unchanged
+};
+
+const std::set<FileEventAction> SEEN_ACTIONS {
+	FileEventAction::ChangedAdded,
+	FileEventAction::ChangedModified,
+	FileEventAction::ChangedRemoved,
+	FileEventAction::Unchanged
+};
+
+/**
+ * Gets the id of each path's latest event matching the criteria from PathState, which can only be done when the
+ * criteria are about the current state of paths rather than their history
+ * \return An expression of the event id, which is 0 if the path has no matching event, or none if the criteria need
+ * the paths' history
+ */
+boost::optional<std::string> GetPathStateEventId(const FileEventSearchCriteria& criteria)
+{
+	if (criteria.runId || criteria.before)
+	{
+		return boost::none;
+	}
+	if (criteria.actions == CHANGED_ACTIONS)
+	{
+		return std::string("IFNULL(PathState.LastChangedEventId, 0)");
+	}
+	if (criteria.actions == OBSERVED_ACTIONS)
+	{
+		return std::string("IFNULL(PathState.LastObservedEventId, 0)");
+	}
+	if (criteria.actions == SEEN_ACTIONS)
+	{
+		return std::string("MAX(IFNULL(PathState.LastChangedEventId, 0), IFNULL(PathState.LastObservedEventId, 0))");
+	}
+	return boost::none;
+}
+
+/**
+ * Whether each path's latest event matching the criteria is its version at a point in time from PathVersion, which is
+ * when the criteria are for the events a backup saw the path in up to that time
+ */
+bool IsPathVersionCriteria(const FileEventSearchCriteria& criteria)
+{
+	return !criteria.runId && criteria.before && criteria.actions == SEEN_ACTIONS;
+}
+
+/**
+ * Joins the version of each path that was valid at the given time as PathVersion. That's the path's first version to
+ * end after the time if it had started by then, which is a single seek of the index however many versions it has.
+ * \param pathIdColumn Column of the path ids in the query
+ */
+std::string BuildPathVersionJoin(const std::string& pathIdColumn, const boost::posix_time::ptime& atUtc)
+{
+	const auto seconds = GetSecondsSinceEpoch(atUtc);
+	std::stringstream ss;
+	ss << R"(
+		LEFT OUTER JOIN PathVersion ON PathVersion.EventId = (
+			SELECT Version.EventId FROM PathVersion AS Version
+			WHERE Version.PathId = )" << pathIdColumn << " AND Version.ValidToUtc > " << seconds << R"(
+			ORDER BY Version.ValidToUtc, Version.ValidFromUtc LIMIT 1
+		) AND PathVersion.ValidFromUtc <= )" << seconds;
+	return ss.str();
+}
+
+/**
+ * Gets the first string after all those prefixed with the given path, which must end with a separator
+ */
+UTF8String GetPrefixUpperBound(const UTF8String& path)
+{
+	auto upperBound = path;
+	if (!upperBound.empty())
+	{
+		upperBound.back()++;
+	}
+	return upperBound;
+}
+
 std::string BuildPredicate(const FileEventSearchCriteria& criteria)
 {
 	std::stringstream ss;
@@ -80,33 +220,39 @@ std::string BuildPredicate(const FilePathSearchCriteria& criteria)
 
 FileEventStreamRepository::FileEventStreamRepository(const sqlitepp::ScopedSqlite3Object& connection)
 	: _db(connection)
+	, _insertBatchSize(1)
 {
+	sqlitepp::prepare_or_throw(_db, BuildInsertEventsQuery(1).c_str(), _insertEventStatement);
+	sqlitepp::prepare_or_throw(_db, BuildInsertEventsQuery(ROWS_PER_INSERT).c_str(), _insertEventsStatement);
 	sqlitepp::prepare_or_throw(_db, R"(
-		SELECT FileEvent.Id, FilePath.Id, FilePath.FullPath, FileEvent.ContentBlobAddress, FileEvent.Action, FilePath.FileType, FileEvent.BackupRunId, FileEvent.DateTimeUtc FROM FileEvent
+		SELECT FileEvent.Id, FilePath.Id, FilePath.FullPath, FileEvent.ContentBlobAddress, FileEvent.Action, FilePath.FileType, FileEvent.BackupRunId, FileEvent.DateTimeUtc, FileEvent.SizeBytes, FileEvent.ModifiedTime, FileEvent.ChangedTime, FileEvent.FileId FROM FileEvent
 		JOIN FilePath ON FileEvent.PathId = FilePath.Id
 		ORDER BY FileEvent.Id ASC
 	)", _getAllEventsStatement);
-	sqlitepp::prepare_or_throw(_db, R"(
+	const auto lastChangedEventsUnderPathQuery = std::string(R"(
 		WITH RECURSIVE DescendantPath(PathId) AS (
 			SELECT Id FROM FilePath WHERE FullPath = :Needle
 			UNION ALL
 			SELECT Id From FilePath, DescendantPath WHERE FilePath.ParentId = DescendantPath.PathId
 		)
-		SELECT FileEvent.Id, FilePath.Id, FilePath.FullPath, FileEvent.ContentBlobAddress, FileEvent.Action, FilePath.FileType, FileEvent.BackupRunId, FileEvent.DateTimeUtc FROM FileEvent
-		JOIN FilePath ON FileEvent.PathId = FilePath.Id
-		WHERE FilePath.Id IN DescendantPath AND FileEvent.Action IN (0, 1, 2)
-		GROUP BY FileEvent.PathId HAVING FileEvent.Id = MAX(FileEvent.Id)
-	)", _getLastChangedEventsUnderPathStatement);
-	sqlitepp::prepare_or_throw(_db, R"(
-		SELECT FileEvent.Id, FilePath.Id, FilePath.FullPath, FileEvent.ContentBlobAddress, FileEvent.Action, FilePath.FileType, FileEvent.BackupRunId, FileEvent.DateTimeUtc FROM FileEvent
-		JOIN FilePath ON FileEvent.PathId = FilePath.Id
-		WHERE FilePath.FullPath = :FullPath AND FileEvent.Action IN (0, 1, 2)
+		SELECT FileEvent.Id, FilePath.Id, FilePath.FullPath, FileEvent.ContentBlobAddress, FileEvent.Action, FilePath.FileType, FileEvent.BackupRunId, FileEvent.DateTimeUtc, Observed.SizeBytes, Observed.ModifiedTime, Observed.ChangedTime, Observed.FileId FROM DescendantPath
+		JOIN FilePath ON FilePath.Id = DescendantPath.PathId
+		)") + LAST_CHANGED_EVENT_JOIN + R"(
+	)";
+	sqlitepp::prepare_or_throw(_db, lastChangedEventsUnderPathQuery.c_str(), _getLastChangedEventsUnderPathStatement);
+	const auto lastChangedEventByPathQuery = std::string(R"(
+		SELECT FileEvent.Id, FilePath.Id, FilePath.FullPath, FileEvent.ContentBlobAddress, FileEvent.Action, FilePath.FileType, FileEvent.BackupRunId, FileEvent.DateTimeUtc, Observed.SizeBytes, Observed.ModifiedTime, Observed.ChangedTime, Observed.FileId FROM FilePath
+		)") + LAST_CHANGED_EVENT_JOIN + R"(
+		WHERE FilePath.FullPath = :FullPath
 		ORDER BY FileEvent.Id DESC LIMIT 1
-	)", _getLastChangedEventByPathStatement);
+	)";
+	sqlitepp::prepare_or_throw(_db, lastChangedEventByPathQuery.c_str(), _getLastChangedEventByPathStatement);
 }
 
 std::vector<FileEvent> FileEventStreamRepository::GetAllEvents() const
 {
+	Flush();
+
 	std::vector<FileEvent> result;
 	sqlitepp::ScopedStatementReset reset(_getAllEventsStatement);
 
@@ -121,6 +267,8 @@ std::vector<FileEvent> FileEventStreamRepository::GetAllEvents() const
 
 std::map<fs::NativePath, FileEvent> FileEventStreamRepository::GetLastChangedEventsUnderPath(const fs::NativePath& fullPath) const
 {
+	Flush();
+
 	std::map<fs::NativePath, FileEvent> result;
 	const auto needle = fullPath.ToString();
 
@@ -137,32 +285,191 @@ std::map<fs::NativePath, FileEvent> FileEventStreamRepository::GetLastChangedEve
 	return result;
 }
 
-void FileEventStreamRepository::AddEvent(const FileEvent& fileEvent, int64_t pathId)
+std::unique_ptr<FileEventStreamRepository::EventCursor> FileEventStreamRepository::OpenLastChangedEventsUnderPath(const fs::NativePath& fullPath, unsigned batchSize) const
 {
-	const auto secs = GetSecondsSinceEpoch(fileEvent.dateTimeUtc);
+	Flush();
 
-	const auto query = "INSERT INTO FileEvent (PathId, ContentBlobAddress, Action, BackupRunId, DateTimeUtc) VALUES (:PathId, :ContentBlobAddress, :Action, :BackupRunId, :DateTimeUtc)";
-	sqlitepp::ScopedStatement statement;
-	sqlitepp::prepare_or_throw(_db, query, statement);
-	sqlitepp::BindByParameterNameInt64(statement, ":PathId", pathId);
-	sqlitepp::BindByParameterNameInt64(statement, ":DateTimeUtc", secs);
+	sqlitepp::ScopedStatement lastEventIdStatement;
+	sqlitepp::prepare_or_throw(_db, "SELECT IFNULL(MAX(Id), 0) FROM FileEvent", lastEventIdStatement);
+	const auto stepResult = sqlite3_step(lastEventIdStatement);
+	if (stepResult != SQLITE_ROW)
+	{
+		throw ExecuteFailedException(stepResult);
+	}
+	const auto lastEventId = sqlite3_column_int64(lastEventIdStatement, 0);
+
+	return std::unique_ptr<EventCursor>(new EventCursor(*this, fullPath, lastEventId, std::max(batchSize, 1U)));
+}
+
+FileEventStreamRepository::EventCursor::EventCursor(const FileEventStreamRepository& repository, const fs::NativePath& fullPath, int64_t lastEventId, unsigned batchSize)
+	: _repository(repository)
+	, _lastEventId(lastEventId)
+	, _batchSize(batchSize)
+	, _lowerBound(fullPath.ToString())
+	, _upperBound(GetPrefixUpperBound(fullPath.ToString()))
+	, _done(false)
+{
+	sqlitepp::prepare_or_throw(_repository._db, LAST_CHANGED_EVENTS_IN_RANGE_QUERY.c_str(), _statement);
+}
+
+std::unique_ptr<FileEvent> FileEventStreamRepository::EventCursor::Next()
+{
+	if (NeedsFetch())
+	{
+		Fetch();
+	}
+
+	if (_batch.empty())
+	{
+		return nullptr;
+	}
+
+	std::unique_ptr<FileEvent> fileEvent(new FileEvent(std::move(_batch.front())));
+	_batch.pop_front();
+	return fileEvent;
+}
+
+bool FileEventStreamRepository::EventCursor::NeedsFetch() const
+{
+	return _batch.empty() && !_done;
+}
+
+void FileEventStreamRepository::EventCursor::Fetch()
+{
+	// Reset once the batch is read, so the statement isn't open while the connection adds events
+	sqlitepp::ScopedStatementReset reset(_statement);
+	sqlitepp::BindByParameterNameText(_statement, ":LowerBound", _lowerBound);
+	sqlitepp::BindByParameterNameText(_statement, ":UpperBound", _upperBound);
+	sqlitepp::BindByParameterNameInt64(_statement, ":LastEventId", _lastEventId);
+	sqlitepp::BindByParameterNameInt64(_statement, ":Limit", _batchSize);
+
+	// Until a path has been read, the lower bound itself is included whatever its type
+	sqlitepp::BindByParameterNameInt32(_statement, ":LowerBoundType", _lowerBoundType ? static_cast<int32_t>(_lowerBoundType.value()) : -1);
 
-	// TODO: This has to stay in scope for the duration of the statement, find a better way to do this without copying
-	blob::binary_address binaryContentAddress;
+	unsigned rowCount = 0;
+	auto stepResult = 0;
+	while ((stepResult = sqlite3_step(_statement)) == SQLITE_ROW)
+	{
+		++rowCount;
+		_batch.push_back(_repository.MapRowToEvent(_statement));
+	}
+
+	if (stepResult != SQLITE_DONE)
+	{
+		_done = true;
+		throw ExecuteFailedException(stepResult);
+	}
+	_done = rowCount < _batchSize;
+	if (!_batch.empty())
+	{
+		_lowerBound = _batch.back().fullPath.ToString();
+		_lowerBoundType = _batch.back().type;
+	}
+}
 
+void FileEventStreamRepository::AddEvent(const FileEvent& fileEvent, int64_t pathId)
+{
+	PendingEvent pendingEvent;
+	pendingEvent.pathId = pathId;
 	if (fileEvent.contentBlobAddress)
 	{
-		binaryContentAddress = fileEvent.contentBlobAddress.value().ToBinary();
-		sqlitepp::BindByParameterNameBlob(statement, ":ContentBlobAddress", &binaryContentAddress[0], binaryContentAddress.size());
+		pendingEvent.contentBlobAddress = fileEvent.contentBlobAddress.value().ToBinary();
 	}
-	else
+	pendingEvent.backupRunId = fileEvent.backupRunId.ToArray();
+	pendingEvent.action = static_cast<int64_t>(fileEvent.action);
+	pendingEvent.dateTimeUtc = GetSecondsSinceEpoch(fileEvent.dateTimeUtc);
+	pendingEvent.metadata = fileEvent.metadata;
+	_pendingEvents.push_back(std::move(pendingEvent));
+
+	if (_pendingEvents.size() >= _insertBatchSize)
 	{
-		sqlitepp::BindByParameterNameNull(statement, ":ContentBlobAddress");
+		Flush();
 	}
+}
 
-	auto byteUuid = fileEvent.backupRunId.ToArray();
-	sqlitepp::BindByParameterNameBlob(statement, ":BackupRunId", &byteUuid[0], byteUuid.size());
-	sqlitepp::BindByParameterNameInt64(statement, ":Action", static_cast<int64_t>(fileEvent.action));
+void FileEventStreamRepository::SetInsertBatchSize(unsigned insertBatchSize)
+{
+	_insertBatchSize = std::max(insertBatchSize, 1U);
+}
+
+void FileEventStreamRepository::Flush() const
+{
+	// Taken first so a failed batch isn't retried, its transaction can only be rolled back
+	std::vector<PendingEvent> pendingEvents;
+	pendingEvents.swap(_pendingEvents);
+
+	const auto count = static_cast<unsigned>(pendingEvents.size());
+	unsigned i = 0;
+	for (; i + ROWS_PER_INSERT <= count; i += ROWS_PER_INSERT)
+	{
+		InsertEvents(_insertEventsStatement, &pendingEvents[i], ROWS_PER_INSERT);
+	}
+	for (; i < count; ++i)
+	{
+		InsertEvents(_insertEventStatement, &pendingEvents[i], 1);
+	}
+}
+
+void FileEventStreamRepository::DiscardUnflushedEvents()
+{
+	_pendingEvents.clear();
+}
+
+uint64_t FileEventStreamRepository::RebuildPathState()
+{
+	Flush();
+
+	sqlitepp::exec_or_throw(_db, R"(
+		DELETE FROM PathVersion;
+		INSERT INTO PathVersion (EventId, PathId, ValidFromUtc, ValidToUtc)
+			SELECT FileEvent.Id, FileEvent.PathId, FileEvent.DateTimeUtc, IFNULL((
+				SELECT NextEvent.DateTimeUtc FROM FileEvent AS NextEvent
+				WHERE NextEvent.PathId = FileEvent.PathId AND NextEvent.Id > FileEvent.Id AND NextEvent.Action IN (0, 1, 2, 5)
+				ORDER BY NextEvent.Id LIMIT 1
+			), 9223372036854775807)
+			FROM FileEvent WHERE FileEvent.Action IN (0, 1, 2, 5);
+		DELETE FROM PathState;
+		INSERT INTO PathState (PathId, LastChangedEventId, LastObservedEventId)
+			SELECT PathId, MAX(CASE WHEN Action IN (0, 1, 2) THEN Id END), MAX(CASE WHEN Action IN (0, 1, 5) THEN Id END)
+			FROM FileEvent GROUP BY PathId;
+	)");
+	return static_cast<uint64_t>(sqlite3_changes(_db));
+}
+
+void FileEventStreamRepository::InsertEvents(sqlitepp::ScopedStatement& statement, const PendingEvent* events, unsigned count) const
+{
+	sqlitepp::ScopedStatementReset reset(statement);
+	for (unsigned row = 0; row < count; ++row)
+	{
+		const auto& event = events[row];
+		auto index = static_cast<int>(row * INSERT_EVENT_COLUMN_COUNT);
+		sqlitepp::BindByParameterIndexInt64(statement, ++index, event.pathId);
+		if (!event.contentBlobAddress.empty())
+		{
+			sqlitepp::BindByParameterIndexBlob(statement, ++index, &event.contentBlobAddress[0], event.contentBlobAddress.size());
+		}
+		else
+		{
+			sqlitepp::BindByParameterIndexNull(statement, ++index);
+		}
+		sqlitepp::BindByParameterIndexInt64(statement, ++index, event.action);
+		sqlitepp::BindByParameterIndexBlob(statement, ++index, &event.backupRunId[0], event.backupRunId.size());
+		sqlitepp::BindByParameterIndexInt64(statement, ++index, event.dateTimeUtc);
+		if (event.metadata)
+		{
+			sqlitepp::BindByParameterIndexInt64(statement, ++index, static_cast<int64_t>(event.metadata->sizeBytes));
+			sqlitepp::BindByParameterIndexInt64(statement, ++index, event.metadata->modifiedTime);
+			sqlitepp::BindByParameterIndexInt64(statement, ++index, event.metadata->changedTime);
+			sqlitepp::BindByParameterIndexInt64(statement, ++index, static_cast<int64_t>(event.metadata->fileId));
+		}
+		else
+		{
+			sqlitepp::BindByParameterIndexNull(statement, ++index);
+			sqlitepp::BindByParameterIndexNull(statement, ++index);
+			sqlitepp::BindByParameterIndexNull(statement, ++index);
+			sqlitepp::BindByParameterIndexNull(statement, ++index);
+		}
+	}
 
 	const auto stepResult = sqlite3_step(statement);
 	if (stepResult != SQLITE_DONE)
@@ -173,6 +480,8 @@ void FileEventStreamRepository::AddEvent(const FileEvent& fileEvent, int64_t pat
 
 boost::optional<FileEvent> FileEventStreamRepository::FindLastChangedEvent(const fs::NativePath& fullPath) const
 {
+	Flush();
+
 	sqlitepp::ScopedStatementReset reset(_getLastChangedEventByPathStatement);
 	const auto rawPath = fullPath.ToString();
 	sqlitepp::BindByParameterNameText(_getLastChangedEventByPathStatement, ":FullPath", rawPath);
@@ -190,6 +499,8 @@ std::map<Uuid, FileEventStreamRepository::RunStats> FileEventStreamRepository::G
 	const std::vector<Uuid>& runIds,
 	const std::set<FileEventAction>& actions) const
 {
+	Flush();
+
 	// Convert UUIDS to a set of hex literals, e.g. (X'000000..', X'123')
 	const auto idsSet = sqlitepp::ToSetLiteral(runIds, [](const Uuid& e) {
 		return "X'" + e.ToDashlessString() + "'";
@@ -235,40 +546,62 @@ std::map<Uuid, FileEventStreamRepository::RunStats> FileEventStreamRepository::G
 	return result;
 }
 
-std::vector<FileEventStreamRepository::PathFirstSearchMatch> FileEventStreamRepository::SearchPathFirst(
+SearchPage<FileEventStreamRepository::PathFirstSearchMatch> FileEventStreamRepository::SearchPathFirst(
 	const FilePathSearchCriteria& pathCriteria,
 	const FileEventSearchCriteria& eventCriteria,
-	unsigned skip,
+	const PageToken& pageToken,
 	unsigned limit) const
 {
+	Flush();
+
 	std::stringstream queryss;
 	queryss << R"(
-		SELECT FileEvent.Id, FilePath.Id, FilePath.FullPath, FileEvent.ContentBlobAddress, FileEvent.Action, FilePath.FileType, FileEvent.BackupRunId, FileEvent.DateTimeUtc
-		FROM FilePath
+		SELECT FileEvent.Id, FilePath.Id, FilePath.FullPath, FileEvent.ContentBlobAddress, FileEvent.Action, FilePath.FileType, FileEvent.BackupRunId, FileEvent.DateTimeUtc, FileEvent.SizeBytes, FileEvent.ModifiedTime, FileEvent.ChangedTime, FileEvent.FileId
+		FROM FilePath)";
+	const auto pathStateEventId = GetPathStateEventId(eventCriteria);
+	if (pathStateEventId)
+	{
+		queryss << R"(
+		LEFT OUTER JOIN PathState ON PathState.PathId = FilePath.Id
+		LEFT OUTER JOIN FileEvent ON FileEvent.Id = )" << pathStateEventId.value();
+	}
+	else if (IsPathVersionCriteria(eventCriteria))
+	{
+		queryss << BuildPathVersionJoin("FilePath.Id", eventCriteria.before.value()) << R"(
+		LEFT OUTER JOIN FileEvent ON FileEvent.Id = PathVersion.EventId)";
+	}
+	else
+	{
+		queryss << R"(
 		LEFT OUTER JOIN FileEvent ON FileEvent.PathId = FilePath.Id AND FileEvent.Id IN (
 			SELECT MAX(FileEvent.Id)
 			FROM FileEvent)";
-	const auto eventPredicate = BuildPredicate(eventCriteria);
-	if (!eventPredicate.empty())
-	{
-		queryss << " WHERE " << eventPredicate;
+		const auto eventPredicate = BuildPredicate(eventCriteria);
+		if (!eventPredicate.empty())
+		{
+			queryss << " WHERE " << eventPredicate;
+		}
+		queryss << " GROUP BY FileEvent.PathId)";
 	}
-	queryss << " GROUP BY FileEvent.PathId)";
 	const auto pathPredicate = BuildPredicate(pathCriteria);
+	const auto& lastPathId = pageToken.GetLastKey();
 	if (!pathPredicate.empty())
 	{
 		queryss << " WHERE " << pathPredicate;
 	}
-	queryss << " ORDER BY FilePath.Id DESC LIMIT :Skip, :Limitation";
+	if (lastPathId)
+	{
+		queryss << (pathPredicate.empty() ? " WHERE " : " AND ") << "FilePath.Id < " << lastPathId.value();
+	}
+	queryss << " ORDER BY FilePath.Id DESC LIMIT :Limitation";
 	const auto query = queryss.str();
 
 	sqlitepp::ScopedStatement statement;
 	sqlitepp::prepare_or_throw(_db, query.c_str(), statement);
 
-	// bind needle but make sure it stays in scope for the query
-	sqlitepp::BindByParameterNameInt64(statement, ":Skip", static_cast<int64_t>(skip));
 	sqlitepp::BindByParameterNameInt64(statement, ":Limitation", static_cast<int64_t>(limit));
-	std::vector<PathFirstSearchMatch> result;
+	SearchPage<PathFirstSearchMatch> result;
+	result.nextPageToken = pageToken;
 	auto stepResult = 0;
 	while ((stepResult = sqlite3_step(statement)) == SQLITE_ROW)
 	{
@@ -283,15 +616,18 @@ std::vector<FileEventStreamRepository::PathFirstSearchMatch> FileEventStreamRepo
 		match.pathType = static_cast<FileType>(sqlite3_column_int(statement, GetFileEvent_ColumnIndex_FileType));
 		match.fullPath = fs::NativePath(reinterpret_cast<const char*>(rawFullPath));
 		match.pathId = sqlite3_column_int64(statement, GetFileEvent_ColumnIndex_PathId);
-		result.push_back(match);
+		result.results.push_back(match);
+		result.nextPageToken = PageToken(match.pathId);
 	}
 	return result;
 }
 
-std::vector<FileEvent> FileEventStreamRepository::Search(const FilePathSearchCriteria& pathCriteria, const FileEventSearchCriteria& eventCriteria, unsigned skip, unsigned limit) const
+SearchPage<FileEvent> FileEventStreamRepository::Search(const FilePathSearchCriteria& pathCriteria, const FileEventSearchCriteria& eventCriteria, const PageToken& pageToken, unsigned limit) const
 {
+	Flush();
+
 	std::stringstream queryss;
-	queryss << "SELECT FileEvent.Id, FilePath.Id, FilePath.FullPath, FileEvent.ContentBlobAddress, FileEvent.Action, FilePath.FileType, FileEvent.BackupRunId, FileEvent.DateTimeUtc FROM FileEvent ";
+	queryss << "SELECT FileEvent.Id, FilePath.Id, FilePath.FullPath, FileEvent.ContentBlobAddress, FileEvent.Action, FilePath.FileType, FileEvent.BackupRunId, FileEvent.DateTimeUtc, FileEvent.SizeBytes, FileEvent.ModifiedTime, FileEvent.ChangedTime, FileEvent.FileId FROM FileEvent ";
 	queryss << "JOIN FilePath ON FileEvent.PathId = FilePath.Id";
 	const auto eventPredicate = BuildPredicate(eventCriteria);
 	if (!eventPredicate.empty())
@@ -311,27 +647,36 @@ std::vector<FileEvent> FileEventStreamRepository::Search(const FilePathSearchCri
 		}
 		queryss << pathPredicate;
 	}
+	const auto& lastEventId = pageToken.GetLastKey();
+	if (lastEventId)
+	{
+		queryss << (eventPredicate.empty() && pathPredicate.empty() ? " WHERE " : " AND ") << "FileEvent.Id > " << lastEventId.value();
+	}
 	queryss << " ORDER BY FileEvent.Id ASC";
-	queryss << " LIMIT " << skip << ", " << limit;
+	queryss << " LIMIT " << limit;
 	const auto query = queryss.str();
 	sqlitepp::ScopedStatement statement;
 	sqlitepp::prepare_or_throw(_db, query.c_str(), statement);
-	std::vector<FileEvent> result;
+	SearchPage<FileEvent> result;
+	result.nextPageToken = pageToken;
 	auto stepResult = 0;
 	while ((stepResult = sqlite3_step(statement)) == SQLITE_ROW)
 	{
-		result.push_back(MapRowToEvent(statement));
+		result.results.push_back(MapRowToEvent(statement));
+		result.nextPageToken = PageToken(sqlite3_column_int64(statement, GetFileEvent_ColumnIndex_Id));
 	}
 	return result;
 }
 
-std::vector<FileEvent> FileEventStreamRepository::Search(const FileEventSearchCriteria& eventCriteria, unsigned skip, unsigned limit) const
+SearchPage<FileEvent> FileEventStreamRepository::Search(const FileEventSearchCriteria& eventCriteria, const PageToken& pageToken, unsigned limit) const
 {
-	return Search(FilePathSearchCriteria{}, eventCriteria, skip, limit);
+	return Search(FilePathSearchCriteria{}, eventCriteria, pageToken, limit);
 }
 
 unsigned FileEventStreamRepository::CountMatching(const FilePathSearchCriteria& pathCriteria, const FileEventSearchCriteria& eventCriteria) const
 {
+	Flush();
+
 	std::stringstream queryss;
 	queryss << "SELECT COUNT(*) FROM FileEvent ";
 	queryss << "JOIN FilePath ON FileEvent.PathId = FilePath.Id";
@@ -391,6 +736,8 @@ unsigned FileEventStreamRepository::CountMatching(const FilePathSearchCriteria&
 
 std::unordered_map<int64_t, unsigned> FileEventStreamRepository::CountNestedMatches(const FileEventSearchCriteria& eventCriteria, const std::unordered_set<int64_t>& pathIds)
 {
+	Flush();
+
 	const auto idsSet = sqlitepp::ToSetLiteral(pathIds, [](const int64_t i) {
 		return std::to_string(i);
 	});
@@ -401,19 +748,37 @@ std::unordered_map<int64_t, unsigned> FileEventStreamRepository::CountNestedMatc
 		UNION ALL
 		SELECT DescendantPath.InputPathId, Id From FilePath, DescendantPath WHERE FilePath.ParentId = DescendantPath.PathId
 	))";
-	queryss << R"(
+	const auto pathStateEventId = GetPathStateEventId(eventCriteria);
+	if (pathStateEventId)
+	{
+		queryss << R"(
+		SELECT DescendantPath.InputPathId, COUNT(PathState.PathId) FROM DescendantPath
+		LEFT OUTER JOIN PathState ON DescendantPath.PathId = PathState.PathId AND )" << pathStateEventId.value() << R"( > 0
+		AND PathState.PathId NOT IN )" << idsSet << " GROUP BY DescendantPath.InputPathId";
+	}
+	else if (IsPathVersionCriteria(eventCriteria))
+	{
+		queryss << R"(
+		SELECT DescendantPath.InputPathId, COUNT(PathVersion.EventId) FROM DescendantPath)"
+			<< BuildPathVersionJoin("DescendantPath.PathId", eventCriteria.before.value()) << R"(
+		AND PathVersion.PathId NOT IN )" << idsSet << " GROUP BY DescendantPath.InputPathId";
+	}
+	else
+	{
+		queryss << R"(
 		SELECT DescendantPath.InputPathId, COUNT(MaxEvent.Id) FROM DescendantPath
 		LEFT OUTER JOIN (
 			SELECT Id, PathId FROM FileEvent)";
-	const auto eventPredicate = BuildPredicate(eventCriteria);
-	if (!eventPredicate.empty())
-	{
-		queryss << " WHERE " << eventPredicate;
-	}
-	queryss << R"(
+		const auto eventPredicate = BuildPredicate(eventCriteria);
+		if (!eventPredicate.empty())
+		{
+			queryss << " WHERE " << eventPredicate;
+		}
+		queryss << R"(
 		GROUP BY FileEvent.PathId HAVING FileEvent.Id = MAX(FileEvent.Id)
 		) AS MaxEvent ON DescendantPath.PathId = MaxEvent.PathId
 		AND MaxEvent.PathId NOT IN )" << idsSet << " GROUP BY DescendantPath.InputPathId";
+	}
 
 	const auto query = queryss.str();
 	sqlitepp::ScopedStatement statement;
@@ -452,7 +817,19 @@ FileEvent FileEventStreamRepository::MapRowToEvent(const sqlitepp::ScopedStateme
 	const FileType type = static_cast<FileType>(sqlite3_column_int(statement, GetFileEvent_ColumnIndex_FileType));
 
 	const auto unixDate = FromSecondsSinceEpoch(sqlite3_column_int(statement, GetFileEvent_ColumnIndex_DateTimeUtc));
-	return FileEvent(runId, fullPath, type, contentBlobAddress, action, unixDate);
+
+	boost::optional<fs::FileMetadata> metadata;
+	if (sqlite3_column_type(statement, GetFileEvent_ColumnIndex_SizeBytes) != SQLITE_NULL)
+	{
+		fs::FileMetadata value;
+		value.sizeBytes = static_cast<uint64_t>(sqlite3_column_int64(statement, GetFileEvent_ColumnIndex_SizeBytes));
+		value.modifiedTime = sqlite3_column_int64(statement, GetFileEvent_ColumnIndex_ModifiedTime);
+		value.changedTime = sqlite3_column_int64(statement, GetFileEvent_ColumnIndex_ChangedTime);
+		value.fileId = static_cast<uint64_t>(sqlite3_column_int64(statement, GetFileEvent_ColumnIndex_FileId));
+		metadata = value;
+	}
+
+	return FileEvent(runId, fullPath, type, contentBlobAddress, action, unixDate, metadata);
 }
 
 }
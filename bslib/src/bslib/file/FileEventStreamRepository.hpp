@@ -3,11 +3,15 @@
 #include "bslib/file/FileEvent.hpp"
 #include "bslib/file/FileEventSearchCriteria.hpp"
 #include "bslib/file/FilePathSearchCriteria.hpp"
+#include "bslib/file/PageToken.hpp"
+#include "bslib/file/fs/FileMetadata.hpp"
 #include "bslib/file/fs/path.hpp"
 #include "bslib/sqlitepp/handles.hpp"
 
 #include <cstdint>
+#include <deque>
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 #include <unordered_map>
@@ -36,6 +40,49 @@ public:
 		boost::optional<FileEvent> latestEvent;
 	};
 
+	/**
+	 * Reads the last changed events under a path one at a time, in the byte-wise order of their full paths.
+	 * Events are read from the database in batches, each a separate query continuing after the last path of the
+	 * previous one, so no statement is left open while events are added on the same connection.
+	 */
+	class EventCursor
+	{
+	public:
+		/**
+		 * \return The next event, or nullptr once all have been read
+		 * \exception ExecuteFailedException The next batch of events couldn't be read
+		 */
+		std::unique_ptr<FileEvent> Next();
+
+		/**
+		 * Whether Next will read the next batch from the database, which has to be on the thread that uses the
+		 * repository's connection
+		 */
+		bool NeedsFetch() const;
+
+		/**
+		 * Reads the next batch of events from the database
+		 * \exception ExecuteFailedException The batch couldn't be read
+		 */
+		void Fetch();
+	private:
+		friend class FileEventStreamRepository;
+		EventCursor(const FileEventStreamRepository& repository, const fs::NativePath& fullPath, int64_t lastEventId, unsigned batchSize);
+
+		const FileEventStreamRepository& _repository;
+		const int64_t _lastEventId;
+		const unsigned _batchSize;
+
+		// Bound without copying, so must outlive the statement's execution. The lower bound moves up to the last path
+		// and type read, as each batch continues after them
+		UTF8String _lowerBound;
+		boost::optional<FileType> _lowerBoundType;
+		const UTF8String _upperBound;
+		sqlitepp::ScopedStatement _statement;
+		std::deque<FileEvent> _batch;
+		bool _done;
+	};
+
 	explicit FileEventStreamRepository(const sqlitepp::ScopedSqlite3Object& connection);
 
 	/**
@@ -45,8 +92,46 @@ public:
 	std::map<fs::NativePath, FileEvent> GetLastChangedEventsUnderPath(const fs::NativePath& fullPath) const;
 	boost::optional<FileEvent> FindLastChangedEvent(const fs::NativePath& fullPath) const;
 
+	// Events read by each query of a cursor
+	static const unsigned DEFAULT_CURSOR_BATCH_SIZE = 1000;
+
+	/**
+	 * Opens a cursor over the same events as GetLastChangedEventsUnderPath, without holding more than a batch of them
+	 * in memory. The cursor only sees events added before it was opened, and must be destroyed before the repository.
+	 */
+	std::unique_ptr<EventCursor> OpenLastChangedEventsUnderPath(const fs::NativePath& fullPath, unsigned batchSize = DEFAULT_CURSOR_BATCH_SIZE) const;
+
+	/**
+	 * Adds an event, which may be buffered until the batch is full. Reads through this repository see buffered events.
+	 * \exception AddFileEventFailedException The event, or another in the batch that was written, couldn't be added
+	 */
 	void AddEvent(const FileEvent& fileEvent, int64_t pathId);
 
+	/**
+	 * Sets how many events are buffered before they're written, 1 writes each event as it's added. Events already
+	 * buffered are written with the next event added, or by Flush.
+	 */
+	void SetInsertBatchSize(unsigned insertBatchSize);
+	unsigned GetInsertBatchSize() const { return _insertBatchSize; }
+
+	/**
+	 * Writes any buffered events
+	 * \exception AddFileEventFailedException An event couldn't be added
+	 */
+	void Flush() const;
+
+	/**
+	 * Drops any buffered events without writing them, such as when their transaction is rolled back
+	 */
+	void DiscardUnflushedEvents();
+
+	/**
+	 * Rebuilds the latest events and versions of every path from their whole history. They're otherwise kept up to
+	 * date as events are added, so this is only needed if they're found to be wrong.
+	 * \return The number of paths with events
+	 */
+	uint64_t RebuildPathState();
+
 	/**
 	 * Gets statics by the given run ids with the given actions
 	 * \param a vector of run ids to return
@@ -56,20 +141,22 @@ public:
 	std::map<Uuid, RunStats> GetStatisticsByRunId(const std::vector<Uuid>& runIds, const std::set<FileEventAction>& actions) const;
 
 	/**
-	 * Searches for events matching the given event *and* path criteria
+	 * Searches for events matching the given event *and* path criteria, in the order they were recorded
+	 * \param pageToken Where to continue from, the next page token of the previous page
 	 */
-	std::vector<FileEvent> Search(const FilePathSearchCriteria& pathCriteria, const FileEventSearchCriteria& eventCriteria, unsigned skip, unsigned limit) const;
-	std::vector<FileEvent> Search(const FileEventSearchCriteria& eventCriteria, unsigned skip, unsigned limit) const;
+	SearchPage<FileEvent> Search(const FilePathSearchCriteria& pathCriteria, const FileEventSearchCriteria& eventCriteria, const PageToken& pageToken, unsigned limit) const;
+	SearchPage<FileEvent> Search(const FileEventSearchCriteria& eventCriteria, const PageToken& pageToken, unsigned limit) const;
 	unsigned CountMatching(const FilePathSearchCriteria& pathCriteria, const FileEventSearchCriteria& eventCriteria) const;
 	unsigned CountMatching(const FileEventSearchCriteria& eventCriteria) const;
 
 	/**
-	 * Searches for all matching paths and associated *latest* event
+	 * Searches for all matching paths and associated *latest* event, most recently added paths first
+	 * \param pageToken Where to continue from, the next page token of the previous page
 	 */
-	std::vector<PathFirstSearchMatch> SearchPathFirst(
+	SearchPage<PathFirstSearchMatch> SearchPathFirst(
 		const FilePathSearchCriteria& pathCriteria,
 		const FileEventSearchCriteria& eventCriteria,
-		unsigned skip,
+		const PageToken& pageToken,
 		unsigned limit) const;
 	unsigned CountMatching(const FilePathSearchCriteria& criteria) const;
 
@@ -79,9 +166,32 @@ public:
 	*/
 	std::unordered_map<int64_t, unsigned> CountNestedMatches(const FileEventSearchCriteria& eventCriteria, const std::unordered_set<int64_t>& pathIds);
 private:
+	/**
+	 * An event's column values, kept until the event is written
+	 */
+	struct PendingEvent
+	{
+		int64_t pathId;
+		std::vector<uint8_t> contentBlobAddress;
+		Uuid::BinaryType backupRunId;
+		int64_t action;
+		int64_t dateTimeUtc;
+		boost::optional<fs::FileMetadata> metadata;
+	};
+
+	/**
+	 * Rows written by each multi-row insert, kept below SQLite's default limit of 999 parameters
+	 */
+	static const unsigned ROWS_PER_INSERT = 100;
+
 	FileEvent MapRowToEvent(const sqlitepp::ScopedStatement& statement) const;
+	void InsertEvents(sqlitepp::ScopedStatement& statement, const PendingEvent* events, unsigned count) const;
 
 	const sqlitepp::ScopedSqlite3Object& _db;
+	unsigned _insertBatchSize;
+	mutable std::vector<PendingEvent> _pendingEvents;
+	mutable sqlitepp::ScopedStatement _insertEventStatement;
+	mutable sqlitepp::ScopedStatement _insertEventsStatement;
 	sqlitepp::ScopedStatement _getAllEventsStatement;
 	sqlitepp::ScopedStatement _getLastChangedEventByPathStatement;
 	sqlitepp::ScopedStatement _getLastChangedEventsUnderPathStatement;
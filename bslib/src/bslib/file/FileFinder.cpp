@@ -4,6 +4,8 @@
 #include "bslib/file/FileEventStreamRepository.hpp"
 #include "bslib/file/FilePathRepository.hpp"
 
+#include <utility>
+
 namespace af {
 namespace bslib {
 namespace file {
@@ -41,13 +43,13 @@ std::vector<FileEvent> FileFinder::GetAllEvents() const
 	return _fileEventStreamRepository.GetAllEvents();
 }
 
-FileFinder::ResultsPage FileFinder::SearchEvents(const FileEventSearchCriteria& criteria, unsigned skip, unsigned pageSize) const
+FileFinder::ResultsPage FileFinder::SearchEvents(const FileEventSearchCriteria& criteria, const PageToken& pageToken, unsigned pageSize) const
 {
+	auto page = _fileEventStreamRepository.Search(criteria, pageToken, pageSize);
 	ResultsPage results;
-	results.events = _fileEventStreamRepository.Search(criteria, skip, pageSize);
+	results.events = std::move(page.results);
+	results.nextPageToken = page.nextPageToken;
 	results.totalEvents = _fileEventStreamRepository.CountMatching(criteria);
-	const auto eventsSize = static_cast<unsigned>(results.events.size());
-	results.nextPageSkip = skip + std::min(eventsSize, pageSize);
 	return results;
 }
 
@@ -0,0 +1,88 @@
+#include "bslib/file/FilePathIndex.hpp"
+
+namespace af {
+namespace bslib {
+namespace file {
+
+namespace {
+// Row ids are allocated from 1, so 0 is free to represent "no parent"
+const int64_t ROOT_PARENT_ID = 0;
+}
+
+FilePathIndex::FilePathIndex()
+{
+}
+
+std::size_t FilePathIndex::KeyHash::operator()(const Key& key) const
+{
+	// Cheap mix of the fields, the parent id carries most of the entropy
+	auto hash = static_cast<uint64_t>(key.parentId) * 0x9E3779B97F4A7C15ULL;
+	hash ^= (static_cast<uint64_t>(key.segmentId) << 2) | static_cast<uint64_t>(key.type);
+	hash ^= hash >> 29;
+	return static_cast<std::size_t>(hash);
+}
+
+FilePathIndex::Key FilePathIndex::MakeKey(const boost::optional<int64_t>& parentId, uint32_t segmentId, FileType type)
+{
+	Key key;
+	key.parentId = parentId ? parentId.value() : ROOT_PARENT_ID;
+	key.segmentId = segmentId;
+	key.type = type;
+	return key;
+}
+
+uint32_t FilePathIndex::InternSegment(const char* start, std::size_t length)
+{
+	_lookupSegment.assign(start, length);
+	const auto it = _segmentIds.find(_lookupSegment);
+	if (it != _segmentIds.end())
+	{
+		return it->second;
+	}
+
+	const auto segmentId = static_cast<uint32_t>(_segmentIds.size());
+	_segmentIds.insert(std::make_pair(_lookupSegment, segmentId));
+	return segmentId;
+}
+
+boost::optional<int64_t> FilePathIndex::Find(const boost::optional<int64_t>& parentId, uint32_t segmentId, FileType type) const
+{
+	const auto it = _pathIds.find(MakeKey(parentId, segmentId, type));
+	if (it == _pathIds.end())
+	{
+		return boost::none;
+	}
+	return it->second;
+}
+
+void FilePathIndex::Add(const boost::optional<int64_t>& parentId, uint32_t segmentId, FileType type, int64_t pathId)
+{
+	_pathIds[MakeKey(parentId, segmentId, type)] = pathId;
+}
+
+void FilePathIndex::Clear()
+{
+	_segmentIds.clear();
+	_pathIds.clear();
+	_lastParentPath.clear();
+	_lastParentId = boost::none;
+}
+
+void FilePathIndex::SetLastParent(const UTF8String& path, std::size_t parentLength, int64_t parentId)
+{
+	_lastParentPath.assign(path, 0, parentLength);
+	_lastParentId = parentId;
+}
+
+boost::optional<int64_t> FilePathIndex::FindLastParent(const UTF8String& path, std::size_t parentLength) const
+{
+	if (!_lastParentId || _lastParentPath.length() != parentLength || path.compare(0, parentLength, _lastParentPath) != 0)
+	{
+		return boost::none;
+	}
+	return _lastParentId;
+}
+
+}
+}
+}
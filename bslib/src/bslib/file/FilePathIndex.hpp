@@ -0,0 +1,89 @@
+#pragma once
+
+#include "bslib/file/FileType.hpp"
+#include "bslib/unicode.hpp"
+
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace af {
+namespace bslib {
+namespace file {
+
+/**
+ * In-memory index of stored path ids, keyed by (parent id, segment, type) rather than the full path.
+ * Segments are interned, so a name such as "bin\" is only stored once no matter how many directories contain it.
+ * Segments include their trailing separator (if any), such that C:\foo and C:\foo\ are distinct -- as they are in the FilePath table.
+ * \remarks Not thread safe
+ */
+class FilePathIndex
+{
+public:
+	FilePathIndex();
+
+	/**
+	 * Gets the id of the given segment, interning it if it hasn't been seen before
+	 */
+	uint32_t InternSegment(const char* start, std::size_t length);
+
+	/**
+	 * Finds the path id of a segment under the given parent, parentId is boost::none for root paths
+	 * \return The path id, or boost::none if the path isn't in the index
+	 */
+	boost::optional<int64_t> Find(const boost::optional<int64_t>& parentId, uint32_t segmentId, FileType type) const;
+
+	void Add(const boost::optional<int64_t>& parentId, uint32_t segmentId, FileType type, int64_t pathId);
+
+	/**
+	 * Remembers the last parent directory that was resolved, such that consecutive paths in the same directory can skip straight to their last segment
+	 */
+	void SetLastParent(const UTF8String& path, std::size_t parentLength, int64_t parentId);
+
+	/**
+	 * Finds the parent of the given path if it's the same as the last parent set
+	 */
+	boost::optional<int64_t> FindLastParent(const UTF8String& path, std::size_t parentLength) const;
+
+	/**
+	 * Forgets all paths and segments, such that they're looked up again when next used
+	 */
+	void Clear();
+
+	std::size_t GetSize() const { return _pathIds.size(); }
+	std::size_t GetSegmentCount() const { return _segmentIds.size(); }
+
+private:
+	struct Key
+	{
+		int64_t parentId;
+		uint32_t segmentId;
+		FileType type;
+
+		bool operator==(const Key& rhs) const
+		{
+			return parentId == rhs.parentId && segmentId == rhs.segmentId && type == rhs.type;
+		}
+	};
+
+	struct KeyHash
+	{
+		std::size_t operator()(const Key& key) const;
+	};
+
+	static Key MakeKey(const boost::optional<int64_t>& parentId, uint32_t segmentId, FileType type);
+
+	std::unordered_map<UTF8String, uint32_t> _segmentIds;
+	std::unordered_map<Key, int64_t, KeyHash> _pathIds;
+
+	// Reused for segment lookups so probing doesn't allocate once it has grown to fit the longest segment
+	UTF8String _lookupSegment;
+
+	UTF8String _lastParentPath;
+	boost::optional<int64_t> _lastParentId;
+};
+
+}
+}
+}
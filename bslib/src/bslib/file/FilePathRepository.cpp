@@ -16,39 +16,26 @@ enum FilePathColumnIndex
 	FilePath_ColumnIndex_ParentId
 };
 
-boost::optional<int64_t> FindCachedPath(FilePathRepository::cache_type& cache, const fs::NativePath& path, FileType type)
-{
-	const auto it = cache.find(path);
-	if (it != cache.end())
-	{
-		const auto typeIt = it->second.find(type);
-		if (typeIt != it->second.end())
-		{
-			return typeIt->second;
-		}
-	}
-
-	return boost::none;
-}
-
-void AddCachedPath(FilePathRepository::cache_type& cache, const fs::NativePath& path, int64_t pathId, FileType type)
-{
-	const auto it = cache.find(path);
-	if (it == cache.end())
-	{
-		std::unordered_map<FileType, int64_t> m = { {type, pathId} };
-		cache.insert(std::make_pair(path, m));
-		return;
-	}
-
-	it->second.insert(std::make_pair(type, pathId));
-}
+// :FullPath is the first parameter of each query that takes it
+const int FullPath_ParameterIndex = 1;
 
 }
 
 FilePathRepository::FilePathRepository(const sqlitepp::ScopedSqlite3Object& connection)
 	: _db(connection)
 {
+	sqlitepp::prepare_or_throw(_db, "INSERT INTO FilePath (FullPath, FileType, ParentId) VALUES(:FullPath, :FileType, :ParentId)", _addPathStatement);
+	sqlitepp::prepare_or_throw(_db, "SELECT Id FROM FilePath WHERE FullPath = :FullPath AND FileType = :FileType", _findPathStatement);
+	sqlitepp::prepare_or_throw(_db, "SELECT Id, NULL, FileType, ParentId FROM FilePath WHERE FullPath = :FullPath AND FileType = :FileType", _findPathDetailsStatement);
+	sqlitepp::prepare_or_throw(_db, R"(
+		WITH RECURSIVE DescendantPath(PathId) AS (
+			SELECT Id FROM FilePath WHERE ParentId = :RootId
+			UNION ALL
+			SELECT Id From FilePath, DescendantPath WHERE FilePath.ParentId = DescendantPath.PathId
+		)
+		SELECT Id, FullPath, FileType, ParentId FROM FilePath
+		WHERE Id IN DescendantPath
+	)", _getPathTreeStatement);
 }
 
 std::vector<std::pair<int64_t, fs::NativePath>> FilePathRepository::GetAllPaths() const
@@ -71,23 +58,26 @@ std::vector<std::pair<int64_t, fs::NativePath>> FilePathRepository::GetAllPaths(
 
 int64_t FilePathRepository::AddPath(const fs::NativePath& path, FileType type, const boost::optional<int64_t>& parentId)
 {
-	const auto query = "INSERT INTO FilePath (FullPath, FileType, ParentId) VALUES(:FullPath, :FileType, :ParentId)";
-	sqlitepp::ScopedStatement statement;
-	sqlitepp::prepare_or_throw(_db, query, statement);
 	const auto& rawPath = path.ToString();
-	sqlitepp::BindByParameterNameText(statement, ":FullPath", rawPath);
-	sqlitepp::BindByParameterNameInt32(statement, ":FileType", static_cast<int>(type));
+	return InsertPath(rawPath.data(), rawPath.length(), type, parentId);
+}
+
+int64_t FilePathRepository::InsertPath(const char* path, std::size_t length, FileType type, const boost::optional<int64_t>& parentId)
+{
+	sqlitepp::ScopedStatementReset reset(_addPathStatement);
+	sqlitepp::BindByParameterIndexText(_addPathStatement, FullPath_ParameterIndex, path, length);
+	sqlitepp::BindByParameterNameInt32(_addPathStatement, ":FileType", static_cast<int>(type));
 
 	if (parentId)
 	{
-		sqlitepp::BindByParameterNameInt64(statement, ":ParentId", parentId.value());
+		sqlitepp::BindByParameterNameInt64(_addPathStatement, ":ParentId", parentId.value());
 	}
 	else
 	{
-		sqlitepp::BindByParameterNameNull(statement, ":ParentId");
+		sqlitepp::BindByParameterNameNull(_addPathStatement, ":ParentId");
 	}
 
-	const auto stepResult = sqlite3_step(statement);
+	const auto stepResult = sqlite3_step(_addPathStatement);
 	if (stepResult != SQLITE_DONE)
 	{
 		throw AddFilePathFailedException(stepResult);
@@ -96,70 +86,123 @@ int64_t FilePathRepository::AddPath(const fs::NativePath& path, FileType type, c
 	return sqlite3_last_insert_rowid(_db);
 }
 
-int64_t FilePathRepository::AddPathTree(const fs::NativePath& path, FileType type, cache_type& lookupCache)
+int64_t FilePathRepository::AddPathTree(const fs::NativePath& path, FileType type, FilePathIndex& index)
 {
-	const auto pathSegments = path.GetIntermediatePaths();
-	boost::optional<int64_t> lastSegmentId;
-	const auto size = pathSegments.size();
-	for (auto i = 0U; i < size; i++)
+	const auto& rawPath = path.ToString();
+	const auto lastSegmentOffset = path.GetLastSegmentOffset();
+	boost::optional<int64_t> parentId;
+	if (lastSegmentOffset > 0)
 	{
-		// Assume any parents are directories
-		auto segmentType = FileType::Directory;
-
-		// on the last segment, use the provided type
-		if (i == (size - 1))
+		// Paths tend to arrive a directory at a time, so usually the parent has just been resolved
+		parentId = index.FindLastParent(rawPath, lastSegmentOffset);
+		if (!parentId)
 		{
-			segmentType = type;
+			for (std::size_t offset = 0; offset < lastSegmentOffset;)
+			{
+				// Assume any parents are directories
+				const auto segmentEnd = path.GetSegmentEnd(offset);
+				parentId = AddSegment(path, offset, segmentEnd, FileType::Directory, parentId, index);
+				offset = segmentEnd;
+			}
+			index.SetLastParent(rawPath, lastSegmentOffset, parentId.value());
 		}
+	}
 
-		const auto& segment = pathSegments[i];
-		int64_t segmentId;
+	return AddSegment(path, lastSegmentOffset, rawPath.length(), type, parentId, index);
+}
 
-		// Don't bother looking it up if we already know about it
-		auto cachedPath = FindCachedPath(lookupCache, segment, segmentType);
-		if (cachedPath)
-		{
-			segmentId = cachedPath.value();
-		}
-		else
+int64_t FilePathRepository::AddPathTree(const fs::NativePath& path, FileType type)
+{
+	FilePathIndex index;
+	return AddPathTree(path, type, index);
+}
+
+int64_t FilePathRepository::AddSegment(
+	const fs::NativePath& path,
+	std::size_t segmentOffset,
+	std::size_t segmentEnd,
+	FileType type,
+	const boost::optional<int64_t>& parentId,
+	FilePathIndex& index)
+{
+	const auto& rawPath = path.ToString();
+	const auto segmentId = index.InternSegment(rawPath.data() + segmentOffset, segmentEnd - segmentOffset);
+
+	// Don't bother looking it up if we already know about it
+	const auto indexedId = index.Find(parentId, segmentId, type);
+	if (indexedId)
+	{
+		return indexedId.value();
+	}
+
+	// Find in DB or add if it doesn't exist, the path up to the end of the segment is the full path
+	auto pathId = FindPathId(rawPath.data(), segmentEnd, type);
+	if (!pathId)
+	{
+		pathId = InsertPath(rawPath.data(), segmentEnd, type, parentId);
+	}
+
+	index.Add(parentId, segmentId, type, pathId.value());
+	return pathId.value();
+}
+
+void FilePathRepository::LoadPathTree(const fs::NativePath& path, FilePathIndex& index) const
+{
+	const auto& rawPath = path.ToString();
+	boost::optional<int64_t> parentId;
+	for (std::size_t offset = 0; offset < rawPath.length();)
+	{
+		const auto segmentEnd = path.GetSegmentEnd(offset);
+		const auto segmentId = index.InternSegment(rawPath.data() + offset, segmentEnd - offset);
+		auto pathId = index.Find(parentId, segmentId, FileType::Directory);
+		if (!pathId)
 		{
-			// Find in DB or add if it doesn't exist
-			const auto existingId = FindPath(segment, segmentType);
-			if (!existingId)
-			{
-				segmentId = AddPath(segment, segmentType, lastSegmentId);
-			}
-			else
+			pathId = FindPathId(rawPath.data(), segmentEnd, FileType::Directory);
+			if (!pathId)
 			{
-				segmentId = existingId.value();
+				// Nothing can have been stored under a path that doesn't exist
+				return;
 			}
-
-			AddCachedPath(lookupCache, segment, segmentId, segmentType);
+			index.Add(parentId, segmentId, FileType::Directory, pathId.value());
 		}
-		lastSegmentId = segmentId;
+		parentId = pathId;
+		offset = segmentEnd;
 	}
 
-	return lastSegmentId.value();
-}
+	sqlitepp::ScopedStatementReset reset(_getPathTreeStatement);
+	sqlitepp::BindByParameterNameInt64(_getPathTreeStatement, ":RootId", parentId.value());
 
-int64_t FilePathRepository::AddPathTree(const fs::NativePath& path, FileType type)
-{
-	cache_type knownPaths;
-	return AddPathTree(path, type, knownPaths);
+	auto stepResult = 0;
+	while ((stepResult = sqlite3_step(_getPathTreeStatement)) == SQLITE_ROW)
+	{
+		const auto id = sqlite3_column_int64(_getPathTreeStatement, FilePath_ColumnIndex_Id);
+		const auto rawFullPath = sqlite3_column_text(_getPathTreeStatement, FilePath_ColumnIndex_FullPath);
+		const fs::NativePath fullPath(reinterpret_cast<const char*>(rawFullPath));
+		const auto type = static_cast<FileType>(sqlite3_column_int(_getPathTreeStatement, FilePath_ColumnIndex_FileType));
+		const auto storedParentId = sqlite3_column_int64(_getPathTreeStatement, FilePath_ColumnIndex_ParentId);
+
+		const auto& rawFullPathString = fullPath.ToString();
+		const auto lastSegmentOffset = fullPath.GetLastSegmentOffset();
+		const auto segmentId = index.InternSegment(rawFullPathString.data() + lastSegmentOffset, rawFullPathString.length() - lastSegmentOffset);
+		index.Add(storedParentId, segmentId, type, id);
+	}
 }
 
 boost::optional<int64_t> FilePathRepository::FindPath(const fs::NativePath& path, FileType type) const
 {
-	const auto query = "SELECT Id FROM FilePath WHERE FullPath = :FullPath AND FileType = :FileType";
-	sqlitepp::ScopedStatement statement;
-	sqlitepp::prepare_or_throw(_db, query, statement);
 	const auto& rawPath = path.ToString();
-	sqlitepp::BindByParameterNameText(statement, ":FullPath", rawPath);
-	sqlitepp::BindByParameterNameInt32(statement, ":FileType", static_cast<int>(type));
-	const auto stepResult = sqlite3_step(statement);
+	return FindPathId(rawPath.data(), rawPath.length(), type);
+}
+
+boost::optional<int64_t> FilePathRepository::FindPathId(const char* path, std::size_t length, FileType type) const
+{
+	sqlitepp::ScopedStatementReset reset(_findPathStatement);
+	sqlitepp::BindByParameterIndexText(_findPathStatement, FullPath_ParameterIndex, path, length);
+	sqlitepp::BindByParameterNameInt32(_findPathStatement, ":FileType", static_cast<int>(type));
+	const auto stepResult = sqlite3_step(_findPathStatement);
 	if(stepResult == SQLITE_ROW)
 	{
-		return sqlite3_column_int64(statement, FilePath_ColumnIndex_Id);
+		return sqlite3_column_int64(_findPathStatement, FilePath_ColumnIndex_Id);
 	}
 
 	return boost::none;
@@ -167,21 +210,19 @@ boost::optional<int64_t> FilePathRepository::FindPath(const fs::NativePath& path
 
 boost::optional<StoredPath> FilePathRepository::FindPathDetails(const fs::NativePath& path, FileType type) const
 {
-	const auto query = "SELECT Id, NULL, FileType, ParentId FROM FilePath WHERE FullPath = :FullPath AND FileType = :FileType";
-	sqlitepp::ScopedStatement statement;
-	sqlitepp::prepare_or_throw(_db, query, statement);
+	sqlitepp::ScopedStatementReset reset(_findPathDetailsStatement);
 	const auto& rawPath = path.ToString();
-	sqlitepp::BindByParameterNameText(statement, ":FullPath", rawPath);
-	sqlitepp::BindByParameterNameInt32(statement, ":FileType", static_cast<int>(type));
-	const auto stepResult = sqlite3_step(statement);
+	sqlitepp::BindByParameterNameText(_findPathDetailsStatement, ":FullPath", rawPath);
+	sqlitepp::BindByParameterNameInt32(_findPathDetailsStatement, ":FileType", static_cast<int>(type));
+	const auto stepResult = sqlite3_step(_findPathDetailsStatement);
 	if(stepResult == SQLITE_ROW)
 	{
 		boost::optional<int64_t> parentId;
-		if (sqlite3_column_type(statement, FilePath_ColumnIndex_ParentId) != SQLITE_NULL)
+		if (sqlite3_column_type(_findPathDetailsStatement, FilePath_ColumnIndex_ParentId) != SQLITE_NULL)
 		{
-			parentId = sqlite3_column_int64(statement, FilePath_ColumnIndex_ParentId);
+			parentId = sqlite3_column_int64(_findPathDetailsStatement, FilePath_ColumnIndex_ParentId);
 		}
-		return StoredPath(sqlite3_column_int64(statement, FilePath_ColumnIndex_Id), type, parentId);
+		return StoredPath(sqlite3_column_int64(_findPathDetailsStatement, FilePath_ColumnIndex_Id), type, parentId);
 	}
 
 	return boost::none;
@@ -189,4 +230,4 @@ boost::optional<StoredPath> FilePathRepository::FindPathDetails(const fs::Native
 
 }
 }
-}
\ No newline at end of file
+}
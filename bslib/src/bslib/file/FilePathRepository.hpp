@@ -1,5 +1,6 @@
 #pragma once
 
+#include "bslib/file/FilePathIndex.hpp"
 #include "bslib/file/FileType.hpp"
 #include "bslib/file/fs/path.hpp"
 #include "bslib/sqlitepp/handles.hpp"
@@ -7,7 +8,6 @@
 #include <boost/optional.hpp>
 
 #include <vector>
-#include <unordered_map>
 
 namespace af {
 namespace bslib {
@@ -29,8 +29,6 @@ struct StoredPath
 class FilePathRepository
 {
 public:
-	typedef std::unordered_map<fs::NativePath, std::unordered_map<FileType, int64_t>> cache_type;
-
 	explicit FilePathRepository(const sqlitepp::ScopedSqlite3Object& connection);
 	std::vector<std::pair<int64_t, fs::NativePath>> GetAllPaths() const;
 
@@ -38,14 +36,28 @@ public:
 
 	/**
 	 * Adds the full path tree for the given path. E.g. given C:\foo\bar, then C:\ will be added (if it doesn't exist), then C:\foo\ with a parent of C:\, etc
+	 * \remarks Paths found in the index aren't looked up again, and paths looked up or added are put in the index
 	 */
-	int64_t AddPathTree(const fs::NativePath& path, FileType type, cache_type& lookupCache);
+	int64_t AddPathTree(const fs::NativePath& path, FileType type, FilePathIndex& index);
 	int64_t AddPathTree(const fs::NativePath& path, FileType type);
 
+	/**
+	 * Loads the given path, its parents and all of its descendants into the index, such that adding paths under it doesn't need to query the database
+	 */
+	void LoadPathTree(const fs::NativePath& path, FilePathIndex& index) const;
+
 	boost::optional<int64_t> FindPath(const fs::NativePath& path, FileType type) const;
 	boost::optional<StoredPath> FindPathDetails(const fs::NativePath& path, FileType type) const;
 private:
+	int64_t AddSegment(const fs::NativePath& path, std::size_t segmentOffset, std::size_t segmentEnd, FileType type, const boost::optional<int64_t>& parentId, FilePathIndex& index);
+	boost::optional<int64_t> FindPathId(const char* path, std::size_t length, FileType type) const;
+	int64_t InsertPath(const char* path, std::size_t length, FileType type, const boost::optional<int64_t>& parentId);
+
 	const sqlitepp::ScopedSqlite3Object& _db;
+	sqlitepp::ScopedStatement _addPathStatement;
+	mutable sqlitepp::ScopedStatement _findPathStatement;
+	mutable sqlitepp::ScopedStatement _findPathDetailsStatement;
+	mutable sqlitepp::ScopedStatement _getPathTreeStatement;
 };
 
 }
@@ -105,14 +105,29 @@ void FileRestorer::RestoreFileEvent(const FileEvent& fileEvent, const fs::Native
 
 bool FileRestorer::RestoreBlobToFile(const blob::Address& blobAddress, const fs::NativePath& targetPath) const
 {
-	const auto content = _blobStore->GetBlob(blobAddress);
 	auto file = fs::OpenFileWrite(targetPath);
 	if (!file)
 	{
 		return false;
 	}
-	file.write(reinterpret_cast<const char*>(&content[0]), content.size());
-	return true;
+
+	// Content stored in chunks is reassembled one chunk at a time
+	auto chunkAddresses = _blobInfoRepository.GetBlobChunks(blobAddress);
+	if (chunkAddresses.empty())
+	{
+		chunkAddresses.push_back(blobAddress);
+	}
+
+	for (const auto& chunkAddress : chunkAddresses)
+	{
+		// Written straight from the store's view of the blob, which may be a mapping of its file
+		const auto content = _blobStore->GetBlobView(chunkAddress);
+		if (!content.IsEmpty())
+		{
+			file.write(reinterpret_cast<const char*>(content.GetData()), content.GetSizeBytes());
+		}
+	}
+	return static_cast<bool>(file);
 }
 
 void FileRestorer::EmitEvent(const FileRestoreEvent& fileRestoreEvent)
@@ -0,0 +1,43 @@
+#include "bslib/file/PageToken.hpp"
+
+#include "bslib/file/exceptions.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+namespace af {
+namespace bslib {
+namespace file {
+
+namespace {
+// Keys are written as fixed width hex, so tokens don't read as offsets that clients could do arithmetic on
+const std::string::size_type TOKEN_LENGTH = 16;
+}
+
+std::string PageToken::ToString() const
+{
+	if (!_lastKey)
+	{
+		return std::string();
+	}
+	std::stringstream ss;
+	ss << std::hex << std::setw(static_cast<int>(TOKEN_LENGTH)) << std::setfill('0') << static_cast<uint64_t>(_lastKey.value());
+	return ss.str();
+}
+
+PageToken PageToken::FromString(const std::string& token)
+{
+	if (token.empty())
+	{
+		return PageToken();
+	}
+	if (token.size() != TOKEN_LENGTH || token.find_first_not_of("0123456789abcdef") != std::string::npos)
+	{
+		throw InvalidPageTokenException(token);
+	}
+	return PageToken(static_cast<int64_t>(std::stoull(token, nullptr, 16)));
+}
+
+}
+}
+}
@@ -32,18 +32,18 @@ VirtualFileBrowser::VirtualFileBrowser(FileEventStreamRepository& fileEventStrea
 {
 }
 
-std::vector<VirtualFile> VirtualFileBrowser::ListRoots(unsigned skip, unsigned limit) const
+SearchPage<VirtualFile> VirtualFileBrowser::ListRoots(const PageToken& pageToken, unsigned limit) const
 {
 	FilePathSearchCriteria pathCriteria;
 	pathCriteria.rootPath = true;
-	return List(pathCriteria, skip, limit);
+	return List(pathCriteria, pageToken, limit);
 }
 
-std::vector<VirtualFile> VirtualFileBrowser::ListContents(int64_t pathId, unsigned skip, unsigned limit) const
+SearchPage<VirtualFile> VirtualFileBrowser::ListContents(int64_t pathId, const PageToken& pageToken, unsigned limit) const
 {
 	FilePathSearchCriteria pathCriteria;
 	pathCriteria.parentPathId = pathId;
-	return List(pathCriteria, skip, limit);
+	return List(pathCriteria, pageToken, limit);
 }
 
 std::unordered_map<int64_t, unsigned> VirtualFileBrowser::CountNestedMatches(const std::unordered_set<int64_t>& pathIds) const
@@ -54,17 +54,18 @@ std::unordered_map<int64_t, unsigned> VirtualFileBrowser::CountNestedMatches(con
 	return _fileEventStreamRepository.CountNestedMatches(eventCriteria, pathIds);
 }
 
-std::vector<VirtualFile> VirtualFileBrowser::List(const FilePathSearchCriteria& pathCriteria, unsigned skip, unsigned limit) const
+SearchPage<VirtualFile> VirtualFileBrowser::List(const FilePathSearchCriteria& pathCriteria, const PageToken& pageToken, unsigned limit) const
 {
 	FileEventSearchCriteria eventCriteria;
 	eventCriteria.actions = MATCH_EVENTS;
 	eventCriteria.before = _atUtc;
-	const auto matches = _fileEventStreamRepository.SearchPathFirst(pathCriteria, eventCriteria, skip, limit);
-	std::vector<VirtualFile> result;
-	for (const auto& match : matches)
+	const auto matches = _fileEventStreamRepository.SearchPathFirst(pathCriteria, eventCriteria, pageToken, limit);
+	SearchPage<VirtualFile> result;
+	for (const auto& match : matches.results)
 	{
-		result.push_back(ToVirtualFile(match));
+		result.results.push_back(ToVirtualFile(match));
 	}
+	result.nextPageToken = matches.nextPageToken;
 	return result;
 }
 
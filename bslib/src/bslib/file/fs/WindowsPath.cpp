@@ -156,6 +156,33 @@ std::vector<WindowsPath> WindowsPath::GetIntermediatePaths() const
 	return result;
 }
 
+std::size_t WindowsPath::GetSegmentEnd(std::size_t offset) const
+{
+	const auto length = _path.length();
+	const auto i = _path.find_first_of(SEPARATOR, std::max(offset, EXTENDED_PATH_PREFIX.length()));
+	if (i == UTF8String::npos || i == length - 1)
+	{
+		return length;
+	}
+	return i + 1;
+}
+
+std::size_t WindowsPath::GetLastSegmentOffset() const
+{
+	const auto length = _path.length();
+	if (length < 2)
+	{
+		return 0;
+	}
+	// Trailing separators belong to the last segment
+	const auto i = _path.find_last_of(SEPARATOR, length - 2);
+	if (i == UTF8String::npos || i < EXTENDED_PATH_PREFIX.length())
+	{
+		return 0;
+	}
+	return i + 1;
+}
+
 UTF8String WindowsPath::ToNormalString() const
 {
 	if (boost::starts_with(_path, EXTENDED_PATH_PREFIX))
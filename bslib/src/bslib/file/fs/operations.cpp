@@ -139,6 +139,45 @@ void RemoveAll(const NativePath& path)
 	boost::filesystem::remove_all(wideString);
 }
 
+void FlushFile(const NativePath& path, boost::system::error_code& ec) noexcept
+{
+	// Flushing through any handle with write access flushes the file, not just what was written through the handle
+	const auto wideString = UTF8ToWideString(path.ToExtendedString());
+	const auto handle = ::CreateFileW(
+		wideString.c_str(),
+		GENERIC_WRITE,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		ec = boost::system::error_code(::GetLastError(), boost::system::system_category());
+		return;
+	}
+
+	if (::FlushFileBuffers(handle) == FALSE)
+	{
+		ec = boost::system::error_code(::GetLastError(), boost::system::system_category());
+	}
+	else
+	{
+		ec.clear();
+	}
+	::CloseHandle(handle);
+}
+
+void FlushFile(const NativePath& path)
+{
+	boost::system::error_code ec;
+	FlushFile(path, ec);
+	if (ec)
+	{
+		throw boost::system::system_error(ec, "Failed to flush file");
+	}
+}
+
 NativePath GetAbsolutePath(const UTF8String& path, boost::system::error_code& ec) noexcept
 {
 	// Find out how big the buffer needs to be
@@ -175,6 +214,141 @@ NativePath GetAbsolutePath(const UTF8String& path)
 	return result;
 }
 
+namespace {
+bool IsNotFoundError(DWORD error)
+{
+	return error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND || error == ERROR_INVALID_NAME || error == ERROR_BAD_NETPATH;
+}
+
+/**
+ * Queries the type and metadata of the given path through a handle opened without access to its content
+ */
+FileStatus QueryFileStatus(const NativePath& path, DWORD& error) noexcept
+{
+	// Only attributes are requested, so this works even when another process has the file open exclusively
+	const auto wideString = UTF8ToWideString(path.ToExtendedString());
+	const auto handle = ::CreateFileW(
+		wideString.c_str(),
+		FILE_READ_ATTRIBUTES,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS,
+		nullptr);
+	FileStatus result;
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		error = ::GetLastError();
+		return result;
+	}
+
+	BY_HANDLE_FILE_INFORMATION fileInformation;
+	FILE_BASIC_INFO basicInformation;
+	if (::GetFileInformationByHandle(handle, &fileInformation) != FALSE &&
+		::GetFileInformationByHandleEx(handle, FileBasicInfo, &basicInformation, sizeof(basicInformation)) != FALSE)
+	{
+		result.type = (fileInformation.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 ? PathType::Directory : PathType::RegularFile;
+		FileMetadata metadata;
+		metadata.sizeBytes = (static_cast<uint64_t>(fileInformation.nFileSizeHigh) << 32) | fileInformation.nFileSizeLow;
+		metadata.modifiedTime = basicInformation.LastWriteTime.QuadPart;
+		metadata.changedTime = basicInformation.ChangeTime.QuadPart;
+		metadata.fileId = (static_cast<uint64_t>(fileInformation.nFileIndexHigh) << 32) | fileInformation.nFileIndexLow;
+		result.metadata = metadata;
+		error = ERROR_SUCCESS;
+	}
+	else
+	{
+		error = ::GetLastError();
+	}
+
+	::CloseHandle(handle);
+	return result;
+}
+}
+
+FileMetadata GetFileMetadata(const NativePath& path, boost::system::error_code& ec) noexcept
+{
+	DWORD error;
+	const auto status = QueryFileStatus(path, error);
+	if (error != ERROR_SUCCESS)
+	{
+		ec = boost::system::error_code(error, boost::system::system_category());
+		return FileMetadata();
+	}
+
+	ec.clear();
+	return status.metadata.value();
+}
+
+FileMetadata GetFileMetadata(const NativePath& path)
+{
+	boost::system::error_code ec;
+	auto result = GetFileMetadata(path, ec);
+	if (ec)
+	{
+		throw boost::system::system_error(ec, "Failed to get file metadata");
+	}
+	return result;
+}
+
+FileStatus GetFileStatus(const NativePath& path, boost::system::error_code& ec) noexcept
+{
+	DWORD error;
+	auto result = QueryFileStatus(path, error);
+	if (error == ERROR_SUCCESS || IsNotFoundError(error))
+	{
+		ec.clear();
+		return result;
+	}
+
+	// The path exists but can't be opened, e.g. it's locked by the system, the attributes are enough to know what it is
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	const auto wideString = UTF8ToWideString(path.ToExtendedString());
+	if (::GetFileAttributesExW(wideString.c_str(), GetFileExInfoStandard, &attributes) != FALSE)
+	{
+		result.type = (attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 ? PathType::Directory : PathType::RegularFile;
+		ec.clear();
+		return result;
+	}
+
+	ec = boost::system::error_code(error, boost::system::system_category());
+	return result;
+}
+
+FileStatus GetFileStatus(const NativePath& path)
+{
+	boost::system::error_code ec;
+	auto result = GetFileStatus(path, ec);
+	if (ec)
+	{
+		throw boost::system::system_error(ec, "Failed to get file status");
+	}
+	return result;
+}
+
+FileStatus GetFileStatus(const boost::filesystem::directory_entry& entry, boost::system::error_code& ec) noexcept
+{
+	// Only queries the file system if the listing didn't provide the type, e.g. for reparse points
+	FileStatus result;
+	switch (entry.status(ec).type())
+	{
+		case boost::filesystem::regular_file:
+			result.type = PathType::RegularFile;
+			break;
+		case boost::filesystem::directory_file:
+			result.type = PathType::Directory;
+			break;
+		case boost::filesystem::file_not_found:
+			result.type = PathType::NotFound;
+			ec.clear();
+			break;
+		default:
+			result.type = PathType::Other;
+			break;
+	}
+	return result;
+}
+
 std::ifstream OpenFileRead(const NativePath& path, std::ios_base::openmode mode) noexcept
 {
 	// VC++ has a constructor that takes a wide string, note that this doesn't exist on other platforms
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "bslib/file/fs/FileMetadata.hpp"
+#include "bslib/file/fs/FileStatus.hpp"
 #include "bslib/file/fs/path.hpp"
 
+#include <boost/filesystem/operations.hpp>
 #include <boost/system/error_code.hpp>
 #include <boost/system/system_error.hpp>
 
@@ -60,6 +63,13 @@ void Remove(const NativePath& path);
 void RemoveAll(const NativePath& path, boost::system::error_code& ec) noexcept;
 void RemoveAll(const NativePath& path);
 
+/**
+ * Writes anything the OS has buffered for the file at the given path to disk, so it survives a power failure
+ * \remarks Content buffered by a stream must be flushed first
+ */
+void FlushFile(const NativePath& path, boost::system::error_code& ec) noexcept;
+void FlushFile(const NativePath& path);
+
 /**
  * Computes a well formed absolute path from the given path segment that may be relative or absolute
  * \remarks This is not thread safe, as the "current directory" is a global concept
@@ -68,6 +78,25 @@ void RemoveAll(const NativePath& path);
 NativePath GetAbsolutePath(const UTF8String& path, boost::system::error_code& ec) noexcept;
 NativePath GetAbsolutePath(const UTF8String& path);
 
+/**
+ * Reads the metadata of the file at the given path without opening its content
+ */
+FileMetadata GetFileMetadata(const NativePath& path, boost::system::error_code& ec) noexcept;
+FileMetadata GetFileMetadata(const NativePath& path);
+
+/**
+ * Reads the type and metadata of the given path with a single query of the file system
+ * \returns The status of the path, with a type of PathType::NotFound if it doesn't exist
+ */
+FileStatus GetFileStatus(const NativePath& path, boost::system::error_code& ec) noexcept;
+FileStatus GetFileStatus(const NativePath& path);
+
+/**
+ * Gets the status of a directory entry, using the type cached by the directory listing where the platform provides it
+ * \remarks The metadata isn't set, as directory listings don't provide all of it
+ */
+FileStatus GetFileStatus(const boost::filesystem::directory_entry& entry, boost::system::error_code& ec) noexcept;
+
 /**
  * Opens the file at the given path for reading
  */
@@ -85,6 +85,42 @@ void BindByParameterNameNull(sqlite3_stmt* statement, const std::string& name)
 	}
 }
 
+void BindByParameterIndexInt64(sqlite3_stmt* statement, int index, int64_t value)
+{
+	const auto bindResult = sqlite3_bind_int64(statement, index, value);
+	if (bindResult != SQLITE_OK)
+	{
+		throw BindParameterFailedException(std::to_string(index), bindResult);
+	}
+}
+
+void BindByParameterIndexBlob(sqlite3_stmt* statement, int index, const uint8_t* start, size_t size)
+{
+	const auto bindResult = sqlite3_bind_blob(statement, index, start, static_cast<int>(size), SQLITE_STATIC);
+	if (bindResult != SQLITE_OK)
+	{
+		throw BindParameterFailedException(std::to_string(index), bindResult);
+	}
+}
+
+void BindByParameterIndexText(sqlite3_stmt* statement, int index, const char* start, size_t length)
+{
+	const auto bindResult = sqlite3_bind_text(statement, index, start, static_cast<int>(length), SQLITE_STATIC);
+	if (bindResult != SQLITE_OK)
+	{
+		throw BindParameterFailedException(std::to_string(index), bindResult);
+	}
+}
+
+void BindByParameterIndexNull(sqlite3_stmt* statement, int index)
+{
+	const auto bindResult = sqlite3_bind_null(statement, index);
+	if (bindResult != SQLITE_OK)
+	{
+		throw BindParameterFailedException(std::to_string(index), bindResult);
+	}
+}
+
 }
 }
 }
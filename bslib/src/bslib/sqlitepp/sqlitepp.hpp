@@ -85,6 +85,30 @@ void BindByParameterNameBlob(sqlite3_stmt* statement, const std::string& name, c
  */
 void BindByParameterNameNull(sqlite3_stmt* statement, const std::string& name);
 
+/**
+ * Binds an int64 parameter by its 1-based index, for statements with too many parameters to bind by name
+ * \throws BindParameterFailedException The parameter couldn't be bound
+ */
+void BindByParameterIndexInt64(sqlite3_stmt* statement, int index, int64_t value);
+
+/**
+ * Binds a blob parameter by its 1-based index, the blob must stay valid until the statement is reset
+ * \throws BindParameterFailedException The parameter couldn't be bound
+ */
+void BindByParameterIndexBlob(sqlite3_stmt* statement, int index, const uint8_t* start, size_t size);
+
+/**
+ * Binds a text parameter by its 1-based index, the text must stay valid until the statement is reset
+ * \throws BindParameterFailedException The parameter couldn't be bound
+ */
+void BindByParameterIndexText(sqlite3_stmt* statement, int index, const char* start, size_t length);
+
+/**
+ * Binds a null parameter by its 1-based index
+ * \throws BindParameterFailedException The parameter couldn't be bound
+ */
+void BindByParameterIndexNull(sqlite3_stmt* statement, int index);
+
 /**
  * Converts the given container elements into a set literal using the given value function
  * \throws EmptySetLiteralException If there are no elements
@@ -5,6 +5,7 @@
 #include "bslib/file/exceptions.hpp"
 #include "bslib/file/FileAdder.hpp"
 #include "bslib/file/fs/operations.hpp"
+#include "bslib/sqlitepp/sqlitepp.hpp"
 #include "bslib_test_util/TestBase.hpp"
 
 #include <boost/filesystem.hpp>
@@ -12,6 +13,7 @@
 #include <gmock/gmock.h>
 
 #include <memory>
+#include <string>
 
 namespace af {
 namespace bslib {
@@ -57,7 +59,7 @@ TEST_F(BackupDatabaseIntegrationTest, UnitOfWorkCommit)
 
 	const auto targetPath = GetUniqueExtendedTempPath().EnsureTrailingSlash();
 	{
-		auto uow = database.CreateUnitOfWork(store);
+		auto uow = database.CreateUnitOfWork({ store });
 		auto adder = uow->CreateFileAdder(Uuid::Empty);
 		file::fs::CreateDirectories(targetPath);
 		adder->Add(targetPath.ToString());
@@ -67,7 +69,7 @@ TEST_F(BackupDatabaseIntegrationTest, UnitOfWorkCommit)
 
 	// Assert
 	{
-		auto uow = database.CreateUnitOfWork(store);
+		auto uow = database.CreateUnitOfWork({ store });
 		auto finder = uow->CreateFileFinder();
 		EXPECT_TRUE(finder->FindLastChangedEventByPath(targetPath));
 	}
@@ -82,8 +84,8 @@ TEST_F(BackupDatabaseIntegrationTest, CreateUnitOfWork_TwiceSuccess)
 	// Act
 	// Assert
 	auto store = std::make_shared<blob::NullBlobStore>();
-	auto uow1 = backup.CreateUnitOfWork(store);
-	EXPECT_NO_THROW(backup.CreateUnitOfWork(store));
+	auto uow1 = backup.CreateUnitOfWork({ store });
+	EXPECT_NO_THROW(backup.CreateUnitOfWork({ store }));
 }
 
 TEST_F(BackupDatabaseIntegrationTest, UnitOfWorkImplicitRollback)
@@ -96,7 +98,7 @@ TEST_F(BackupDatabaseIntegrationTest, UnitOfWorkImplicitRollback)
 	// Act
 	const auto targetPath = GetUniqueExtendedTempPath().EnsureTrailingSlash();
 	{
-		auto uow = backup.CreateUnitOfWork(store);
+		auto uow = backup.CreateUnitOfWork({ store });
 		auto adder = uow->CreateFileAdder(Uuid::Empty);
 		file::fs::CreateDirectories(targetPath);
 		adder->Add(targetPath.ToString());
@@ -104,7 +106,7 @@ TEST_F(BackupDatabaseIntegrationTest, UnitOfWorkImplicitRollback)
 
 	// Assert
 	{
-		auto uow = backup.CreateUnitOfWork(store);
+		auto uow = backup.CreateUnitOfWork({ store });
 		auto finder = uow->CreateFileFinder();
 		EXPECT_FALSE(finder->FindLastChangedEventByPath(targetPath));
 	}
@@ -153,7 +155,7 @@ TEST_F(BackupDatabaseIntegrationTest, SaveAs_Success)
 	BackupDatabase copy(target);
 	ASSERT_NO_THROW(copy.Open());
 	auto nullBlobStore = std::make_shared<blob::NullBlobStore>();
-	const auto uowCopy = copy.CreateUnitOfWork(nullBlobStore);
+	const auto uowCopy = copy.CreateUnitOfWork({ nullBlobStore });
 	const auto finder = uowCopy->CreateFileFinder();
 	const auto allEvents = finder->GetAllEvents();
 	EXPECT_EQ(1, allEvents.size());
@@ -179,7 +181,7 @@ TEST_F(BackupDatabaseIntegrationTest, SaveAs_ExcludesUncommittedWork)
 	BackupDatabase copy(target);
 	copy.Open();
 	auto nullBlobStore = std::make_shared<blob::NullBlobStore>();
-	const auto uowCopy = copy.CreateUnitOfWork(nullBlobStore);
+	const auto uowCopy = copy.CreateUnitOfWork({ nullBlobStore });
 	const auto finder = uowCopy->CreateFileFinder();
 	const auto allEvents = finder->GetAllEvents();
 	EXPECT_EQ(0, allEvents.size());
@@ -197,6 +199,140 @@ TEST_F(BackupDatabaseIntegrationTest, SaveAs_ThrowsIfExists)
 	ASSERT_THROW(_testBackup.GetBackupDatabase().SaveAs(target), DatabaseAlreadyExistsException);
 }
 
+TEST_F(BackupDatabaseIntegrationTest, Open_UsesWriteAheadLog)
+{
+	// Arrange
+	_testBackup.Create();
+	const auto connection = _testBackup.ConnectToDatabase();
+
+	// Act
+	sqlitepp::ScopedStatement statement;
+	sqlitepp::prepare_or_throw(*connection, "PRAGMA journal_mode", statement);
+	ASSERT_EQ(SQLITE_ROW, sqlite3_step(statement));
+
+	// Assert
+	EXPECT_EQ(std::string("wal"), reinterpret_cast<const char*>(sqlite3_column_text(statement, 0)));
+}
+
+TEST_F(BackupDatabaseIntegrationTest, CreateReadOnlyUnitOfWork_ReadsSnapshotWhileWriting)
+{
+	// Arrange
+	_testBackup.Create();
+	auto& database = _testBackup.GetBackupDatabase();
+	auto store = std::make_shared<blob::NullBlobStore>();
+	const auto testFile = GetUniqueExtendedTempPath();
+	WriteFile(testFile, "hi");
+	auto writer = database.CreateUnitOfWork({ store });
+	writer->CreateFileAdder(Uuid::Empty)->Add(testFile.ToString());
+
+	// Act
+	const auto reader = database.CreateReadOnlyUnitOfWork({ store });
+	const auto eventsWhileWriting = reader->CreateFileFinder()->GetAllEvents();
+	writer->Commit();
+	const auto eventsAfterCommit = reader->CreateFileFinder()->GetAllEvents();
+	const auto laterEvents = database.CreateReadOnlyUnitOfWork({ store })->CreateFileFinder()->GetAllEvents();
+
+	// Assert
+	EXPECT_TRUE(eventsWhileWriting.empty());
+	EXPECT_TRUE(eventsAfterCommit.empty());
+	EXPECT_EQ(1, laterEvents.size());
+}
+
+TEST_F(BackupDatabaseIntegrationTest, CreateReadOnlyUnitOfWork_WritesFail)
+{
+	// Arrange
+	_testBackup.Create();
+	auto& database = _testBackup.GetBackupDatabase();
+	auto store = std::make_shared<blob::NullBlobStore>();
+	const auto testFile = GetUniqueExtendedTempPath();
+	WriteFile(testFile, "hi");
+	const auto reader = database.CreateReadOnlyUnitOfWork({ store });
+
+	// Act
+	// Assert
+	EXPECT_ANY_THROW({
+		reader->CreateFileAdder(Uuid::Empty)->Add(testFile.ToString());
+		reader->Commit();
+	});
+}
+
+TEST_F(BackupDatabaseIntegrationTest, BlobAddressFilter_SavedOnCloseAndUsedOnOpen)
+{
+	// Arrange
+	_testBackup.Create();
+	auto store = std::make_shared<blob::NullBlobStore>();
+	{
+		auto uow = _testBackup.GetBackupDatabase().CreateUnitOfWork({ store });
+		auto adder = uow->CreateFileAdder(Uuid::Empty);
+		const auto testFile = GetUniqueExtendedTempPath();
+		WriteFile(testFile, "hi");
+		adder->Add(testFile.ToString());
+		uow->Commit();
+	}
+	_testBackup.Close();
+	auto filterPath = _testBackup.GetBackupDatabaseDbPath();
+	filterPath += ".blobfilter";
+
+	// Act
+	BackupDatabase reopened(_testBackup.GetBackupDatabaseDbPath());
+	reopened.Open();
+	{
+		auto uow = reopened.CreateUnitOfWork({ store });
+		auto adder = uow->CreateFileAdder(Uuid::Empty);
+		const auto sameContentFile = GetUniqueExtendedTempPath();
+		WriteFile(sameContentFile, "hi");
+		adder->Add(sameContentFile.ToString());
+		uow->Commit();
+	}
+	const auto stats = reopened.GetBlobAddressFilterStats();
+
+	// Assert
+	EXPECT_TRUE(boost::filesystem::exists(filterPath));
+	EXPECT_EQ(1U, stats.lookups);
+	EXPECT_EQ(1U, stats.possibleHits);
+	EXPECT_EQ(0U, stats.falsePositives);
+}
+
+TEST_F(BackupDatabaseIntegrationTest, BlobAddressFilter_RebuiltIfBlobReplacedWhileClosed)
+{
+	// Arrange
+	_testBackup.Create();
+	auto store = std::make_shared<blob::NullBlobStore>();
+	{
+		auto uow = _testBackup.GetBackupDatabase().CreateUnitOfWork({ store });
+		auto adder = uow->CreateFileAdder(Uuid::Empty);
+		const auto testFile = GetUniqueExtendedTempPath();
+		WriteFile(testFile, "hi");
+		adder->Add(testFile.ToString());
+		uow->Commit();
+	}
+	_testBackup.Close();
+
+	// Such as by another process collecting garbage then backing up, which reuses the removed blob's row id
+	const auto otherFile = GetUniqueExtendedTempPath();
+	const auto otherAddress = WriteFile(otherFile, "there").ToBinary();
+	{
+		sqlitepp::ScopedSqlite3Object db;
+		sqlitepp::open_database_or_throw(_testBackup.GetBackupDatabaseDbPath().string().c_str(), db, SQLITE_OPEN_READWRITE);
+		sqlitepp::exec_or_throw(db, "DELETE FROM Blob");
+		sqlitepp::ScopedStatement statement;
+		sqlitepp::prepare_or_throw(db, "INSERT INTO Blob (rowid, Address, SizeBytes) VALUES (1, :Address, :SizeBytes)", statement);
+		sqlitepp::BindByParameterNameBlob(statement, ":Address", &otherAddress[0], otherAddress.size());
+		sqlitepp::BindByParameterNameInt64(statement, ":SizeBytes", 5);
+		ASSERT_EQ(SQLITE_DONE, sqlite3_step(statement));
+	}
+
+	// Act
+	BackupDatabase reopened(_testBackup.GetBackupDatabaseDbPath());
+	reopened.Open();
+	auto uow = reopened.CreateUnitOfWork({ store });
+	auto adder = uow->CreateFileAdder(Uuid::Empty);
+
+	// Assert
+	EXPECT_NO_THROW(adder->Add(otherFile.ToString()));
+	EXPECT_NO_THROW(uow->Commit());
+}
+
 }
 }
 }
@@ -1,9 +1,11 @@
 #include "blob/MockBlobStore.hpp"
 #include "bslib/exceptions.hpp"
 #include "bslib/Backup.hpp"
+#include "bslib/blob/DirectoryBlobStore.hpp"
 #include "bslib/blob/exceptions.hpp"
 #include "bslib/blob/NullBlobStore.hpp"
 #include "bslib/file/exceptions.hpp"
+#include "bslib/file/FileAdderSettings.hpp"
 #include "bslib/file/fs/operations.hpp"
 #include "bslib_test_util/TestBase.hpp"
 
@@ -11,7 +13,10 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <algorithm>
+#include <ctime>
 #include <memory>
+#include <random>
 
 namespace af {
 namespace bslib {
@@ -79,6 +84,117 @@ TEST_F(BackupIntegrationTest, ModifyBlobStoresDuringBackup_Success)
 	ASSERT_NO_THROW(uow->GetBlob(blobAddress));
 }
 
+TEST_F(BackupIntegrationTest, ReadBlob_VisitsChunksInOrder)
+{
+	// Arrange
+	_testBackup.OpenOrCreate();
+	file::FileAdderSettings settings;
+	settings.contentDefinedChunking = true;
+	settings.minChunkSizeBytes = 1024;
+	settings.averageChunkSizeBytes = 4096;
+	settings.maxChunkSizeBytes = 16384;
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<int> distribution(0, 255);
+	UTF8String content(256 * 1024, '\0');
+	std::generate(content.begin(), content.end(), [&]() { return static_cast<char>(distribution(generator)); });
+	const auto tempPath = GetUniqueExtendedTempPath();
+	const auto blobAddress = WriteFile(tempPath, content);
+	{
+		auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+		uow->CreateFileAdder(Uuid::Empty, settings)->Add(tempPath.ToString());
+		uow->Commit();
+	}
+	auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+
+	// Act
+	std::vector<uint8_t> result;
+	size_t partCount = 0;
+	uow->ReadBlob(blobAddress, [&](const blob::BlobView& part) {
+		result.insert(result.end(), part.begin(), part.end());
+		++partCount;
+	});
+
+	// Assert
+	EXPECT_EQ(std::vector<uint8_t>(content.begin(), content.end()), result);
+	EXPECT_GT(partCount, 1U);
+}
+
+TEST_F(BackupIntegrationTest, Commit_FlushesBlobStore)
+{
+	// Arrange
+	_testBackup.OpenOrCreate();
+	auto& blobStoreManager = _testBackup.GetBlobStoreManager();
+	blobStoreManager.RemoveById((*(blobStoreManager.GetStores().begin()))->GetId());
+	const auto blobStore = std::make_shared<blob::test::MockBlobStore>();
+	blobStoreManager.AddBlobStore(blobStore);
+	auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+	EXPECT_CALL(*blobStore, Flush()).Times(1);
+
+	// Act
+	uow->Commit();
+
+	// Assert
+	testing::Mock::VerifyAndClearExpectations(blobStore.get());
+}
+
+TEST_F(BackupIntegrationTest, Commit_CreatesBlobsInEveryStore)
+{
+	// Arrange
+	_testBackup.OpenOrCreate();
+	const auto secondStore = std::make_shared<blob::DirectoryBlobStore>(GetUniqueTempPath());
+	_testBackup.GetBlobStoreManager().AddBlobStore(secondStore);
+	const auto tempPath = GetUniqueExtendedTempPath();
+	const auto blobAddress = WriteFile(tempPath, "hey");
+	auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+	uow->CreateFileAdder(Uuid::Empty)->Add(tempPath.ToString());
+
+	// Act
+	uow->Commit();
+
+	// Assert
+	for (const auto& store : _testBackup.GetBlobStoreManager().GetStores())
+	{
+		EXPECT_NO_THROW(store->GetBlob(blobAddress));
+	}
+	EXPECT_EQ(0U, _testBackup.GetBackup().CreateUnitOfWork()->CopyMissingBlobs(secondStore->GetId()));
+}
+
+TEST_F(BackupIntegrationTest, CopyMissingBlobs_CopiesToAddedStore)
+{
+	// Arrange
+	_testBackup.OpenOrCreate();
+	const auto tempPath = GetUniqueExtendedTempPath();
+	const auto blobAddress = WriteFile(tempPath, "hey");
+	{
+		auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+		uow->CreateFileAdder(Uuid::Empty)->Add(tempPath.ToString());
+		uow->Commit();
+	}
+	const auto addedStore = std::make_shared<blob::DirectoryBlobStore>(GetUniqueTempPath());
+	_testBackup.GetBlobStoreManager().AddBlobStore(addedStore);
+	auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+
+	// Act
+	const auto copiedCount = uow->CopyMissingBlobs(addedStore->GetId());
+	uow->Commit();
+
+	// Assert
+	EXPECT_EQ(1U, copiedCount);
+	EXPECT_NO_THROW(addedStore->GetBlob(blobAddress));
+	EXPECT_EQ(0U, _testBackup.GetBackup().CreateUnitOfWork()->CopyMissingBlobs(addedStore->GetId()));
+}
+
+TEST_F(BackupIntegrationTest, CopyMissingBlobs_ThrowsIfStoreNotFound)
+{
+	// Arrange
+	_testBackup.OpenOrCreate();
+	auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+
+	// Act
+	// Assert
+	EXPECT_THROW(uow->CopyMissingBlobs(Uuid::Create()), BlobStoreNotFoundException);
+}
+
 TEST_F(BackupIntegrationTest, CreateUnitOfWork_ThrowsIfNoBlobStores)
 {
 	// Arrange
@@ -91,6 +207,154 @@ TEST_F(BackupIntegrationTest, CreateUnitOfWork_ThrowsIfNoBlobStores)
 	ASSERT_THROW(_testBackup.GetBackup().CreateUnitOfWork(), NoBlobStoresConfiguredException);
 }
 
+TEST_F(BackupIntegrationTest, CollectGarbage_DeletesUnknownBlobsOutsideGracePeriod)
+{
+	// Arrange
+	_testBackup.OpenOrCreate();
+	const auto tempPath = GetUniqueExtendedTempPath();
+	const auto referencedAddress = WriteFile(tempPath, "hey");
+	{
+		auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+		uow->CreateFileAdder(Uuid::Empty)->Add(tempPath.ToString());
+		uow->Commit();
+	}
+	auto store = _testBackup.GetBlobStoreManager().GetStores().front();
+	const std::vector<uint8_t> oldContent = { 1, 2, 3 };
+	const std::vector<uint8_t> newContent = { 4, 5, 6, 7 };
+	const auto oldAddress = blob::Address::CalculateFromContent(oldContent);
+	const auto newAddress = blob::Address::CalculateFromContent(newContent);
+	store->CreateBlob(oldAddress, oldContent);
+	store->CreateBlob(newAddress, newContent);
+	const auto oldPath = blob::DirectoryBlobStore::GetBlobPath(_testBackup.GetDirectoryStorePath(), oldAddress, blob::DirectoryBlobStore::DEFAULT_FAN_OUT_DEPTH);
+	boost::filesystem::last_write_time(oldPath, std::time(nullptr) - 2 * 24 * 60 * 60);
+	auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+
+	// Act
+	const auto result = uow->CollectGarbage();
+	uow->Commit();
+
+	// Assert
+	EXPECT_EQ(1U, result.blobsDeleted);
+	EXPECT_EQ(oldContent.size(), result.bytesReclaimed);
+	EXPECT_EQ(1U, result.blobsInGracePeriod);
+	EXPECT_EQ(0U, result.catalogBlobsRemoved);
+	EXPECT_THROW(store->GetBlob(oldAddress), blob::BlobReadException);
+	EXPECT_NO_THROW(store->GetBlob(newAddress));
+	EXPECT_NO_THROW(store->GetBlob(referencedAddress));
+}
+
+TEST_F(BackupIntegrationTest, CollectGarbage_SkipsStoresThatCantListBlobs)
+{
+	// Arrange
+	_testBackup.OpenOrCreate();
+	_testBackup.GetBlobStoreManager().AddBlobStore(std::make_shared<blob::NullBlobStore>());
+	auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+
+	// Act
+	const auto result = uow->CollectGarbage();
+
+	// Assert
+	EXPECT_EQ(1U, result.storesSkipped);
+}
+
+TEST_F(BackupIntegrationTest, ScrubBlobs_FindsCorruptBlobThatBackupStoresAgain)
+{
+	// Arrange
+	_testBackup.OpenOrCreate();
+	const auto tempPath = GetUniqueExtendedTempPath();
+	const auto blobAddress = WriteFile(tempPath, "hey");
+	{
+		auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+		uow->CreateFileAdder(Uuid::Empty)->Add(tempPath.ToString());
+		uow->Commit();
+	}
+	const auto blobPath = blob::DirectoryBlobStore::GetBlobPath(_testBackup.GetDirectoryStorePath(), blobAddress, blob::DirectoryBlobStore::DEFAULT_FAN_OUT_DEPTH);
+	WriteFile(blobPath, "hex");
+
+	// Act
+	blob::ScrubResult result;
+	{
+		auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+		result = uow->ScrubBlobs();
+		uow->Commit();
+	}
+	{
+		auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+		uow->CreateFileAdder(Uuid::Empty)->Add(tempPath.ToString());
+		uow->Commit();
+	}
+
+	// Assert
+	EXPECT_EQ(1U, result.blobsScrubbed);
+	EXPECT_EQ(1U, result.blobsCorrupt);
+	EXPECT_TRUE(result.complete);
+	const auto content = _testBackup.GetBlobStoreManager().GetStores().front()->GetBlob(blobAddress);
+	EXPECT_EQ("hey", std::string(content.begin(), content.end()));
+	EXPECT_EQ(0U, _testBackup.GetBackup().CreateUnitOfWork()->ScrubBlobs().blobsCorrupt);
+}
+
+TEST_F(BackupIntegrationTest, ScrubBlobs_KeepsProgressIfNotCommitted)
+{
+	// Arrange
+	_testBackup.OpenOrCreate();
+	const auto tempPath = GetUniqueExtendedTempPath();
+	const auto blobAddress = WriteFile(tempPath, "hey");
+	{
+		auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+		uow->CreateFileAdder(Uuid::Empty)->Add(tempPath.ToString());
+		uow->Commit();
+	}
+	const auto blobPath = blob::DirectoryBlobStore::GetBlobPath(_testBackup.GetDirectoryStorePath(), blobAddress, blob::DirectoryBlobStore::DEFAULT_FAN_OUT_DEPTH);
+	WriteFile(blobPath, "hex");
+
+	// Act
+	const auto result = _testBackup.GetBackup().CreateUnitOfWork()->ScrubBlobs();
+	{
+		auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+		uow->CreateFileAdder(Uuid::Empty)->Add(tempPath.ToString());
+		uow->Commit();
+	}
+
+	// Assert
+	EXPECT_EQ(1U, result.blobsCorrupt);
+	const auto content = _testBackup.GetBlobStoreManager().GetStores().front()->GetBlob(blobAddress);
+	EXPECT_EQ("hey", std::string(content.begin(), content.end()));
+}
+
+TEST_F(BackupIntegrationTest, ScrubBlobs_CarriesOnFromCursor)
+{
+	// Arrange
+	_testBackup.OpenOrCreate();
+	const auto tempPath = GetUniqueExtendedTempPath();
+	boost::filesystem::create_directories(tempPath.ToExtendedString());
+	WriteFile(tempPath / "a.txt", "hey");
+	WriteFile(tempPath / "b.txt", "there");
+	{
+		auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+		uow->CreateFileAdder(Uuid::Empty)->Add(tempPath.ToString());
+		uow->Commit();
+	}
+	blob::ScrubSettings settings;
+	settings.maxBlobs = 1;
+	settings.threads = 2;
+
+	// Act
+	blob::ScrubResult first;
+	{
+		auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+		first = uow->ScrubBlobs(settings);
+		uow->Commit();
+	}
+	const auto second = _testBackup.GetBackup().CreateUnitOfWork()->ScrubBlobs();
+
+	// Assert
+	EXPECT_EQ(1U, first.blobsScrubbed);
+	EXPECT_FALSE(first.complete);
+	EXPECT_EQ(1U, second.blobsScrubbed);
+	EXPECT_TRUE(second.complete);
+	EXPECT_EQ(0U, second.blobsMissing + second.blobsCorrupt);
+}
+
 }
 }
 }
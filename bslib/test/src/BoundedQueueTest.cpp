@@ -0,0 +1,113 @@
+#include "bslib/BoundedQueue.hpp"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <thread>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace test {
+
+TEST(BoundedQueueTest, Pop_ReturnsItemsInOrder)
+{
+	// Arrange
+	BoundedQueue<int> queue(3);
+	queue.Push(1);
+	queue.Push(2);
+	queue.Push(3);
+
+	// Act
+	std::vector<int> items(3);
+	queue.Pop(items[0]);
+	queue.Pop(items[1]);
+	queue.Pop(items[2]);
+
+	// Assert
+	EXPECT_THAT(items, ::testing::ElementsAre(1, 2, 3));
+}
+
+TEST(BoundedQueueTest, Pop_DrainsItemsAfterClose)
+{
+	// Arrange
+	BoundedQueue<int> queue(2);
+	queue.Push(1);
+	queue.Close();
+
+	// Act
+	int item = 0;
+	const auto first = queue.Pop(item);
+	const auto second = queue.Pop(item);
+
+	// Assert
+	EXPECT_TRUE(first);
+	EXPECT_EQ(1, item);
+	EXPECT_FALSE(second);
+}
+
+TEST(BoundedQueueTest, Push_FailsAfterClose)
+{
+	// Arrange
+	BoundedQueue<int> queue(1);
+	queue.Close();
+
+	// Act
+	const auto pushed = queue.Push(1);
+
+	// Assert
+	EXPECT_FALSE(pushed);
+}
+
+TEST(BoundedQueueTest, Push_WaitsWhileFull)
+{
+	// Arrange
+	BoundedQueue<int> queue(1);
+	const auto count = 1000;
+
+	// Act
+	std::thread producer([&]() {
+		for (auto i = 0; i < count; ++i)
+		{
+			queue.Push(i);
+		}
+		queue.Close();
+	});
+
+	std::vector<int> items;
+	int item = 0;
+	while (queue.Pop(item))
+	{
+		items.push_back(item);
+	}
+	producer.join();
+
+	// Assert
+	ASSERT_EQ(count, items.size());
+	for (auto i = 0; i < count; ++i)
+	{
+		EXPECT_EQ(i, items[i]);
+	}
+}
+
+TEST(BoundedQueueTest, Close_WakesWaitingConsumer)
+{
+	// Arrange
+	BoundedQueue<int> queue(1);
+	bool popped = true;
+	std::thread consumer([&]() {
+		int item = 0;
+		popped = queue.Pop(item);
+	});
+
+	// Act
+	queue.Close();
+	consumer.join();
+
+	// Assert
+	EXPECT_FALSE(popped);
+}
+
+}
+}
+}
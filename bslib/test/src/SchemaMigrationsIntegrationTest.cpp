@@ -0,0 +1,164 @@
+#include "bslib/exceptions.hpp"
+#include "bslib/SchemaMigrations.hpp"
+#include "bslib/sqlitepp/sqlitepp.hpp"
+#include "bslib_test_util/TestBase.hpp"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <string>
+
+namespace af {
+namespace bslib {
+namespace test {
+
+class SchemaMigrationsIntegrationTest : public bslib_test_util::TestBase
+{
+protected:
+	SchemaMigrationsIntegrationTest()
+		: _path(GetUniqueTempPath().string())
+	{
+		sqlitepp::open_database_or_throw(_path.c_str(), _db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+	}
+
+	bool HasIndex(const std::string& name)
+	{
+		sqlitepp::ScopedStatement statement;
+		sqlitepp::prepare_or_throw(_db, "SELECT 1 FROM sqlite_master WHERE type = 'index' AND name = :Name", statement);
+		sqlitepp::BindByParameterNameText(statement, ":Name", name);
+		return sqlite3_step(statement) == SQLITE_ROW;
+	}
+
+	bool HasColumn(const std::string& table, const std::string& column)
+	{
+		const auto sql = "PRAGMA table_info(" + table + ")";
+		sqlitepp::ScopedStatement statement;
+		sqlitepp::prepare_or_throw(_db, sql.c_str(), statement);
+		while (sqlite3_step(statement) == SQLITE_ROW)
+		{
+			if (column == reinterpret_cast<const char*>(sqlite3_column_text(statement, 1)))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	const std::string _path;
+	sqlitepp::ScopedSqlite3Object _db;
+};
+
+TEST_F(SchemaMigrationsIntegrationTest, MigrateSchema_CreatesEmptyDatabase)
+{
+	// Arrange
+	// Act
+	MigrateSchema(_db, _path);
+
+	// Assert
+	EXPECT_EQ(CURRENT_SCHEMA_VERSION, GetSchemaVersion(_db));
+	EXPECT_NO_THROW(sqlitepp::exec_or_throw(_db, "SELECT COUNT(*) FROM FileEvent; SELECT COUNT(*) FROM ScrubCursor;"));
+	EXPECT_TRUE(HasIndex("FileEvent_BackupRunId_Id"));
+}
+
+TEST_F(SchemaMigrationsIntegrationTest, MigrateSchema_UpgradesUnversionedDatabase)
+{
+	// Arrange
+	// The schema databases were created with before it was versioned
+	sqlitepp::exec_or_throw(_db, R"(
+		CREATE TABLE Blob (
+			Address BLOB (20) PRIMARY KEY,
+			SizeBytes INTEGER (8) NOT NULL
+		);
+		CREATE TABLE FileEvent (
+			Id INTEGER PRIMARY KEY AUTOINCREMENT,
+			PathId INTEGER NOT NULL REFERENCES FilePath (Id),
+			ContentBlobAddress BLOB(20) REFERENCES Blob (Address),
+			Action INTEGER NOT NULL,
+			BackupRunId BLOB(16) NOT NULL,
+			DateTimeUtc INTEGER NOT NULL
+		);
+		CREATE TABLE FileBackupRunEvent (
+			Id INTEGER PRIMARY KEY AUTOINCREMENT,
+			BackupRunId BLOB(16) NOT NULL,
+			DateTimeUtc INTEGER NOT NULL,
+			Action INTEGER NOT NULL
+		);
+		CREATE TABLE FilePath (
+			Id INTEGER PRIMARY KEY,
+			FullPath TEXT NOT NULL COLLATE BINARY,
+			FileType INTEGER NOT NULL,
+			ParentId INTEGER NULL REFERENCES FilePath (Id),
+			UNIQUE (FullPath, FileType)
+		);
+	)");
+	sqlitepp::exec_or_throw(_db, "INSERT INTO FilePath (Id, FullPath, FileType) VALUES (1, 'C:\\', 1)");
+	sqlitepp::exec_or_throw(_db, "INSERT INTO FileEvent (PathId, Action, BackupRunId, DateTimeUtc) VALUES (1, 0, x'00', 1)");
+
+	// Act
+	MigrateSchema(_db, _path);
+
+	// Assert
+	EXPECT_EQ(CURRENT_SCHEMA_VERSION, GetSchemaVersion(_db));
+	EXPECT_FALSE(HasIndex("FileEvent_PathId"));
+	EXPECT_TRUE(HasIndex("FileEvent_PathId_Id_Action"));
+	EXPECT_TRUE(HasIndex("FileBackupRunEvent_BackupRunId"));
+	EXPECT_TRUE(HasIndex("PathVersion_PathId_ValidToUtc"));
+	EXPECT_TRUE(HasColumn("FileEvent", "SizeBytes"));
+	EXPECT_TRUE(HasColumn("FileEvent", "ModifiedTime"));
+	EXPECT_TRUE(HasColumn("FileEvent", "ChangedTime"));
+	EXPECT_TRUE(HasColumn("FileEvent", "FileId"));
+	sqlitepp::ScopedStatement statement;
+	sqlitepp::prepare_or_throw(_db, "SELECT COUNT(*), SizeBytes, FileId FROM FileEvent", statement);
+	ASSERT_EQ(SQLITE_ROW, sqlite3_step(statement));
+	EXPECT_EQ(1, sqlite3_column_int(statement, 0));
+	EXPECT_EQ(SQLITE_NULL, sqlite3_column_type(statement, 1));
+	EXPECT_EQ(SQLITE_NULL, sqlite3_column_type(statement, 2));
+	EXPECT_NO_THROW(sqlitepp::exec_or_throw(_db, "SELECT COUNT(*) FROM PathVersion; SELECT COUNT(*) FROM BlobChunk;"));
+}
+
+TEST_F(SchemaMigrationsIntegrationTest, MigrateSchema_StopsAtTargetVersion)
+{
+	// Arrange
+	// Act
+	MigrateSchema(_db, _path, 2);
+
+	// Assert
+	EXPECT_EQ(2, GetSchemaVersion(_db));
+	EXPECT_TRUE(HasIndex("FileEvent_PathId"));
+	EXPECT_FALSE(HasIndex("FileEvent_BackupRunId"));
+}
+
+TEST_F(SchemaMigrationsIntegrationTest, MigrateSchema_CountsBlobChanges)
+{
+	// Arrange
+	MigrateSchema(_db, _path);
+
+	// Act
+	sqlitepp::exec_or_throw(_db, R"(
+		INSERT INTO Blob (Address, SizeBytes) VALUES (x'01', 1);
+		DELETE FROM Blob;
+		INSERT INTO Blob (Address, SizeBytes) VALUES (x'02', 1);
+	)");
+
+	// Assert
+	sqlitepp::ScopedStatement statement;
+	sqlitepp::prepare_or_throw(_db, "SELECT (SELECT MAX(rowid) FROM Blob), ChangeCount FROM BlobChangeCount", statement);
+	ASSERT_EQ(SQLITE_ROW, sqlite3_step(statement));
+	EXPECT_EQ(1, sqlite3_column_int64(statement, 0));
+	EXPECT_EQ(3, sqlite3_column_int64(statement, 1));
+}
+
+TEST_F(SchemaMigrationsIntegrationTest, MigrateSchema_ThrowsIfNewer)
+{
+	// Arrange
+	const auto sql = "PRAGMA user_version = " + std::to_string(CURRENT_SCHEMA_VERSION + 1);
+	sqlitepp::exec_or_throw(_db, sql.c_str());
+
+	// Act
+	// Assert
+	EXPECT_THROW(MigrateSchema(_db, _path), DatabaseSchemaTooNewException);
+}
+
+}
+}
+}
@@ -1,9 +1,13 @@
 #include "bslib/blob/Address.hpp"
+#include "bslib/blob/AddressCalculator.hpp"
+#include "bslib/blob/Sha1Hasher.hpp"
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <algorithm>
 #include <array>
+#include <random>
 #include <vector>
 
 namespace af {
@@ -26,7 +30,7 @@ TEST(AddressTest, ConstructFromVoidBuffer)
 	const Address result(rawAddress, static_cast<int>(expectedBinaryAddress.size()));
 
 	// Assert
-	EXPECT_EQ(expectedBinaryAddress, result.ToBinary());
+	EXPECT_EQ(std::vector<uint8_t>(expectedBinaryAddress.begin(), expectedBinaryAddress.end()), result.ToBinary());
 }
 
 TEST(AddressTest, ConstructFromVoidBufferLongThrows)
@@ -60,7 +64,7 @@ TEST(AddressTest, ConstructFromString)
 	const Address result(stringAddress);
 
 	// Assert
-	EXPECT_EQ(expectedBinaryAddress, result.ToBinary());
+	EXPECT_EQ(std::vector<uint8_t>(expectedBinaryAddress.begin(), expectedBinaryAddress.end()), result.ToBinary());
 }
 
 TEST(AddressTest, ConstructFromLongStringThrows)
@@ -127,6 +131,116 @@ TEST(AddressTest, CalculateFromEmptyContent)
 	EXPECT_EQ("da39a3ee5e6b4b0d3255bfef95601890afd80709", result.ToString());
 }
 
+TEST(AddressTest, CalculatorIncrementalMatchesContent)
+{
+	// Arrange
+	const std::vector<uint8_t> content = {
+		'h', 'e', 'l', 'l', 'o'
+	};
+	AddressCalculator calculator;
+
+	// Act
+	calculator.Update(&content[0], 2);
+	calculator.Update(&content[2], 0);
+	calculator.Update(&content[2], 3);
+	const auto result = calculator.Finalize();
+
+	// Assert
+	EXPECT_EQ(Address::CalculateFromContent(content), result);
+}
+
+TEST(AddressTest, CalculateFromContentBlake3)
+{
+	// Arrange
+	const std::vector<uint8_t> content = {
+		'h', 'e', 'l', 'l', 'o'
+	};
+
+	// Act
+	const auto result = Address::CalculateFromContent(content, AddressAlgorithm::Blake3);
+
+	// Assert
+	EXPECT_EQ(AddressAlgorithm::Blake3, result.GetAlgorithm());
+	EXPECT_EQ("01ea8f163db38682925e4491c5e58d4bb3506ef8c14eb78a86e908c5624a67200f", result.ToString());
+}
+
+TEST(AddressTest, CalculateFromContentSpanningChunks)
+{
+	// Arrange
+	std::vector<uint8_t> content(102400);
+	for (size_t i = 0; i < content.size(); ++i)
+	{
+		content[i] = static_cast<uint8_t>(i % 251);
+	}
+
+	// Act
+	const auto sha1 = Address::CalculateFromContent(content, AddressAlgorithm::Sha1);
+	const auto blake3 = Address::CalculateFromContent(content, AddressAlgorithm::Blake3);
+
+	// Assert
+	EXPECT_EQ("f18b928d893ae172a000efa19b80e1c04fb36414", sha1.ToString());
+	EXPECT_EQ("01bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085", blake3.ToString());
+}
+
+TEST(AddressTest, VersionedAddressRoundTrips)
+{
+	// Arrange
+	const auto address = Address::CalculateFromContent({ 'h', 'i' }, AddressAlgorithm::Blake3);
+	const auto binaryAddress = address.ToBinary();
+
+	// Act
+	const Address fromBinary(&binaryAddress[0], static_cast<int>(binaryAddress.size()));
+	const Address fromString(address.ToString());
+
+	// Assert
+	EXPECT_EQ(33U, binaryAddress.size());
+	EXPECT_EQ(address, fromBinary);
+	EXPECT_EQ(address, fromString);
+	EXPECT_NE(Address::CalculateFromContent({ 'h', 'i' }), address);
+}
+
+TEST(AddressTest, ConstructFromUnknownAlgorithmThrows)
+{
+	// Arrange
+	std::vector<uint8_t> binaryAddress(33);
+	binaryAddress[0] = 0x7f;
+
+	// Act
+	// Assert
+	EXPECT_THROW(Address(&binaryAddress[0], static_cast<int>(binaryAddress.size())), InvalidAddressException);
+}
+
+TEST(AddressTest, Sha1HardwareMatchesPortable)
+{
+	if (!Sha1Hasher::IsHardwareAccelerationSupported())
+	{
+		return;
+	}
+
+	// Arrange
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<int> distribution(0, 255);
+	std::vector<uint8_t> content(10000);
+	std::generate(content.begin(), content.end(), [&]() { return static_cast<uint8_t>(distribution(generator)); });
+
+	for (const auto size : { 0, 1, 55, 56, 63, 64, 65, 127, 128, 1000, 10000 })
+	{
+		Sha1Hasher portable(false);
+		Sha1Hasher hardware(true);
+		std::array<uint8_t, 20> portableDigest;
+		std::array<uint8_t, 20> hardwareDigest;
+
+		// Act
+		portable.Update(&content[0], size);
+		portable.Finalize(&portableDigest[0]);
+		hardware.Update(&content[0], size);
+		hardware.Finalize(&hardwareDigest[0]);
+
+		// Assert
+		EXPECT_EQ(portableDigest, hardwareDigest) << "size " << size;
+	}
+}
+
 }
 }
 }
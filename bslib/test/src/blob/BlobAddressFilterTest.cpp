@@ -0,0 +1,206 @@
+#include "bslib/blob/BlobAddressFilter.hpp"
+#include "bslib_test_util/TestBase.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+namespace test {
+
+namespace {
+Address MakeAddress(unsigned i)
+{
+	const std::string content = "content " + std::to_string(i);
+	return Address::CalculateFromContent(std::vector<uint8_t>(content.begin(), content.end()));
+}
+}
+
+class BlobAddressFilterTest : public bslib_test_util::TestBase
+{
+};
+
+TEST_F(BlobAddressFilterTest, MayContain_NoFalseNegatives)
+{
+	// Arrange
+	BlobAddressFilter filter(1000);
+	for (auto i = 0U; i < 1000; ++i)
+	{
+		filter.Add(MakeAddress(i));
+	}
+
+	// Act
+	// Assert
+	for (auto i = 0U; i < 1000; ++i)
+	{
+		EXPECT_TRUE(filter.MayContain(MakeAddress(i)));
+	}
+	EXPECT_EQ(1000U, filter.GetCount());
+}
+
+TEST_F(BlobAddressFilterTest, MayContain_FalsePositiveRateNearTarget)
+{
+	// Arrange
+	BlobAddressFilter filter(10000, 0.01);
+	const auto capacity = filter.GetCapacity();
+	for (auto i = 0U; i < capacity; ++i)
+	{
+		filter.Add(MakeAddress(i));
+	}
+
+	// Act
+	auto possibleHits = 0U;
+	for (auto i = 0U; i < 10000; ++i)
+	{
+		if (filter.MayContain(MakeAddress(static_cast<unsigned>(capacity) + i)))
+		{
+			possibleHits++;
+		}
+	}
+
+	// Assert
+	EXPECT_LT(possibleHits, 200U);
+}
+
+TEST_F(BlobAddressFilterTest, Add_GrowsPastCapacity)
+{
+	// Arrange
+	BlobAddressFilter filter(1000, 0.01);
+	const auto capacity = filter.GetCapacity();
+	const auto addedCount = static_cast<unsigned>(capacity * 4);
+
+	// Act
+	for (auto i = 0U; i < addedCount; ++i)
+	{
+		filter.Add(MakeAddress(i));
+	}
+	auto possibleHits = 0U;
+	for (auto i = 0U; i < 10000; ++i)
+	{
+		if (filter.MayContain(MakeAddress(addedCount + i)))
+		{
+			possibleHits++;
+		}
+	}
+
+	// Assert
+	EXPECT_GT(filter.GetLayerCount(), 1U);
+	EXPECT_GE(filter.GetCapacity(), filter.GetCount());
+	EXPECT_EQ(addedCount, filter.GetCount());
+	for (auto i = 0U; i < addedCount; i += 97)
+	{
+		EXPECT_TRUE(filter.MayContain(MakeAddress(i)));
+	}
+	EXPECT_LT(possibleHits, 200U);
+}
+
+TEST_F(BlobAddressFilterTest, GetStats_Success)
+{
+	// Arrange
+	BlobAddressFilter filter(100);
+	filter.Add(MakeAddress(1));
+
+	// Act
+	filter.MayContain(MakeAddress(1));
+	filter.MayContain(MakeAddress(2));
+	filter.MayContain(MakeAddress(1));
+	filter.RecordFalsePositive();
+	const auto stats = filter.GetStats();
+
+	// Assert
+	EXPECT_EQ(3U, stats.lookups);
+	EXPECT_EQ(2U, stats.possibleHits);
+	EXPECT_EQ(1U, stats.falsePositives);
+	EXPECT_DOUBLE_EQ(0.5, stats.GetFalsePositiveRate());
+}
+
+TEST_F(BlobAddressFilterTest, SaveLoad_RoundTrips)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath() / "filter";
+	boost::filesystem::create_directories(path.parent_path());
+	BlobAddressFilter filter(100);
+	filter.Add(MakeAddress(1));
+	filter.Add(MakeAddress(2));
+
+	// Act
+	filter.Save(path, 2, 7);
+	const auto loaded = BlobAddressFilter::Load(path, 2, 7);
+
+	// Assert
+	ASSERT_TRUE(loaded);
+	EXPECT_TRUE(loaded->MayContain(MakeAddress(1)));
+	EXPECT_TRUE(loaded->MayContain(MakeAddress(2)));
+	EXPECT_EQ(filter.GetCapacity(), loaded->GetCapacity());
+	EXPECT_EQ(2U, loaded->GetCount());
+}
+
+TEST_F(BlobAddressFilterTest, SaveLoad_RoundTripsLayers)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath() / "filter";
+	boost::filesystem::create_directories(path.parent_path());
+	BlobAddressFilter filter(100);
+	const auto addedCount = static_cast<unsigned>(filter.GetCapacity() * 2);
+	for (auto i = 0U; i < addedCount; ++i)
+	{
+		filter.Add(MakeAddress(i));
+	}
+
+	// Act
+	filter.Save(path, addedCount, 7);
+	const auto loaded = BlobAddressFilter::Load(path, addedCount, 7);
+
+	// Assert
+	ASSERT_TRUE(loaded);
+	EXPECT_EQ(filter.GetLayerCount(), loaded->GetLayerCount());
+	EXPECT_EQ(filter.GetCapacity(), loaded->GetCapacity());
+	EXPECT_EQ(addedCount, loaded->GetCount());
+	EXPECT_TRUE(loaded->MayContain(MakeAddress(0)));
+	EXPECT_TRUE(loaded->MayContain(MakeAddress(addedCount - 1)));
+}
+
+TEST_F(BlobAddressFilterTest, Load_NullIfStale)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath() / "filter";
+	boost::filesystem::create_directories(path.parent_path());
+	BlobAddressFilter filter(100);
+	filter.Save(path, 2, 7);
+
+	// Act
+	const auto moreBlobs = BlobAddressFilter::Load(path, 3, 8);
+	const auto replacedBlob = BlobAddressFilter::Load(path, 2, 8);
+
+	// Assert
+	EXPECT_FALSE(moreBlobs);
+	EXPECT_FALSE(replacedBlob);
+}
+
+TEST_F(BlobAddressFilterTest, Load_NullIfMissingOrCorrupt)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath() / "filter";
+	boost::filesystem::create_directories(path.parent_path());
+	BlobAddressFilter filter(100);
+	filter.Save(path, 2, 7);
+	boost::filesystem::resize_file(path, boost::filesystem::file_size(path) - 1);
+
+	// Act
+	const auto missing = BlobAddressFilter::Load(path.parent_path() / "missing", 2, 7);
+	const auto truncated = BlobAddressFilter::Load(path, 2, 7);
+
+	// Assert
+	EXPECT_FALSE(missing);
+	EXPECT_FALSE(truncated);
+}
+
+}
+}
+}
+}
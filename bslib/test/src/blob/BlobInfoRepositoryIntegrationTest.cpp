@@ -100,6 +100,135 @@ TEST_F(BlobInfoRepositoryIntegrationTest, FindBlobSuccess)
 	EXPECT_EQ(blobInfo1, *result);
 }
 
+TEST_F(BlobInfoRepositoryIntegrationTest, FindBlobWithFilterSuccess)
+{
+	// Arrange
+	auto filter = std::make_shared<BlobAddressFilter>(100);
+	BlobInfoRepository repo(*_connection, filter);
+
+	const BlobInfo blobInfo1(Address("cf23df2207d99a74fbe169e3eba035e633b65d94"), 3573975UL);
+	const Address unknownAddress("5323df2207d99a74fbe169e3eba035e635779792");
+	repo.AddBlob(blobInfo1);
+
+	// Act
+	const auto found = repo.FindBlob(blobInfo1.GetAddress());
+	const auto notFound = repo.FindBlob(unknownAddress);
+	const auto stats = filter->GetStats();
+
+	// Assert
+	ASSERT_TRUE(found);
+	EXPECT_EQ(blobInfo1, *found);
+	EXPECT_FALSE(notFound);
+	EXPECT_EQ(2U, stats.lookups);
+	EXPECT_LE(1U, stats.possibleHits);
+}
+
+TEST_F(BlobInfoRepositoryIntegrationTest, FindBlobWithFilterSkipsDatabaseIfNotContained)
+{
+	// Arrange
+	auto filter = std::make_shared<BlobAddressFilter>(100);
+	BlobInfoRepository filteredRepo(*_connection, filter);
+	BlobInfoRepository repo(*_connection);
+
+	// Added behind the filter's back, so it's never been told about it
+	const BlobInfo blobInfo1(Address("cf23df2207d99a74fbe169e3eba035e633b65d94"), 3573975UL);
+	repo.AddBlob(blobInfo1);
+
+	// Act
+	const auto result = filteredRepo.FindBlob(blobInfo1.GetAddress());
+
+	// Assert
+	EXPECT_FALSE(result);
+	EXPECT_EQ(0U, filter->GetStats().possibleHits);
+}
+
+TEST_F(BlobInfoRepositoryIntegrationTest, AddGetBlobChunks)
+{
+	// Arrange
+	BlobInfoRepository repo(*_connection);
+
+	const Address blobAddress("cf23df2207d99a74fbe169e3eba035e633b65d94");
+	const std::vector<Address> chunkAddresses = {
+		Address("5323df2207d99a74fbe169e3eba035e635779792"),
+		Address("f259225215937593795395739753973973593571"),
+		Address("5323df2207d99a74fbe169e3eba035e635779792")
+	};
+	repo.AddBlob(BlobInfo(blobAddress, 3573975UL));
+	repo.AddBlobChunks(blobAddress, chunkAddresses);
+
+	// Act
+	const auto result = repo.GetBlobChunks(blobAddress);
+
+	// Assert
+	EXPECT_EQ(chunkAddresses, result);
+}
+
+TEST_F(BlobInfoRepositoryIntegrationTest, GetBlobChunksEmptyIfNotChunked)
+{
+	// Arrange
+	BlobInfoRepository repo(*_connection);
+	const Address blobAddress("cf23df2207d99a74fbe169e3eba035e633b65d94");
+	repo.AddBlob(BlobInfo(blobAddress, 3573975UL));
+
+	// Act
+	const auto result = repo.GetBlobChunks(blobAddress);
+
+	// Assert
+	EXPECT_TRUE(result.empty());
+}
+
+TEST_F(BlobInfoRepositoryIntegrationTest, RemoveUnreferencedBlobs_KeepsReferencedBlobsAndTheirChunks)
+{
+	// Arrange
+	BlobInfoRepository repo(*_connection);
+	const Address referenced("cf23df2207d99a74fbe169e3eba035e633b65d94");
+	const Address chunk("5323df2207d99a74fbe169e3eba035e635779792");
+	const Address unreferenced("f259225215937593795395739753973973593571");
+	const Address unreferencedChunk("1234a123451234b123451234a123451234b12345");
+	repo.AddBlob(BlobInfo(referenced, 1));
+	repo.AddBlob(BlobInfo(chunk, 1));
+	repo.AddBlob(BlobInfo(unreferenced, 1));
+	repo.AddBlob(BlobInfo(unreferencedChunk, 1));
+	repo.AddBlobChunks(referenced, { chunk });
+	repo.AddBlobChunks(unreferenced, { unreferencedChunk });
+	sqlitepp::exec_or_throw(*_connection, R"(
+		INSERT INTO FilePath (Id, FullPath, FileType) VALUES (1, 'C:\file', 0);
+		INSERT INTO FileEvent (PathId, ContentBlobAddress, Action, BackupRunId, DateTimeUtc)
+		VALUES (1, X'cf23df2207d99a74fbe169e3eba035e633b65d94', 0, X'00000000000000000000000000000000', 0);
+	)");
+
+	// Act
+	const auto removedCount = repo.RemoveUnreferencedBlobs();
+
+	// Assert
+	EXPECT_EQ(2U, removedCount);
+	EXPECT_TRUE(repo.FindBlob(referenced));
+	EXPECT_TRUE(repo.FindBlob(chunk));
+	EXPECT_FALSE(repo.FindBlob(unreferenced));
+	EXPECT_FALSE(repo.FindBlob(unreferencedChunk));
+	EXPECT_TRUE(repo.GetBlobChunks(unreferenced).empty());
+}
+
+TEST_F(BlobInfoRepositoryIntegrationTest, VisitBlobAddresses_Success)
+{
+	// Arrange
+	BlobInfoRepository repo(*_connection);
+	const Address first("cf23df2207d99a74fbe169e3eba035e633b65d94");
+	const Address second("5323df2207d99a74fbe169e3eba035e635779792");
+	repo.AddBlob(BlobInfo(first, 1));
+	repo.AddBlob(BlobInfo(second, 2));
+
+	// Act
+	std::vector<Address> result;
+	repo.VisitBlobAddresses([&](const Address& address) {
+		result.push_back(address);
+	});
+
+	// Assert
+	EXPECT_THAT(result, ::testing::UnorderedElementsAre(first, second));
+	EXPECT_EQ(2U, repo.GetBlobCount());
+}
+
 }
 }
 }
@@ -1,7 +1,11 @@
 #include "bslib/blob/BlobStoreManager.hpp"
+#include "bslib/blob/CachingBlobStore.hpp"
+#include "bslib/blob/CompressedBlobStore.hpp"
 #include "bslib/blob/DirectoryBlobStore.hpp"
 #include "bslib/blob/exceptions.hpp"
 #include "bslib/blob/NullBlobStore.hpp"
+#include "bslib/blob/PackBlobStore.hpp"
+#include "bslib/blob/WriteBehindBlobStore.hpp"
 #include "bslib_test_util/TestBase.hpp"
 
 #include <boost/filesystem.hpp>
@@ -9,6 +13,7 @@
 #include <gmock/gmock.h>
 
 #include <memory>
+#include <vector>
 
 namespace af {
 namespace bslib {
@@ -40,6 +45,40 @@ TEST_F(BlobStoreManagerIntegrationTest, SaveLoad_Success)
 	}
 }
 
+TEST_F(BlobStoreManagerIntegrationTest, SaveLoad_KeepsIds)
+{
+	// Arrange
+	const auto settingsPath = GetUniqueTempPath();
+	BlobStoreManager manager(settingsPath);
+	manager.AddBlobStore(std::make_shared<DirectoryBlobStore>(GetUniqueTempPath()));
+	manager.AddBlobStore(std::make_shared<NullBlobStore>());
+	manager.AddBlobStore(PackBlobStore::TYPE, nlohmann::json{
+		{ "path", GetUniqueTempPath().string() },
+		{ CompressedBlobStore::SETTINGS_KEY, "lz4" }
+	});
+	std::vector<Uuid> ids;
+	for (const auto& store : manager.GetStores())
+	{
+		ids.push_back(store->GetId());
+	}
+
+	// Act
+	manager.SaveToSettingsFile();
+	BlobStoreManager other(settingsPath);
+	other.LoadFromSettingsFile();
+	other.SaveToSettingsFile();
+	BlobStoreManager reloaded(settingsPath);
+	reloaded.LoadFromSettingsFile();
+
+	// Assert
+	const auto& loadedStores = reloaded.GetStores();
+	ASSERT_EQ(ids.size(), loadedStores.size());
+	for (size_t i = 0; i < ids.size(); ++i)
+	{
+		EXPECT_EQ(ids[i], loadedStores[i]->GetId());
+	}
+}
+
 TEST_F(BlobStoreManagerIntegrationTest, SaveToSettingsFile_CreatesPath)
 {
 	// Arrange
@@ -107,6 +146,107 @@ TEST_F(BlobStoreManagerIntegrationTest, RemoveById_NotExistSuccess)
 	ASSERT_EQ(2, stores.size());
 }
 
+TEST_F(BlobStoreManagerIntegrationTest, SaveLoad_PackSuccess)
+{
+	// Arrange
+	const auto settingsPath = GetUniqueTempPath();
+	const auto storePath = GetUniqueTempPath();
+	BlobStoreManager manager(settingsPath);
+	manager.AddBlobStore(std::make_shared<PackBlobStore>(storePath, 1024));
+
+	// Act
+	manager.SaveToSettingsFile();
+
+	// Assert
+	BlobStoreManager other(settingsPath);
+	other.LoadFromSettingsFile();
+	const auto& loadedStores = other.GetStores();
+	ASSERT_EQ(1, loadedStores.size());
+	EXPECT_EQ(PackBlobStore::TYPE, loadedStores[0]->GetTypeString());
+	EXPECT_EQ(1024U, loadedStores[0]->ConvertToJson()["maxPackSizeBytes"].get<uint64_t>());
+}
+
+TEST_F(BlobStoreManagerIntegrationTest, SaveLoad_CompressedSuccess)
+{
+	// Arrange
+	const auto settingsPath = GetUniqueTempPath();
+	const auto storePath = GetUniqueTempPath();
+	BlobStoreManager manager(settingsPath);
+	manager.AddBlobStore(std::make_shared<CompressedBlobStore>(std::make_shared<DirectoryBlobStore>(storePath), "lz4"));
+	manager.SaveToSettingsFile();
+	const std::vector<uint8_t> content(10000, 'a');
+	const auto address = Address::CalculateFromContent(content);
+
+	// Act
+	BlobStoreManager other(settingsPath);
+	other.LoadFromSettingsFile();
+	const auto& loadedStores = other.GetStores();
+	ASSERT_EQ(1, loadedStores.size());
+	loadedStores[0]->CreateBlob(address, content);
+
+	// Assert
+	EXPECT_EQ(DirectoryBlobStore::TYPE, loadedStores[0]->GetTypeString());
+	EXPECT_EQ("lz4", loadedStores[0]->ConvertToJson()[CompressedBlobStore::SETTINGS_KEY].get<std::string>());
+	EXPECT_EQ(content, loadedStores[0]->GetBlob(address));
+	EXPECT_LT(DirectoryBlobStore(storePath).GetBlob(address).size(), content.size());
+}
+
+TEST_F(BlobStoreManagerIntegrationTest, SaveLoad_WriteBehindSuccess)
+{
+	// Arrange
+	const auto settingsPath = GetUniqueTempPath();
+	const auto storePath = GetUniqueTempPath();
+	BlobStoreManager manager(settingsPath);
+	WriteBehindBlobStoreSettings settings;
+	settings.writerThreads = 3;
+	manager.AddBlobStore(std::make_shared<WriteBehindBlobStore>(std::make_shared<DirectoryBlobStore>(storePath), settings));
+	manager.SaveToSettingsFile();
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+
+	// Act
+	BlobStoreManager other(settingsPath);
+	other.LoadFromSettingsFile();
+	const auto& loadedStores = other.GetStores();
+	ASSERT_EQ(1, loadedStores.size());
+	loadedStores[0]->CreateBlob(address, content);
+	loadedStores[0]->Flush();
+
+	// Assert
+	EXPECT_EQ(DirectoryBlobStore::TYPE, loadedStores[0]->GetTypeString());
+	EXPECT_EQ(3U, loadedStores[0]->ConvertToJson()[WriteBehindBlobStore::SETTINGS_KEY]["writerThreads"].get<unsigned>());
+	EXPECT_EQ(content, DirectoryBlobStore(storePath).GetBlob(address));
+}
+
+TEST_F(BlobStoreManagerIntegrationTest, SaveLoad_CachedSuccess)
+{
+	// Arrange
+	const auto settingsPath = GetUniqueTempPath();
+	const auto storePath = GetUniqueTempPath();
+	const auto cachePath = GetUniqueTempPath();
+	BlobStoreManager manager(settingsPath);
+	CachingBlobStoreSettings settings;
+	settings.maxDiskBytes = 1024;
+	settings.diskPath = cachePath;
+	manager.AddBlobStore(std::make_shared<CachingBlobStore>(std::make_shared<DirectoryBlobStore>(storePath), settings));
+	manager.SaveToSettingsFile();
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	DirectoryBlobStore(storePath).CreateBlob(address, content);
+
+	// Act
+	BlobStoreManager other(settingsPath);
+	other.LoadFromSettingsFile();
+	const auto& loadedStores = other.GetStores();
+	ASSERT_EQ(1, loadedStores.size());
+	const auto result = loadedStores[0]->GetBlob(address);
+
+	// Assert
+	EXPECT_EQ(DirectoryBlobStore::TYPE, loadedStores[0]->GetTypeString());
+	EXPECT_EQ(content, result);
+	EXPECT_TRUE(boost::filesystem::exists(cachePath / address.ToString()));
+}
+
 TEST_F(BlobStoreManagerIntegrationTest, AddBlobStore_ThrowsOnInvalidType)
 {
 	// Arrange
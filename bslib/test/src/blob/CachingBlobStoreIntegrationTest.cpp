@@ -0,0 +1,162 @@
+#include "blob/MockBlobStore.hpp"
+#include "bslib/blob/CachingBlobStore.hpp"
+#include "bslib/blob/exceptions.hpp"
+#include "bslib_test_util/TestBase.hpp"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <vector>
+
+using namespace testing;
+
+namespace af {
+namespace bslib {
+namespace blob {
+namespace test {
+
+class CachingBlobStoreIntegrationTest : public bslib_test_util::TestBase
+{
+protected:
+	CachingBlobStoreIntegrationTest()
+		: _inner(std::make_shared<MockBlobStore>())
+	{
+	}
+
+	CachingBlobStoreSettings MakeSettings(uint64_t maxMemoryBytes, uint64_t maxDiskBytes = 0)
+	{
+		CachingBlobStoreSettings settings;
+		settings.maxMemoryBytes = maxMemoryBytes;
+		settings.maxDiskBytes = maxDiskBytes;
+		if (maxDiskBytes > 0)
+		{
+			settings.diskPath = _diskPath;
+		}
+		return settings;
+	}
+
+	std::shared_ptr<MockBlobStore> _inner;
+	const boost::filesystem::path _diskPath = GetUniqueTempPath();
+};
+
+TEST_F(CachingBlobStoreIntegrationTest, GetBlob_SecondReadFromMemory)
+{
+	// Arrange
+	CachingBlobStore store(_inner, MakeSettings(1024));
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	EXPECT_CALL(*_inner, GetBlob(address)).WillOnce(Return(content));
+
+	// Act
+	const auto first = store.GetBlob(address);
+	const auto second = store.GetBlob(address);
+
+	// Assert
+	EXPECT_EQ(content, first);
+	EXPECT_EQ(content, second);
+	const auto stats = store.GetCacheStats();
+	EXPECT_EQ(1U, stats.memoryHits);
+	EXPECT_EQ(1U, stats.misses);
+	EXPECT_EQ(content.size(), stats.memoryBytes);
+}
+
+TEST_F(CachingBlobStoreIntegrationTest, GetBlob_EvictsLeastRecentlyUsed)
+{
+	// Arrange
+	CachingBlobStore store(_inner, MakeSettings(6));
+	const std::vector<uint8_t> a = { 1, 2, 3 };
+	const std::vector<uint8_t> b = { 4, 5, 6 };
+	const std::vector<uint8_t> c = { 7, 8, 9 };
+	EXPECT_CALL(*_inner, GetBlob(Address::CalculateFromContent(a))).WillOnce(Return(a));
+	EXPECT_CALL(*_inner, GetBlob(Address::CalculateFromContent(b))).Times(2).WillRepeatedly(Return(b));
+	EXPECT_CALL(*_inner, GetBlob(Address::CalculateFromContent(c))).WillOnce(Return(c));
+
+	// Act
+	store.GetBlob(Address::CalculateFromContent(a));
+	store.GetBlob(Address::CalculateFromContent(b));
+	store.GetBlob(Address::CalculateFromContent(a));
+	store.GetBlob(Address::CalculateFromContent(c));
+	store.GetBlob(Address::CalculateFromContent(b));
+
+	// Assert
+	const auto stats = store.GetCacheStats();
+	EXPECT_EQ(1U, stats.memoryHits);
+	EXPECT_EQ(4U, stats.misses);
+	EXPECT_EQ(6U, stats.memoryBytes);
+}
+
+TEST_F(CachingBlobStoreIntegrationTest, GetBlob_LargerThanMemoryNotCached)
+{
+	// Arrange
+	CachingBlobStore store(_inner, MakeSettings(2));
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	EXPECT_CALL(*_inner, GetBlob(address)).Times(2).WillRepeatedly(Return(content));
+
+	// Act
+	store.GetBlob(address);
+	const auto result = store.GetBlob(address);
+
+	// Assert
+	EXPECT_EQ(content, result);
+	EXPECT_EQ(0U, store.GetCacheStats().memoryBytes);
+}
+
+TEST_F(CachingBlobStoreIntegrationTest, GetBlob_ReadsFromDiskAfterReopen)
+{
+	// Arrange
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	EXPECT_CALL(*_inner, GetBlob(address)).WillOnce(Return(content));
+	CachingBlobStore(_inner, MakeSettings(1024, 1024)).GetBlob(address);
+	CachingBlobStore store(_inner, MakeSettings(1024, 1024));
+
+	// Act
+	const auto result = store.GetBlob(address);
+
+	// Assert
+	EXPECT_EQ(content, result);
+	const auto stats = store.GetCacheStats();
+	EXPECT_EQ(1U, stats.diskHits);
+	EXPECT_EQ(0U, stats.misses);
+	EXPECT_EQ(content.size(), stats.diskBytes);
+}
+
+TEST_F(CachingBlobStoreIntegrationTest, Constructor_EvictsDiskCacheOverSize)
+{
+	// Arrange
+	const std::vector<uint8_t> a = { 1, 2, 3 };
+	const std::vector<uint8_t> b = { 4, 5, 6 };
+	EXPECT_CALL(*_inner, GetBlob(Address::CalculateFromContent(a))).WillOnce(Return(a));
+	EXPECT_CALL(*_inner, GetBlob(Address::CalculateFromContent(b))).WillOnce(Return(b));
+	{
+		CachingBlobStore store(_inner, MakeSettings(0, 1024));
+		store.GetBlob(Address::CalculateFromContent(a));
+		store.GetBlob(Address::CalculateFromContent(b));
+	}
+
+	// Act
+	CachingBlobStore store(_inner, MakeSettings(0, 3));
+
+	// Assert
+	EXPECT_EQ(3U, store.GetCacheStats().diskBytes);
+}
+
+TEST_F(CachingBlobStoreIntegrationTest, GetBlob_ThrowsIfNotExist)
+{
+	// Arrange
+	CachingBlobStore store(_inner, MakeSettings(1024, 1024));
+	const Address address("cf23df2207d99a74fbe169e3eba035e633b65d94");
+	EXPECT_CALL(*_inner, GetBlob(address)).WillOnce(Throw(BlobReadException(address)));
+
+	// Act
+	// Assert
+	EXPECT_THROW(store.GetBlob(address), BlobReadException);
+	EXPECT_EQ(0U, store.GetCacheStats().diskBytes);
+}
+
+}
+}
+}
+}
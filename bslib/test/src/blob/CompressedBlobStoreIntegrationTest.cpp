@@ -0,0 +1,280 @@
+#include "bslib/blob/CompressedBlobStore.hpp"
+#include "bslib/blob/DirectoryBlobStore.hpp"
+#include "bslib/blob/exceptions.hpp"
+#include "bslib_test_util/TestBase.hpp"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+namespace test {
+
+namespace {
+std::vector<uint8_t> MakeText(size_t lines)
+{
+	std::string text;
+	for (size_t i = 0; i < lines; ++i)
+	{
+		text += "2017-01-01 12:00:00 INFO Backed up file number " + std::to_string(i) + "\n";
+	}
+	return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+std::vector<uint8_t> MakeRandom(size_t sizeBytes)
+{
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<int> distribution(0, 255);
+	std::vector<uint8_t> content(sizeBytes);
+	for (auto& b : content)
+	{
+		b = static_cast<uint8_t>(distribution(generator));
+	}
+	return content;
+}
+}
+
+class CompressedBlobStoreIntegrationTest : public bslib_test_util::TestBase
+{
+protected:
+	CompressedBlobStoreIntegrationTest()
+		: _inner(std::make_shared<DirectoryBlobStore>(GetUniqueTempPath()))
+		, _store(_inner, "lz4")
+	{
+	}
+
+	std::shared_ptr<DirectoryBlobStore> _inner;
+	CompressedBlobStore _store;
+};
+
+TEST_F(CompressedBlobStoreIntegrationTest, CreateBlob_CompressesText)
+{
+	// Arrange
+	const auto content = MakeText(1000);
+	const auto address = Address::CalculateFromContent(content);
+
+	// Act
+	_store.CreateBlob(address, content);
+
+	// Assert
+	EXPECT_EQ(content, _store.GetBlob(address));
+	EXPECT_LT(_inner->GetBlob(address).size(), content.size() / 2);
+}
+
+TEST_F(CompressedBlobStoreIntegrationTest, CreateBlob_StoresRandomContentUncompressed)
+{
+	// Arrange
+	const auto content = MakeRandom(100000);
+	const auto address = Address::CalculateFromContent(content);
+
+	// Act
+	_store.CreateBlob(address, content);
+
+	// Assert
+	EXPECT_EQ(content, _store.GetBlob(address));
+	EXPECT_EQ(content.size() + 13, _inner->GetBlob(address).size());
+}
+
+TEST_F(CompressedBlobStoreIntegrationTest, CreateBlob_EmptySuccess)
+{
+	// Arrange
+	const std::vector<uint8_t> content;
+	const auto address = Address::CalculateFromContent(content);
+
+	// Act
+	_store.CreateBlob(address, content);
+
+	// Assert
+	EXPECT_EQ(content, _store.GetBlob(address));
+}
+
+TEST_F(CompressedBlobStoreIntegrationTest, GetBlob_ReadsBlobsWrittenWithoutCompression)
+{
+	// Arrange
+	const auto content = MakeText(10);
+	const auto address = Address::CalculateFromContent(content);
+	_inner->CreateBlob(address, content);
+
+	// Act
+	const auto result = _store.GetBlob(address);
+
+	// Assert
+	EXPECT_EQ(content, result);
+}
+
+TEST_F(CompressedBlobStoreIntegrationTest, GetBlobView_Success)
+{
+	// Arrange
+	const auto text = MakeText(1000);
+	const auto random = MakeRandom(100000);
+	_store.CreateBlob(Address::CalculateFromContent(text), text);
+	_store.CreateBlob(Address::CalculateFromContent(random), random);
+
+	// Act
+	const auto textResult = _store.GetBlobView(Address::CalculateFromContent(text));
+	const auto randomResult = _store.GetBlobView(Address::CalculateFromContent(random));
+
+	// Assert
+	EXPECT_EQ(text, textResult.ToVector());
+	EXPECT_EQ(random, randomResult.ToVector());
+}
+
+TEST_F(CompressedBlobStoreIntegrationTest, GetBlob_ThrowsIfCorrupt)
+{
+	// Arrange
+	const auto content = MakeText(1000);
+	const auto address = Address::CalculateFromContent(content);
+	auto stored = CompressedBlobStore::Encode(content, CompressionCodec::Lz4);
+	stored.resize(stored.size() - 10);
+	_inner->CreateBlob(address, stored);
+
+	// Act
+	// Assert
+	EXPECT_THROW(_store.GetBlob(address), BlobReadException);
+}
+
+TEST_F(CompressedBlobStoreIntegrationTest, CreateBlobWriter_StreamsLargeBlobInChunks)
+{
+	// Arrange
+	auto content = MakeText(40000);
+	const auto random = MakeRandom(1500000);
+	content.insert(content.end(), random.begin(), random.end());
+	const auto address = Address::CalculateFromContent(content);
+	auto writer = _store.CreateBlobWriter();
+
+	// Act
+	for (size_t offset = 0; offset < content.size(); offset += 65536)
+	{
+		writer->Write(&content[offset], std::min<size_t>(65536, content.size() - offset));
+	}
+	writer->Commit(address);
+
+	// Assert
+	EXPECT_EQ(content, _store.GetBlob(address));
+	EXPECT_EQ(content, _store.GetBlobView(address).ToVector());
+	EXPECT_LT(_inner->GetBlob(address).size(), content.size() - MakeText(40000).size() / 2);
+	EXPECT_EQ(content.size(), _store.GetStats().contentBytes);
+	EXPECT_EQ(_inner->GetBlob(address).size(), _store.GetStats().storedBytes);
+}
+
+TEST_F(CompressedBlobStoreIntegrationTest, CreateBlobWriter_SmallBlobFramedAsCreateBlob)
+{
+	// Arrange
+	const auto content = MakeText(1000);
+	const auto address = Address::CalculateFromContent(content);
+	auto writer = _store.CreateBlobWriter();
+
+	// Act
+	writer->Write(content.data(), content.size());
+	writer->Commit(address);
+
+	// Assert
+	EXPECT_EQ(CompressedBlobStore::Encode(content, CompressionCodec::Lz4), _inner->GetBlob(address));
+	EXPECT_EQ(content, _store.GetBlob(address));
+}
+
+TEST_F(CompressedBlobStoreIntegrationTest, GetBlob_ThrowsIfChunkCorrupt)
+{
+	// Arrange
+	const auto content = MakeText(40000);
+	const auto address = Address::CalculateFromContent(content);
+	auto writer = _store.CreateBlobWriter();
+	writer->Write(content.data(), content.size());
+	writer->Commit(address);
+	auto stored = _inner->GetBlob(address);
+	stored.resize(stored.size() - 10);
+	_inner->CreateBlob(address, stored);
+
+	// Act
+	// Assert
+	EXPECT_THROW(_store.GetBlob(address), BlobReadException);
+}
+
+TEST_F(CompressedBlobStoreIntegrationTest, GetStats_Success)
+{
+	// Arrange
+	const auto text = MakeText(1000);
+	const auto random = MakeRandom(1000);
+
+	// Act
+	_store.CreateBlob(Address::CalculateFromContent(text), text);
+	_store.CreateBlob(Address::CalculateFromContent(random), random);
+	const auto stats = _store.GetStats();
+
+	// Assert
+	EXPECT_EQ(2U, stats.blobsCreated);
+	EXPECT_EQ(text.size() + random.size(), stats.contentBytes);
+	EXPECT_LT(stats.storedBytes, stats.contentBytes);
+	EXPECT_GT(stats.GetCompressionRatio(), 1.0);
+}
+
+TEST_F(CompressedBlobStoreIntegrationTest, ConvertToJson_IncludesCodec)
+{
+	// Arrange
+	// Act
+	const auto json = _store.ConvertToJson();
+
+	// Assert
+	EXPECT_EQ("lz4", json[CompressedBlobStore::SETTINGS_KEY].get<std::string>());
+	EXPECT_EQ(_inner->ConvertToJson()["path"], json["path"]);
+	EXPECT_EQ(DirectoryBlobStore::TYPE, _store.GetTypeString());
+}
+
+TEST_F(CompressedBlobStoreIntegrationTest, Ctor_ThrowsOnInvalidCodec)
+{
+	// Arrange
+	// Act
+	// Assert
+	EXPECT_THROW(CompressedBlobStore(_inner, "nope"), InvalidCompressionCodecException);
+}
+
+TEST_F(CompressedBlobStoreIntegrationTest, EncodeDecode_RoundTrips)
+{
+	// Arrange
+	std::vector<std::vector<uint8_t>> contents = {
+		std::vector<uint8_t>(),
+		std::vector<uint8_t>(1, 7),
+		std::vector<uint8_t>(100000, 0),
+		MakeText(1),
+		MakeText(5000),
+		MakeRandom(12),
+		MakeRandom(70000)
+	};
+
+	for (const auto& content : contents)
+	{
+		// Act
+		std::vector<uint8_t> decoded;
+		const auto decodeResult = CompressedBlobStore::Decode(CompressedBlobStore::Encode(content, CompressionCodec::Lz4), decoded);
+
+		// Assert
+		EXPECT_TRUE(decodeResult);
+		EXPECT_EQ(content, decoded);
+	}
+}
+
+TEST_F(CompressedBlobStoreIntegrationTest, EstimateEntropyBitsPerByte_Success)
+{
+	// Arrange
+	const auto text = MakeText(1000);
+	const auto random = MakeRandom(100000);
+	const std::vector<uint8_t> zeros(1000, 0);
+
+	// Act
+	// Assert
+	EXPECT_LT(CompressedBlobStore::EstimateEntropyBitsPerByte(&text[0], text.size()), 6.0);
+	EXPECT_GT(CompressedBlobStore::EstimateEntropyBitsPerByte(&random[0], random.size()), 7.9);
+	EXPECT_DOUBLE_EQ(0.0, CompressedBlobStore::EstimateEntropyBitsPerByte(&zeros[0], zeros.size()));
+}
+
+}
+}
+}
+}
@@ -0,0 +1,135 @@
+#include "bslib/blob/Address.hpp"
+#include "bslib/blob/ContentChunker.hpp"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+namespace test {
+
+namespace {
+std::vector<uint8_t> CreateRandomContent(size_t sizeBytes)
+{
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<int> distribution(0, 255);
+	std::vector<uint8_t> result(sizeBytes);
+	std::generate(result.begin(), result.end(), [&]() { return static_cast<uint8_t>(distribution(generator)); });
+	return result;
+}
+
+std::vector<std::vector<uint8_t>> Split(ContentChunker& chunker, const std::vector<uint8_t>& content, size_t feedSizeBytes)
+{
+	std::vector<std::vector<uint8_t>> result(1);
+	for (size_t offset = 0; offset < content.size(); offset += feedSizeBytes)
+	{
+		auto data = &content[offset];
+		auto remaining = std::min(feedSizeBytes, content.size() - offset);
+		while (remaining > 0)
+		{
+			const auto chunkBytes = chunker.Next(data, remaining);
+			result.back().insert(result.back().end(), data, data + chunkBytes);
+			data += chunkBytes;
+			remaining -= chunkBytes;
+			if (chunker.IsChunkComplete())
+			{
+				result.emplace_back();
+			}
+		}
+	}
+
+	if (result.back().empty())
+	{
+		result.pop_back();
+	}
+	return result;
+}
+
+std::set<Address> GetAddresses(const std::vector<std::vector<uint8_t>>& chunks)
+{
+	std::set<Address> result;
+	for (const auto& chunk : chunks)
+	{
+		result.insert(Address::CalculateFromContent(chunk));
+	}
+	return result;
+}
+}
+
+TEST(ContentChunkerTest, CtorThrowsOnInvalidSizes)
+{
+	// Arrange
+	// Act
+	// Assert
+	EXPECT_THROW(ContentChunker(1024, 3000, 8192), InvalidChunkSizeException);
+	EXPECT_THROW(ContentChunker(8192, 4096, 16384), InvalidChunkSizeException);
+	EXPECT_THROW(ContentChunker(1024, 4096, 2048), InvalidChunkSizeException);
+	EXPECT_THROW(ContentChunker(0, 4096, 16384), InvalidChunkSizeException);
+}
+
+TEST(ContentChunkerTest, ChunksAreWithinBounds)
+{
+	// Arrange
+	const auto content = CreateRandomContent(1024 * 1024);
+	ContentChunker chunker(1024, 4096, 16384);
+
+	// Act
+	const auto chunks = Split(chunker, content, 10000);
+
+	// Assert
+	ASSERT_GT(chunks.size(), 1U);
+	for (auto i = 0U; i < chunks.size() - 1; ++i)
+	{
+		EXPECT_GE(chunks[i].size(), 1024U);
+		EXPECT_LE(chunks[i].size(), 16384U);
+	}
+	EXPECT_LE(chunks.back().size(), 16384U);
+}
+
+TEST(ContentChunkerTest, BoundariesDoNotDependOnFeedSize)
+{
+	// Arrange
+	const auto content = CreateRandomContent(256 * 1024);
+	ContentChunker chunker1(1024, 4096, 16384);
+	ContentChunker chunker2(1024, 4096, 16384);
+
+	// Act
+	const auto chunks1 = Split(chunker1, content, content.size());
+	const auto chunks2 = Split(chunker2, content, 333);
+
+	// Assert
+	EXPECT_EQ(chunks1, chunks2);
+}
+
+TEST(ContentChunkerTest, InsertOnlyChangesNearbyChunks)
+{
+	// Arrange
+	const auto content = CreateRandomContent(1024 * 1024);
+	auto modifiedContent = content;
+	modifiedContent.insert(modifiedContent.begin() + 1000, 100, 0x42);
+	ContentChunker chunker1(1024, 4096, 16384);
+	ContentChunker chunker2(1024, 4096, 16384);
+
+	// Act
+	const auto addresses = GetAddresses(Split(chunker1, content, 65536));
+	const auto modifiedAddresses = GetAddresses(Split(chunker2, modifiedContent, 65536));
+
+	// Assert
+	std::vector<Address> changedAddresses;
+	std::set_difference(
+		modifiedAddresses.begin(), modifiedAddresses.end(),
+		addresses.begin(), addresses.end(),
+		std::back_inserter(changedAddresses));
+	EXPECT_LE(changedAddresses.size(), 2U);
+}
+
+}
+}
+}
+}
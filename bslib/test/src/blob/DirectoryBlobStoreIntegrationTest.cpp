@@ -6,6 +6,8 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <algorithm>
+#include <iterator>
 #include <memory>
 
 namespace af {
@@ -13,6 +15,16 @@ namespace bslib {
 namespace blob {
 namespace test {
 
+namespace {
+long CountBlobEntries(const boost::filesystem::path& path)
+{
+	return static_cast<long>(std::count_if(
+		boost::filesystem::directory_iterator(path),
+		boost::filesystem::directory_iterator(),
+		[](const auto& entry) { return entry.path().filename() != DirectoryBlobStore::LAYOUT_FILENAME; }));
+}
+}
+
 class DirectoryBlobStoreIntegrationTest : public bslib_test_util::TestBase
 {
 };
@@ -132,6 +144,181 @@ TEST_F(DirectoryBlobStoreIntegrationTest, CreateNamedBlobThrowsErrorIfFails)
 	EXPECT_THROW(store.CreateNamedBlob("backup.db", sourcePath), CreateBlobFailed);
 }
 
+TEST_F(DirectoryBlobStoreIntegrationTest, BlobWriter_Commit)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	DirectoryBlobStore store(path);
+
+	const std::vector<uint8_t> content = {
+		1, 2, 3, 4, 4, 5, 3, 2, 1
+	};
+	const auto address = Address::CalculateFromContent(content);
+	auto writer = store.CreateBlobWriter();
+
+	// Act
+	writer->Write(&content[0], 4);
+	writer->Write(&content[4], content.size() - 4);
+	writer->Commit(address);
+	writer.reset();
+
+	// Assert
+	EXPECT_EQ(content, store.GetBlob(address));
+	EXPECT_EQ(1, CountBlobEntries(path));
+	EXPECT_TRUE(boost::filesystem::exists(DirectoryBlobStore::GetBlobPath(path, address, store.GetFanOutDepth())));
+}
+
+TEST_F(DirectoryBlobStoreIntegrationTest, BlobWriter_DiscardedIfNotCommitted)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	DirectoryBlobStore store(path);
+
+	const std::vector<uint8_t> content = {
+		1, 2, 3, 4, 4, 5, 3, 2, 1
+	};
+	const auto address = Address::CalculateFromContent(content);
+	auto writer = store.CreateBlobWriter();
+	writer->Write(&content[0], content.size());
+
+	// Act
+	writer.reset();
+
+	// Assert
+	EXPECT_THROW(store.GetBlob(address), BlobReadException);
+	EXPECT_EQ(0, CountBlobEntries(path));
+}
+
+TEST_F(DirectoryBlobStoreIntegrationTest, CreateBlob_FansOutByAddress)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	DirectoryBlobStore store(path, 2);
+	const std::vector<uint8_t> content = {
+		1, 2, 3, 4, 4, 5, 3, 2, 1
+	};
+	const auto address = Address::CalculateFromContent(content);
+	const auto stringAddress = address.ToString();
+
+	// Act
+	store.CreateBlob(address, content);
+
+	// Assert
+	EXPECT_TRUE(boost::filesystem::exists(path / stringAddress.substr(0, 2) / stringAddress.substr(2, 2) / stringAddress));
+	EXPECT_EQ(content, store.GetBlob(address));
+}
+
+TEST_F(DirectoryBlobStoreIntegrationTest, CreateBlob_FlatWithoutFanOut)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	DirectoryBlobStore store(path, 0);
+	const std::vector<uint8_t> content = {
+		1, 2, 3, 4, 4, 5, 3, 2, 1
+	};
+	const auto address = Address::CalculateFromContent(content);
+
+	// Act
+	store.CreateBlob(address, content);
+
+	// Assert
+	EXPECT_TRUE(boost::filesystem::exists(path / address.ToString()));
+	EXPECT_EQ(content, store.GetBlob(address));
+}
+
+TEST_F(DirectoryBlobStoreIntegrationTest, Open_MovesBlobsToNewLayout)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	const auto sourcePath = GetUniqueTempPath();
+	WriteFile(sourcePath, "hello");
+	std::vector<std::vector<uint8_t>> contents;
+	{
+		DirectoryBlobStore store(path, 0);
+		for (uint8_t i = 0; i < 50; ++i)
+		{
+			contents.push_back({ i, 1, 2, 3 });
+			store.CreateBlob(Address::CalculateFromContent(contents.back()), contents.back());
+		}
+		store.CreateNamedBlob("backup.db", sourcePath);
+	}
+
+	// Act
+	DirectoryBlobStore store(path, 2);
+	for (const auto& content : contents)
+	{
+		EXPECT_EQ(content, store.GetBlob(Address::CalculateFromContent(content)));
+	}
+	store.WaitForMigration();
+
+	// Assert
+	EXPECT_FALSE(store.IsMigrating());
+	for (const auto& content : contents)
+	{
+		const auto address = Address::CalculateFromContent(content);
+		EXPECT_TRUE(boost::filesystem::exists(DirectoryBlobStore::GetBlobPath(path, address, 2)));
+		EXPECT_FALSE(boost::filesystem::exists(path / address.ToString()));
+		EXPECT_EQ(content, store.GetBlob(address));
+	}
+	EXPECT_TRUE(boost::filesystem::exists(path / "backup.db"));
+}
+
+TEST_F(DirectoryBlobStoreIntegrationTest, Open_MovesBlobsWrittenBeforeLayoutWasRecorded)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	const std::vector<uint8_t> content = {
+		1, 2, 3, 4, 4, 5, 3, 2, 1
+	};
+	const auto address = Address::CalculateFromContent(content);
+	boost::filesystem::create_directories(path);
+	WriteFile(path / address.ToString(), "\x01\x02\x03\x04\x04\x05\x03\x02\x01");
+
+	// Act
+	DirectoryBlobStore store(path, 1);
+	store.WaitForMigration();
+
+	// Assert
+	EXPECT_TRUE(boost::filesystem::exists(path / address.ToString().substr(0, 2) / address.ToString()));
+	EXPECT_EQ(content, store.GetBlob(address));
+}
+
+TEST_F(DirectoryBlobStoreIntegrationTest, Open_NewStoreNeedsNoMigration)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+
+	// Act
+	DirectoryBlobStore store(path, 3);
+
+	// Assert
+	EXPECT_FALSE(store.IsMigrating());
+	EXPECT_TRUE(boost::filesystem::exists(path / DirectoryBlobStore::LAYOUT_FILENAME));
+}
+
+TEST_F(DirectoryBlobStoreIntegrationTest, CtorThrowsIfFanOutTooDeep)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+
+	// Act
+	// Assert
+	EXPECT_THROW(DirectoryBlobStore store(path, DirectoryBlobStore::MAX_FAN_OUT_DEPTH + 1), DirectoryBlobCreationFailed);
+}
+
+TEST_F(DirectoryBlobStoreIntegrationTest, ConvertToJson_IncludesFanOutDepth)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	DirectoryBlobStore store(path, 3);
+
+	// Act
+	const auto json = store.ConvertToJson();
+
+	// Assert
+	EXPECT_EQ(3U, json["fanOutDepth"].get<unsigned>());
+}
+
 TEST_F(DirectoryBlobStoreIntegrationTest, GetBlobThrowsIfNotExist)
 {
 	// Arrange
@@ -149,6 +336,96 @@ TEST_F(DirectoryBlobStoreIntegrationTest, GetBlobThrowsIfNotExist)
 	EXPECT_THROW(store.GetBlob(address), BlobReadException);
 }
 
+TEST_F(DirectoryBlobStoreIntegrationTest, GetBlobView_SmallBlobSuccess)
+{
+	// Arrange
+	DirectoryBlobStore store(GetUniqueTempPath());
+	const std::vector<uint8_t> content = { 1, 2, 3, 4, 4, 5, 3, 2, 1 };
+	const auto address = Address::CalculateFromContent(content);
+	store.CreateBlob(address, content);
+
+	// Act
+	const auto result = store.GetBlobView(address);
+
+	// Assert
+	EXPECT_EQ(content, result.ToVector());
+}
+
+TEST_F(DirectoryBlobStoreIntegrationTest, GetBlobView_MappedBlobOutlivesStore)
+{
+	// Arrange
+	std::vector<uint8_t> content(1024 * 1024);
+	for (size_t i = 0; i < content.size(); ++i)
+	{
+		content[i] = static_cast<uint8_t>(i % 251);
+	}
+	const auto address = Address::CalculateFromContent(content);
+	BlobView result;
+
+	// Act
+	{
+		DirectoryBlobStore store(GetUniqueTempPath());
+		store.CreateBlob(address, content);
+		result = store.GetBlobView(address);
+	}
+
+	// Assert
+	ASSERT_EQ(content.size(), result.GetSizeBytes());
+	EXPECT_TRUE(std::equal(content.begin(), content.end(), result.begin()));
+}
+
+TEST_F(DirectoryBlobStoreIntegrationTest, GetBlobView_ThrowsIfNotExist)
+{
+	// Arrange
+	DirectoryBlobStore store(GetUniqueTempPath());
+	const Address address("1234a123451234b123451234a123451234b12345");
+
+	// Act
+	// Assert
+	EXPECT_THROW(store.GetBlobView(address), BlobReadException);
+}
+
+TEST_F(DirectoryBlobStoreIntegrationTest, ListBlobs_SkipsNamedBlobs)
+{
+	// Arrange
+	DirectoryBlobStore store(GetUniqueTempPath());
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	store.CreateBlob(address, content);
+	const auto sourcePath = GetUniqueTempPath();
+	WriteFile(sourcePath, "hi");
+	store.CreateNamedBlob("backup.db", sourcePath);
+
+	// Act
+	std::vector<StoredBlob> result;
+	const auto listed = store.ListBlobs([&](const StoredBlob& blob) {
+		result.push_back(blob);
+	});
+
+	// Assert
+	EXPECT_TRUE(listed);
+	ASSERT_EQ(1U, result.size());
+	EXPECT_EQ(address, result[0].address);
+	EXPECT_EQ(content.size(), result[0].sizeBytes);
+	EXPECT_FALSE(result[0].lastWriteUtc.is_not_a_date_time());
+}
+
+TEST_F(DirectoryBlobStoreIntegrationTest, DeleteBlob_Success)
+{
+	// Arrange
+	DirectoryBlobStore store(GetUniqueTempPath());
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	store.CreateBlob(address, content);
+
+	// Act
+	store.DeleteBlob(address);
+
+	// Assert
+	EXPECT_THROW(store.GetBlob(address), BlobReadException);
+	EXPECT_NO_THROW(store.DeleteBlob(address));
+}
+
 }
 }
 }
@@ -0,0 +1,409 @@
+#include "blob/FakeObjectStore.hpp"
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+
+#include <algorithm>
+#include <istream>
+#include <set>
+#include <sstream>
+
+namespace af {
+namespace bslib {
+namespace blob {
+namespace test {
+
+namespace {
+std::string UriDecode(const std::string& value)
+{
+	std::string result;
+	for (size_t i = 0; i < value.size(); ++i)
+	{
+		if (value[i] == '%' && i + 2 < value.size())
+		{
+			result += static_cast<char>(std::stoi(value.substr(i + 1, 2), nullptr, 16));
+			i += 2;
+		}
+		else
+		{
+			result += value[i];
+		}
+	}
+	return result;
+}
+
+std::string GetStatusText(unsigned status)
+{
+	switch (status)
+	{
+		case 200:
+			return "OK";
+		case 204:
+			return "No Content";
+		case 400:
+			return "Bad Request";
+		case 404:
+			return "Not Found";
+	}
+	return "Error";
+}
+}
+
+FakeObjectStore::FakeObjectStore()
+	: requestsToStall(0)
+	, responsesToMalform(0)
+	, connectionsAccepted(0)
+	, requestsReceived(0)
+	, maxConcurrentRequests(0)
+	, multipartUploadsCompleted(0)
+	, multipartUploadsAborted(0)
+	, requestsAuthorized(0)
+	, _acceptor(_ioService, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0))
+	, _stopping(false)
+	, _activeRequests(0)
+	, _nextUploadId(1)
+{
+	_acceptThread = std::thread(&FakeObjectStore::Accept, this);
+}
+
+FakeObjectStore::~FakeObjectStore()
+{
+	_stopping = true;
+
+	// Accepting doesn't stop when the acceptor is closed on another thread, so it's woken with a connection
+	{
+		boost::system::error_code ec;
+		boost::asio::ip::tcp::socket wake(_ioService);
+		wake.connect(_acceptor.local_endpoint(), ec);
+		_acceptThread.join();
+	}
+
+	std::vector<std::thread> connectionThreads;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		for (auto& socket : _sockets)
+		{
+			boost::system::error_code ec;
+			socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+		}
+		connectionThreads.swap(_connectionThreads);
+	}
+	for (auto& thread : connectionThreads)
+	{
+		thread.join();
+	}
+}
+
+std::string FakeObjectStore::GetEndpoint() const
+{
+	return "127.0.0.1:" + std::to_string(_acceptor.local_endpoint().port());
+}
+
+std::map<std::string, std::vector<uint8_t>> FakeObjectStore::GetObjects(const std::string& bucket) const
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	const auto objects = _buckets.find(bucket);
+	return objects == _buckets.end() ? std::map<std::string, std::vector<uint8_t>>() : objects->second;
+}
+
+void FakeObjectStore::Accept()
+{
+	while (true)
+	{
+		auto socket = std::make_shared<boost::asio::ip::tcp::socket>(_ioService);
+		boost::system::error_code ec;
+		_acceptor.accept(*socket, ec);
+		if (_stopping)
+		{
+			return;
+		}
+		if (ec)
+		{
+			continue;
+		}
+
+		++connectionsAccepted;
+		std::unique_lock<std::mutex> lock(_mutex);
+		_sockets.push_back(socket);
+		_connectionThreads.emplace_back(&FakeObjectStore::Serve, this, socket);
+	}
+}
+
+void FakeObjectStore::Serve(std::shared_ptr<boost::asio::ip::tcp::socket> socket)
+{
+	boost::asio::streambuf buffer;
+	std::istream stream(&buffer);
+	while (!_stopping)
+	{
+		boost::system::error_code ec;
+		boost::asio::read_until(*socket, buffer, "\r\n\r\n", ec);
+		if (ec)
+		{
+			return;
+		}
+
+		Request request;
+		std::string line;
+		std::getline(stream, line);
+		std::istringstream requestLine(line);
+		std::string target;
+		requestLine >> request.method >> target;
+
+		while (std::getline(stream, line) && line != "\r")
+		{
+			const auto colon = line.find(':');
+			if (colon != std::string::npos)
+			{
+				request.headers[boost::to_lower_copy(line.substr(0, colon))] = boost::trim_copy(line.substr(colon + 1));
+			}
+		}
+
+		const auto contentLength = request.headers.find("content-length");
+		if (contentLength != request.headers.end())
+		{
+			const auto size = std::stoull(contentLength->second);
+			if (buffer.size() < size)
+			{
+				boost::asio::read(*socket, buffer, boost::asio::transfer_at_least(size - buffer.size()), ec);
+				if (ec)
+				{
+					return;
+				}
+			}
+			request.body.resize(size);
+			stream.read(reinterpret_cast<char*>(request.body.data()), size);
+		}
+
+		const auto queryStart = target.find('?');
+		const auto path = target.substr(1, queryStart == std::string::npos ? std::string::npos : queryStart - 1);
+		const auto slash = path.find('/');
+		request.bucket = UriDecode(path.substr(0, slash));
+		request.key = slash == std::string::npos ? std::string() : UriDecode(path.substr(slash + 1));
+		if (queryStart != std::string::npos)
+		{
+			std::istringstream query(target.substr(queryStart + 1));
+			std::string parameter;
+			while (std::getline(query, parameter, '&'))
+			{
+				const auto equals = parameter.find('=');
+				request.query[UriDecode(parameter.substr(0, equals))] =
+					equals == std::string::npos ? std::string() : UriDecode(parameter.substr(equals + 1));
+			}
+		}
+
+		++requestsReceived;
+		if (request.headers.count("authorization") > 0)
+		{
+			++requestsAuthorized;
+		}
+		const auto active = ++_activeRequests;
+		auto max = maxConcurrentRequests.load();
+		while (active > max && !maxConcurrentRequests.compare_exchange_weak(max, active))
+		{
+		}
+		std::this_thread::sleep_for(latency);
+		auto toStall = requestsToStall.load();
+		while (toStall > 0 && !requestsToStall.compare_exchange_weak(toStall, toStall - 1))
+		{
+		}
+		if (toStall > 0)
+		{
+			std::this_thread::sleep_for(stall);
+		}
+		auto response = Handle(request);
+		--_activeRequests;
+		auto toMalform = responsesToMalform.load();
+		while (toMalform > 0 && !responsesToMalform.compare_exchange_weak(toMalform, toMalform - 1))
+		{
+		}
+		if (toMalform > 0)
+		{
+			response.headers["Content-Length"] = "many";
+		}
+
+		std::ostringstream header;
+		header << "HTTP/1.1 " << response.status << " " << GetStatusText(response.status) << "\r\n";
+		if (response.headers.count("Content-Length") == 0)
+		{
+			header << "Content-Length: " << response.body.size() << "\r\n";
+		}
+		for (const auto& field : response.headers)
+		{
+			header << field.first << ": " << field.second << "\r\n";
+		}
+		header << "\r\n";
+		if (request.method != "HEAD")
+		{
+			header << response.body;
+		}
+		boost::asio::write(*socket, boost::asio::buffer(header.str()), ec);
+		if (ec)
+		{
+			return;
+		}
+	}
+}
+
+FakeObjectStore::Response FakeObjectStore::Handle(const Request& request)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	Response response;
+	auto& objects = _buckets[request.bucket];
+	const auto uploadId = request.query.find("uploadId");
+
+	if (request.key.empty() && request.method == "GET")
+	{
+		lock.unlock();
+		return List(request);
+	}
+	else if (request.method == "POST" && request.query.count("uploads") > 0)
+	{
+		const auto id = std::to_string(_nextUploadId++);
+		_uploads[id] = Upload{ request.bucket, request.key, {} };
+		response.body = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			"<InitiateMultipartUploadResult xmlns=\"http://s3.amazonaws.com/doc/2006-03-01/\">"
+			"<Bucket>" + request.bucket + "</Bucket><Key>" + request.key + "</Key><UploadId>" + id + "</UploadId>"
+			"</InitiateMultipartUploadResult>";
+	}
+	else if (uploadId != request.query.end() && _uploads.count(uploadId->second) == 0)
+	{
+		response.status = 404;
+		response.body = "<Error><Code>NoSuchUpload</Code></Error>";
+	}
+	else if (request.method == "PUT" && uploadId != request.query.end())
+	{
+		const auto partNumber = std::stoul(request.query.at("partNumber"));
+		_uploads[uploadId->second].parts[partNumber] = request.body;
+		response.headers["ETag"] = "\"part" + std::to_string(partNumber) + "\"";
+	}
+	else if (request.method == "POST" && uploadId != request.query.end())
+	{
+		const auto upload = _uploads[uploadId->second];
+		std::vector<uint8_t> content;
+		for (const auto& part : upload.parts)
+		{
+			const auto etag = "<ETag>\"part" + std::to_string(part.first) + "\"</ETag>";
+			if (std::string(request.body.begin(), request.body.end()).find(etag) == std::string::npos)
+			{
+				response.body = "<Error><Code>InvalidPart</Code></Error>";
+				return response;
+			}
+			content.insert(content.end(), part.second.begin(), part.second.end());
+		}
+		objects[upload.key] = content;
+		_uploads.erase(uploadId->second);
+		++multipartUploadsCompleted;
+		response.body = "<CompleteMultipartUploadResult><Key>" + upload.key + "</Key></CompleteMultipartUploadResult>";
+	}
+	else if (request.method == "DELETE" && uploadId != request.query.end())
+	{
+		_uploads.erase(uploadId->second);
+		++multipartUploadsAborted;
+		response.status = 204;
+	}
+	else if (request.method == "PUT")
+	{
+		objects[request.key] = request.body;
+		response.headers["ETag"] = "\"object\"";
+	}
+	else if (request.method == "DELETE")
+	{
+		objects.erase(request.key);
+		response.status = 204;
+	}
+	else if (request.method == "GET" || request.method == "HEAD")
+	{
+		const auto object = objects.find(request.key);
+		if (object == objects.end())
+		{
+			response.status = 404;
+			response.body = "<Error><Code>NoSuchKey</Code></Error>";
+		}
+		else if (request.method == "HEAD")
+		{
+			response.headers["Content-Length"] = std::to_string(object->second.size());
+		}
+		else
+		{
+			response.body.assign(object->second.begin(), object->second.end());
+		}
+	}
+	else
+	{
+		response.status = 400;
+	}
+	return response;
+}
+
+FakeObjectStore::Response FakeObjectStore::List(const Request& request)
+{
+	const auto prefix = request.query.count("prefix") > 0 ? request.query.at("prefix") : std::string();
+	const auto delimiter = request.query.count("delimiter") > 0 ? request.query.at("delimiter") : std::string();
+	const auto after = request.query.count("continuation-token") > 0 ? request.query.at("continuation-token") : std::string();
+	const auto objects = GetObjects(request.bucket);
+
+	std::ostringstream contents;
+	std::set<std::string> commonPrefixes;
+	unsigned count = 0;
+	std::string lastKey;
+	bool truncated = false;
+	for (auto object = objects.upper_bound(after); object != objects.end(); ++object)
+	{
+		if (!boost::starts_with(object->first, prefix))
+		{
+			continue;
+		}
+		if (count == maxKeys)
+		{
+			truncated = true;
+			break;
+		}
+
+		const auto rest = object->first.substr(prefix.size());
+		const auto delimiterPosition = delimiter.empty() ? std::string::npos : rest.find(delimiter);
+		if (delimiterPosition != std::string::npos)
+		{
+			commonPrefixes.insert(prefix + rest.substr(0, delimiterPosition + delimiter.size()));
+		}
+		else
+		{
+			contents << "<Contents><Key>" << object->first << "</Key>"
+				<< "<LastModified>2026-01-02T03:04:05.000Z</LastModified>"
+				<< "<ETag>\"object\"</ETag><Size>" << object->second.size() << "</Size>"
+				<< "<StorageClass>STANDARD</StorageClass></Contents>";
+		}
+		++count;
+		lastKey = object->first;
+	}
+
+	Response response;
+	std::ostringstream body;
+	body << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		<< "<ListBucketResult xmlns=\"http://s3.amazonaws.com/doc/2006-03-01/\">"
+		<< "<Name>" << request.bucket << "</Name><Prefix>" << prefix << "</Prefix>"
+		<< "<KeyCount>" << count << "</KeyCount><MaxKeys>" << maxKeys << "</MaxKeys>"
+		<< "<IsTruncated>" << (truncated ? "true" : "false") << "</IsTruncated>"
+		<< contents.str();
+	for (const auto& commonPrefix : commonPrefixes)
+	{
+		body << "<CommonPrefixes><Prefix>" << commonPrefix << "</Prefix></CommonPrefixes>";
+	}
+	if (truncated)
+	{
+		body << "<NextContinuationToken>" << lastKey << "</NextContinuationToken>";
+	}
+	body << "</ListBucketResult>";
+	response.body = body.str();
+	return response;
+}
+
+}
+}
+}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/core/noncopyable.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+namespace test {
+
+/**
+ * An S3 compatible object store on a local port, holding objects in memory, for testing stores against without a
+ * server. Supports the requests S3BlobStore makes, and doesn't check signatures.
+ */
+class FakeObjectStore : private boost::noncopyable
+{
+public:
+	/**
+	 * Starts listening on a free port
+	 */
+	FakeObjectStore();
+	~FakeObjectStore();
+
+	/**
+	 * Gets the host and port to connect to
+	 */
+	std::string GetEndpoint() const;
+
+	std::map<std::string, std::vector<uint8_t>> GetObjects(const std::string& bucket) const;
+
+	// Each request waits this long before it's answered, so requests overlap as they would over a network
+	std::chrono::milliseconds latency = std::chrono::milliseconds(0);
+
+	// The next this many requests wait for the stall before they're answered, so they time out
+	std::atomic<unsigned> requestsToStall;
+	std::chrono::milliseconds stall = std::chrono::milliseconds(0);
+
+	// The next this many responses have a Content-Length that isn't a number
+	std::atomic<unsigned> responsesToMalform;
+
+	// Keys listed a page
+	unsigned maxKeys = 1000;
+
+	std::atomic<unsigned> connectionsAccepted;
+	std::atomic<unsigned> requestsReceived;
+	std::atomic<unsigned> maxConcurrentRequests;
+	std::atomic<unsigned> multipartUploadsCompleted;
+	std::atomic<unsigned> multipartUploadsAborted;
+
+	// Requests that were signed
+	std::atomic<unsigned> requestsAuthorized;
+private:
+	struct Request
+	{
+		std::string method;
+		std::string bucket;
+		std::string key;
+		std::map<std::string, std::string> query;
+		std::map<std::string, std::string> headers;
+		std::vector<uint8_t> body;
+	};
+
+	struct Response
+	{
+		unsigned status = 200;
+		std::map<std::string, std::string> headers;
+		std::string body;
+	};
+
+	struct Upload
+	{
+		std::string bucket;
+		std::string key;
+		std::map<unsigned, std::vector<uint8_t>> parts;
+	};
+
+	void Accept();
+	void Serve(std::shared_ptr<boost::asio::ip::tcp::socket> socket);
+	Response Handle(const Request& request);
+	Response List(const Request& request);
+
+	boost::asio::io_service _ioService;
+	boost::asio::ip::tcp::acceptor _acceptor;
+	std::atomic_bool _stopping;
+	std::atomic<unsigned> _activeRequests;
+	std::thread _acceptThread;
+
+	mutable std::mutex _mutex;
+	std::map<std::string, std::map<std::string, std::vector<uint8_t>>> _buckets;
+	std::map<std::string, Upload> _uploads;
+	unsigned _nextUploadId;
+	std::vector<std::shared_ptr<boost::asio::ip::tcp::socket>> _sockets;
+	std::vector<std::thread> _connectionThreads;
+};
+
+}
+}
+}
+}
@@ -0,0 +1,246 @@
+#include "blob/MockBlobStore.hpp"
+#include "bslib/blob/FanOutBlobStore.hpp"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+
+using namespace testing;
+
+namespace af {
+namespace bslib {
+namespace blob {
+namespace test {
+
+class FanOutBlobStoreTest : public testing::Test
+{
+protected:
+	FanOutBlobStoreTest()
+		: _first(std::make_shared<MockBlobStore>())
+		, _second(std::make_shared<MockBlobStore>())
+		, _firstId(Uuid::Create())
+		, _secondId(Uuid::Create())
+	{
+		ON_CALL(*_first, GetId()).WillByDefault(Return(_firstId));
+		ON_CALL(*_second, GetId()).WillByDefault(Return(_secondId));
+	}
+
+	std::map<Uuid, std::set<Address>> RecordStoredBlobs(FanOutBlobStore& store)
+	{
+		std::map<Uuid, std::set<Address>> result;
+		store.RecordStoredBlobs([&](const Uuid& storeId, const Address& address) {
+			result[storeId].insert(address);
+		});
+		return result;
+	}
+
+	std::shared_ptr<MockBlobStore> _first;
+	std::shared_ptr<MockBlobStore> _second;
+	const Uuid _firstId;
+	const Uuid _secondId;
+};
+
+TEST_F(FanOutBlobStoreTest, Flush_CreatesInEveryStore)
+{
+	// Arrange
+	FanOutBlobStore store({ _first, _second });
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	EXPECT_CALL(*_first, CreateBlob(address, content)).Times(1);
+	EXPECT_CALL(*_second, CreateBlob(address, content)).Times(1);
+	EXPECT_CALL(*_first, Flush()).Times(1);
+	EXPECT_CALL(*_second, Flush()).Times(1);
+
+	// Act
+	store.CreateBlob(address, content);
+	store.Flush();
+	const auto result = RecordStoredBlobs(store);
+
+	// Assert
+	EXPECT_EQ(std::set<Address>({ address }), result.at(_firstId));
+	EXPECT_EQ(std::set<Address>({ address }), result.at(_secondId));
+}
+
+TEST_F(FanOutBlobStoreTest, CreateBlob_SlowStoreDoesNotHoldUpOthers)
+{
+	// Arrange
+	FanOutBlobStore store({ _first, _second });
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	std::promise<void> release;
+	auto released = release.get_future().share();
+	std::promise<void> secondCreated;
+	EXPECT_CALL(*_first, CreateBlob(address, content)).WillOnce(Invoke([released](const auto&, const auto&) {
+		released.wait();
+	}));
+	EXPECT_CALL(*_second, CreateBlob(address, content)).WillOnce(Invoke([&secondCreated](const auto&, const auto&) {
+		secondCreated.set_value();
+	}));
+
+	// Act
+	store.CreateBlob(address, content);
+	const auto status = secondCreated.get_future().wait_for(std::chrono::seconds(10));
+	release.set_value();
+
+	// Assert
+	EXPECT_EQ(std::future_status::ready, status);
+}
+
+TEST_F(FanOutBlobStoreTest, Flush_SucceedsIfAnotherStoreHasBlob)
+{
+	// Arrange
+	FanOutBlobStore store({ _first, _second });
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	EXPECT_CALL(*_first, CreateBlob(address, content)).WillOnce(Throw(CreateBlobFailed("Failed", "some path")));
+	EXPECT_CALL(*_second, CreateBlob(address, content)).Times(1);
+	store.CreateBlob(address, content);
+
+	// Act
+	store.Flush();
+	const auto result = RecordStoredBlobs(store);
+
+	// Assert
+	EXPECT_EQ(0U, result.count(_firstId));
+	EXPECT_EQ(std::set<Address>({ address }), result.at(_secondId));
+}
+
+TEST_F(FanOutBlobStoreTest, Flush_RecordsNothingInStoreThatFailedToFlush)
+{
+	// Arrange
+	FanOutBlobStore store({ _first, _second });
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	EXPECT_CALL(*_first, CreateBlob(address, content)).Times(1);
+	EXPECT_CALL(*_second, CreateBlob(address, content)).Times(1);
+	EXPECT_CALL(*_second, Flush()).WillOnce(Throw(CreateBlobFailed("Failed", "some path")));
+	store.CreateBlob(address, content);
+
+	// Act
+	store.Flush();
+	const auto result = RecordStoredBlobs(store);
+
+	// Assert
+	EXPECT_EQ(std::set<Address>({ address }), result.at(_firstId));
+	EXPECT_EQ(0U, result.count(_secondId));
+}
+
+TEST_F(FanOutBlobStoreTest, Flush_ThrowsIfNoStoreHasBlob)
+{
+	// Arrange
+	FanOutBlobStore store({ _first, _second });
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	EXPECT_CALL(*_first, CreateBlob(address, content)).WillOnce(Throw(CreateBlobFailed("Failed", "some path")));
+	EXPECT_CALL(*_second, CreateBlob(address, content)).WillOnce(Throw(CreateBlobFailed("Failed", "some path")));
+	store.CreateBlob(address, content);
+
+	// Act
+	// Assert
+	EXPECT_THROW(store.Flush(), CreateBlobFailed);
+}
+
+TEST_F(FanOutBlobStoreTest, CreateBlob_SingleStoreWritesOnCallingThread)
+{
+	// Arrange
+	FanOutBlobStore store({ _first });
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	const auto callingThread = std::this_thread::get_id();
+	std::thread::id writingThread;
+	EXPECT_CALL(*_first, CreateBlob(address, content)).WillOnce(InvokeWithoutArgs([&]() {
+		writingThread = std::this_thread::get_id();
+	}));
+	EXPECT_CALL(*_first, Flush()).Times(1);
+
+	// Act
+	store.CreateBlob(address, content);
+	store.Flush();
+	const auto result = RecordStoredBlobs(store);
+
+	// Assert
+	EXPECT_EQ(callingThread, writingThread);
+	EXPECT_EQ(std::set<Address>({ address }), result.at(_firstId));
+}
+
+TEST_F(FanOutBlobStoreTest, CreateBlob_SingleStoreThrowsIfStoreFails)
+{
+	// Arrange
+	FanOutBlobStore store({ _first });
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	EXPECT_CALL(*_first, CreateBlob(address, content)).WillOnce(Throw(CreateBlobFailed("Failed", "some path")));
+
+	// Act
+	// Assert
+	EXPECT_THROW(store.CreateBlob(address, content), CreateBlobFailed);
+	store.Flush();
+	EXPECT_TRUE(RecordStoredBlobs(store).empty());
+}
+
+TEST_F(FanOutBlobStoreTest, CreateBlobWriter_WritesToEveryStore)
+{
+	// Arrange
+	FanOutBlobStore store({ _first, _second });
+	const std::vector<uint8_t> content = { 1, 2, 3, 4 };
+	const auto address = Address::CalculateFromContent(content);
+	EXPECT_CALL(*_first, CreateBlob(address, content)).Times(1);
+	EXPECT_CALL(*_second, CreateBlob(address, content)).Times(1);
+
+	// Act
+	auto writer = store.CreateBlobWriter();
+	writer->Write(&content[0], 2);
+	writer->Write(&content[2], 2);
+	writer->Commit(address);
+	store.Flush();
+
+	// Assert
+	Mock::VerifyAndClearExpectations(_first.get());
+	Mock::VerifyAndClearExpectations(_second.get());
+}
+
+TEST_F(FanOutBlobStoreTest, CreateBlobWriter_NotCommittedDiscarded)
+{
+	// Arrange
+	FanOutBlobStore store({ _first, _second });
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	EXPECT_CALL(*_first, CreateBlob(_, _)).Times(0);
+	EXPECT_CALL(*_second, CreateBlob(_, _)).Times(0);
+
+	// Act
+	{
+		auto writer = store.CreateBlobWriter();
+		writer->Write(&content[0], content.size());
+	}
+	store.Flush();
+
+	// Assert
+	EXPECT_TRUE(RecordStoredBlobs(store).empty());
+}
+
+TEST_F(FanOutBlobStoreTest, GetBlob_ReadsFromNextStoreIfMissing)
+{
+	// Arrange
+	FanOutBlobStore store({ _first, _second });
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	EXPECT_CALL(*_first, GetBlob(address)).WillRepeatedly(Throw(BlobStoreError("Missing")));
+	EXPECT_CALL(*_second, GetBlob(address)).WillOnce(Return(content));
+
+	// Act
+	const auto result = store.GetBlob(address);
+
+	// Assert
+	EXPECT_EQ(content, result);
+}
+
+}
+}
+}
+}
@@ -16,6 +16,7 @@ public:
 	MOCK_METHOD2(CreateBlob, void(const Address& address, const std::vector<uint8_t>& content));
 	MOCK_CONST_METHOD1(GetBlob, std::vector<uint8_t>(const Address& address));
 	MOCK_METHOD2(CreateNamedBlob, void(const UTF8String& name, const boost::filesystem::path& sourcePath));
+	MOCK_METHOD0(Flush, void());
 	MOCK_CONST_METHOD0(ConvertToJson, nlohmann::json());
 };
 
@@ -0,0 +1,249 @@
+#include "bslib/blob/PackBlobStore.hpp"
+#include "bslib/blob/exceptions.hpp"
+#include "bslib_test_util/TestBase.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+namespace test {
+
+namespace {
+long CountFiles(const boost::filesystem::path& path)
+{
+	return static_cast<long>(std::distance(boost::filesystem::directory_iterator(path), boost::filesystem::directory_iterator()));
+}
+}
+
+class PackBlobStoreIntegrationTest : public bslib_test_util::TestBase
+{
+};
+
+TEST_F(PackBlobStoreIntegrationTest, SaveLoad)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	PackBlobStore store(path);
+	const auto content = MakeContent(1);
+	const auto address = Address::CalculateFromContent(content);
+
+	// Act
+	store.CreateBlob(address, content);
+
+	// Assert
+	EXPECT_EQ(content, store.GetBlob(address));
+}
+
+TEST_F(PackBlobStoreIntegrationTest, CreateBlob_ManyBlobsShareAPack)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	PackBlobStore store(path);
+
+	// Act
+	for (auto i = 0U; i < 100; ++i)
+	{
+		const auto content = MakeContent(i);
+		store.CreateBlob(Address::CalculateFromContent(content), content);
+	}
+
+	// Assert
+	EXPECT_EQ(100U, store.GetBlobCount());
+	EXPECT_EQ(1U, store.GetPackCount());
+	EXPECT_EQ(1, CountFiles(path));
+}
+
+TEST_F(PackBlobStoreIntegrationTest, CreateBlob_DuplicateStoredOnce)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	PackBlobStore store(path);
+	const auto content = MakeContent(1);
+	const auto address = Address::CalculateFromContent(content);
+	store.CreateBlob(address, content);
+	const auto sizeBytes = boost::filesystem::file_size(*boost::filesystem::directory_iterator(path));
+
+	// Act
+	store.CreateBlob(address, content);
+
+	// Assert
+	EXPECT_EQ(1U, store.GetBlobCount());
+	EXPECT_EQ(sizeBytes, boost::filesystem::file_size(*boost::filesystem::directory_iterator(path)));
+}
+
+TEST_F(PackBlobStoreIntegrationTest, CreateBlob_SealsFullPacks)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	PackBlobStore store(path, 1000);
+	std::vector<std::vector<uint8_t>> contents;
+
+	// Act
+	for (auto i = 0U; i < 25; ++i)
+	{
+		contents.push_back(MakeContent(i));
+		store.CreateBlob(Address::CalculateFromContent(contents.back()), contents.back());
+	}
+
+	// Assert
+	EXPECT_EQ(4U, store.GetPackCount());
+	for (const auto& content : contents)
+	{
+		EXPECT_EQ(content, store.GetBlob(Address::CalculateFromContent(content)));
+	}
+}
+
+TEST_F(PackBlobStoreIntegrationTest, Reopen_FindsSealedAndActiveBlobs)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	std::vector<std::vector<uint8_t>> contents;
+	{
+		PackBlobStore store(path, 1000);
+		for (auto i = 0U; i < 25; ++i)
+		{
+			contents.push_back(MakeContent(i));
+			store.CreateBlob(Address::CalculateFromContent(contents.back()), contents.back());
+		}
+	}
+
+	// Act
+	PackBlobStore store(path, 1000);
+
+	// Assert
+	EXPECT_EQ(25U, store.GetBlobCount());
+	EXPECT_EQ(4U, store.GetPackCount());
+	for (const auto& content : contents)
+	{
+		EXPECT_EQ(content, store.GetBlob(Address::CalculateFromContent(content)));
+	}
+}
+
+TEST_F(PackBlobStoreIntegrationTest, Reopen_DropsIncompleteRecord)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	const auto first = MakeContent(1);
+	const auto second = MakeContent(2);
+	{
+		PackBlobStore store(path);
+		store.CreateBlob(Address::CalculateFromContent(first), first);
+		store.CreateBlob(Address::CalculateFromContent(second), second);
+	}
+	const auto packPath = boost::filesystem::directory_iterator(path)->path();
+	boost::filesystem::resize_file(packPath, boost::filesystem::file_size(packPath) - 10);
+
+	// Act
+	PackBlobStore store(path);
+	const auto third = MakeContent(3);
+	store.CreateBlob(Address::CalculateFromContent(third), third);
+
+	// Assert
+	EXPECT_EQ(2U, store.GetBlobCount());
+	EXPECT_EQ(first, store.GetBlob(Address::CalculateFromContent(first)));
+	EXPECT_THROW(store.GetBlob(Address::CalculateFromContent(second)), BlobReadException);
+	EXPECT_EQ(third, store.GetBlob(Address::CalculateFromContent(third)));
+}
+
+TEST_F(PackBlobStoreIntegrationTest, Reopen_LeavesUnrecognisedPack)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	const auto first = MakeContent(1);
+	{
+		PackBlobStore store(path);
+		store.CreateBlob(Address::CalculateFromContent(first), first);
+	}
+	const auto packPath = boost::filesystem::directory_iterator(path)->path();
+	{
+		boost::filesystem::fstream pack(packPath, std::ios::in | std::ios::out | std::ios::binary);
+		pack.write("XXXX", 4);
+	}
+	const auto packSizeBytes = boost::filesystem::file_size(packPath);
+
+	// Act
+	PackBlobStore store(path);
+	const auto second = MakeContent(2);
+	store.CreateBlob(Address::CalculateFromContent(second), second);
+
+	// Assert
+	EXPECT_EQ(packSizeBytes, boost::filesystem::file_size(packPath));
+	EXPECT_EQ(2, CountFiles(path));
+	EXPECT_EQ(second, store.GetBlob(Address::CalculateFromContent(second)));
+}
+
+TEST_F(PackBlobStoreIntegrationTest, BlobWriter_Commit)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	PackBlobStore store(path);
+	const auto content = MakeContent(1, 200 * 1024);
+	const auto address = Address::CalculateFromContent(content);
+	auto writer = store.CreateBlobWriter();
+
+	// Act
+	writer->Write(&content[0], 4);
+	writer->Write(&content[4], content.size() - 4);
+	writer->Commit(address);
+	writer.reset();
+
+	// Assert
+	EXPECT_EQ(content, store.GetBlob(address));
+	EXPECT_EQ(1, CountFiles(path));
+}
+
+TEST_F(PackBlobStoreIntegrationTest, BlobWriter_DiscardedIfNotCommitted)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	PackBlobStore store(path);
+	const auto content = MakeContent(1);
+	const auto address = Address::CalculateFromContent(content);
+	auto writer = store.CreateBlobWriter();
+	writer->Write(&content[0], content.size());
+
+	// Act
+	writer.reset();
+
+	// Assert
+	EXPECT_THROW(store.GetBlob(address), BlobReadException);
+	EXPECT_EQ(0U, store.GetBlobCount());
+	EXPECT_EQ(1, CountFiles(path));
+}
+
+TEST_F(PackBlobStoreIntegrationTest, GetBlobThrowsIfNotExist)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	PackBlobStore store(path);
+	const Address address("1234a123451234b123451234a123451234b12345");
+
+	// Act
+	// Assert
+	EXPECT_THROW(store.GetBlob(address), BlobReadException);
+}
+
+TEST_F(PackBlobStoreIntegrationTest, CtorThrowsErrorIfPathIsNonFolder)
+{
+	// Arrange
+	const auto path = GetUniqueTempPath();
+	WriteFile(path, "hahahah");
+
+	// Act
+	// Assert
+	EXPECT_THROW(PackBlobStore store(path), PackBlobStoreOpenFailed);
+}
+
+}
+}
+}
+}
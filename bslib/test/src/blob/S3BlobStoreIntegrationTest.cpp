@@ -0,0 +1,335 @@
+#include "blob/FakeObjectStore.hpp"
+#include "bslib/blob/BlobStoreManager.hpp"
+#include "bslib/blob/S3BlobStore.hpp"
+#include "bslib/blob/WriteBehindBlobStore.hpp"
+#include "bslib/blob/exceptions.hpp"
+#include "bslib_test_util/TestBase.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace af {
+namespace bslib {
+namespace blob {
+namespace test {
+
+namespace {
+const std::string BUCKET = "backups";
+}
+
+class S3BlobStoreIntegrationTest : public bslib_test_util::TestBase
+{
+protected:
+	S3BlobStoreSettings MakeSettings() const
+	{
+		S3BlobStoreSettings settings;
+		settings.endpoint = _server.GetEndpoint();
+		settings.bucket = BUCKET;
+		settings.prefix = "store/";
+		settings.maxConnections = 4;
+		settings.multipartThresholdBytes = 1000;
+		settings.partSizeBytes = 256;
+		return settings;
+	}
+
+	// Declared first, so it outlives the stores connected to it
+	FakeObjectStore _server;
+};
+
+TEST_F(S3BlobStoreIntegrationTest, SaveLoad)
+{
+	// Arrange
+	S3BlobStore store(MakeSettings());
+	const auto content = MakeContent(1);
+	const auto address = Address::CalculateFromContent(content);
+
+	// Act
+	store.CreateBlob(address, content);
+
+	// Assert
+	EXPECT_EQ(content, store.GetBlob(address));
+	EXPECT_EQ(content, _server.GetObjects(BUCKET).at("store/" + address.ToString()));
+	EXPECT_EQ(0U, _server.multipartUploadsCompleted);
+}
+
+TEST_F(S3BlobStoreIntegrationTest, CreateBlob_ReusesConnection)
+{
+	// Arrange
+	S3BlobStore store(MakeSettings());
+
+	// Act
+	for (auto i = 0U; i < 20; ++i)
+	{
+		const auto content = MakeContent(i);
+		store.CreateBlob(Address::CalculateFromContent(content), content);
+	}
+
+	// Assert
+	EXPECT_EQ(20U, _server.GetObjects(BUCKET).size());
+	EXPECT_EQ(1U, _server.connectionsAccepted);
+}
+
+TEST_F(S3BlobStoreIntegrationTest, CreateBlob_LargeBlobUploadedInConcurrentParts)
+{
+	// Arrange
+	_server.latency = std::chrono::milliseconds(20);
+	S3BlobStore store(MakeSettings());
+	const auto content = MakeContent(1, 2000);
+	const auto address = Address::CalculateFromContent(content);
+
+	// Act
+	store.CreateBlob(address, content);
+
+	// Assert
+	EXPECT_EQ(content, store.GetBlob(address));
+	EXPECT_EQ(1U, _server.multipartUploadsCompleted);
+	EXPECT_LT(1U, _server.maxConcurrentRequests);
+	EXPECT_GE(4U, _server.maxConcurrentRequests);
+}
+
+TEST_F(S3BlobStoreIntegrationTest, CreateBlobWriter_SmallBlobPutWhole)
+{
+	// Arrange
+	S3BlobStore store(MakeSettings());
+	const auto content = MakeContent(1, 500);
+	const auto address = Address::CalculateFromContent(content);
+	auto writer = store.CreateBlobWriter();
+
+	// Act
+	writer->Write(content.data(), 250);
+	writer->Write(content.data() + 250, 250);
+	writer->Commit(address);
+
+	// Assert
+	EXPECT_EQ(content, store.GetBlob(address));
+	EXPECT_EQ(0U, _server.multipartUploadsCompleted);
+}
+
+TEST_F(S3BlobStoreIntegrationTest, CreateBlobWriter_LargeBlobUploadedInPartsFromSpool)
+{
+	// Arrange
+	S3BlobStore store(MakeSettings());
+	const auto content = MakeContent(1, 3000);
+	const auto address = Address::CalculateFromContent(content);
+	auto writer = store.CreateBlobWriter();
+
+	// Act
+	for (size_t offset = 0; offset < content.size(); offset += 100)
+	{
+		writer->Write(&content[offset], 100);
+	}
+	writer->Commit(address);
+
+	// Assert
+	EXPECT_EQ(content, store.GetBlob(address));
+	EXPECT_EQ(1U, _server.multipartUploadsCompleted);
+}
+
+TEST_F(S3BlobStoreIntegrationTest, CreateNamedBlob_LargeFileUploadedInParts)
+{
+	// Arrange
+	S3BlobStore store(MakeSettings());
+	const auto path = GetUniqueTempPath();
+	const auto content = MakeContent(1, 3000);
+	{
+		boost::filesystem::ofstream file(path, std::ios::out | std::ios::binary);
+		file.write(reinterpret_cast<const char*>(content.data()), content.size());
+	}
+
+	// Act
+	store.CreateNamedBlob("settings.json", path);
+
+	// Assert
+	EXPECT_EQ(content, _server.GetObjects(BUCKET).at("store/named/settings.json"));
+	EXPECT_EQ(1U, _server.multipartUploadsCompleted);
+}
+
+TEST_F(S3BlobStoreIntegrationTest, GetBlob_MissingThrows)
+{
+	// Arrange
+	S3BlobStore store(MakeSettings());
+
+	// Act
+	// Assert
+	EXPECT_THROW(store.GetBlob(Address::CalculateFromContent(MakeContent(1))), BlobReadException);
+}
+
+TEST_F(S3BlobStoreIntegrationTest, Send_TimedOutRequestSentAgain)
+{
+	// Arrange
+	auto settings = MakeSettings();
+	settings.timeout = std::chrono::milliseconds(100);
+	S3BlobStore store(settings);
+	const auto content = MakeContent(1);
+	const auto address = Address::CalculateFromContent(content);
+	_server.stall = std::chrono::milliseconds(500);
+	_server.requestsToStall = 1;
+
+	// Act
+	store.CreateBlob(address, content);
+
+	// Assert
+	EXPECT_EQ(content, store.GetBlob(address));
+	EXPECT_EQ(3U, _server.requestsReceived);
+}
+
+TEST_F(S3BlobStoreIntegrationTest, GetBlob_ThrowsIfEveryAttemptTimesOut)
+{
+	// Arrange
+	auto settings = MakeSettings();
+	settings.timeout = std::chrono::milliseconds(100);
+	S3BlobStore store(settings);
+	const auto content = MakeContent(1);
+	const auto address = Address::CalculateFromContent(content);
+	store.CreateBlob(address, content);
+	_server.stall = std::chrono::milliseconds(500);
+	_server.requestsToStall = 3;
+
+	// Act
+	// Assert
+	EXPECT_THROW(store.GetBlob(address), BlobReadException);
+	EXPECT_EQ(0U, _server.requestsToStall);
+}
+
+TEST_F(S3BlobStoreIntegrationTest, GetBlob_ThrowsAndReconnectsIfContentLengthMalformed)
+{
+	// Arrange
+	S3BlobStore store(MakeSettings());
+	const auto content = MakeContent(1);
+	const auto address = Address::CalculateFromContent(content);
+	store.CreateBlob(address, content);
+	_server.responsesToMalform = 2;
+
+	// Act
+	// Assert
+	EXPECT_THROW(store.GetBlob(address), BlobReadException);
+	EXPECT_EQ(content, store.GetBlob(address));
+	EXPECT_EQ(3U, _server.connectionsAccepted);
+}
+
+TEST_F(S3BlobStoreIntegrationTest, FindBlobs_ChecksBatchConcurrently)
+{
+	// Arrange
+	S3BlobStore store(MakeSettings());
+	std::vector<Address> addresses;
+	std::set<Address> stored;
+	for (auto i = 0U; i < 20; ++i)
+	{
+		const auto content = MakeContent(i);
+		addresses.push_back(Address::CalculateFromContent(content));
+		if (i % 2 == 0)
+		{
+			store.CreateBlob(addresses.back(), content);
+			stored.insert(addresses.back());
+		}
+	}
+	_server.latency = std::chrono::milliseconds(20);
+
+	// Act
+	const auto found = store.FindBlobs(addresses);
+
+	// Assert
+	EXPECT_EQ(stored, found);
+	EXPECT_LT(1U, _server.maxConcurrentRequests);
+}
+
+TEST_F(S3BlobStoreIntegrationTest, ListBlobs_PagesAndSkipsNamedBlobs)
+{
+	// Arrange
+	_server.maxKeys = 3;
+	S3BlobStore store(MakeSettings());
+	std::set<Address> created;
+	for (auto i = 0U; i < 7; ++i)
+	{
+		const auto content = MakeContent(i, 10 + i);
+		created.insert(Address::CalculateFromContent(content));
+		store.CreateBlob(Address::CalculateFromContent(content), content);
+	}
+	const auto path = GetUniqueTempPath();
+	boost::filesystem::ofstream(path) << "named";
+	store.CreateNamedBlob("settings.json", path);
+
+	// Act
+	std::set<Address> listed;
+	uint64_t sizeBytes = 0;
+	const auto result = store.ListBlobs([&](const StoredBlob& blob) {
+		listed.insert(blob.address);
+		sizeBytes += blob.sizeBytes;
+	});
+
+	// Assert
+	EXPECT_TRUE(result);
+	EXPECT_EQ(created, listed);
+	EXPECT_EQ(91U, sizeBytes);
+}
+
+TEST_F(S3BlobStoreIntegrationTest, DeleteBlob_RemovesObject)
+{
+	// Arrange
+	S3BlobStore store(MakeSettings());
+	const auto content = MakeContent(1);
+	const auto address = Address::CalculateFromContent(content);
+	store.CreateBlob(address, content);
+
+	// Act
+	store.DeleteBlob(address);
+
+	// Assert
+	EXPECT_TRUE(store.FindBlobs({ address }).empty());
+	EXPECT_NO_THROW(store.DeleteBlob(address));
+}
+
+TEST_F(S3BlobStoreIntegrationTest, Send_SignsRequestsWithKeys)
+{
+	// Arrange
+	auto settings = MakeSettings();
+	settings.accessKeyId = "AKIDEXAMPLE";
+	settings.secretAccessKey = "secret";
+	S3BlobStore store(settings);
+	const auto content = MakeContent(1);
+
+	// Act
+	store.CreateBlob(Address::CalculateFromContent(content), content);
+
+	// Assert
+	EXPECT_EQ(1U, _server.requestsAuthorized);
+}
+
+TEST_F(S3BlobStoreIntegrationTest, SaveLoad_ThroughBlobStoreManagerWritesBehind)
+{
+	// Arrange
+	const auto settingsPath = GetUniqueTempPath();
+	BlobStoreManager manager(settingsPath);
+	manager.AddBlobStore(S3BlobStore::TYPE, S3BlobStore(MakeSettings()).ConvertToJson());
+	manager.SaveToSettingsFile();
+	const auto content = MakeContent(1);
+	const auto address = Address::CalculateFromContent(content);
+
+	// Act
+	BlobStoreManager other(settingsPath);
+	other.LoadFromSettingsFile();
+	const auto& loadedStores = other.GetStores();
+	ASSERT_EQ(1, loadedStores.size());
+	loadedStores[0]->CreateBlob(address, content);
+	loadedStores[0]->Flush();
+
+	// Assert
+	const auto json = loadedStores[0]->ConvertToJson();
+	EXPECT_EQ(S3BlobStore::TYPE, loadedStores[0]->GetTypeString());
+	EXPECT_EQ(BUCKET, json["bucket"].get<std::string>());
+	EXPECT_EQ(4U, json[WriteBehindBlobStore::SETTINGS_KEY]["writerThreads"].get<unsigned>());
+	EXPECT_EQ(content, _server.GetObjects(BUCKET).at("store/" + address.ToString()));
+}
+
+}
+}
+}
+}
@@ -0,0 +1,147 @@
+#include "bslib/blob/BlobInfoRepository.hpp"
+#include "bslib/blob/StoreBlobRepository.hpp"
+#include "bslib/sqlitepp/sqlitepp.hpp"
+#include "bslib_test_util/TestBase.hpp"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <set>
+
+namespace af {
+namespace bslib {
+namespace blob {
+namespace test {
+
+class StoreBlobRepositoryIntegrationTest : public bslib_test_util::TestBase
+{
+protected:
+	StoreBlobRepositoryIntegrationTest()
+		: _storeId(Uuid::Create())
+	{
+		_testBackup.Create();
+		_connection = _testBackup.ConnectToDatabase();
+	}
+
+	std::unique_ptr<sqlitepp::ScopedSqlite3Object> _connection;
+	const Uuid _storeId;
+};
+
+TEST_F(StoreBlobRepositoryIntegrationTest, GetBlobsMissingFromStore_ExcludesStoredBlobs)
+{
+	// Arrange
+	BlobInfoRepository blobRepo(*_connection);
+	StoreBlobRepository repo(*_connection);
+	const Address stored("cf23df2207d99a74fbe169e3eba035e633b65d94");
+	const Address missing("5323df2207d99a74fbe169e3eba035e635779792");
+	const Address storedElsewhere("f259225215937593795395739753973973593571");
+	blobRepo.AddBlob(BlobInfo(stored, 1));
+	blobRepo.AddBlob(BlobInfo(missing, 2));
+	blobRepo.AddBlob(BlobInfo(storedElsewhere, 3));
+	repo.AddStoreBlob(_storeId, stored);
+	repo.AddStoreBlob(Uuid::Create(), storedElsewhere);
+
+	// Act
+	const auto result = repo.GetBlobsMissingFromStore(_storeId, boost::none, 10);
+
+	// Assert
+	EXPECT_EQ(std::vector<Address>({ missing, storedElsewhere }), result);
+}
+
+TEST_F(StoreBlobRepositoryIntegrationTest, GetBlobsMissingFromStore_PagesAfterAddress)
+{
+	// Arrange
+	BlobInfoRepository blobRepo(*_connection);
+	StoreBlobRepository repo(*_connection);
+	const Address first("1323df2207d99a74fbe169e3eba035e635779792");
+	const Address second("5323df2207d99a74fbe169e3eba035e635779792");
+	const Address third("f259225215937593795395739753973973593571");
+	blobRepo.AddBlob(BlobInfo(third, 1));
+	blobRepo.AddBlob(BlobInfo(first, 2));
+	blobRepo.AddBlob(BlobInfo(second, 3));
+
+	// Act
+	const auto firstPage = repo.GetBlobsMissingFromStore(_storeId, boost::none, 2);
+	const auto secondPage = repo.GetBlobsMissingFromStore(_storeId, firstPage.back(), 2);
+
+	// Assert
+	EXPECT_EQ(std::vector<Address>({ first, second }), firstPage);
+	EXPECT_EQ(std::vector<Address>({ third }), secondPage);
+}
+
+TEST_F(StoreBlobRepositoryIntegrationTest, GetBlobsMissingFromStore_ExcludesChunkedBlobs)
+{
+	// Arrange
+	BlobInfoRepository blobRepo(*_connection);
+	StoreBlobRepository repo(*_connection);
+	const Address chunked("cf23df2207d99a74fbe169e3eba035e633b65d94");
+	const Address chunk("5323df2207d99a74fbe169e3eba035e635779792");
+	blobRepo.AddBlob(BlobInfo(chunked, 1));
+	blobRepo.AddBlob(BlobInfo(chunk, 1));
+	blobRepo.AddBlobChunks(chunked, { chunk });
+
+	// Act
+	const auto result = repo.GetBlobsMissingFromStore(_storeId, boost::none, 10);
+
+	// Assert
+	EXPECT_EQ(std::vector<Address>({ chunk }), result);
+}
+
+TEST_F(StoreBlobRepositoryIntegrationTest, AddStoreBlob_TwiceSuccess)
+{
+	// Arrange
+	StoreBlobRepository repo(*_connection);
+	const Address address("cf23df2207d99a74fbe169e3eba035e633b65d94");
+	repo.AddStoreBlob(_storeId, address);
+
+	// Act
+	// Assert
+	EXPECT_NO_THROW(repo.AddStoreBlob(_storeId, address));
+}
+
+TEST_F(StoreBlobRepositoryIntegrationTest, AddDamagedBlob_IncludesChunkedBlobsUntilStoredAgain)
+{
+	// Arrange
+	BlobInfoRepository blobRepo(*_connection);
+	StoreBlobRepository repo(*_connection);
+	const Address chunked("cf23df2207d99a74fbe169e3eba035e633b65d94");
+	const Address chunk("5323df2207d99a74fbe169e3eba035e635779792");
+	blobRepo.AddBlob(BlobInfo(chunked, 1));
+	blobRepo.AddBlob(BlobInfo(chunk, 1));
+	blobRepo.AddBlobChunks(chunked, { chunk });
+	repo.AddStoreBlob(_storeId, chunk);
+
+	// Act
+	repo.AddDamagedBlob(_storeId, chunk, BlobDamage::Corrupt);
+	const auto damaged = repo.GetDamagedBlobs();
+	const auto stored = repo.GetStoreBlobs(_storeId, boost::none, 10);
+	repo.AddStoreBlob(_storeId, chunk);
+
+	// Assert
+	EXPECT_EQ(std::set<Address>({ chunked, chunk }), damaged);
+	EXPECT_TRUE(stored.empty());
+	EXPECT_TRUE(repo.GetDamagedBlobs().empty());
+}
+
+TEST_F(StoreBlobRepositoryIntegrationTest, SetScrubCursor_SavedUntilCleared)
+{
+	// Arrange
+	StoreBlobRepository repo(*_connection);
+	const Address address("cf23df2207d99a74fbe169e3eba035e633b65d94");
+
+	// Act
+	repo.SetScrubCursor(_storeId, address);
+	const auto saved = repo.GetScrubCursor(_storeId);
+	repo.SetScrubCursor(_storeId, boost::none);
+
+	// Assert
+	EXPECT_EQ(address, saved.value());
+	EXPECT_FALSE(repo.GetScrubCursor(_storeId));
+	EXPECT_FALSE(repo.GetScrubCursor(Uuid::Create()));
+}
+
+}
+}
+}
+}
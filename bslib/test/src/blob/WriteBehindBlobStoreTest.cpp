@@ -0,0 +1,253 @@
+#include "blob/MockBlobStore.hpp"
+#include "bslib/blob/WriteBehindBlobStore.hpp"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+
+using namespace testing;
+
+namespace af {
+namespace bslib {
+namespace blob {
+namespace test {
+
+namespace {
+WriteBehindBlobStoreSettings MakeSettings(uint64_t maxInFlightBytes = 1024 * 1024)
+{
+	WriteBehindBlobStoreSettings settings;
+	settings.writerThreads = 2;
+	settings.maxInFlightBytes = maxInFlightBytes;
+	settings.flushInterval = std::chrono::milliseconds(10);
+	return settings;
+}
+}
+
+class WriteBehindBlobStoreTest : public testing::Test
+{
+protected:
+	WriteBehindBlobStoreTest()
+		: _inner(std::make_shared<MockBlobStore>())
+	{
+	}
+
+	std::shared_ptr<MockBlobStore> _inner;
+};
+
+TEST_F(WriteBehindBlobStoreTest, Flush_WritesAndFlushesInnerStore)
+{
+	// Arrange
+	WriteBehindBlobStore store(_inner, MakeSettings());
+	std::vector<std::vector<uint8_t>> contents;
+	for (uint8_t i = 0; i < 100; ++i)
+	{
+		contents.push_back({ i, 1, 2, 3 });
+		EXPECT_CALL(*_inner, CreateBlob(Address::CalculateFromContent(contents.back()), contents.back())).Times(1);
+	}
+	EXPECT_CALL(*_inner, Flush()).Times(AtLeast(1));
+
+	// Act
+	for (const auto& content : contents)
+	{
+		store.CreateBlob(Address::CalculateFromContent(content), content);
+	}
+	store.Flush();
+
+	// Assert
+	Mock::VerifyAndClearExpectations(_inner.get());
+}
+
+TEST_F(WriteBehindBlobStoreTest, GetBlob_ReadsBlobBeforeItIsWritten)
+{
+	// Arrange
+	WriteBehindBlobStore store(_inner, MakeSettings());
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	std::promise<void> release;
+	auto released = release.get_future().share();
+	EXPECT_CALL(*_inner, CreateBlob(address, content)).WillOnce(Invoke([released](const auto&, const auto&) {
+		released.wait();
+	}));
+	EXPECT_CALL(*_inner, GetBlob(_)).Times(0);
+
+	// Act
+	store.CreateBlob(address, content);
+	const auto result = store.GetBlob(address);
+	release.set_value();
+
+	// Assert
+	EXPECT_EQ(content, result);
+}
+
+TEST_F(WriteBehindBlobStoreTest, CreateBlob_WaitsWhileFull)
+{
+	// Arrange
+	WriteBehindBlobStore store(_inner, MakeSettings(4));
+	const std::vector<uint8_t> first = { 1, 2, 3 };
+	const std::vector<uint8_t> second = { 4, 5, 6 };
+	std::promise<void> release;
+	auto released = release.get_future().share();
+	EXPECT_CALL(*_inner, CreateBlob(Address::CalculateFromContent(first), first)).WillOnce(Invoke([released](const auto&, const auto&) {
+		released.wait();
+	}));
+	EXPECT_CALL(*_inner, CreateBlob(Address::CalculateFromContent(second), second)).Times(1);
+	store.CreateBlob(Address::CalculateFromContent(first), first);
+
+	// Act
+	std::atomic_bool created(false);
+	std::thread creator([&]() {
+		store.CreateBlob(Address::CalculateFromContent(second), second);
+		created = true;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	const bool createdWhileFull = created;
+	release.set_value();
+	creator.join();
+
+	// Assert
+	EXPECT_FALSE(createdWhileFull);
+	EXPECT_TRUE(created);
+}
+
+TEST_F(WriteBehindBlobStoreTest, Flush_ThrowsIfWriteFailed)
+{
+	// Arrange
+	WriteBehindBlobStore store(_inner, MakeSettings());
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	EXPECT_CALL(*_inner, CreateBlob(address, content)).WillOnce(Throw(CreateBlobFailed("Failed", "some path")));
+	store.CreateBlob(address, content);
+
+	// Act
+	// Assert
+	EXPECT_THROW(store.Flush(), CreateBlobFailed);
+}
+
+TEST_F(WriteBehindBlobStoreTest, Flush_ReportsWriteFailureOnce)
+{
+	// Arrange
+	WriteBehindBlobStore store(_inner, MakeSettings());
+	const std::vector<uint8_t> first = { 1, 2, 3 };
+	const std::vector<uint8_t> second = { 4, 5, 6 };
+	EXPECT_CALL(*_inner, CreateBlob(Address::CalculateFromContent(first), first)).WillOnce(Throw(CreateBlobFailed("Failed", "some path")));
+	EXPECT_CALL(*_inner, CreateBlob(Address::CalculateFromContent(second), second)).Times(1);
+	EXPECT_CALL(*_inner, Flush()).Times(AtLeast(1));
+	store.CreateBlob(Address::CalculateFromContent(first), first);
+	EXPECT_THROW(store.Flush(), CreateBlobFailed);
+
+	// Act
+	store.CreateBlob(Address::CalculateFromContent(second), second);
+
+	// Assert
+	EXPECT_NO_THROW(store.Flush());
+	Mock::VerifyAndClearExpectations(_inner.get());
+}
+
+TEST_F(WriteBehindBlobStoreTest, Flush_ThrowsIfInnerFlushFailed)
+{
+	// Arrange
+	WriteBehindBlobStore store(_inner, MakeSettings());
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	EXPECT_CALL(*_inner, CreateBlob(_, _)).Times(1);
+	EXPECT_CALL(*_inner, Flush()).WillOnce(Throw(CreateBlobFailed("Failed", "some path"))).WillRepeatedly(Return());
+	store.CreateBlob(Address::CalculateFromContent(content), content);
+
+	// Act
+	// Assert
+	EXPECT_THROW(store.Flush(), CreateBlobFailed);
+	EXPECT_NO_THROW(store.Flush());
+}
+
+TEST_F(WriteBehindBlobStoreTest, CreateBlobWriter_WritesOnCallingThreadAndFlushes)
+{
+	// Arrange
+	WriteBehindBlobStore store(_inner, MakeSettings());
+	const std::vector<uint8_t> content = { 1, 2, 3, 4 };
+	const auto address = Address::CalculateFromContent(content);
+	std::thread::id writingThread;
+	EXPECT_CALL(*_inner, CreateBlob(address, content)).WillOnce(Invoke([&](const auto&, const auto&) {
+		writingThread = std::this_thread::get_id();
+	}));
+	EXPECT_CALL(*_inner, Flush()).Times(AtLeast(1));
+	auto writer = store.CreateBlobWriter();
+
+	// Act
+	writer->Write(content.data(), 2);
+	writer->Write(content.data() + 2, 2);
+	writer->Commit(address);
+	store.Flush();
+
+	// Assert
+	EXPECT_EQ(std::this_thread::get_id(), writingThread);
+	Mock::VerifyAndClearExpectations(_inner.get());
+}
+
+TEST_F(WriteBehindBlobStoreTest, CreateBlobWriter_CommitThrowsIfWriteFailed)
+{
+	// Arrange
+	WriteBehindBlobStore store(_inner, MakeSettings());
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	const auto address = Address::CalculateFromContent(content);
+	EXPECT_CALL(*_inner, CreateBlob(address, content)).WillOnce(Throw(CreateBlobFailed("Failed", "some path")));
+	auto writer = store.CreateBlobWriter();
+	writer->Write(content.data(), content.size());
+
+	// Act
+	// Assert
+	EXPECT_THROW(writer->Commit(address), CreateBlobFailed);
+	EXPECT_NO_THROW(store.Flush());
+}
+
+TEST_F(WriteBehindBlobStoreTest, Flush_NothingCreatedSuccess)
+{
+	// Arrange
+	WriteBehindBlobStore store(_inner, MakeSettings());
+	EXPECT_CALL(*_inner, Flush()).Times(0);
+
+	// Act
+	// Assert
+	EXPECT_NO_THROW(store.Flush());
+}
+
+TEST_F(WriteBehindBlobStoreTest, Dtor_WritesQueuedBlobs)
+{
+	// Arrange
+	const std::vector<uint8_t> content = { 1, 2, 3 };
+	EXPECT_CALL(*_inner, CreateBlob(_, content)).Times(1);
+	EXPECT_CALL(*_inner, Flush()).Times(AtLeast(1));
+
+	// Act
+	{
+		WriteBehindBlobStore store(_inner, MakeSettings());
+		store.CreateBlob(Address::CalculateFromContent(content), content);
+	}
+
+	// Assert
+	Mock::VerifyAndClearExpectations(_inner.get());
+}
+
+TEST_F(WriteBehindBlobStoreTest, ConvertToJson_RoundTripsSettings)
+{
+	// Arrange
+	EXPECT_CALL(*_inner, ConvertToJson()).WillOnce(Return(nlohmann::json::object()));
+	WriteBehindBlobStore store(_inner, MakeSettings(1234));
+
+	// Act
+	const auto json = store.ConvertToJson();
+	const auto settings = WriteBehindBlobStore::ParseSettings(json[WriteBehindBlobStore::SETTINGS_KEY]);
+
+	// Assert
+	EXPECT_EQ(2U, settings.writerThreads);
+	EXPECT_EQ(1234U, settings.maxInFlightBytes);
+	EXPECT_EQ(10, settings.flushInterval.count());
+}
+
+}
+}
+}
+}
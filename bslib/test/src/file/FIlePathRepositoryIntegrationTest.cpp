@@ -100,9 +100,9 @@ TEST_F(FilePathRepositoryIntegrationTest, AddPathTree_DifferentTypesSuccess)
 	const fs::WindowsPath path(R"(C:\Foo\Bar)");
 
 	// Act
-	FilePathRepository::cache_type cache;
-	const auto directoryId = repo.AddPathTree(path, FileType::Directory, cache);
-	const auto fileId = repo.AddPathTree(path, FileType::RegularFile, cache);
+	FilePathIndex index;
+	const auto directoryId = repo.AddPathTree(path, FileType::Directory, index);
+	const auto fileId = repo.AddPathTree(path, FileType::RegularFile, index);
 
 	// Assert
 	const auto foundFile = repo.FindPathDetails(path, FileType::RegularFile);
@@ -123,6 +123,88 @@ TEST_F(FilePathRepositoryIntegrationTest, AddPathTree_DifferentTypesSuccess)
 	EXPECT_EQ(foundFoo->pathId, foundDirectory->parentId);
 }
 
+TEST_F(FilePathRepositoryIntegrationTest, AddPathTree_SiblingsShareParentsSuccess)
+{
+	// Arrange
+	FilePathRepository repo(*_connection);
+	FilePathIndex index;
+	const fs::WindowsPath path1(R"(C:\Foo\Bar\a.txt)");
+	const fs::WindowsPath path2(R"(C:\Foo\Bar\b.txt)");
+	const fs::WindowsPath path3(R"(C:\Foo\Baz\a.txt)");
+
+	// Act
+	const auto id1 = repo.AddPathTree(path1, FileType::RegularFile, index);
+	const auto id2 = repo.AddPathTree(path2, FileType::RegularFile, index);
+	const auto id3 = repo.AddPathTree(path3, FileType::RegularFile, index);
+
+	// Assert
+	const auto found1 = repo.FindPathDetails(path1, FileType::RegularFile);
+	const auto found2 = repo.FindPathDetails(path2, FileType::RegularFile);
+	const auto found3 = repo.FindPathDetails(path3, FileType::RegularFile);
+	const auto bar = repo.FindPathDetails(fs::WindowsPath(R"(C:\Foo\Bar\)"), FileType::Directory);
+	const auto baz = repo.FindPathDetails(fs::WindowsPath(R"(C:\Foo\Baz\)"), FileType::Directory);
+	ASSERT_TRUE(found1 && found2 && found3 && bar && baz);
+	EXPECT_EQ(id1, found1->pathId);
+	EXPECT_EQ(id2, found2->pathId);
+	EXPECT_EQ(id3, found3->pathId);
+	EXPECT_EQ(bar->pathId, found1->parentId.value());
+	EXPECT_EQ(bar->pathId, found2->parentId.value());
+	EXPECT_EQ(baz->pathId, found3->parentId.value());
+	EXPECT_EQ(7U, repo.GetAllPaths().size());
+	EXPECT_EQ(7U, index.GetSize());
+
+	// "a.txt" is only interned once
+	EXPECT_EQ(6U, index.GetSegmentCount());
+}
+
+TEST_F(FilePathRepositoryIntegrationTest, AddPathTree_TrailingSlashIsDistinctSuccess)
+{
+	// Arrange
+	FilePathRepository repo(*_connection);
+	FilePathIndex index;
+
+	// Act
+	const auto withSlash = repo.AddPathTree(fs::WindowsPath(R"(C:\Foo\)"), FileType::Directory, index);
+	const auto withoutSlash = repo.AddPathTree(fs::WindowsPath(R"(C:\Foo)"), FileType::Directory, index);
+
+	// Assert
+	EXPECT_NE(withSlash, withoutSlash);
+	EXPECT_EQ(withoutSlash, repo.FindPath(fs::WindowsPath(R"(C:\Foo)"), FileType::Directory).value());
+	EXPECT_EQ(withSlash, repo.FindPath(fs::WindowsPath(R"(C:\Foo\)"), FileType::Directory).value());
+}
+
+TEST_F(FilePathRepositoryIntegrationTest, LoadPathTree_Success)
+{
+	// Arrange
+	FilePathRepository repo(*_connection);
+	const auto fileId = repo.AddPathTree(fs::WindowsPath(R"(C:\Foo\Bar\a.txt)"), FileType::RegularFile);
+	const auto otherId = repo.AddPathTree(fs::WindowsPath(R"(C:\Other\b.txt)"), FileType::RegularFile);
+	FilePathIndex index;
+
+	// Act
+	repo.LoadPathTree(fs::WindowsPath(R"(C:\Foo\)"), index);
+
+	// Assert
+	// Root, Foo, Bar and a.txt but nothing under Other
+	EXPECT_EQ(4U, index.GetSize());
+	EXPECT_EQ(fileId, repo.AddPathTree(fs::WindowsPath(R"(C:\Foo\Bar\a.txt)"), FileType::RegularFile, index));
+	EXPECT_EQ(4U, index.GetSize());
+	EXPECT_EQ(otherId, repo.AddPathTree(fs::WindowsPath(R"(C:\Other\b.txt)"), FileType::RegularFile, index));
+}
+
+TEST_F(FilePathRepositoryIntegrationTest, LoadPathTree_MissingPathSuccess)
+{
+	// Arrange
+	FilePathRepository repo(*_connection);
+	FilePathIndex index;
+
+	// Act
+	repo.LoadPathTree(fs::WindowsPath(R"(C:\Missing\)"), index);
+
+	// Assert
+	EXPECT_EQ(0U, index.GetSize());
+}
+
 TEST_F(FilePathRepositoryIntegrationTest, FindPath_Success)
 {
 	// Arrange
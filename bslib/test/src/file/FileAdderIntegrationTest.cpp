@@ -1,3 +1,4 @@
+#include "bslib/blob/BlobInfoRepository.hpp"
 #include "bslib/file/exceptions.hpp"
 #include "bslib/file/fs/operations.hpp"
 #include "bslib/sqlitepp/sqlitepp.hpp"
@@ -11,8 +12,11 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <algorithm>
 #include <functional>
+#include <map>
 #include <memory>
+#include <random>
 
 namespace af {
 namespace bslib {
@@ -109,6 +113,70 @@ TEST_F(FileAdderIntegrationTest, Add_SkipsLockedFile)
 	EXPECT_THAT(_adder->GetEmittedEvents(), ::testing::ElementsAre(expectedEmittedEvent));
 }
 
+TEST_F(FileAdderIntegrationTest, Add_UnchangedMetadataSkipsReadingFile)
+{
+	// Arrange
+	const auto filePath = GetUniqueExtendedTempPath();
+	const auto fileAddress = WriteFile(filePath, "hello");
+	_adder->Add(filePath.ToString());
+
+	// The content can't be read while this is held, so reading would emit FailedToRead
+	test_utility::ScopedExclusiveFileAccess exclusiveAccess(filePath);
+
+	// Act
+	_adder->Add(filePath.ToString());
+
+	// Assert
+	EXPECT_THAT(_adder->GetEmittedEvents(), ::testing::ElementsAre(
+		RegularFileEvent(_backupRunId, filePath, fileAddress, FileEventAction::ChangedAdded),
+		RegularFileEvent(_backupRunId, filePath, fileAddress, FileEventAction::Unchanged)));
+	const auto lastEvent = _finder->FindLastChangedEventByPath(filePath);
+	ASSERT_TRUE(lastEvent);
+	ASSERT_TRUE(lastEvent->metadata);
+	EXPECT_EQ(5U, lastEvent->metadata->sizeBytes);
+}
+
+TEST_F(FileAdderIntegrationTest, Add_ParanoidReadsUnchangedFile)
+{
+	// Arrange
+	FileAdderSettings settings;
+	settings.paranoid = true;
+	auto adder = _uow->CreateFileAdder(_backupRunId, settings);
+	const auto filePath = GetUniqueExtendedTempPath();
+	const auto fileAddress = WriteFile(filePath, "hello");
+	adder->Add(filePath.ToString());
+	test_utility::ScopedExclusiveFileAccess exclusiveAccess(filePath);
+
+	// Act
+	adder->Add(filePath.ToString());
+
+	// Assert
+	EXPECT_THAT(adder->GetEmittedEvents(), ::testing::ElementsAre(
+		RegularFileEvent(_backupRunId, filePath, fileAddress, FileEventAction::ChangedAdded),
+		RegularFileEvent(_backupRunId, filePath, boost::none, FileEventAction::FailedToRead)));
+}
+
+TEST_F(FileAdderIntegrationTest, Add_ChangedMetadataWithSameContentIsUnchanged)
+{
+	// Arrange
+	const auto filePath = GetUniqueExtendedTempPath();
+	const auto fileAddress = WriteFile(filePath, "hello");
+	_adder->Add(filePath.ToString());
+	WriteFile(filePath, "hello");
+	_adder->Add(filePath.ToString());
+	test_utility::ScopedExclusiveFileAccess exclusiveAccess(filePath);
+
+	// Act
+	_adder->Add(filePath.ToString());
+
+	// Assert
+	// The second unchanged event records the new metadata, so the third add doesn't need to read the file
+	EXPECT_THAT(_adder->GetEmittedEvents(), ::testing::ElementsAre(
+		RegularFileEvent(_backupRunId, filePath, fileAddress, FileEventAction::ChangedAdded),
+		RegularFileEvent(_backupRunId, filePath, fileAddress, FileEventAction::Unchanged),
+		RegularFileEvent(_backupRunId, filePath, fileAddress, FileEventAction::Unchanged)));
+}
+
 TEST_F(FileAdderIntegrationTest, Add_RecordsAllStates)
 {
 	// Arrange
@@ -343,6 +411,233 @@ TEST_F(FileAdderIntegrationTest, Add_DetectsModifications)
 	EXPECT_THAT(expectedEvents, ::testing::UnorderedElementsAreArray(result | boost::adaptors::map_values));
 }
 
+TEST_F(FileAdderIntegrationTest, Add_ChunkedModificationOnlyStoresChangedChunks)
+{
+	// Arrange
+	FileAdderSettings settings;
+	settings.contentDefinedChunking = true;
+	settings.minChunkSizeBytes = 1024;
+	settings.averageChunkSizeBytes = 4096;
+	settings.maxChunkSizeBytes = 16384;
+
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<int> distribution(0, 255);
+	UTF8String content(1024 * 1024, '\0');
+	std::generate(content.begin(), content.end(), [&]() { return static_cast<char>(distribution(generator)); });
+	const auto filePath = GetUniqueExtendedTempPath();
+	WriteFile(filePath, content);
+
+	auto adder = _uow->CreateFileAdder(_backupRunId, settings);
+	adder->Add(filePath.ToString());
+	_uow->Commit();
+	auto connection = _testBackup.ConnectToDatabase();
+	blob::BlobInfoRepository blobInfoRepository(*connection);
+	const auto blobCountBefore = blobInfoRepository.GetAllBlobs().size();
+
+	// Act
+	const auto modifiedAddress = WriteFile(filePath, content + "appended");
+	auto uow2 = _testBackup.GetBackup().CreateUnitOfWork();
+	auto adder2 = uow2->CreateFileAdder(_backupRunId, settings);
+	adder2->Add(filePath.ToString());
+	uow2->Commit();
+
+	// Assert
+	EXPECT_THAT(adder2->GetEmittedEvents(), ::testing::ElementsAre(
+		RegularFileEvent(_backupRunId, filePath, modifiedAddress, FileEventAction::ChangedModified)));
+
+	// The whole file and the last chunk
+	EXPECT_EQ(blobCountBefore + 2, blobInfoRepository.GetAllBlobs().size());
+}
+
+TEST_F(FileAdderIntegrationTest, Add_StreamingScanDetectsModifications)
+{
+	// Arrange
+	FileAdderSettings settings;
+	settings.streamingScan = true;
+	const auto path = GetUniqueExtendedTempPath().EnsureTrailingSlash();
+	const auto fooPath = (path / "Foo").EnsureTrailingSlash();
+	fs::CreateDirectories(fooPath);
+	const auto barPath = (fooPath / "Bar").EnsureTrailingSlash();
+	fs::CreateDirectories(barPath);
+	const auto samsonPath = fooPath / "samson.txt";
+	const auto sakoPath = barPath / "sako.txt";
+	WriteFile(samsonPath, "samson was here");
+	const auto sakoContentAddress = WriteFile(sakoPath, "sako was here");
+
+	// Sorts between Foo and its contents, as a space sorts before a slash
+	const auto fooSpacePath = path / "Foo bar.txt";
+	const auto fooSpaceContentAddress = WriteFile(fooSpacePath, "foo bar was here");
+
+	auto adder = _uow->CreateFileAdder(_backupRunId, settings);
+	std::vector<FileEvent> all;
+	adder->GetEventManager().Subscribe([&](const auto& fileEvent) {
+		all.push_back(fileEvent);
+	});
+	adder->Add(path.ToString());
+
+	fs::Remove(samsonPath);
+	const auto fileAddress = WriteFile(samsonPath, "samson was here with some new content");
+	fs::RemoveAll(barPath);
+	const auto fizzPath = (path / "fizz").EnsureTrailingSlash();
+	fs::CreateDirectories(fizzPath);
+	const auto beforeCount = all.size();
+
+	// Act
+	adder->Add(path.ToString());
+	const auto afterCount = all.size();
+	adder->Add(path.ToString());
+
+	// Assert
+	const std::vector<FileEvent> expectedEmittedEvents = {
+		RegularFileEvent(_backupRunId, samsonPath, fileAddress, FileEventAction::ChangedModified),
+		DirectoryEvent(_backupRunId, barPath, FileEventAction::ChangedRemoved),
+		RegularFileEvent(_backupRunId, sakoPath, sakoContentAddress, FileEventAction::ChangedRemoved),
+		DirectoryEvent(_backupRunId, fizzPath, FileEventAction::ChangedAdded),
+		RegularFileEvent(_backupRunId, fooSpacePath, fooSpaceContentAddress, FileEventAction::Unchanged)
+	};
+	EXPECT_TRUE(adder->GetEmittedEvents().empty());
+	std::vector<FileEvent> newEvents(all.begin() + beforeCount, all.begin() + afterCount);
+	EXPECT_THAT(newEvents, ::testing::UnorderedElementsAreArray(expectedEmittedEvents));
+
+	// Nothing changed the last time, so every path should have been matched with its previous event
+	const std::vector<FileEvent> expectedUnchangedEvents = {
+		RegularFileEvent(_backupRunId, samsonPath, fileAddress, FileEventAction::Unchanged),
+		RegularFileEvent(_backupRunId, fooSpacePath, fooSpaceContentAddress, FileEventAction::Unchanged)
+	};
+	std::vector<FileEvent> unchangedEvents(all.begin() + afterCount, all.end());
+	EXPECT_THAT(unchangedEvents, ::testing::UnorderedElementsAreArray(expectedUnchangedEvents));
+}
+
+TEST_F(FileAdderIntegrationTest, Add_StreamingScanMatchesLoadedScan)
+{
+	// Arrange
+	const auto path = GetUniqueExtendedTempPath().EnsureTrailingSlash();
+	for (const auto& directory : { "a", "a b", "a\\b", "a-b", "a_b", "a\\b\\c" })
+	{
+		const auto directoryPath = (path / directory).EnsureTrailingSlash();
+		fs::CreateDirectories(directoryPath);
+		WriteFile(directoryPath / "file.txt", directory);
+		WriteFile(directoryPath / "file .txt", directory);
+	}
+
+	std::vector<FileEvent> loadedEvents;
+	{
+		auto adder = _uow->CreateFileAdder(_backupRunId);
+		adder->Add(path.ToString());
+		loadedEvents = adder->GetEmittedEvents();
+	}
+
+	// Throw away the loaded scan
+	_adder.reset();
+	_finder.reset();
+	_uow.reset();
+
+	// Act
+	FileAdderSettings settings;
+	settings.streamingScan = true;
+	auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+	auto adder = uow->CreateFileAdder(_backupRunId, settings);
+	std::vector<FileEvent> streamedEvents;
+	adder->GetEventManager().Subscribe([&](const auto& fileEvent) {
+		streamedEvents.push_back(fileEvent);
+	});
+	adder->Add(path.ToString());
+
+	// Assert
+	EXPECT_THAT(streamedEvents, ::testing::UnorderedElementsAreArray(loadedEvents));
+}
+
+TEST_F(FileAdderIntegrationTest, Add_PipelinedMatchesSingleThreaded)
+{
+	// Arrange
+	FileAdderSettings settings;
+	settings.contentDefinedChunking = true;
+	settings.minChunkSizeBytes = 1024;
+	settings.averageChunkSizeBytes = 4096;
+	settings.maxChunkSizeBytes = 16384;
+	settings.pipelineDepth = 4;
+
+	const auto path = GetUniqueExtendedTempPath().EnsureTrailingSlash();
+	const auto deepDirectory = (path / "deep").EnsureTrailingSlash();
+	fs::CreateDirectories(deepDirectory);
+
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<int> distribution(0, 255);
+	std::map<fs::NativePath, UTF8String> files;
+	for (auto i = 0; i < 20; ++i)
+	{
+		// Mix of empty, single chunk and multiple chunk files, with some duplicated content
+		UTF8String content((i % 5) * 10000, '\0');
+		std::generate(content.begin(), content.end(), [&]() { return static_cast<char>(distribution(generator)); });
+		const auto filePath = (i % 2 == 0 ? path : deepDirectory) / ("file" + std::to_string(i) + ".dat");
+		WriteFile(filePath, i % 7 == 0 ? "duplicate" : content);
+		files[filePath] = i % 7 == 0 ? "duplicate" : content;
+	}
+
+	std::vector<FileEvent> singleThreadedEvents;
+	{
+		auto adder = _uow->CreateFileAdder(_backupRunId, settings);
+		adder->Add(path.ToString());
+		singleThreadedEvents = adder->GetEmittedEvents();
+	}
+
+	// Throw away the single threaded add
+	_adder.reset();
+	_finder.reset();
+	_uow.reset();
+
+	// Act
+	settings.readerThreads = 4;
+	auto uow = _testBackup.GetBackup().CreateUnitOfWork();
+	auto adder = uow->CreateFileAdder(_backupRunId, settings);
+	adder->Add(path.ToString());
+	uow->Commit();
+
+	// Assert
+	EXPECT_THAT(adder->GetEmittedEvents(), ::testing::ElementsAreArray(singleThreadedEvents));
+
+	auto uow2 = _testBackup.GetBackup().CreateUnitOfWork();
+	auto finder = uow2->CreateFileFinder();
+	for (const auto& file : files)
+	{
+		const auto fileEvent = finder->FindLastChangedEventByPath(file.first);
+		ASSERT_TRUE(fileEvent);
+		const std::vector<uint8_t> expectedContent(file.second.begin(), file.second.end());
+		EXPECT_EQ(expectedContent, uow2->GetBlob(fileEvent->contentBlobAddress.value()));
+	}
+}
+
+TEST_F(FileAdderIntegrationTest, Add_PipelinedWholeFiles)
+{
+	// Arrange
+	FileAdderSettings settings;
+	settings.contentDefinedChunking = false;
+	settings.readerThreads = 2;
+	settings.storeWriterThreads = 0;
+
+	const auto path = GetUniqueExtendedTempPath().EnsureTrailingSlash();
+	fs::CreateDirectories(path);
+	const auto filePath = path / "file.dat";
+	const auto fileAddress = WriteFile(filePath, "hello");
+	const auto duplicatePath = path / "duplicate.dat";
+	WriteFile(duplicatePath, "hello");
+	const std::vector<uint8_t> helloBytes = { 104, 101, 108, 108, 111 };
+
+	// Act
+	auto adder = _uow->CreateFileAdder(_backupRunId, settings);
+	adder->Add(path.ToString());
+	_uow->Commit();
+
+	// Assert
+	EXPECT_THAT(adder->GetEmittedEvents(), ::testing::UnorderedElementsAre(
+		DirectoryEvent(_backupRunId, path, FileEventAction::ChangedAdded),
+		RegularFileEvent(_backupRunId, filePath, fileAddress, FileEventAction::ChangedAdded),
+		RegularFileEvent(_backupRunId, duplicatePath, fileAddress, FileEventAction::ChangedAdded)));
+
+	auto uow2 = _testBackup.GetBackup().CreateUnitOfWork();
+	EXPECT_EQ(helloBytes, uow2->GetBlob(fileAddress));
+}
+
 TEST_F(FileAdderIntegrationTest, Add_HandlesChangeInType)
 {
 	// Arrange
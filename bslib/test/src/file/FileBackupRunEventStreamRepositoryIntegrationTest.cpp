@@ -70,12 +70,12 @@ TEST_F(FileBackupRunEventStreamRepositoryIntegrationTest, SearchByRun_Success)
 	repo.AddEvent(e5);
 
 	// Act
-	const auto page1 = repo.SearchByRun(FileBackupRunSearchCriteria(), 0, 2);
-	const auto page2 = repo.SearchByRun(FileBackupRunSearchCriteria(), 2, 2);
+	const auto page1 = repo.SearchByRun(FileBackupRunSearchCriteria(), PageToken(), 2);
+	const auto page2 = repo.SearchByRun(FileBackupRunSearchCriteria(), page1.nextPageToken, 2);
 
 	// Assert
-	EXPECT_THAT(page1, ::testing::ElementsAre(e5, e4, e3));
-	EXPECT_THAT(page2, ::testing::ElementsAre(e2, e1));
+	EXPECT_THAT(page1.results, ::testing::ElementsAre(e5, e4, e3));
+	EXPECT_THAT(page2.results, ::testing::ElementsAre(e2, e1));
 }
 
 TEST_F(FileBackupRunEventStreamRepositoryIntegrationTest, SearchByRun_SpecificRunSuccess)
@@ -96,10 +96,10 @@ TEST_F(FileBackupRunEventStreamRepositoryIntegrationTest, SearchByRun_SpecificRu
 	// Act
 	FileBackupRunSearchCriteria criteria;
 	criteria.runId = run1;
-	const auto page = repo.SearchByRun(criteria, 0, 1);
+	const auto page = repo.SearchByRun(criteria, PageToken(), 1);
 
 	// Assert
-	EXPECT_THAT(page, ::testing::ElementsAre(e2, e1));
+	EXPECT_THAT(page.results, ::testing::ElementsAre(e2, e1));
 }
 
 TEST_F(FileBackupRunEventStreamRepositoryIntegrationTest, GetBackupCount_Success)
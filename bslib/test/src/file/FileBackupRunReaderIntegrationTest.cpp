@@ -55,12 +55,12 @@ TEST_F(FileBackupRunReaderIntegrationTest, Search_Success)
 
 	auto reader = _uow->CreateFileBackupRunReader();
 	// Act
-	const auto page1 = reader->Search(FileBackupRunSearchCriteria(), 0, 2);
-	const auto page2 = reader->Search(FileBackupRunSearchCriteria(), 2, 2);
+	const auto page1 = reader->Search(FileBackupRunSearchCriteria(), PageToken(), 2);
+	const auto page2 = reader->Search(FileBackupRunSearchCriteria(), page1.nextPageToken, 2);
+	const auto page3 = reader->Search(FileBackupRunSearchCriteria(), page2.nextPageToken, 2);
 
 	// Assert
 	ASSERT_EQ(2, page1.backups.size());
-	EXPECT_EQ(2, page1.nextPageSkip);
 	{
 		const auto backup = std::find_if(page1.backups.begin(), page1.backups.end(), [&](const auto& x) { return x.runId == run4; });
 		ASSERT_NE(backup, page1.backups.end());
@@ -77,7 +77,6 @@ TEST_F(FileBackupRunReaderIntegrationTest, Search_Success)
 	}
 
 	ASSERT_EQ(2, page2.backups.size());
-	EXPECT_EQ(4, page2.nextPageSkip);
 	{
 		const auto backup = std::find_if(page2.backups.begin(), page2.backups.end(), [&](const auto& x) { return x.runId == run2; });
 		ASSERT_NE(backup, page2.backups.end());
@@ -94,6 +93,8 @@ TEST_F(FileBackupRunReaderIntegrationTest, Search_Success)
 		EXPECT_EQ(1, backup->modifiedFilesCount);
 		EXPECT_EQ(5, backup->totalSizeBytes);
 	}
+
+	EXPECT_TRUE(page3.backups.empty());
 }
 
 TEST_F(FileBackupRunReaderIntegrationTest, Search_IncludeRunEventsSuccess)
@@ -109,7 +110,7 @@ TEST_F(FileBackupRunReaderIntegrationTest, Search_IncludeRunEventsSuccess)
 	auto reader = _uow->CreateFileBackupRunReader();
 
 	// Act
-	const auto page1 = reader->Search(FileBackupRunSearchCriteria(), 0, 2, true);
+	const auto page1 = reader->Search(FileBackupRunSearchCriteria(), PageToken(), 2, true);
 
 	// Assert
 	ASSERT_EQ(1, page1.backups.size());
@@ -122,7 +123,7 @@ TEST_F(FileBackupRunReaderIntegrationTest, Search_EmptySuccess)
 	auto reader = _uow->CreateFileBackupRunReader();
 
 	// Act
-	const auto results = reader->Search(FileBackupRunSearchCriteria(), 0, 10);
+	const auto results = reader->Search(FileBackupRunSearchCriteria(), PageToken(), 10);
 
 	// Assert
 	EXPECT_TRUE(results.backups.empty());
@@ -197,6 +197,93 @@ TEST_F(FileEventStreamRepositoryIntegrationTest, GetLastGoodEventsUnderPath_Hand
 	EXPECT_THAT(justEvents, ::testing::UnorderedElementsAreArray(expectedEvents));
 }
 
+TEST_F(FileEventStreamRepositoryIntegrationTest, OpenLastChangedEventsUnderPath_OrderedByPathSuccess)
+{
+	// Arrange
+	const std::vector<FileEvent> events = {
+		FileEvent(_backupRunId, fs::NativePath(R"(C:\Its_\)"), FileType::Directory, boost::none, FileEventAction::ChangedAdded),
+		FileEvent(_backupRunId, fs::NativePath(R"(C:\Its_\b\)"), FileType::Directory, boost::none, FileEventAction::ChangedAdded),
+		FileEvent(_backupRunId, fs::NativePath(R"(C:\Its_\b\c.txt)"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded),
+		FileEvent(_backupRunId, fs::NativePath(R"(C:\Its_\b c.txt)"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded),
+		FileEvent(_backupRunId, fs::NativePath(R"(C:\Its_\b\c.txt)"), FileType::RegularFile, boost::none, FileEventAction::ChangedRemoved),
+		FileEvent(_backupRunId, fs::NativePath(R"(C:\Its_\b\c.txt)"), FileType::RegularFile, boost::none, FileEventAction::FailedToRead),
+		FileEvent(_backupRunId, fs::NativePath(R"(C:\Its \)"), FileType::Directory, boost::none, FileEventAction::ChangedAdded),
+		FileEvent(_backupRunId, fs::NativePath(R"(C:\Its_]\)"), FileType::Directory, boost::none, FileEventAction::ChangedAdded),
+	};
+	AddEvents(events);
+
+	// In byte-wise order, where a space sorts before a slash
+	const std::vector<FileEvent> expectedEvents = {
+		events[0],
+		events[3],
+		events[1],
+		events[4]
+	};
+
+	// Act
+	const auto cursor = _fileEventStreamRepository->OpenLastChangedEventsUnderPath(fs::NativePath(R"(C:\Its_\)"));
+
+	// Assert
+	std::vector<FileEvent> result;
+	while (auto fileEvent = cursor->Next())
+	{
+		result.push_back(*fileEvent);
+	}
+	EXPECT_THAT(result, ::testing::ElementsAreArray(expectedEvents));
+	EXPECT_FALSE(cursor->Next());
+}
+
+TEST_F(FileEventStreamRepositoryIntegrationTest, OpenLastChangedEventsUnderPath_IgnoresLaterEventsSuccess)
+{
+	// Arrange
+	const FileEvent before(_backupRunId, fs::NativePath(R"(C:\root\a.txt)"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded);
+	AddEvent(before);
+	const auto cursor = _fileEventStreamRepository->OpenLastChangedEventsUnderPath(fs::NativePath(R"(C:\root\)"));
+
+	// Act
+	AddEvent(FileEvent(_backupRunId, fs::NativePath(R"(C:\root\a.txt)"), FileType::RegularFile, boost::none, FileEventAction::ChangedRemoved));
+	AddEvent(FileEvent(_backupRunId, fs::NativePath(R"(C:\root\b.txt)"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded));
+	_fileEventStreamRepository->Flush();
+
+	// Assert
+	const auto first = cursor->Next();
+	ASSERT_TRUE(first);
+	EXPECT_EQ(before, *first);
+	EXPECT_FALSE(cursor->Next());
+}
+
+TEST_F(FileEventStreamRepositoryIntegrationTest, OpenLastChangedEventsUnderPath_BatchesIgnoreEventsAddedBetweenSuccess)
+{
+	// Arrange
+	const std::vector<FileEvent> events = {
+		FileEvent(_backupRunId, fs::NativePath(R"(C:\root\a.txt)"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded),
+		FileEvent(_backupRunId, fs::NativePath(R"(C:\root\c.txt)"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded),
+		FileEvent(_backupRunId, fs::NativePath(R"(C:\root\c.txt)"), FileType::Directory, boost::none, FileEventAction::ChangedAdded),
+		FileEvent(_backupRunId, fs::NativePath(R"(C:\root\e.txt)"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded),
+		FileEvent(_backupRunId, fs::NativePath(R"(C:\root\g.txt)"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded),
+	};
+	AddEvents(events);
+	const auto cursor = _fileEventStreamRepository->OpenLastChangedEventsUnderPath(fs::NativePath(R"(C:\root\)"), 2);
+
+	// Act
+	// Each read is followed by events for paths before, at and after the cursor's position, as a scan adds them
+	std::vector<FileEvent> result;
+	auto added = 0;
+	while (auto fileEvent = cursor->Next())
+	{
+		result.push_back(*fileEvent);
+		const auto path = fileEvent->fullPath.ToString();
+		AddEvent(FileEvent(_backupRunId, fileEvent->fullPath, fileEvent->type, boost::none, FileEventAction::ChangedRemoved));
+		AddEvent(FileEvent(_backupRunId, fs::NativePath(path + "0"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded));
+		AddEvent(FileEvent(_backupRunId, fs::NativePath(R"(C:\root\b)" + std::to_string(added++)), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded));
+		_fileEventStreamRepository->Flush();
+	}
+
+	// Assert
+	EXPECT_THAT(result, ::testing::ElementsAreArray(events));
+	EXPECT_FALSE(cursor->Next());
+}
+
 TEST_F(FileEventStreamRepositoryIntegrationTest, AddEvent_NoBlobSuccess)
 {
 	// Arrange
@@ -230,6 +317,127 @@ TEST_F(FileEventStreamRepositoryIntegrationTest, AddEvent_MissingPathThrows)
 	ASSERT_THROW(_fileEventStreamRepository->AddEvent(FileEvent(_backupRunId, fs::NativePath("/look/phil/no/hands"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded), 69), AddFileEventFailedException);
 }
 
+TEST_F(FileEventStreamRepositoryIntegrationTest, AddEvent_BatchedEventsVisibleToReads)
+{
+	// Arrange
+	_fileEventStreamRepository->SetInsertBatchSize(1000);
+	const std::vector<FileEvent> events = {
+		FileEvent(_backupRunId, fs::NativePath("/foo"), FileType::Directory, boost::none, FileEventAction::ChangedAdded),
+		FileEvent(_backupRunId, fs::NativePath("/foo/bar"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded)
+	};
+
+	// Act
+	AddEvents(events);
+
+	// Assert
+	EXPECT_EQ(events, _fileEventStreamRepository->GetAllEvents());
+	EXPECT_TRUE(_fileEventStreamRepository->FindLastChangedEvent(fs::NativePath("/foo/bar")));
+}
+
+TEST_F(FileEventStreamRepositoryIntegrationTest, Flush_WritesMultiRowBatches)
+{
+	// Arrange
+	blob::BlobInfoRepository blobRepo(*_connection);
+	const blob::BlobInfo blobInfo(blob::Address("1259225215937593795395739753973973593571"), 444UL);
+	blobRepo.AddBlob(blobInfo);
+
+	_fileEventStreamRepository->SetInsertBatchSize(1000);
+	std::vector<FileEvent> events;
+	for (auto i = 0; i < 250; ++i)
+	{
+		fs::FileMetadata metadata;
+		metadata.sizeBytes = i;
+		metadata.modifiedTime = i * 2;
+		metadata.changedTime = i * 3;
+		metadata.fileId = i * 4;
+		events.push_back(RegularFileEvent(
+			_backupRunId,
+			fs::NativePath("/file" + std::to_string(i)),
+			boost::make_optional(i % 2 == 0, blobInfo.GetAddress()),
+			i % 2 == 0 ? FileEventAction::ChangedAdded : FileEventAction::FailedToRead,
+			boost::make_optional(i % 3 == 0, metadata)));
+	}
+	AddEvents(events);
+
+	// Act
+	_fileEventStreamRepository->Flush();
+
+	// Assert
+	// A separate repository only sees events that have been written
+	FileEventStreamRepository repository(*_connection);
+	const auto result = repository.GetAllEvents();
+	EXPECT_EQ(events, result);
+	ASSERT_EQ(events.size(), result.size());
+	for (size_t i = 0; i < events.size(); ++i)
+	{
+		EXPECT_EQ(events[i].metadata.is_initialized(), result[i].metadata.is_initialized());
+		if (events[i].metadata && result[i].metadata)
+		{
+			EXPECT_EQ(events[i].metadata.value(), result[i].metadata.value());
+		}
+	}
+}
+
+TEST_F(FileEventStreamRepositoryIntegrationTest, DiscardUnflushedEvents_Success)
+{
+	// Arrange
+	_fileEventStreamRepository->SetInsertBatchSize(1000);
+	AddEvent(FileEvent(_backupRunId, fs::NativePath("/foo"), FileType::Directory, boost::none, FileEventAction::ChangedAdded));
+
+	// Act
+	_fileEventStreamRepository->DiscardUnflushedEvents();
+
+	// Assert
+	EXPECT_TRUE(_fileEventStreamRepository->GetAllEvents().empty());
+}
+
+TEST_F(FileEventStreamRepositoryIntegrationTest, Flush_MissingPathThrows)
+{
+	// Arrange
+	_fileEventStreamRepository->SetInsertBatchSize(1000);
+	_fileEventStreamRepository->AddEvent(FileEvent(_backupRunId, fs::NativePath("/look/phil/no/hands"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded), 69);
+
+	// Act
+	// Assert
+	ASSERT_THROW(_fileEventStreamRepository->Flush(), AddFileEventFailedException);
+}
+
+TEST_F(FileEventStreamRepositoryIntegrationTest, SetInsertBatchSize_LeavesBufferedEventsToFlush)
+{
+	// Arrange
+	_fileEventStreamRepository->SetInsertBatchSize(1000);
+	_fileEventStreamRepository->AddEvent(FileEvent(_backupRunId, fs::NativePath("/look/phil/no/hands"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded), 69);
+
+	// Act
+	_fileEventStreamRepository->SetInsertBatchSize(1);
+
+	// Assert
+	EXPECT_EQ(1U, _fileEventStreamRepository->GetInsertBatchSize());
+	ASSERT_THROW(_fileEventStreamRepository->Flush(), AddFileEventFailedException);
+}
+
+TEST_F(FileEventStreamRepositoryIntegrationTest, RebuildPathState_RestoresLastChangedEvents)
+{
+	// Arrange
+	const FileEvent expectedEvent(_backupRunId, fs::NativePath("/foo"), FileType::RegularFile, boost::none, FileEventAction::ChangedModified);
+	AddEvents({
+		FileEvent(_backupRunId, fs::NativePath("/foo"), FileType::RegularFile, boost::none, FileEventAction::ChangedAdded),
+		expectedEvent,
+		FileEvent(_backupRunId, fs::NativePath("/bar"), FileType::RegularFile, boost::none, FileEventAction::FailedToRead)
+	});
+	sqlitepp::exec_or_throw(*_connection, "DELETE FROM PathState");
+
+	// Act
+	const auto pathCount = _fileEventStreamRepository->RebuildPathState();
+
+	// Assert
+	EXPECT_EQ(2, pathCount);
+	const auto found = _fileEventStreamRepository->FindLastChangedEvent(fs::NativePath("/foo"));
+	ASSERT_TRUE(found);
+	EXPECT_EQ(expectedEvent, found.value());
+	EXPECT_FALSE(_fileEventStreamRepository->FindLastChangedEvent(fs::NativePath("/bar")));
+}
+
 TEST_F(FileEventStreamRepositoryIntegrationTest, GetStatisticsByRunId_Success)
 {
 	// Arrange
@@ -310,12 +518,15 @@ TEST_F(FileEventStreamRepositoryIntegrationTest, Search_Success)
 
 	// Act
 	FileEventSearchCriteria criteria;
-	const auto page1 = _fileEventStreamRepository->Search(criteria, 0, 4);
-	const auto page2 = _fileEventStreamRepository->Search(criteria, 4, 4);
+	const auto page1 = _fileEventStreamRepository->Search(criteria, PageToken(), 4);
+	const auto page2 = _fileEventStreamRepository->Search(criteria, page1.nextPageToken, 4);
+	const auto page3 = _fileEventStreamRepository->Search(criteria, page2.nextPageToken, 4);
 
 	// Assert
-	EXPECT_THAT(page1, ::testing::ElementsAre(expectedEvents[0], expectedEvents[1], expectedEvents[2], expectedEvents[3]));
-	EXPECT_THAT(page2, ::testing::ElementsAre(expectedEvents[4], expectedEvents[5]));
+	EXPECT_THAT(page1.results, ::testing::ElementsAre(expectedEvents[0], expectedEvents[1], expectedEvents[2], expectedEvents[3]));
+	EXPECT_THAT(page2.results, ::testing::ElementsAre(expectedEvents[4], expectedEvents[5]));
+	EXPECT_TRUE(page3.results.empty());
+	EXPECT_EQ(page2.nextPageToken.ToString(), page3.nextPageToken.ToString());
 }
 
 TEST_F(FileEventStreamRepositoryIntegrationTest, Search_ByActionSuccess)
@@ -345,15 +556,15 @@ TEST_F(FileEventStreamRepositoryIntegrationTest, Search_ByActionSuccess)
 	// Act
 	FileEventSearchCriteria criteria;
 	criteria.actions = std::set<FileEventAction>{ FileEventAction::ChangedAdded, FileEventAction::ChangedModified };
-	const auto page1 = _fileEventStreamRepository->Search(criteria, 0, 2);
-	const auto page2 = _fileEventStreamRepository->Search(criteria, 2, 2);
+	const auto page1 = _fileEventStreamRepository->Search(criteria, PageToken(), 2);
+	const auto page2 = _fileEventStreamRepository->Search(criteria, page1.nextPageToken, 2);
 
 	const auto matching = _fileEventStreamRepository->CountMatching(criteria);
 	EXPECT_THAT(4, matching);
 
 	// Assert
-	EXPECT_THAT(page1, ::testing::ElementsAre(expectedEvents[0], expectedEvents[1]));
-	EXPECT_THAT(page2, ::testing::ElementsAre(expectedEvents[2], expectedEvents[3]));
+	EXPECT_THAT(page1.results, ::testing::ElementsAre(expectedEvents[0], expectedEvents[1]));
+	EXPECT_THAT(page2.results, ::testing::ElementsAre(expectedEvents[2], expectedEvents[3]));
 }
 
 TEST_F(FileEventStreamRepositoryIntegrationTest, Search_ByDateSuccess)
@@ -386,15 +597,15 @@ TEST_F(FileEventStreamRepositoryIntegrationTest, Search_ByDateSuccess)
 	FileEventSearchCriteria criteria;
 	criteria.before = start + boost::posix_time::minutes(1);
 	criteria.actions = std::set<FileEventAction>{ FileEventAction::ChangedAdded, FileEventAction::ChangedModified };
-	const auto page1 = _fileEventStreamRepository->Search(criteria, 0, 2);
-	const auto page2 = _fileEventStreamRepository->Search(criteria, 2, 2);
+	const auto page1 = _fileEventStreamRepository->Search(criteria, PageToken(), 2);
+	const auto page2 = _fileEventStreamRepository->Search(criteria, page1.nextPageToken, 2);
 
 	const auto matching = _fileEventStreamRepository->CountMatching(criteria);
 	EXPECT_THAT(3, matching);
 
 	// Assert
-	EXPECT_THAT(page1, ::testing::ElementsAre(expectedEvents[0], expectedEvents[1]));
-	EXPECT_THAT(page2, ::testing::ElementsAre(expectedEvents[2]));
+	EXPECT_THAT(page1.results, ::testing::ElementsAre(expectedEvents[0], expectedEvents[1]));
+	EXPECT_THAT(page2.results, ::testing::ElementsAre(expectedEvents[2]));
 }
 
 TEST_F(FileEventStreamRepositoryIntegrationTest, Search_ByRunIdSuccess)
@@ -425,13 +636,13 @@ TEST_F(FileEventStreamRepositoryIntegrationTest, Search_ByRunIdSuccess)
 	FileEventSearchCriteria criteria;
 	criteria.actions = std::set<FileEventAction>{ FileEventAction::ChangedRemoved};
 	criteria.runId = run1;
-	const auto page1 = _fileEventStreamRepository->Search(criteria, 0, 4);
+	const auto page1 = _fileEventStreamRepository->Search(criteria, PageToken(), 4);
 
 	const auto matching = _fileEventStreamRepository->CountMatching(criteria);
 	EXPECT_THAT(1, matching);
 
 	// Assert
-	EXPECT_THAT(page1, ::testing::ElementsAre(expectedEvents[4]));
+	EXPECT_THAT(page1.results, ::testing::ElementsAre(expectedEvents[4]));
 }
 
 TEST_F(FileEventStreamRepositoryIntegrationTest, Search_ByParentPathIdSuccess)
@@ -470,13 +681,13 @@ TEST_F(FileEventStreamRepositoryIntegrationTest, Search_ByParentPathIdSuccess)
 	eventCriteria.runId = run1;
 	FilePathSearchCriteria pathCriteria;
 	pathCriteria.parentPathId = rootPathId;
-	const auto page1 = _fileEventStreamRepository->Search(pathCriteria, eventCriteria, 0, 4);
+	const auto page1 = _fileEventStreamRepository->Search(pathCriteria, eventCriteria, PageToken(), 4);
 
 	const auto matching = _fileEventStreamRepository->CountMatching(pathCriteria, eventCriteria);
 	EXPECT_THAT(2, matching);
 
 	// Assert
-	EXPECT_THAT(page1, ::testing::ElementsAre(expectedEvents[1], expectedEvents[5]));
+	EXPECT_THAT(page1.results, ::testing::ElementsAre(expectedEvents[1], expectedEvents[5]));
 }
 
 TEST_F(FileEventStreamRepositoryIntegrationTest, SearchPathFirst_Success)
@@ -508,7 +719,7 @@ TEST_F(FileEventStreamRepositoryIntegrationTest, SearchPathFirst_Success)
 	FilePathSearchCriteria pathCriteria;
 	FileEventSearchCriteria eventCriteria;
 	eventCriteria.actions = { FileEventAction::ChangedRemoved, FileEventAction::ChangedModified, FileEventAction::ChangedAdded };
-	const auto page1 = _fileEventStreamRepository->SearchPathFirst(pathCriteria, eventCriteria, 0, 100);
+	const auto page1 = _fileEventStreamRepository->SearchPathFirst(pathCriteria, eventCriteria, PageToken(), 100).results;
 
 	const auto matching = _fileEventStreamRepository->CountMatching(pathCriteria);
 	EXPECT_EQ(10, matching);
@@ -580,7 +791,7 @@ TEST_F(FileEventStreamRepositoryIntegrationTest, SearchPathFirst_RootsSuccess)
 	pathCriteria.rootPath = true;
 	FileEventSearchCriteria eventCriteria;
 	eventCriteria.actions = { FileEventAction::ChangedModified, FileEventAction::ChangedAdded };
-	const auto page1 = _fileEventStreamRepository->SearchPathFirst(pathCriteria, eventCriteria, 0, 100);
+	const auto page1 = _fileEventStreamRepository->SearchPathFirst(pathCriteria, eventCriteria, PageToken(), 100).results;
 
 	const auto matching = _fileEventStreamRepository->CountMatching(pathCriteria);
 	EXPECT_EQ(3, matching);
@@ -615,6 +826,32 @@ TEST_F(FileEventStreamRepositoryIntegrationTest, SearchPathFirst_RootsSuccess)
 	}
 }
 
+TEST_F(FileEventStreamRepositoryIntegrationTest, SearchPathFirst_PagesSuccess)
+{
+	// Arrange
+	const auto runId = Uuid::Create();
+	AddEvents({
+		FileEvent(runId, fs::NativePath(R"(C:\)"), FileType::Directory, boost::none, FileEventAction::ChangedAdded),
+		FileEvent(runId, fs::NativePath(R"(D:\)"), FileType::Directory, boost::none, FileEventAction::ChangedAdded),
+		FileEvent(runId, fs::NativePath(R"(E:\)"), FileType::Directory, boost::none, FileEventAction::ChangedAdded),
+	});
+	FilePathSearchCriteria pathCriteria;
+	pathCriteria.rootPath = true;
+	FileEventSearchCriteria eventCriteria;
+	eventCriteria.actions = { FileEventAction::ChangedAdded };
+
+	// Act
+	const auto page1 = _fileEventStreamRepository->SearchPathFirst(pathCriteria, eventCriteria, PageToken(), 2);
+	const auto page2 = _fileEventStreamRepository->SearchPathFirst(pathCriteria, eventCriteria, page1.nextPageToken, 2);
+
+	// Assert
+	ASSERT_EQ(2, page1.results.size());
+	EXPECT_EQ(fs::NativePath(R"(E:\)"), page1.results[0].fullPath);
+	EXPECT_EQ(fs::NativePath(R"(D:\)"), page1.results[1].fullPath);
+	ASSERT_EQ(1, page2.results.size());
+	EXPECT_EQ(fs::NativePath(R"(C:\)"), page2.results[0].fullPath);
+}
+
 TEST_F(FileEventStreamRepositoryIntegrationTest, CountNestedMatches_Success)
 {
 	// Arrange
@@ -693,6 +930,50 @@ TEST_F(FileEventStreamRepositoryIntegrationTest, CountNestedMatches_Success)
 	}
 }
 
+TEST_F(FileEventStreamRepositoryIntegrationTest, SearchPathFirst_FindsVersionAtTime)
+{
+	// Arrange
+	const boost::posix_time::ptime start(boost::gregorian::date(2001, boost::date_time::Sep, 11), boost::posix_time::time_duration(10, 30, 0));
+	const fs::NativePath filePath(R"(C:\dir\file)");
+	const std::vector<FileEvent> events = {
+		FileEvent(Uuid::Create(), filePath, FileType::RegularFile, boost::none, FileEventAction::ChangedAdded, start),
+		FileEvent(Uuid::Create(), filePath, FileType::RegularFile, boost::none, FileEventAction::ChangedModified, start + boost::posix_time::hours(1)),
+		FileEvent(Uuid::Create(), filePath, FileType::RegularFile, boost::none, FileEventAction::FailedToRead, start + boost::posix_time::hours(2)),
+		FileEvent(Uuid::Create(), filePath, FileType::RegularFile, boost::none, FileEventAction::ChangedRemoved, start + boost::posix_time::hours(3)),
+	};
+	AddEvents(events);
+	const auto dirPathId = _filePathRepository->FindPath(fs::NativePath(R"(C:\dir\)"), FileType::Directory);
+	ASSERT_TRUE(dirPathId);
+
+	FilePathSearchCriteria pathCriteria;
+	pathCriteria.parentPathId = dirPathId.value();
+	const auto searchAt = [&](const boost::posix_time::ptime& atUtc) {
+		FileEventSearchCriteria eventCriteria;
+		eventCriteria.actions = { FileEventAction::ChangedAdded, FileEventAction::ChangedModified, FileEventAction::ChangedRemoved, FileEventAction::Unchanged };
+		eventCriteria.before = atUtc;
+		const auto matches = _fileEventStreamRepository->SearchPathFirst(pathCriteria, eventCriteria, PageToken(), 100).results;
+		const auto count = _fileEventStreamRepository->CountNestedMatches(eventCriteria, { dirPathId.value() }).at(dirPathId.value());
+		EXPECT_EQ(1, matches.size());
+		EXPECT_EQ(matches.front().latestEvent ? 1 : 0, count);
+		return matches.front().latestEvent;
+	};
+
+	// Act
+	const auto beforeAdded = searchAt(start - boost::posix_time::seconds(1));
+	const auto added = searchAt(start);
+	const auto modified = searchAt(start + boost::posix_time::hours(2) + boost::posix_time::minutes(30));
+	const auto removed = searchAt(start + boost::posix_time::hours(4));
+
+	// Assert
+	EXPECT_FALSE(beforeAdded);
+	ASSERT_TRUE(added);
+	EXPECT_EQ(events[0], added.value());
+	ASSERT_TRUE(modified);
+	EXPECT_EQ(events[1], modified.value());
+	ASSERT_TRUE(removed);
+	EXPECT_EQ(events[3], removed.value());
+}
+
 }
 }
 }
@@ -11,7 +11,9 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <algorithm>
 #include <memory>
+#include <random>
 
 namespace af {
 namespace bslib {
@@ -97,6 +99,36 @@ TEST_F(FileRestorerIntegrationTest, Restore_FileToFilePath)
 	EXPECT_THAT(_sampleFilePath, HasSameFileContents(fileRestorePath));
 }
 
+TEST_F(FileRestorerIntegrationTest, Restore_ChunkedFile)
+{
+	// Arrange
+	FileAdderSettings settings;
+	settings.contentDefinedChunking = true;
+	settings.minChunkSizeBytes = 1024;
+	settings.averageChunkSizeBytes = 4096;
+	settings.maxChunkSizeBytes = 16384;
+	auto adder = _uow->CreateFileAdder(_backupRunId, settings);
+
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<int> distribution(0, 255);
+	UTF8String content(256 * 1024, '\0');
+	std::generate(content.begin(), content.end(), [&]() { return static_cast<char>(distribution(generator)); });
+	const auto filePath = _sampleBasePath / "chunked.dat";
+	const auto fileAddress = WriteFile(filePath, content);
+	adder->Add(filePath.ToString());
+
+	const auto fileRestorePath = _restorePath / filePath.GetFilename();
+
+	// Act
+	const auto lastEvent = _finder->GetLastEventByPath(filePath);
+	_restorer->Restore(lastEvent, fileRestorePath.ToString());
+
+	// Assert
+	EXPECT_EQ(fileAddress, lastEvent.contentBlobAddress.value());
+	EXPECT_THAT(filePath, HasSameFileContents(fileRestorePath));
+	EXPECT_EQ(std::vector<uint8_t>(content.begin(), content.end()), _uow->GetBlob(fileAddress));
+}
+
 TEST_F(FileRestorerIntegrationTest, Restore_IgnoresUnsupportedEvents)
 {
 	// Arrange
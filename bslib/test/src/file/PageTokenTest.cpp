@@ -0,0 +1,49 @@
+#include "bslib/file/exceptions.hpp"
+#include "bslib/file/PageToken.hpp"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace af {
+namespace bslib {
+namespace file {
+namespace test {
+
+TEST(PageTokenTest, ToString_RoundTrips)
+{
+	// Arrange
+	const PageToken token(1234567);
+
+	// Act
+	const auto parsed = PageToken::FromString(token.ToString());
+
+	// Assert
+	ASSERT_TRUE(parsed.GetLastKey());
+	EXPECT_EQ(1234567, parsed.GetLastKey().value());
+}
+
+TEST(PageTokenTest, FromString_EmptyIsFirstPage)
+{
+	// Arrange
+	// Act
+	const auto token = PageToken::FromString("");
+
+	// Assert
+	EXPECT_FALSE(token.GetLastKey());
+	EXPECT_EQ("", PageToken().ToString());
+}
+
+TEST(PageTokenTest, FromString_InvalidThrows)
+{
+	// Arrange
+	// Act
+	// Assert
+	EXPECT_THROW(PageToken::FromString("12"), InvalidPageTokenException);
+	EXPECT_THROW(PageToken::FromString("000000000000000g"), InvalidPageTokenException);
+	EXPECT_THROW(PageToken::FromString("-000000000000001"), InvalidPageTokenException);
+}
+
+}
+}
+}
+}
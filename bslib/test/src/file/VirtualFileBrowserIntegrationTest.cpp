@@ -104,7 +104,7 @@ TEST_F(VirtualFileBrowserIntegrationTest, ListRoots_Success)
 	const auto uow = _testBackup.GetBackup().CreateUnitOfWork();
 	const auto browser = uow->CreateVirtualFileBrowser();
 	// Act
-	const auto roots = browser->ListRoots(0, 100);
+	const auto roots = browser->ListRoots(PageToken(), 100).results;
 	// Assert
 	ASSERT_EQ(2, roots.size());
 	{
@@ -129,7 +129,7 @@ TEST_F(VirtualFileBrowserIntegrationTest, ListRoots_AtDateSuccess)
 	const auto uow = _testBackup.GetBackup().CreateUnitOfWork();
 	const auto browser = uow->CreateVirtualFileBrowser(START + boost::posix_time::hours(3));
 	// Act
-	const auto roots = browser->ListRoots(0, 100);
+	const auto roots = browser->ListRoots(PageToken(), 100).results;
 	// Assert
 	ASSERT_EQ(2, roots.size());
 	{
@@ -155,7 +155,7 @@ TEST_F(VirtualFileBrowserIntegrationTest, ListContents_Success)
 	const auto pathId = _filePathRepository->FindPath(fs::NativePath(R"(C:\Users\zsims\)"), FileType::Directory);
 	ASSERT_TRUE(pathId);
 	// Act
-	const auto contents = browser->ListContents(pathId.value(), 0, 100);
+	const auto contents = browser->ListContents(pathId.value(), PageToken(), 100).results;
 
 	// Assert
 	ASSERT_EQ(4, contents.size());
@@ -201,7 +201,7 @@ TEST_F(VirtualFileBrowserIntegrationTest, ListContents_AtDateSuccess)
 	const auto pathId = _filePathRepository->FindPath(fs::NativePath(R"(C:\Users\zsims\)"), FileType::Directory);
 	ASSERT_TRUE(pathId);
 	// Act
-	const auto contents = browser->ListContents(pathId.value(), 0, 100);
+	const auto contents = browser->ListContents(pathId.value(), PageToken(), 100).results;
 
 	// Assert
 	ASSERT_EQ(4, contents.size());
@@ -246,7 +246,7 @@ TEST_F(VirtualFileBrowserIntegrationTest, ListContents_ChangedTypesSuccess)
 	const auto pathId = _filePathRepository->FindPath(fs::NativePath(R"(C:\wtf\)"), FileType::Directory);
 	ASSERT_TRUE(pathId);
 	// Act
-	const auto contents = browser->ListContents(pathId.value(), 0, 100);
+	const auto contents = browser->ListContents(pathId.value(), PageToken(), 100).results;
 	// Assert
 	ASSERT_EQ(2, contents.size());
 	{
@@ -215,6 +215,43 @@ TEST(WindowsPathIntegrationTest, GetIntermediatePaths_EmptySuccess)
 	));
 }
 
+TEST(WindowsPathIntegrationTest, GetSegmentEnd_MatchesIntermediatePaths)
+{
+	// Arrange
+	const WindowsPath input(R"(C:\something\\empty\\\parts)");
+	const auto intermediatePaths = input.GetIntermediatePaths();
+
+	// Act
+	std::vector<std::size_t> segmentEnds;
+	for (std::size_t offset = 0; offset < input.ToString().length(); offset = segmentEnds.back())
+	{
+		segmentEnds.push_back(input.GetSegmentEnd(offset));
+	}
+
+	// Assert
+	ASSERT_EQ(intermediatePaths.size(), segmentEnds.size());
+	for (auto i = 0U; i < segmentEnds.size(); ++i)
+	{
+		EXPECT_EQ(intermediatePaths[i].ToString(), input.ToString().substr(0, segmentEnds[i]));
+	}
+	EXPECT_EQ(segmentEnds[segmentEnds.size() - 2], input.GetLastSegmentOffset());
+}
+
+TEST(WindowsPathIntegrationTest, GetLastSegmentOffset_Success)
+{
+	// Arrange
+	const WindowsPath directory(R"(C:\something\dir\)");
+	const WindowsPath root(R"(C:\)");
+
+	// Act
+	const auto directoryOffset = directory.GetLastSegmentOffset();
+	const auto rootOffset = root.GetLastSegmentOffset();
+
+	// Assert
+	EXPECT_EQ(R"(dir\)", directory.ToString().substr(directoryOffset));
+	EXPECT_EQ(0U, rootOffset);
+}
+
 TEST(WindowsPathIntegrationTest, AppendSegment_Success)
 {
 	// Arrange
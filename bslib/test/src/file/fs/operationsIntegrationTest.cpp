@@ -197,6 +197,93 @@ TEST_F(operationsIntegrationTest, GetAbsolutePath_RootSuccess)
 	EXPECT_EQ(root, actual);
 }
 
+TEST_F(operationsIntegrationTest, GetFileMetadata_Success)
+{
+	// Arrange
+	const auto first = GetUniqueExtendedTempPath();
+	WriteFile(first, "hello");
+
+	// Act
+	const auto metadata = GetFileMetadata(first);
+
+	// Assert
+	EXPECT_EQ(5U, metadata.sizeBytes);
+	EXPECT_NE(0, metadata.modifiedTime);
+	EXPECT_NE(0U, metadata.fileId);
+}
+
+TEST_F(operationsIntegrationTest, GetFileMetadata_ChangesWithContent)
+{
+	// Arrange
+	const auto first = GetUniqueExtendedTempPath();
+	WriteFile(first, "hello");
+	const auto before = GetFileMetadata(first);
+
+	// Act
+	WriteFile(first, "hello again");
+	const auto after = GetFileMetadata(first);
+
+	// Assert
+	EXPECT_NE(before, after);
+	EXPECT_EQ(before.fileId, after.fileId);
+}
+
+TEST_F(operationsIntegrationTest, GetFileMetadata_FailsIfNotExists)
+{
+	// Arrange
+	const auto first = GetUniqueExtendedTempPath();
+	boost::system::error_code ec;
+
+	// Act
+	GetFileMetadata(first, ec);
+
+	// Assert
+	EXPECT_TRUE(ec);
+}
+
+TEST_F(operationsIntegrationTest, GetFileStatus_RegularFileSuccess)
+{
+	// Arrange
+	const auto first = GetUniqueExtendedTempPath();
+	WriteFile(first, "hello");
+
+	// Act
+	const auto status = GetFileStatus(first);
+
+	// Assert
+	EXPECT_EQ(PathType::RegularFile, status.type);
+	ASSERT_TRUE(status.metadata);
+	EXPECT_EQ(GetFileMetadata(first), status.metadata.value());
+}
+
+TEST_F(operationsIntegrationTest, GetFileStatus_DirectorySuccess)
+{
+	// Arrange
+	const auto first = GetUniqueExtendedTempPath();
+	CreateDirectories(first);
+
+	// Act
+	const auto status = GetFileStatus(first);
+
+	// Assert
+	EXPECT_EQ(PathType::Directory, status.type);
+}
+
+TEST_F(operationsIntegrationTest, GetFileStatus_NotFoundIfNotExists)
+{
+	// Arrange
+	const auto first = GetUniqueExtendedTempPath();
+	boost::system::error_code ec;
+
+	// Act
+	const auto status = GetFileStatus(first, ec);
+
+	// Assert
+	EXPECT_FALSE(ec);
+	EXPECT_EQ(PathType::NotFound, status.type);
+	EXPECT_FALSE(status.metadata);
+}
+
 TEST_F(operationsIntegrationTest, OpenFileRead_Success)
 {
 	// Arrange
@@ -57,5 +57,15 @@ bslib::blob::Address TestBase::WriteFile(const bslib::file::fs::NativePath& path
 	return bslib::blob::Address::CalculateFromContent(binaryContent);
 }
 
+std::vector<uint8_t> TestBase::MakeContent(unsigned seed, size_t sizeBytes) const
+{
+	std::vector<uint8_t> content(sizeBytes);
+	for (size_t i = 0; i < content.size(); ++i)
+	{
+		content[i] = static_cast<uint8_t>(seed * 31 + i);
+	}
+	return content;
+}
+
 }
 }
@@ -36,6 +36,11 @@ protected:
 	 */
 	bslib::blob::Address WriteFile(const boost::filesystem::path& path, const bslib::UTF8String& content = "");
 	bslib::blob::Address WriteFile(const bslib::file::fs::NativePath& path, const bslib::UTF8String& content = "");
+
+	/**
+	 * Makes blob content that differs for each seed, the same every time for a seed
+	 */
+	std::vector<uint8_t> MakeContent(unsigned seed, size_t sizeBytes = 100) const;
 private:
 	const boost::filesystem::path _testTemporaryPath;
 protected:
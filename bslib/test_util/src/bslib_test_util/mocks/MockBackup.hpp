@@ -20,6 +20,7 @@ public:
 	virtual ~MockBackup() { }
 
 	MOCK_METHOD0(CreateUnitOfWork, std::unique_ptr<bslib::UnitOfWork>());
+	MOCK_METHOD0(CreateReadOnlyUnitOfWork, std::unique_ptr<bslib::UnitOfWork>());
 	MOCK_METHOD0(Open, void());
 	MOCK_METHOD0(Create, void());
 	MOCK_METHOD0(OpenOrCreate, void());
@@ -14,12 +14,17 @@ public:
 	virtual ~MockUnitOfWork() { }
 	MOCK_METHOD0(Commit, void());
 	MOCK_METHOD1(CreateVirtualFileBrowser, std::unique_ptr<bslib::file::VirtualFileBrowser>(const boost::optional<boost::posix_time::ptime>& atUtc));
-	MOCK_METHOD1(CreateFileAdder, std::unique_ptr<bslib::file::FileAdder>(const bslib::Uuid&));
+	MOCK_METHOD2(CreateFileAdder, std::unique_ptr<bslib::file::FileAdder>(const bslib::Uuid&, const bslib::file::FileAdderSettings&));
 	MOCK_METHOD0(CreateFileRestorer, std::unique_ptr<bslib::file::FileRestorer>());
 	MOCK_METHOD0(CreateFileFinder, std::unique_ptr<bslib::file::FileFinder>());
 	MOCK_METHOD0(CreateFileBackupRunReader, std::unique_ptr<bslib::file::FileBackupRunReader>());
 	MOCK_METHOD0(CreateFileBackupRunRecorder, std::unique_ptr<bslib::file::FileBackupRunRecorder>());
 	MOCK_CONST_METHOD1(GetBlob, std::vector<uint8_t>(const bslib::blob::Address& address));
+	MOCK_CONST_METHOD2(ReadBlob, void(const bslib::blob::Address& address, const std::function<void(const bslib::blob::BlobView& part)>& visit));
+	MOCK_METHOD1(CopyMissingBlobs, uint64_t(const bslib::Uuid& storeId));
+	MOCK_METHOD1(CollectGarbage, bslib::blob::GarbageCollectionResult(const bslib::blob::GarbageCollectionSettings& settings));
+	MOCK_METHOD1(ScrubBlobs, bslib::blob::ScrubResult(const bslib::blob::ScrubSettings& settings));
+	MOCK_METHOD0(RebuildPathState, uint64_t());
 };
 
 }